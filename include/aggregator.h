@@ -0,0 +1,92 @@
+#ifndef AGGREGATOR_H
+#define AGGREGATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include "mesh_packet.h"
+#include "wire_format.h"
+
+/* BATCH FRAME (SEVERAL WIRE FRAMES TO ONE NEXT HOP) */
+//  0      AGG_FRAME_MAGIC, never a valid wire_format version or DV_FRAME_MAGIC
+//  1      frame count
+//  2..    count times: length(1), then a complete version 2 frame of that length
+#define AGG_FRAME_MAGIC 0xB7
+#define AGG_HEADER_SIZE 2
+#define AGG_ENTRY_OVERHEAD 1 // Length byte in front of every frame
+#define AGG_MIN_ENTRY (AGG_ENTRY_OVERHEAD + WIRE_HEADER_SIZE) // Smallest frame that can join a batch
+
+#define AGG_QUEUES 4 // Next hops with frames waiting at the same time
+#define AGG_DELAY_MS 0 // Extra wait for others to the same next hop, 0 -> until the end of the next Poll()
+
+// Frames waiting for one next hop, already laid out as a batch
+typedef struct agg_queue {
+  uint8_t mac[MAC_SIZE];
+  uint8_t frame[WIRE_MAX_FRAME];
+  uint8_t len; // Bytes used in frame, header included
+  uint8_t count; // Frames in it
+  uint8_t priority; // Most urgent (lowest) priority of its frames, the batch goes out with it
+  uint32_t due; // millis() when the first frame has waited long enough
+  bool used;
+} agg_queue_t;
+
+typedef struct agg_stats {
+  uint32_t frames_in; // Frames handed to Add()
+  uint32_t frames_out; // Radio frames sent, batches and frames that went alone
+  uint32_t batches; // ... of them carrying more than one frame
+  uint32_t bytes_in;
+  uint32_t bytes_out;
+  uint32_t full; // Sent before the delay because the next frame did not fit
+  uint32_t send_errors; // Rejected on the way to the radio, every frame in them is lost
+} agg_stats_t;
+
+/* MESSAGE AGGREGATION */
+// Unicasts to the same next hop are held and packed into one batch frame, so a burst of
+// small packets pays the ESP-NOW/802.11 overhead and the channel access once. With no
+// delay a queue only collects what is sent until the end of the next Poll() (the relays
+// of a full RX queue, acks, retransmissions), so it adds no more than one loop() of
+// latency; a delay trades more latency for fuller batches. A queue also goes out early
+// when the next frame would not fit or its slot is needed for another next hop. A queue
+// holding a single frame sends it as it is, so an idle link sees exactly the frames it
+// saw before. The receiver splits a batch with Unpack() and handles every frame in it
+// as if it had arrived alone.
+class FrameAggregator {
+public:
+  // Hands a frame on to be sent
+  typedef bool (*SendFn)(void *ctx, const uint8_t *mac, const uint8_t *frame, size_t len, uint8_t priority);
+  // Same shape as Radio::ReceiveFn, called once per frame in a batch
+  typedef void (*ReceiveFn)(void *ctx, const uint8_t *mac, const uint8_t *data, int len, int rssi);
+
+  FrameAggregator(SendFn send, void *ctx);
+
+  // Off -> every frame goes to the radio as soon as it is added
+  void Configure(bool enabled, uint32_t delay_ms);
+  bool Enabled() const { return enabled; }
+  // Queue frame to mac. False if something sent on during the call was rejected
+  bool Add(const uint8_t *mac, const uint8_t *frame, size_t len, uint8_t priority, uint32_t now);
+  // Send queues whose delay ended
+  void Poll(uint32_t now);
+  // Send every queue now
+  void Flush();
+
+  static bool IsBatch(const uint8_t *data, int len) { return data != NULL && len >= AGG_HEADER_SIZE && data[0] == AGG_FRAME_MAGIC; }
+  // Check the whole batch, then pass each frame in it to receive. False (and nothing passed) if malformed
+  static bool Unpack(const uint8_t *mac, const uint8_t *data, int len, int rssi, ReceiveFn receive, void *ctx);
+
+  size_t Pending() const;
+  const agg_stats_t &Stats() const { return stats; }
+
+private:
+  agg_queue_t *Find(const uint8_t *mac);
+  agg_queue_t *Open(const uint8_t *mac, uint32_t now, bool *ok);
+  bool Send(agg_queue_t *queue);
+  bool SendFrame(const uint8_t *mac, const uint8_t *frame, size_t len, uint8_t priority);
+
+  SendFn send;
+  void *ctx;
+  bool enabled;
+  uint32_t delay;
+  agg_queue_t queues[AGG_QUEUES];
+  agg_stats_t stats;
+};
+
+#endif
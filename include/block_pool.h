@@ -0,0 +1,98 @@
+#ifndef BLOCK_POOL_H
+#define BLOCK_POOL_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+typedef struct pool_stats {
+  uint32_t allocs;
+  uint32_t failures; // Alloc() found every block in use
+  uint16_t in_use;
+  uint16_t high_water; // Most blocks in use at once
+} pool_stats_t;
+
+/* FIXED-BLOCK POOL */
+// N preallocated blocks of T on a free list: Alloc() and Free() are O(1) and never
+// touch the heap, so whatever is sized here at compile time is all the node will ever
+// use. The free list is a lock-free stack whose head carries a tag against ABA, which
+// makes both calls safe from any task and from an ISR, in any mix. Blocks come back
+// as they were freed, the caller initialises them.
+template <typename T, size_t N>
+class BlockPool {
+  static_assert(N >= 1 && N < 0xFFFF, "Block indices are kept in 16 bits");
+
+public:
+  BlockPool() : head(Pack(0, 0)), allocs(0), failures(0), in_use(0), high_water(0) {
+    for(size_t i = 0; i < N; i++) {
+      next[i].store((uint16_t)(i + 1), std::memory_order_relaxed);
+    }
+  }
+
+  // Free block, NULL (and counts a failure) when all are in use
+  T *Alloc() {
+    uint32_t old = head.load(std::memory_order_acquire);
+    uint16_t index;
+    for(;;) {
+      index = (uint16_t)(old & 0xFFFF);
+      if(index >= N) {
+        failures.fetch_add(1, std::memory_order_relaxed);
+        return NULL;
+      }
+      // A stale next[] is harmless: the tag changed and the exchange fails
+      uint32_t desired = Pack(next[index].load(std::memory_order_relaxed), Tag(old) + 1);
+      if(head.compare_exchange_weak(old, desired, std::memory_order_acquire, std::memory_order_acquire)) {
+        break;
+      }
+    }
+
+    allocs.fetch_add(1, std::memory_order_relaxed);
+    uint16_t used = in_use.fetch_add(1, std::memory_order_relaxed) + 1;
+    uint16_t peak = high_water.load(std::memory_order_relaxed);
+    while(used > peak && !high_water.compare_exchange_weak(peak, used, std::memory_order_relaxed)) {
+    }
+    return &blocks[index];
+  }
+
+  // Hand a block from Alloc() back. NULL is ignored
+  void Free(T *block) {
+    if(block == NULL) {
+      return;
+    }
+    uint16_t index = (uint16_t)(block - blocks);
+    uint32_t old = head.load(std::memory_order_relaxed);
+    uint32_t desired;
+    do {
+      next[index].store((uint16_t)(old & 0xFFFF), std::memory_order_relaxed);
+      desired = Pack(index, Tag(old) + 1);
+    } while(!head.compare_exchange_weak(old, desired, std::memory_order_release, std::memory_order_relaxed));
+    in_use.fetch_sub(1, std::memory_order_relaxed);
+  }
+
+  bool Owns(const T *block) const { return block >= blocks && block < blocks + N; }
+  static size_t Capacity() { return N; }
+  size_t InUse() const { return in_use.load(std::memory_order_relaxed); }
+
+  pool_stats_t Stats() const {
+    pool_stats_t stats;
+    stats.allocs = allocs.load(std::memory_order_relaxed);
+    stats.failures = failures.load(std::memory_order_relaxed);
+    stats.in_use = in_use.load(std::memory_order_relaxed);
+    stats.high_water = high_water.load(std::memory_order_relaxed);
+    return stats;
+  }
+
+private:
+  static uint32_t Pack(uint16_t index, uint16_t tag) { return ((uint32_t)tag << 16) | index; }
+  static uint16_t Tag(uint32_t packed) { return (uint16_t)(packed >> 16); }
+
+  std::atomic<uint32_t> head; // Tag << 16 | index of the first free block, N -> none
+  std::atomic<uint16_t> next[N]; // Free list links, meaningful while a block is free
+  std::atomic<uint32_t> allocs;
+  std::atomic<uint32_t> failures;
+  std::atomic<uint16_t> in_use;
+  std::atomic<uint16_t> high_water;
+  T blocks[N];
+};
+
+#endif
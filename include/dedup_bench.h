@@ -0,0 +1,25 @@
+#ifndef DEDUP_BENCH_H
+#define DEDUP_BENCH_H
+
+#include <cstddef>
+#include <cstdint>
+
+#define DEDUP_BENCH_COPIES 3 // Times each packet is heard, one per neighbour that floods it
+
+typedef struct dedup_bench_report {
+  uint32_t packets; // Distinct packet IDs, each looked up DEDUP_BENCH_COPIES times
+  double map_ns; // std::map<int, bool> of the original firmware, per lookup
+  double filter_ns; // DedupFilter::CheckAndInsert, per lookup
+  size_t map_bytes; // Heap held by the map afterwards (node allocations, malloc overhead not counted)
+  size_t filter_bytes; // DedupFilter entries, whatever the packet count
+  uint32_t missed; // Duplicates the filter let through (copies of evicted entries)
+} dedup_bench_report_t;
+
+/* DUPLICATE FILTER BENCHMARK */
+// Feeds the same flood traffic to the receivedpackets map the firmware used before the
+// dedup filter and to DedupFilter: random packet IDs from a few sources, each ID heard
+// DEDUP_BENCH_COPIES times a few packets apart, 20 new packets a second of simulated
+// clock. Wall clock, so only the ratios mean much across machines.
+dedup_bench_report_t RunDedupBench(uint32_t packets);
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef DEDUP_FILTER_H
+#define DEDUP_FILTER_H
+
+#include <cstddef>
+#include <cstdint>
+#include "mesh_packet.h"
+
+#ifndef DEDUP_SLOTS
+#define DEDUP_SLOTS 64 // Remembered packets (Power of 2)
+#endif
+#define DEDUP_PROBE 8 // Slots searched per lookup
+#define DEDUP_LIFETIME_MS 30000 // A packet ID is forgotten after this long
+
+typedef struct dedup_entry {
+  uint32_t packet_id;
+  uint32_t seen; // millis() of first reception
+  uint8_t source[MAC_SIZE];
+  bool used;
+} dedup_entry_t;
+
+typedef struct dedup_stats {
+  uint32_t lookups;
+  uint32_t duplicates;
+  uint32_t evictions; // Live entries pushed out before their lifetime ended
+} dedup_stats_t;
+
+/* DUPLICATE PACKET FILTER */
+// Fixed-size set of (source MAC, packet ID) with a timestamp per entry. Lookups probe a
+// short window of slots; a new entry takes an empty or expired slot in that window, else
+// evicts the oldest one. Memory stays constant however long the node runs.
+class DedupFilter {
+  static_assert((DEDUP_SLOTS & (DEDUP_SLOTS - 1)) == 0, "Dedup slots must be a power of two");
+
+public:
+  DedupFilter() { Clear(); }
+
+  // True if the packet was already seen within the lifetime, otherwise remembers it
+  bool CheckAndInsert(const uint8_t *source, uint32_t packet_id, uint32_t now);
+  void Clear();
+
+  const dedup_stats_t &Stats() const { return stats; }
+  static size_t MemoryBytes() { return sizeof(dedup_entry_t) * DEDUP_SLOTS; }
+
+private:
+  static uint32_t Hash(const uint8_t *source, uint32_t packet_id);
+
+  dedup_entry_t entries[DEDUP_SLOTS];
+  dedup_stats_t stats;
+};
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef DEFERRED_FLASH_H
+#define DEFERRED_FLASH_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "mesh_hal.h"
+
+#ifndef FLASH_FLUSH_MS
+#define FLASH_FLUSH_MS 2000 // Longest a committed update waits in RAM before it goes to flash
+#endif
+#define FLASH_POLL_MS 100 // Cadence of Flush() calls where nothing else sets it (the simulator's loop())
+
+typedef struct flash_stats {
+  uint32_t requests; // Commit() calls from the mesh core
+  uint32_t commits; // Flash commits they were folded into
+  uint32_t failures; // Flash commits that failed, retried on a later Flush()
+  uint32_t bytes_changed; // Writes that changed a byte
+  uint32_t bytes_unchanged; // Writes skipped, the byte already had that value
+  uint32_t bytes_flushed; // Dirty span summed over all commits
+  uint32_t stall_ms; // Time spent inside flash commits
+  uint32_t stall_max_ms; // Longest single commit
+} flash_stats_t;
+
+/* DEFERRED FLASH COMMITS */
+// A FlashBackend in front of another one that batches commits. Writes go straight to the
+// backing RAM image, skipping bytes that do not change, and the byte range they touch
+// is tracked. Commit() only marks the image consistent. Flush() does the one real commit
+// for every Commit() since the previous one, once the oldest has waited interval_ms,
+// so a burst of route and peer updates costs one flash write instead of one each.
+// The backing commit copies the RAM image the writes go to, so Flush() runs in the
+// context that writes (the mesh task between Poll()s on the device, see MeshTask), with
+// force set when that context stops. Only Pending() is safe from other contexts.
+class DeferredFlash : public FlashBackend {
+public:
+  DeferredFlash(FlashBackend &backing, Clock &clock, uint32_t interval_ms = FLASH_FLUSH_MS);
+
+  size_t Size() const { return backing.Size(); }
+  uint8_t Read(size_t addr) const { return backing.Read(addr); }
+  void Write(size_t addr, uint8_t value);
+  // Never touches flash, the update goes out with a later Flush()
+  bool Commit();
+
+  // Commit the backing image if an update is due, or anything pending when force is set.
+  // False if the flash commit failed; the update stays pending
+  bool Flush(bool force = false);
+  bool Pending() const { return requested.load(std::memory_order_acquire) != flushed.load(std::memory_order_acquire); }
+  void SetInterval(uint32_t ms) { interval_ms = ms; }
+
+  const flash_stats_t &Stats() const { return stats; }
+
+private:
+  FlashBackend &backing;
+  Clock &clock;
+  uint32_t interval_ms;
+  // Writer side: range changed since the last Commit()
+  uint32_t write_lo;
+  uint32_t write_hi;
+  // Published by Commit(), taken by Flush()
+  std::atomic<uint32_t> dirty_lo;
+  std::atomic<uint32_t> dirty_hi;
+  std::atomic<uint32_t> requested; // Commit()s that had changes
+  std::atomic<uint32_t> flushed; // ... of them on flash
+  std::atomic<uint32_t> pending_since; // Millis() of the oldest one not yet on flash
+  flash_stats_t stats;
+};
+
+#endif
@@ -0,0 +1,113 @@
+#ifndef DV_ROUTING_H
+#define DV_ROUTING_H
+
+#include <cstddef>
+#include <cstdint>
+#include "mesh_packet.h"
+
+#ifndef DV_ROUTES
+#define DV_ROUTES 64 // Destinations (Power of 2), keep well above the network size
+#endif
+#define DV_HOP_COST 16 // Metric of one perfect hop (ETX 1.0, LINK_ETX_ONE)
+#define DV_SWITCH_MARGIN (DV_HOP_COST / 4) // Another next hop must be this much better, damps ETX noise
+#define DV_TRIGGER_DELTA (DV_HOP_COST / 2) // Smaller metric drifts wait for the next full dump
+#define DV_INFINITY 0xFFFF // Unreachable
+#define DV_FULL_INTERVAL_MS 15000 // Full table dump, own sequence number advances
+#define DV_TRIGGER_MS 500 // Minimum gap between incremental updates
+#define DV_NEIGHBOUR_TIMEOUT_MS (3 * DV_FULL_INTERVAL_MS + 1000) // Silent neighbour is gone
+#define DV_ROUTED_TTL 16 // Hop limit of frames forwarded by the table
+
+/* ROUTE UPDATE FRAME (ALL MULTI-BYTE FIELDS LITTLE-ENDIAN) */
+//  0      DV_FRAME_MAGIC, never a valid wire_format version
+//  1      entry count
+//  2..    entries: dest MAC(6) seq(2) metric(2)
+// Sent to the broadcast address; the sender is the MAC the frame came from.
+#define DV_FRAME_MAGIC 0xD5
+#define DV_FRAME_HEADER 2
+#define DV_ENTRY_SIZE 10
+#define DV_FRAME_MAX ESPNOW_MTU
+#define DV_ENTRIES_PER_FRAME ((DV_FRAME_MAX - DV_FRAME_HEADER) / DV_ENTRY_SIZE)
+
+typedef struct dv_route {
+  uint8_t dest[MAC_SIZE];
+  uint8_t next_hop[MAC_SIZE];
+  uint16_t seq; // Destination-issued: even -> alive, odd -> reported broken
+  uint16_t metric; // DV_HOP_COST per hop, DV_INFINITY when broken
+  uint32_t heard; // millis() of the last update that confirmed the route
+  uint8_t alt_hop[MAC_SIZE]; // Loop-free alternate: another neighbour nearer to dest than we are
+  uint16_t alt_metric; // Metric through alt_hop, DV_INFINITY -> none
+  uint32_t alt_heard; // millis() of the update that offered it
+  bool changed; // Goes out with the next incremental update
+  bool used;
+} dv_route_t;
+
+typedef struct dv_stats {
+  uint32_t frames_sent;
+  uint32_t bytes_sent;
+  uint32_t entries_sent;
+  uint32_t frames_received;
+  uint32_t frames_malformed;
+  uint32_t route_changes; // Next hop changed or metric moved by DV_TRIGGER_DELTA
+  uint32_t last_change; // millis() of the last change, for convergence measurements
+  uint32_t table_full; // Destinations not learned for lack of slots
+} dv_stats_t;
+
+/* DISTANCE-VECTOR ROUTING (DSDV) */
+// Every node keeps next hop + metric per destination. Each destination numbers its own
+// advertisements, so a route is only replaced by a newer sequence number or by a shorter
+// route with the same one, which keeps the table loop free. Hops cost the ETX of the link
+// to the neighbour that advertised the route (DV_HOP_COST on a perfect link). A full table goes out every
+// DV_FULL_INTERVAL_MS; changed entries go out as soon as DV_TRIGGER_MS allows. A neighbour
+// that stays silent is reported broken (odd sequence, infinite metric) to the rest.
+// Each route also keeps the best other neighbour that advertised the same sequence
+// number with a metric below ours. It cannot route through us, so a frame its next hop
+// never acked can go there instead without risking a loop.
+class DvRouter {
+public:
+  // Hands a route update frame to the radio for broadcast
+  typedef bool (*BroadcastFn)(void *ctx, const uint8_t *frame, size_t len);
+
+  DvRouter(BroadcastFn broadcast, void *ctx);
+
+  // Start advertising self, first full update goes out on the next Poll()
+  void Begin(const uint8_t *self, uint32_t now);
+  // Send due updates and expire silent neighbours
+  void Poll(uint32_t now);
+  // Merge an update heard from neighbour, link_cost is the metric of the hop to it.
+  // Returns false if the frame is malformed.
+  bool OnUpdate(const uint8_t *neighbour, uint16_t link_cost, const uint8_t *frame, size_t len, uint32_t now);
+
+  // Usable route to dest, NULL if none
+  const dv_route_t *Lookup(const uint8_t *dest) const;
+  // Next hop to dest other than avoid: the route's own if it moved away from avoid,
+  // else its loop-free alternate. NULL if there is none
+  const uint8_t *Alternate(const uint8_t *dest, const uint8_t *avoid, uint32_t now) const;
+  // Destinations with a finite metric
+  size_t Reachable() const;
+  const dv_stats_t &Stats() const { return stats; }
+
+  static bool IsUpdate(const uint8_t *frame, size_t len) {
+    return len >= DV_FRAME_HEADER && frame[0] == DV_FRAME_MAGIC;
+  }
+
+private:
+  static uint32_t Hash(const uint8_t *mac);
+  dv_route_t *Find(const uint8_t *dest, bool create);
+  void Accept(dv_route_t *route, const uint8_t *next_hop, uint16_t seq, uint16_t metric, uint32_t now);
+  void SendUpdate(bool full, uint32_t now);
+  void Flush(uint8_t *frame, int count);
+  uint32_t Jitter();
+
+  BroadcastFn broadcast;
+  void *ctx;
+  uint8_t self[MAC_SIZE];
+  uint16_t own_seq;
+  uint32_t next_full; // millis() of the next full dump
+  uint32_t last_update; // millis() of the last update sent
+  uint32_t jitter_state;
+  bool pending; // Some entry changed since the last update
+  dv_route_t routes[DV_ROUTES];
+  dv_stats_t stats;
+};
+
+#endif
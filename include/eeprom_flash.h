@@ -0,0 +1,16 @@
+#ifndef EEPROM_FLASH_H
+#define EEPROM_FLASH_H
+
+#include <EEPROM.h>
+#include "flash_backend.h"
+
+// Arduino EEPROM emulation (RAM image committed to one NVS blob) as a FlashBackend
+class EepromFlash : public FlashBackend {
+public:
+  size_t Size() const { return EEPROM.length(); }
+  uint8_t Read(size_t addr) const { return EEPROM.read(addr); }
+  void Write(size_t addr, uint8_t value) { EEPROM.write(addr, value); }
+  bool Commit() { return EEPROM.commit(); }
+};
+
+#endif
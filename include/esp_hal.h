@@ -0,0 +1,173 @@
+#ifndef ESP_HAL_H
+#define ESP_HAL_H
+
+#include <Arduino.h>
+#include <esp_wifi.h>
+#include <esp_now.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include <cstring>
+#include "mesh_hal.h"
+#include "mesh_task.h"
+
+/* ESP32 HAL: ESP-NOW, millis()/esp_random(), Serial and the FreeRTOS mesh task */
+
+#define MESH_TASK_STACK 8192 // Bytes, the task decodes into rx_slot_t and logs through vsnprintf
+#define MESH_TASK_PRIORITY 5 // Above loop() (1), below the Wi-Fi task (23)
+#define MESH_TASK_CORE 1 // Same core as loop(), Wi-Fi runs on core 0
+
+// Core 3.x hands the RSSI to the receive callback; on 2.x it is taken from a
+// promiscuous-mode sniffer that sees every management frame just before ESP-NOW does
+#if defined(ESP_ARDUINO_VERSION_MAJOR) && ESP_ARDUINO_VERSION_MAJOR >= 3
+#define ESP_HAL_RECV_INFO 1
+#else
+#define ESP_HAL_RECV_INFO 0
+#endif
+
+// ESP-NOW as a Radio. Peers are added with the LMK so encryption can be switched on later
+class EspNowRadio : public Radio {
+public:
+  EspNowRadio(const char *lmk) : lmk(lmk), on_receive(NULL), on_sent(NULL), ctx(NULL), last_error(ESP_OK), sniffed_rssi(RADIO_RSSI_UNKNOWN) {
+    memset(mac, 0, sizeof(mac));
+    memset((void *)sniffed_from, 0, sizeof(sniffed_from));
+  }
+
+  // Read the station MAC, call after Wi-Fi is started
+  bool Begin() { return esp_read_mac(mac, ESP_MAC_WIFI_STA) == ESP_OK; }
+
+  const uint8_t *Address() const { return mac; }
+
+  bool Send(const uint8_t *dest, const uint8_t *data, size_t len) {
+    return Check(esp_now_send(dest, data, len));
+  }
+
+  bool AddPeer(const uint8_t *peer, bool encrypt) {
+    esp_now_peer_info_t peerInfo = {};
+    memcpy(peerInfo.peer_addr, peer, 6);
+    peerInfo.channel = 0;
+    memcpy(peerInfo.lmk, lmk, ESP_NOW_KEY_LEN);
+    peerInfo.encrypt = encrypt;
+    return Check(esp_now_add_peer(&peerInfo));
+  }
+
+  bool DeletePeer(const uint8_t *peer) { return Check(esp_now_del_peer(peer)); }
+  bool PeerExists(const uint8_t *peer) const { return esp_now_is_peer_exist(peer); }
+
+  bool PeerEncrypted(const uint8_t *peer) const {
+    esp_now_peer_info_t peerInfo = {};
+    return esp_now_get_peer(peer, &peerInfo) == ESP_OK && peerInfo.encrypt;
+  }
+
+  void SetCallbacks(ReceiveFn receive, SentFn sent, void *context) {
+    on_receive = receive;
+    on_sent = sent;
+    ctx = context;
+    Instance() = this; // ESP-NOW callbacks carry no context pointer
+    esp_now_register_send_cb(SentTrampoline);
+    esp_now_register_recv_cb(ReceiveTrampoline);
+#if !ESP_HAL_RECV_INFO
+    wifi_promiscuous_filter_t filter = {};
+    filter.filter_mask = WIFI_PROMIS_FILTER_MASK_MGMT; // ESP-NOW frames are vendor action frames
+    esp_wifi_set_promiscuous_filter(&filter);
+    esp_wifi_set_promiscuous_rx_cb(SniffTrampoline);
+    esp_wifi_set_promiscuous(true);
+#endif
+  }
+
+  const char *LastError() const { return esp_err_to_name(last_error); }
+
+private:
+  bool Check(esp_err_t result) {
+    if(result != ESP_OK) {
+      last_error = result;
+    }
+    return result == ESP_OK;
+  }
+
+#if ESP_HAL_RECV_INFO
+  static void ReceiveTrampoline(const esp_now_recv_info_t *info, const uint8_t *data, int len) {
+    EspNowRadio *radio = Instance();
+    if(radio != NULL && radio->on_receive != NULL) {
+      radio->on_receive(radio->ctx, info->src_addr, data, len, info->rx_ctrl != NULL ? info->rx_ctrl->rssi : RADIO_RSSI_UNKNOWN);
+    }
+  }
+#else
+  static void ReceiveTrampoline(const uint8_t *mac_addr, const uint8_t *data, int len) {
+    EspNowRadio *radio = Instance();
+    if(radio != NULL && radio->on_receive != NULL) {
+      // Sniffed RSSI only counts if it belongs to the same sender
+      int rssi = memcmp((const void *)radio->sniffed_from, mac_addr, 6) == 0 ? radio->sniffed_rssi : RADIO_RSSI_UNKNOWN;
+      radio->on_receive(radio->ctx, mac_addr, data, len, rssi);
+    }
+  }
+
+  static void SniffTrampoline(void *buf, wifi_promiscuous_pkt_type_t type) {
+    EspNowRadio *radio = Instance();
+    const wifi_promiscuous_pkt_t *pkt = (const wifi_promiscuous_pkt_t *)buf;
+    if(radio == NULL || type != WIFI_PKT_MGMT || pkt->rx_ctrl.sig_len < 16) {
+      return;
+    }
+    memcpy((void *)radio->sniffed_from, pkt->payload + 10, 6); // 802.11 header: addr2 is the sender
+    radio->sniffed_rssi = pkt->rx_ctrl.rssi;
+  }
+#endif
+
+  static void SentTrampoline(const uint8_t *mac_addr, esp_now_send_status_t status) {
+    EspNowRadio *radio = Instance();
+    if(radio != NULL && radio->on_sent != NULL) {
+      radio->on_sent(radio->ctx, mac_addr, status == ESP_NOW_SEND_SUCCESS);
+    }
+  }
+
+  static EspNowRadio *&Instance() {
+    static EspNowRadio *instance = NULL;
+    return instance;
+  }
+
+  uint8_t mac[6];
+  const char *lmk; // 16-byte LMK
+  ReceiveFn on_receive;
+  SentFn on_sent;
+  void *ctx;
+  esp_err_t last_error;
+  volatile uint8_t sniffed_from[6]; // Sender of the last management frame (Wi-Fi task)
+  volatile int sniffed_rssi;
+};
+
+class ArduinoClock : public Clock {
+public:
+  uint32_t Millis() { return millis(); }
+  uint32_t Random() { return esp_random(); }
+};
+
+class SerialLogger : public Logger {
+public:
+  void Write(const char *text) { Serial.print(text); }
+};
+
+// Binary semaphore: Notify() from the Wi-Fi task gives it, the mesh task blocks taking it
+class FreeRtosSignal : public Signal {
+public:
+  FreeRtosSignal() : semaphore(xSemaphoreCreateBinary()) {}
+  ~FreeRtosSignal() { vSemaphoreDelete(semaphore); }
+
+  void Notify() { xSemaphoreGive(semaphore); }
+  bool Wait(uint32_t timeout_ms) { return xSemaphoreTake(semaphore, pdMS_TO_TICKS(timeout_ms)) == pdTRUE; }
+
+private:
+  SemaphoreHandle_t semaphore;
+};
+
+// Start task.Run() in a FreeRTOS task of its own, its handle goes to handle if given
+inline bool StartMeshTask(MeshTask &task, TaskHandle_t *handle = NULL) {
+  struct Entry {
+    static void Run(void *arg) {
+      ((MeshTask *)arg)->Run();
+      vTaskDelete(NULL);
+    }
+  };
+  return xTaskCreatePinnedToCore(Entry::Run, "mesh", MESH_TASK_STACK, &task, MESH_TASK_PRIORITY, handle, MESH_TASK_CORE) == pdPASS;
+}
+
+#endif
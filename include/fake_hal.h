@@ -0,0 +1,264 @@
+#ifndef FAKE_HAL_H
+#define FAKE_HAL_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "mesh_hal.h"
+
+/* IN-PROCESS HAL FOR HOST BUILDS */
+// Stand-ins for the ESP32 HAL so several mesh nodes can run in one process (env:native).
+// Nothing here touches the network. FakeClock and FakeAir are deterministic; SteadyClock,
+// ThreadSignal and ThreadedAir run nodes on std::threads in real time instead.
+
+// RAM image, starts erased
+class RamFlash : public FlashBackend {
+public:
+  RamFlash(size_t size) : image(size, 0xFF), commits(0) {}
+
+  size_t Size() const { return image.size(); }
+  uint8_t Read(size_t addr) const { return addr < image.size() ? image[addr] : 0xFF; }
+  void Write(size_t addr, uint8_t value) {
+    if(addr < image.size()) {
+      image[addr] = value;
+    }
+  }
+  bool Commit() {
+    commits++;
+    return true;
+  }
+
+  uint32_t Commits() const { return commits; }
+
+protected:
+  std::vector<uint8_t> image;
+  uint32_t commits;
+};
+
+// Manually advanced time and a seeded xorshift generator
+class FakeClock : public Clock {
+public:
+  FakeClock(uint32_t seed) : now(0), state(seed ? seed : 1) {}
+
+  uint32_t Millis() { return now; }
+  uint32_t Random() {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+  }
+
+  void Advance(uint32_t ms) { now += ms; }
+  void Set(uint32_t ms) { now = ms; }
+
+private:
+  uint32_t now;
+  uint32_t state;
+};
+
+// RamFlash whose commits take time, like a flash write stalling its caller: each one moves
+// the node's clock on by commit_ms
+class SlowFlash : public RamFlash {
+public:
+  SlowFlash(size_t size, FakeClock &clock, uint32_t commit_ms) : RamFlash(size), clock(clock), commit_ms(commit_ms) {}
+
+  bool Commit() {
+    clock.Advance(commit_ms);
+    return RamFlash::Commit();
+  }
+
+private:
+  FakeClock &clock;
+  uint32_t commit_ms;
+};
+
+// RamFlash kept in a file: the image is loaded from path if it has the right size, and
+// every commit writes it out whole, as the EEPROM emulation commits its NVS blob. Writes
+// not committed yet are gone once the object is, like after a reset
+class FileFlash : public RamFlash {
+public:
+  FileFlash(const char *path, size_t size);
+
+  bool Commit();
+  // Image was read from the file rather than starting erased
+  bool Loaded() const { return loaded; }
+
+private:
+  const char *path;
+  bool loaded;
+};
+
+// Wall time for nodes on threads. Millis() may be called from any thread, Random() from one
+class SteadyClock : public Clock {
+public:
+  SteadyClock(uint32_t seed) : start(std::chrono::steady_clock::now()), state(seed ? seed : 1) {}
+
+  uint32_t Millis() {
+    return (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+  }
+  uint32_t Random() {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+  }
+
+private:
+  std::chrono::steady_clock::time_point start;
+  uint32_t state;
+};
+
+// MeshTask on a std::thread
+class ThreadSignal : public Signal {
+public:
+  ThreadSignal() : pending(false) {}
+
+  void Notify();
+  bool Wait(uint32_t timeout_ms);
+
+private:
+  std::mutex mutex;
+  std::condition_variable cv;
+  bool pending;
+};
+
+// stdout with a per-node prefix, or silent for benchmarks
+class ConsoleLogger : public Logger {
+public:
+  ConsoleLogger(const char *prefix, bool enabled) : prefix(prefix), enabled(enabled), at_line_start(true) {}
+
+  void Write(const char *text);
+  bool Enabled() const { return enabled; }
+
+private:
+  const char *prefix;
+  bool enabled;
+  bool at_line_start;
+};
+
+class FakeRadio;
+
+// What carries frames between FakeRadios: FakeAir or ThreadedAir below, or the simulator (mesh_sim.h)
+class RadioMedium {
+public:
+  virtual ~RadioMedium() {}
+
+  virtual void Attach(FakeRadio *radio) = 0;
+  virtual void Transmit(FakeRadio *from, const uint8_t *to, const uint8_t *data, size_t len) = 0;
+};
+
+/* SHARED MEDIUM */
+// Frames sent by any attached radio are queued and handed out by Deliver(). A frame
+// reaches the radio it is addressed to (or every radio for the broadcast address) if
+// the two are linked; links are symmetric and off by default.
+class FakeAir : public RadioMedium {
+public:
+  FakeAir() : frames_sent(0), frames_delivered(0) {}
+
+  void Attach(FakeRadio *radio);
+  void Link(FakeRadio *a, FakeRadio *b, bool up = true);
+  bool Linked(const FakeRadio *a, const FakeRadio *b) const;
+
+  void Transmit(FakeRadio *from, const uint8_t *to, const uint8_t *data, size_t len);
+  // Deliver every frame queued so far. Frames sent by receivers wait for the next call.
+  size_t Deliver();
+  bool Idle() const { return pending.empty(); }
+
+  uint32_t FramesSent() const { return frames_sent; }
+  uint32_t FramesDelivered() const { return frames_delivered; }
+
+private:
+  struct frame_t {
+    FakeRadio *from;
+    uint8_t to[6];
+    std::vector<uint8_t> data;
+  };
+
+  int IndexOf(const FakeRadio *radio) const;
+
+  std::vector<FakeRadio *> radios;
+  std::vector<std::vector<bool> > links;
+  std::deque<frame_t> pending;
+  uint32_t frames_sent;
+  uint32_t frames_delivered;
+};
+
+/* THREADED MEDIUM */
+// Plays the Wi-Fi task for nodes that run on std::threads: frames sent from any thread
+// are queued, and one driver thread hands each to the linked receivers and reports it
+// to the sender, so like on the device every radio callback comes from the same thread.
+// Links are set up before Start() and fixed while it runs.
+class ThreadedAir : public RadioMedium {
+public:
+  ThreadedAir() : running(false), frames_sent(0) {}
+  ~ThreadedAir() { Stop(); }
+
+  void Attach(FakeRadio *radio);
+  void Link(FakeRadio *a, FakeRadio *b);
+  void Transmit(FakeRadio *from, const uint8_t *to, const uint8_t *data, size_t len);
+
+  void Start();
+  void Stop();
+  uint32_t FramesSent() const { return frames_sent.load(std::memory_order_relaxed); }
+
+private:
+  struct frame_t {
+    FakeRadio *from;
+    uint8_t to[6];
+    std::vector<uint8_t> data;
+  };
+
+  void Drive();
+
+  std::vector<FakeRadio *> radios;
+  std::vector<std::vector<bool> > links;
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::deque<frame_t> pending;
+  bool running;
+  std::thread driver;
+  std::atomic<uint32_t> frames_sent;
+};
+
+// ESP-NOW-like radio on a RadioMedium: sending needs a registered peer, receiving does not
+class FakeRadio : public Radio {
+public:
+  FakeRadio(RadioMedium &air, const uint8_t *mac);
+
+  const uint8_t *Address() const { return mac; }
+  bool Send(const uint8_t *dest, const uint8_t *data, size_t len);
+  bool AddPeer(const uint8_t *peer, bool encrypt);
+  bool DeletePeer(const uint8_t *peer);
+  bool PeerExists(const uint8_t *peer) const;
+  bool PeerEncrypted(const uint8_t *peer) const;
+  void SetCallbacks(ReceiveFn receive, SentFn sent, void *context);
+  const char *LastError() const { return last_error; }
+
+  // Called by the medium
+  void Receive(const uint8_t *from, const uint8_t *data, int len, int rssi = RADIO_RSSI_UNKNOWN);
+  void Sent(const uint8_t *dest, bool success);
+
+private:
+  struct peer_t {
+    uint8_t mac[6];
+    bool encrypt;
+  };
+
+  int FindPeer(const uint8_t *peer) const;
+
+  RadioMedium &air;
+  uint8_t mac[6];
+  std::vector<peer_t> peers;
+  ReceiveFn on_receive;
+  SentFn on_sent;
+  void *ctx;
+  const char *last_error;
+};
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef FLASH_BACKEND_H
+#define FLASH_BACKEND_H
+
+#include <cstddef>
+#include <cstdint>
+
+/* BYTE-ADDRESSABLE PERSISTENT STORAGE */
+// Writes land in a RAM image and only reach flash on Commit(), the same model as the
+// Arduino EEPROM emulation. Lets the route store run against EEPROM on the device
+// and against any other image (file, RAM) off-device.
+class FlashBackend {
+public:
+  virtual ~FlashBackend() {}
+
+  virtual size_t Size() const = 0;
+  virtual uint8_t Read(size_t addr) const = 0;
+  virtual void Write(size_t addr, uint8_t value) = 0;
+  virtual bool Commit() = 0;
+
+  void ReadBlock(size_t addr, uint8_t *out, size_t len) const {
+    for(size_t i = 0; i < len; i++) {
+      out[i] = Read(addr + i);
+    }
+  }
+
+  void WriteBlock(size_t addr, const uint8_t *data, size_t len) {
+    for(size_t i = 0; i < len; i++) {
+      Write(addr + i, data[i]);
+    }
+  }
+};
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef FLOOD_CONTROL_H
+#define FLOOD_CONTROL_H
+
+#include <cstddef>
+#include <cstdint>
+#include "mesh_packet.h"
+
+#ifndef FLOOD_PENDING
+#define FLOOD_PENDING 8 // Rebroadcasts waiting out their backoff
+#endif
+#define FLOOD_BACKOFF_MS 120 // Random assessment delay, uniform in [0, FLOOD_BACKOFF_MS)
+#define FLOOD_DUP_LIMIT 3 // Copies heard (first one included) that make our rebroadcast redundant
+#define FLOOD_GOSSIP_PERCENT 100 // Chance to consider rebroadcasting at all, 100 -> counter-based only
+
+// How floods leave this node
+enum FloodMode {
+  FLOOD_UNICAST, // One encrypted unicast per peer, immediately (default, original behaviour)
+  FLOOD_BROADCAST, // One unencrypted broadcast frame, reaches non-peers too
+};
+
+typedef struct flood_slot {
+  message_t packet;
+  uint32_t due; // millis() when the backoff ends
+  uint8_t copies; // Times this flood was heard so far
+  bool used;
+} flood_slot_t;
+
+typedef struct flood_stats {
+  uint32_t scheduled;
+  uint32_t sent;
+  uint32_t suppressed; // Cancelled: enough neighbours already rebroadcast
+  uint32_t gossip_skipped; // Lost the gossip coin toss
+  uint32_t overflow; // No free slot, sent without backoff
+} flood_stats_t;
+
+/* CONTROLLED FLOODING */
+// Counter-based rebroadcast suppression. A flood to relay is held for a random backoff;
+// every duplicate heard meanwhile is counted, and once dup_limit copies were heard the
+// neighbourhood is considered covered and the rebroadcast is dropped. With gossip below
+// 100 a node also skips relaying a flood outright with that probability.
+class FloodControl {
+public:
+  // Hands a flood frame to the radio layer
+  typedef void (*RelayFn)(const message_t *packet, void *ctx);
+
+  FloodControl(RelayFn relay, void *ctx);
+
+  void Configure(uint8_t dup_limit, uint8_t gossip_percent);
+  // Hold a relay for a backoff, random is any 32-bit random number
+  void Schedule(const message_t *packet, uint32_t now, uint32_t random);
+  // A copy of (source, packetID) arrived again. Returns true if it was pending here.
+  bool OnDuplicate(const uint8_t *source, int packetID);
+  // Relay floods whose backoff ended
+  void Poll(uint32_t now);
+
+  size_t Pending() const;
+  const flood_stats_t &Stats() const { return stats; }
+
+private:
+  flood_slot_t *Find(const uint8_t *source, int packetID);
+
+  RelayFn relay;
+  void *ctx;
+  uint8_t dup_limit; // 0 -> never suppress
+  uint8_t gossip_percent;
+  flood_slot_t slots[FLOOD_PENDING];
+  flood_stats_t stats;
+};
+
+#endif
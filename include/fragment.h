@@ -0,0 +1,124 @@
+#ifndef FRAGMENT_H
+#define FRAGMENT_H
+
+#include <cstddef>
+#include <cstdint>
+#include "mesh_packet.h"
+#include "wire_format.h"
+
+/* FRAGMENT PAYLOAD (CARRIED IN message_t.text, identification 3) */
+//  Fragment:      transfer(2) index(1) count(1) flags(1) chunk...
+//  Fragment Ack:  transfer(2) count(1) received bitmap(4)          (Data_Ack set)
+#define FRAG_HEADER_SIZE 5
+#define FRAG_ACK_SIZE 7
+#define FRAG_CHUNK (WIRE_MAX_TEXT - FRAG_HEADER_SIZE) // Buffer bytes per fragment
+#define FRAG_MAX_FRAGMENTS 32 // Per transfer, the width of the ack bitmap
+#define FRAG_MAX_BYTES (FRAG_MAX_FRAGMENTS * FRAG_CHUNK) // Largest buffer, a bit over 5 KB
+#define FRAG_FLAG_ACK_REQUEST 0x01 // Last fragment of a round: answer with the bitmap
+
+#ifndef FRAG_TX_TRANSFERS
+#define FRAG_TX_TRANSFERS 2 // Outgoing buffers in flight
+#endif
+#ifndef FRAG_RX_TRANSFERS
+#define FRAG_RX_TRANSFERS 2 // Buffers being reassembled
+#endif
+#define FRAG_BURST 4 // Fragments handed to the radio per Poll(), keeps relay queues from overflowing
+#define FRAG_ACK_TIMEOUT_MS 2000 // No ack for a round -> send what is missing again
+#define FRAG_MAX_ROUNDS 6 // Rounds before a transfer is given up
+#define FRAG_RX_TIMEOUT_MS 15000 // Reassembly nobody finishes is dropped, finished ones are forgotten
+
+// Outgoing buffer
+typedef struct frag_tx {
+  uint8_t dest[MAC_SIZE];
+  uint8_t data[FRAG_MAX_BYTES];
+  uint16_t len;
+  uint16_t transfer;
+  uint8_t count; // Fragments
+  uint8_t rounds; // Rounds started so far
+  uint32_t acked; // Bit i -> fragment i confirmed by the receiver
+  uint32_t queued; // Fragments of the current round not yet handed to the radio
+  uint32_t ack_due; // millis() by which the round's ack is expected
+  bool waiting; // Round sent, waiting for its ack
+  bool used;
+} frag_tx_t;
+
+// Buffer being reassembled
+typedef struct frag_rx {
+  uint8_t source[MAC_SIZE];
+  uint8_t data[FRAG_MAX_BYTES];
+  uint16_t len; // Known once the last fragment arrived
+  uint16_t transfer;
+  uint8_t count;
+  uint32_t received; // Bit i -> fragment i is in data
+  uint32_t touched; // millis() of the last fragment
+  bool complete; // Delivered, kept so a lost ack can be repeated
+  bool used;
+} frag_rx_t;
+
+typedef struct frag_stats {
+  uint32_t transfers; // Buffers accepted by Send()
+  uint32_t delivered; // ... confirmed complete by the receiver
+  uint32_t failed; // ... given up after FRAG_MAX_ROUNDS
+  uint32_t fragments_sent;
+  uint32_t fragments_resent; // Only missing fragments are sent again
+  uint32_t acks_sent;
+  uint32_t reassembled; // Buffers handed to the receive handler
+  uint32_t expired; // Reassemblies dropped incomplete
+  uint32_t busy; // Fragments of new transfers dropped for lack of a slot
+  uint32_t malformed;
+} frag_stats_t;
+
+/* FRAGMENTATION AND REASSEMBLY */
+// Splits buffers of up to FRAG_MAX_BYTES into FRAG_CHUNK-byte fragments that travel the
+// mesh as ordinary packets. The sender paces a round of fragments out over a few Poll()s
+// and flags the last one; the receiver answers with a bitmap of what it holds, and the
+// next round carries only the fragments missing from it. Reassembly happens in fixed
+// buffers that time out, so a sender that disappears cannot pin them.
+class FragmentTransport {
+public:
+  // Hands a fragment (ack false) or fragment ack (ack true) payload to the mesh. False if it
+  // had no packet free: a fragment is tried again by a later Poll(), an ack when asked again
+  typedef bool (*TransmitFn)(void *ctx, const uint8_t *dest, const uint8_t *payload, size_t len, bool ack);
+  // Reassembled buffer from source, only valid during the call
+  typedef void (*ReceiveFn)(void *ctx, const uint8_t *source, const uint8_t *data, size_t len);
+  // Outcome of a Send(): delivered is true once the receiver confirmed every fragment
+  typedef void (*DoneFn)(void *ctx, const uint8_t *dest, uint16_t transfer, bool delivered);
+
+  FragmentTransport(TransmitFn transmit, void *ctx);
+
+  void SetHandlers(ReceiveFn on_receive, DoneFn on_done, void *handler_ctx);
+  // Start numbering transfers from a random value so a reboot does not reuse recent ones
+  void Begin(uint16_t first_transfer) { next_transfer = first_transfer; }
+
+  // Queue a buffer to dest. Returns the transfer number, -1 if too big or no slot is free.
+  int Send(const uint8_t *dest, const uint8_t *data, size_t len, uint32_t now);
+  // Fragment payload received from source
+  void OnFrame(const uint8_t *source, const uint8_t *payload, size_t len, bool ack, uint32_t now);
+  // Pace out fragments, restart rounds whose ack is overdue, expire stale reassemblies
+  void Poll(uint32_t now);
+
+  size_t InFlight() const;
+  const frag_stats_t &Stats() const { return stats; }
+
+private:
+  static uint32_t Mask(uint8_t count) { return count >= 32 ? 0xFFFFFFFFu : (1u << count) - 1; }
+
+  void OnFragment(const uint8_t *source, const uint8_t *payload, size_t len, uint32_t now);
+  void OnAck(const uint8_t *source, const uint8_t *payload, size_t len, uint32_t now);
+  bool StartRound(frag_tx_t *tx);
+  void Finish(frag_tx_t *tx, bool delivered);
+  void SendAck(const frag_rx_t *rx);
+  frag_rx_t *FindReassembly(const uint8_t *source, uint16_t transfer, uint32_t now, bool create);
+
+  TransmitFn transmit;
+  void *ctx;
+  ReceiveFn on_receive;
+  DoneFn on_done;
+  void *handler_ctx;
+  uint16_t next_transfer;
+  frag_tx_t tx[FRAG_TX_TRANSFERS];
+  frag_rx_t rx[FRAG_RX_TRANSFERS];
+  frag_stats_t stats;
+};
+
+#endif
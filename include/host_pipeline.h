@@ -0,0 +1,58 @@
+#ifndef HOST_PIPELINE_H
+#define HOST_PIPELINE_H
+
+#include <cstdint>
+
+typedef struct pipeline_config {
+  int nodes; // In a line, messages cross nodes - 1 hops
+  int messages; // Reliable messages from the first node to the last
+  uint32_t interval_ms; // Gap between messages
+  uint32_t poll_ms; // 0 -> mesh task woken per frame, else Poll() from a loop every poll_ms
+  uint32_t timeout_ms; // Give up waiting for deliveries after this
+} pipeline_config_t;
+
+typedef struct pipeline_report {
+  int sent;
+  int delivered;
+  double latency_p50_ms; // Send_Reliable() on the first node to delivery on the last
+  double latency_p90_ms;
+  double latency_max_ms;
+  double hop_p50_ms; // Median latency per hop
+  uint32_t frames;
+  uint32_t iterations; // Poll() calls on all nodes
+  uint32_t wakeups; // ... of them started by a frame
+} pipeline_report_t;
+
+/* THREADED PIPELINE */
+// Runs a line of MeshNodes each on a std::thread of its own, exactly as the firmware
+// runs them in FreeRTOS tasks: radio callbacks come from one driver thread (ThreadedAir),
+// queue the frame and notify, and the node's MeshTask wakes up to route it. Timings are
+// wall clock, so results vary a little from run to run.
+pipeline_report_t RunPipeline(const pipeline_config_t &config);
+
+typedef struct stress_config {
+  int nodes; // In a line
+  int messages; // Reliable messages from every node, to every other node in turn
+  uint32_t interval_ms; // Gap between one node's messages
+  uint32_t timeout_ms; // Give up once nothing was sent or delivered for this long
+} stress_config_t;
+
+typedef struct stress_report {
+  int sent;
+  int delivered; // Intact and at the right node, duplicates not counted
+  int corrupt; // Text or source differs from what was sent
+  int misrouted; // Intact, but delivered to the wrong node
+  uint32_t frames;
+  uint32_t rx_drops; // Frames lost in full RX queues, all nodes
+  uint32_t pool_exhausted; // Packets dropped for want of a packet context, all nodes
+  uint8_t pool_high_water; // Most packet contexts any node had in use at once
+} stress_report_t;
+
+/* INTERLEAVED RECEIVE STRESS */
+// The same threaded line, but every node sends at once: each one originates, relays,
+// acknowledges and retransmits while frames keep arriving from the driver thread.
+// Every delivered message is checked byte for byte against what its source sent, so
+// a packet built on top of another one shows up as corrupt.
+stress_report_t RunStress(const stress_config_t &config);
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef LINK_QUALITY_H
+#define LINK_QUALITY_H
+
+#include <cstddef>
+#include <cstdint>
+#include "mesh_packet.h"
+
+#ifndef LINK_TABLE_SIZE
+#define LINK_TABLE_SIZE 32 // Neighbours (Power of 2), keep above the ESP-NOW peer limit
+#endif
+#define LINK_ETX_ONE 16 // Fixed-point ETX 1.0: a link that never loses a frame
+#define LINK_ETX_MAX (8 * LINK_ETX_ONE) // Worse links are capped, still usable as a last resort
+#define LINK_RATIO_ONE 256 // Fixed-point delivery ratio 1.0
+#define LINK_EWMA_SHIFT 3 // Each send result moves the ratio 1/8 of the way
+#define LINK_RSSI_GOOD (-70) // dBm at or above which an unmeasured link is assumed clean
+#define LINK_RSSI_POOR (-92) // dBm at which an unmeasured link is assumed to be at LINK_ETX_MAX
+
+typedef struct link_entry {
+  uint8_t mac[MAC_SIZE];
+  uint16_t ratio; // EWMA of unicast send results, LINK_RATIO_ONE -> every frame acked
+  int16_t rssi4; // EWMA of received signal strength, dBm x 4
+  uint32_t sent; // Unicast frames with a send result
+  uint32_t failed; // ... of which got no MAC-layer ack
+  uint32_t heard; // millis() of the last frame received
+  bool measured; // ratio holds at least one send result
+  bool has_rssi;
+  bool used;
+} link_entry_t;
+
+/* PER-NEIGHBOUR LINK QUALITY */
+// Fixed-size open addressing table keyed by neighbour MAC. The delivery ratio is an
+// EWMA over the send callback's ack result for unicasts; until a link has carried
+// one, the RSSI of frames heard from the neighbour stands in for it. Etx() turns the
+// ratio into a cost on the same scale as DV_HOP_COST, 1 / ratio in LINK_ETX_ONE units.
+// Only the forward direction is measured: an ESP-NOW ack already needs both.
+class LinkTable {
+  static_assert((LINK_TABLE_SIZE & (LINK_TABLE_SIZE - 1)) == 0, "Link table size must be a power of two");
+
+public:
+  LinkTable() { Clear(); }
+
+  // Ack result of a unicast to mac (broadcasts have none)
+  void OnSent(const uint8_t *mac, bool success);
+  // Frame heard from mac, rssi in dBm or RADIO_RSSI_UNKNOWN
+  void OnReceive(const uint8_t *mac, int rssi, uint32_t now);
+
+  // Cost of the link to mac, LINK_ETX_ONE for links we know nothing about
+  uint16_t Etx(const uint8_t *mac) const;
+  // Link to mac, NULL if never heard or used
+  const link_entry_t *Lookup(const uint8_t *mac) const;
+  void Clear();
+
+  size_t Count() const { return count; }
+  uint32_t Untracked() const { return untracked; }
+
+private:
+  static uint32_t Hash(const uint8_t *mac);
+  static uint16_t RssiRatio(int rssi4);
+  static uint16_t Prior(const link_entry_t *link);
+  link_entry_t *Find(const uint8_t *mac, bool create);
+
+  link_entry_t entries[LINK_TABLE_SIZE];
+  size_t count;
+  uint32_t untracked; // Results dropped for lack of slots
+};
+
+#endif
@@ -0,0 +1,108 @@
+#ifndef MESH_CONFIG_H
+#define MESH_CONFIG_H
+
+/* BUILD-TIME SIZING */
+// Every table, queue and packet buffer of the mesh core has a fixed capacity chosen
+// at compile time, so RAM and frame layout follow the deployment. Each capacity can
+// be set on its own with -D in build_flags, or a whole set picked with
+// -DMESH_PROFILE=MESH_PROFILE_TINY / MESH_PROFILE_LARGE; whatever is left unset keeps
+// the default next to its module. All nodes of one mesh must use the same MAX_NODES
+// and MESH_TEXT_SIZE, they decide what a valid frame is. program --sizes (native)
+// prints what a build ends up with.
+
+#define ESPNOW_MTU 250 // ESP-NOW payload limit (ESP_NOW_MAX_DATA_LEN)
+
+#define MESH_PROFILE_DEFAULT 0 // Around ten nodes, the sizes this code grew up with
+#define MESH_PROFILE_TINY 1 // A handful of nodes: short paths, small tables, least RAM
+#define MESH_PROFILE_LARGE 2 // 50 nodes and more: long paths, large route and duplicate tables
+
+#ifndef MESH_PROFILE
+#define MESH_PROFILE MESH_PROFILE_DEFAULT
+#endif
+
+// Floods (route discovery, broadcasts) go out as one encrypted unicast per peer unless
+// this is 1. Broadcast floods cost far less airtime in dense meshes, but ESP-NOW cannot
+// encrypt broadcast frames: anyone in range reads them and can inject floods that relays
+// pass on. Opt in only where the radio neighbourhood is trusted.
+#ifndef MESH_FLOOD_BROADCAST
+#define MESH_FLOOD_BROADCAST 0
+#endif
+
+#if MESH_PROFILE == MESH_PROFILE_TINY
+#ifndef MAX_NODES
+#define MAX_NODES 4
+#endif
+#ifndef MESH_MAX_PEERS
+#define MESH_MAX_PEERS 8
+#endif
+#ifndef DV_ROUTES
+#define DV_ROUTES 16
+#endif
+#ifndef LINK_TABLE_SIZE
+#define LINK_TABLE_SIZE 8
+#endif
+#ifndef ROUTE_CACHE_SIZE
+#define ROUTE_CACHE_SIZE 8
+#endif
+#ifndef DEDUP_SLOTS
+#define DEDUP_SLOTS 16
+#endif
+#ifndef RX_QUEUE_DEPTH
+#define RX_QUEUE_DEPTH 8
+#endif
+#ifndef RTX_PEERS
+#define RTX_PEERS 2
+#endif
+#ifndef TX_CONTROL_DEPTH
+#define TX_CONTROL_DEPTH 4
+#endif
+#ifndef TX_FORWARD_DEPTH
+#define TX_FORWARD_DEPTH 8
+#endif
+#ifndef TX_ORIGIN_DEPTH
+#define TX_ORIGIN_DEPTH 4
+#endif
+#ifndef TX_FAILED_DEPTH
+#define TX_FAILED_DEPTH 2
+#endif
+#ifndef FLOOD_PENDING
+#define FLOOD_PENDING 4
+#endif
+#ifndef FRAG_TX_TRANSFERS
+#define FRAG_TX_TRANSFERS 1
+#endif
+#ifndef FRAG_RX_TRANSFERS
+#define FRAG_RX_TRANSFERS 1
+#endif
+
+#elif MESH_PROFILE == MESH_PROFILE_LARGE
+#ifndef MAX_NODES
+#define MAX_NODES 12
+#endif
+#ifndef DV_ROUTES
+#define DV_ROUTES 256
+#endif
+#ifndef LINK_TABLE_SIZE
+#define LINK_TABLE_SIZE 64
+#endif
+#ifndef ROUTE_CACHE_SIZE
+#define ROUTE_CACHE_SIZE 128
+#endif
+#ifndef DEDUP_SLOTS
+#define DEDUP_SLOTS 256
+#endif
+#ifndef RX_QUEUE_DEPTH
+#define RX_QUEUE_DEPTH 32
+#endif
+#ifndef RTX_PEERS
+#define RTX_PEERS 8
+#endif
+// The route log grows with ROUTE_CACHE_SIZE: about 20 KB of EEPROM image here, more
+// than the default 20 KB nvs partition holds. Give nvs 0x8000 or more in the partition
+// table, or lower ROUTE_CACHE_SIZE.
+
+#elif MESH_PROFILE != MESH_PROFILE_DEFAULT
+#error "Unknown MESH_PROFILE"
+#endif
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef MESH_HAL_H
+#define MESH_HAL_H
+
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include "flash_backend.h"
+
+/* HARDWARE ABSTRACTION */
+// Everything the mesh core needs from the platform. On the device these wrap ESP-NOW,
+// millis()/esp_random(), EEPROM, Serial and FreeRTOS (esp_hal.h); off-device they are
+// in-process fakes (fake_hal.h). Persistent storage is the FlashBackend from flash_backend.h.
+
+#define RADIO_RSSI_UNKNOWN (-128) // Driver gives no signal strength for this frame
+
+// Connectionless frame radio with a peer list (ESP-NOW model)
+class Radio {
+public:
+  // Invoked from the radio driver's context, data is only valid during the call
+  typedef void (*ReceiveFn)(void *ctx, const uint8_t *mac, const uint8_t *data, int len, int rssi);
+  typedef void (*SentFn)(void *ctx, const uint8_t *mac, bool success);
+
+  virtual ~Radio() {}
+
+  // Own station MAC
+  virtual const uint8_t *Address() const = 0;
+  // Queue a frame to mac. False if it could not be queued, see LastError()
+  virtual bool Send(const uint8_t *mac, const uint8_t *data, size_t len) = 0;
+  virtual bool AddPeer(const uint8_t *mac, bool encrypt) = 0;
+  virtual bool DeletePeer(const uint8_t *mac) = 0;
+  virtual bool PeerExists(const uint8_t *mac) const = 0;
+  virtual bool PeerEncrypted(const uint8_t *mac) const = 0;
+  virtual void SetCallbacks(ReceiveFn on_receive, SentFn on_sent, void *ctx) = 0;
+  // Name of the last failure, for logging
+  virtual const char *LastError() const = 0;
+};
+
+// Time and randomness (packet IDs). Fakes make both deterministic.
+class Clock {
+public:
+  virtual ~Clock() {}
+
+  virtual uint32_t Millis() = 0;
+  virtual uint32_t Random() = 0;
+};
+
+// Wakes the mesh task (mesh_task.h) when there is work, instead of it polling
+class Signal {
+public:
+  virtual ~Signal() {}
+
+  // Any context, also the radio callbacks. Wakeups while nobody waits are not lost
+  virtual void Notify() = 0;
+  // Task only: sleep until Notify() or timeout_ms. True if notified
+  virtual bool Wait(uint32_t timeout_ms) = 0;
+};
+
+// Line-oriented debug output
+class Logger {
+public:
+  virtual ~Logger() {}
+
+  virtual void Write(const char *text) = 0;
+  // Lets benchmarks skip formatting altogether
+  virtual bool Enabled() const { return true; }
+
+  void Printf(const char *format, ...) __attribute__((format(printf, 2, 3))) {
+    if(!Enabled()) {
+      return;
+    }
+    char line[192];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    Write(line);
+  }
+};
+
+#endif
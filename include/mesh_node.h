@@ -0,0 +1,236 @@
+#ifndef MESH_NODE_H
+#define MESH_NODE_H
+
+#include <cstddef>
+#include <cstdint>
+#include "mesh_hal.h"
+#include "mesh_packet.h"
+#include "spsc_ring.h"
+#include "wire_format.h"
+#include "route_cache.h"
+#include "route_store.h"
+#include "dedup_filter.h"
+#include "reliable_tx.h"
+#include "dv_routing.h"
+#include "link_quality.h"
+#include "flood_control.h"
+#include "fragment.h"
+#include "aggregator.h"
+#include "tx_scheduler.h"
+#include "packet_pool.h"
+#include "peer_table.h"
+#include "peer_slots.h"
+
+#ifndef MESH_FLASH_SIZE
+#define MESH_FLASH_SIZE (ROUTE_STORE_BASE + ROUTE_STORE_SIZE) // Persistent image: peer table, then the route log
+#endif
+#define ROUTE_STORE_BASE 128 // Bytes below hold the peer table
+#ifndef MESH_MAX_PEERS
+#define MESH_MAX_PEERS 32 // Peer Table Slots. More than ESP-NOW Registers, PeerSlots Swaps them in
+#endif
+#define PEER_FLASH_SLOTS ((ROUTE_STORE_BASE - 1) / MAC_SIZE) // Peers that fit the Table in Flash (Count Byte First)
+#ifndef RX_QUEUE_DEPTH
+#define RX_QUEUE_DEPTH 16 // Receive Ring Slots (Power of 2)
+#endif
+#ifndef CTRL_QUEUE_DEPTH
+#define CTRL_QUEUE_DEPTH 4 // Route Update Ring Slots (Power of 2)
+#endif
+#define LINK_QUEUE_DEPTH 32 // Send Result Ring Slots (Power of 2), one per Send
+#define FRAGMENT_TTL 3 // Flood Reach of Fragments and their Acks, as Send_Reliable
+#define PATH_SWITCH_MARGIN (LINK_ETX_ONE / 2) // New Path must be this much Cheaper to Replace a Stored one
+#define ROUTE_ERROR_ID 4 // identification of Route Errors: Text is the Broken Link, From and To MAC
+#define ROUTE_ERROR_TTL 10 // Hop Limit of Route Errors, as Data Acks
+#define ROUTE_ERROR_HOLDOFF_MS 1000 // Same Broken Link Reported to the same Source at most this often
+#define PATH_REPAIR_TTL 2 // Flood Reach of a Local Re-Discovery from the Node where a Path Broke
+
+// Receive Queue Slot
+typedef struct rx_slot {
+  message_t data;
+  uint8_t mac[6];
+  int16_t rssi; // dBm, RADIO_RSSI_UNKNOWN if the Driver gave None
+  bool forward; // Packet is for another node
+} rx_slot_t;
+
+// Route Update Queue Slot, kept as the raw frame
+typedef struct ctrl_slot {
+  uint8_t mac[6];
+  int16_t rssi;
+  uint8_t len;
+  uint8_t data[DV_FRAME_MAX];
+} ctrl_slot_t;
+
+// What Became of Path-Routed Packets whose Next Hop Stopped Acking
+typedef struct repair_stats {
+  uint32_t breaks; // Packets this Node could not get to the Next Hop in their Path
+  uint32_t repaired; // ... Sent on along a Route this Node Knows
+  uint32_t rediscoveries; // ... Flooded again from here, PATH_REPAIR_TTL Hops
+  uint32_t errors_sent; // Route Errors Sent Back towards Sources
+  uint32_t errors_received; // Route Errors Heard, as their Destination or on the Way
+  uint32_t routes_invalidated; // Stored Paths Removed for a Broken Link
+} repair_stats_t;
+
+// Send Result Queue Slot, the Send Callback Runs in the Radio Task
+typedef struct link_status {
+  uint8_t mac[6];
+  bool success;
+} link_status_t;
+
+/* MESH NODE */
+// The protocol core: flooding, path routing, acknowledgements and route persistence.
+// Talks to the platform only through the HAL, so the same code runs on the ESP32
+// (main.cpp) and natively against fakes (native/). Frames come in through the radio
+// callback and are queued; Poll() processes them and drives retransmissions.
+class MeshNode {
+public:
+  // Called once per new DATA packet addressed to this node
+  typedef void (*DeliverFn)(void *ctx, const message_t *packet);
+
+  MeshNode(Radio &radio, Clock &clock, FlashBackend &flash, Logger &log, const wire_node_table_t *node_table);
+
+  // Load stored routes and start receiving
+  bool Begin();
+  // Process queued frames and retransmit unacknowledged packets
+  void Poll();
+
+  void Add_Peer(const uint8_t *mac);
+  void SwitchToEncryption(const uint8_t *mac);
+  void AddToRoutingAndEEPROM(const uint8_t *mac);
+  void LoadDataFromEEPROM();
+  void PrintMACTable();
+  void broadcast();
+  // Send Text to Destination through its Send Window. Returns false if the window is full
+  bool Send_Reliable(const char *text, const uint8_t *destination_mac);
+  // Send a Buffer of up to FRAG_MAX_BYTES in Fragments. Returns the Transfer Number, -1 if Busy or too Big
+  int Send_Buffer(const uint8_t *data, size_t len, const uint8_t *destination_mac);
+  void ResetEEPROMLocations();
+  void SetDeliveryHandler(DeliverFn fn, void *ctx);
+  // Notified whenever a Frame is Queued for Poll(), lets a Task Sleep until there is Work
+  void SetSignal(Signal *wakeup) { signal = wakeup; }
+  // Reassembled Buffers, and the Outcome of each Send_Buffer()
+  void SetBufferHandlers(FragmentTransport::ReceiveFn on_receive, FragmentTransport::DoneFn on_done, void *ctx) { fragments.SetHandlers(on_receive, on_done, ctx); }
+  // Proactive distance-vector routing, on by default. Off -> flooding and path arrays only
+  void SetDistanceVector(bool enabled) { dv_enabled = enabled; }
+  // Price Hops by Measured ETX, on by default. Off -> every Hop Costs the Same (Hop Count)
+  void SetLinkMetric(bool enabled) { etx_enabled = enabled; }
+  // Floods go out Encrypted, one Unicast per Peer, by default. FLOOD_BROADCAST sends one Frame with Suppression (MESH_FLOOD_BROADCAST)
+  void SetFloodMode(FloodMode mode) { flood_mode = mode; }
+  // Broadcast Floods: Copies Heard that Cancel a Relay (0 -> Never), Chance to Relay at all
+  void SetFloodSuppression(uint8_t dup_limit, uint8_t gossip_percent) { flood.Configure(dup_limit, gossip_percent); }
+  // Unicasts to the same Next Hop Share Frames, on by Default. delay_ms is the Extra Wait for Fuller Batches
+  void SetAggregation(bool enabled, uint32_t delay_ms = AGG_DELAY_MS) { aggregator.Configure(enabled, delay_ms); }
+  // Evict the Least Recently Used Radio Peer when a Send Needs a Slot, on by Default. Off -> Sends to Peers without a Slot Fail
+  void SetPeerEviction(bool enabled) { slots.SetEviction(enabled); }
+  // Forwarded vs Originated Frames per Round when both Wait. Acks and Control always go First
+  void SetTxWeights(uint8_t forward_weight, uint8_t origin_weight) { scheduler.Configure(forward_weight, origin_weight); }
+  // Local Resends of a Frame the Next Hop did not Ack, then a Loop-Free Alternate Next Hop for Table Routes. Both on by Default
+  void SetHopRecovery(uint8_t retries, bool failover) { scheduler.SetRetries(retries); failover_enabled = failover; }
+  // Broken Path Arrays are Reported to the Source and Repaired Locally, on by Default. Off -> Packets are Dropped, Paths Stay Stored
+  void SetPathRepair(bool enabled) { repair_enabled = enabled; }
+
+  // Radio callbacks
+  void On_Data_Receive(const uint8_t *mac, const uint8_t *data, int len, int rssi = RADIO_RSSI_UNKNOWN);
+  void On_Data_Sent(const uint8_t *mac_addr, bool success);
+
+  const uint8_t *Address() const { return baseMac; }
+  const ReliableTransport &Transport() const { return reliable_tx; }
+  const RouteCache &Routes() const { return route_cache; }
+  const DvRouter &Router() const { return router; }
+  const LinkTable &Links() const { return links; }
+  const FloodControl &Flooding() const { return flood; }
+  const FragmentTransport &Fragments() const { return fragments; }
+  const FrameAggregator &Aggregation() const { return aggregator; }
+  const TxScheduler &Scheduler() const { return scheduler; }
+  const PacketPool &Packets() const { return packets; }
+  const PeerTable<MESH_MAX_PEERS> &Peers() const { return peers; }
+  const PeerSlots &Slots() const { return slots; }
+  uint32_t MalformedFrames() const { return malformed_frames; }
+  uint32_t Failovers() const { return failovers; } // Packets Sent to an Alternate Next Hop
+  uint32_t HopLosses() const { return hop_losses; } // Packets Lost at this Hop after every Resend
+  const repair_stats_t &Repairs() const { return repairs; }
+  uint32_t RxDrops() const { return rx_queue.Dropped(); }
+
+private:
+  static void Receive_Callback(void *ctx, const uint8_t *mac, const uint8_t *data, int len, int rssi);
+  static void Sent_Callback(void *ctx, const uint8_t *mac, bool success);
+  static bool Transmit_Reliable(const message_t *packet, void *ctx);
+  static bool Broadcast_Routes(void *ctx, const uint8_t *frame, size_t len);
+  static void Relay_Flood(const message_t *packet, void *ctx);
+  static bool Transmit_Fragment(void *ctx, const uint8_t *dest, const uint8_t *payload, size_t len, bool ack);
+  static bool Send_Frame(void *ctx, const uint8_t *mac, const uint8_t *frame, size_t len, uint8_t priority);
+  static bool Transmit_Frame(void *ctx, const uint8_t *mac, const uint8_t *frame, size_t len, bool encrypt);
+  static void Fail_Over(void *ctx, const uint8_t *mac, const uint8_t *data, int len, int rssi);
+
+  void FollowPathArray(message_t *packet);
+  void SaveDataToEEPROM();
+  void Forward_Message(const message_t *packet);
+  void Flood_Packet(const message_t *packet);
+  bool Configure_Packet(packet_ctx_t *pkt, const char *data, int TTL, int identification, bool broadcast_Ack, bool Data_Ack, const uint8_t *destination_mac, const uint8_t *source_mac, bool path_exist);
+  void Send_Data(message_t *packet, const uint8_t *mac);
+  packet_ctx_t *Acquire_Packet();
+  bool Send_Packet(const uint8_t *mac, const message_t *packet);
+  TxClass ClassOf(const message_t *packet) const;
+  TxClass ClassOf(const MessageView &view) const;
+  void Check_Existing_Peer(const uint8_t *mac);
+  void ProcessReceivedData();
+  bool AppendBaseMAC(message_t *packet, uint8_t index);
+  void SavePathToEEPROM(uint8_t path_arr[MAX_NODES][MAC_SIZE], uint8_t index);
+  void ReverseArray(uint8_t index, uint8_t path_arr[MAX_NODES][MAC_SIZE]);
+  void PrintArray(uint8_t path_arr[MAX_NODES][MAC_SIZE], uint8_t index);
+  void PrintMACPath(const message_t *packet, uint8_t index);
+  bool CheckDestInPath(const uint8_t *mac);
+  bool LoadPathFromCache(message_t *packet, const uint8_t *mac);
+  bool Route_Packet(message_t *packet);
+  void Repair_Path(const MessageView &view, const uint8_t *broken_hop);
+  void Send_Route_Error(const message_t *packet, const uint8_t *broken_hop);
+  void Handle_Route_Error(const message_t *packet);
+  void Invalidate_Link(const uint8_t *from, const uint8_t *to);
+  uint16_t LinkCost(const uint8_t *mac) const { return etx_enabled ? links.Etx(mac) : LINK_ETX_ONE; }
+  uint16_t PathCost(uint8_t path_arr[MAX_NODES][MAC_SIZE], uint8_t index) const;
+
+  Radio &radio;
+  Clock &clock;
+  FlashBackend &flash;
+  Logger &log;
+  const wire_node_table_t *node_table; // Paths made of known nodes go on air as 1-byte indices
+  DeliverFn on_deliver;
+  void *deliver_ctx;
+  Signal *signal; // NULL -> Poll() Runs on its Own Cadence
+
+  uint8_t baseMac[6]; // Base MAC Address of Sender
+  int counter; // Session Counter
+  PacketPool packets; // Packets being Built, one Context each
+
+  PeerTable<MESH_MAX_PEERS> peers; // Neighbours in MAC Order, with what we Know of each
+  PeerSlots slots; // The Radio's Peer List, Registered on Demand before a Send
+  DedupFilter receivedpackets; // Track of Recent PacketID's (Bounded)
+  RouteCache route_cache; // RAM Copy of the Paths Stored in EEPROM
+  RouteStore route_store; // Route Log in EEPROM
+  SpscRing<rx_slot_t, RX_QUEUE_DEPTH> rx_queue; // Radio Task -> Poll()
+  ReliableTransport reliable_tx; // Send Windows per Destination
+  DvRouter router; // Next Hop per Destination
+  SpscRing<ctrl_slot_t, CTRL_QUEUE_DEPTH> ctrl_queue; // Route Updates, Radio Task -> Poll()
+  bool dv_enabled;
+  LinkTable links; // ETX per Neighbour, Prices Routes
+  bool etx_enabled;
+  FloodControl flood; // Relays Waiting out their Backoff
+  FloodMode flood_mode;
+  FragmentTransport fragments; // Buffers Larger than a Frame
+  SpscRing<link_status_t, LINK_QUEUE_DEPTH> link_queue; // Send Results, Radio Task -> Poll()
+  FrameAggregator aggregator; // Unicasts Waiting to Share a Frame to their Next Hop
+  TxScheduler scheduler; // Every Frame Waits here for the Radio, by Class
+  bool failover_enabled;
+  bool repair_enabled;
+  repair_stats_t repairs;
+  uint8_t last_error_source[6]; // Last Route Error Sent, for the Holdoff
+  uint8_t last_error_hop[6];
+  uint32_t last_error_at;
+
+  uint32_t reported_drops; // Last Reported RX Drop Count
+  uint32_t reported_tx_drops; // Last Reported TX Queue Drop Count
+  uint32_t malformed_frames; // Frames that fail wire format validation
+  uint32_t reported_failures; // Last Reported Count of Packets Given Up
+  uint32_t failovers; // Packets Rerouted around a Next Hop that stopped Acking
+  uint32_t hop_losses; // ... and those with no Alternate
+};
+
+#endif
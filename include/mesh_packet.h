@@ -0,0 +1,41 @@
+#ifndef MESH_PACKET_H
+#define MESH_PACKET_H
+
+#include <cstdint>
+#include "mesh_config.h"
+
+#ifndef MAX_NODES
+#define MAX_NODES 9 // Longest path a packet carries, in hops
+#endif
+#define MAC_SIZE 6
+#define MESH_HEADER_BYTES 25 // Fixed part of every frame (WIRE_HEADER_SIZE)
+#ifndef MESH_TEXT_SIZE
+#define MESH_TEXT_SIZE (ESPNOW_MTU - MESH_HEADER_BYTES - MAX_NODES * MAC_SIZE + 1) // Payload + NUL. Fills a frame even with a full path of MACs
+#endif
+
+/* PACKET STRUCTURE */
+typedef struct message {
+  unsigned char text[MESH_TEXT_SIZE]; // Text (NUL-terminated) or binary payload
+  uint8_t Text_Length; // Bytes used in text, binary payloads may contain NUL
+  //int value;
+  //float temperature;
+  int TTL; // Time to live for packet
+  int identification; // 1-> BROADCAST, 2-> DATA, 3-> FRAGMENT, 4-> ROUTE ERROR
+  bool broadcast_Ack; //  0 -> Default Communication, 1 -> Acknowledgement of Broadcast
+  bool Data_Ack; // 0 -> Default Communication, 1 -> Acknowledgement of Data
+  uint8_t destination_mac[6]; // MAC Address of Receiver
+  uint8_t source_mac[6]; // MAC Address of Sender
+  int packetID; // Packet ID
+  uint8_t Path_Array[MAX_NODES][MAC_SIZE]; // Path Array
+  uint8_t Path_Index; // Index of Path Array
+  uint8_t Path_Length;  // Length of Path Array
+  bool Path_Exist;  // Check if Path Exists
+  bool Reliable; // Sent through the send window, Acks carry ack_seq/sack
+  bool New_Session; // Reliable Data among the first RTX_WINDOW seqs of a session, restarts the receive window
+  uint16_t seq; // Sequence Number per Source -> Destination
+  uint16_t ack_seq; // Data Ack: Every seq below this was received (Cumulative)
+  uint32_t sack; // Data Ack: Bit i set -> ack_seq + 1 + i was received (Selective)
+  bool Routed; // Forwarded hop by hop from the distance-vector table, carries no path
+} message_t;
+
+#endif
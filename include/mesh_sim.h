@@ -0,0 +1,232 @@
+#ifndef MESH_SIM_H
+#define MESH_SIM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <queue>
+#include <vector>
+#include "deferred_flash.h"
+#include "fake_hal.h"
+#include "mesh_node.h"
+
+#define SIM_TOPOLOGY_RANDOM 0 // Uniform in an area x area square
+#define SIM_TOPOLOGY_LINE 1
+#define SIM_TOPOLOGY_GRID 2 // 4-neighbour grid
+
+#define SIM_ROUTING_PATH 0 // Flooding + path arrays only
+#define SIM_ROUTING_DV 1 // Distance-vector table first, path arrays as fallback
+
+#define SIM_CHECK_MS 100 // Convergence sampling period
+#define SIM_FAIL_RELAY (-2) // fail_node: the first relay on node 0's route to the flow destination when it fails
+
+typedef struct sim_config {
+  uint32_t seed;
+  int nodes;
+  int topology; // SIM_TOPOLOGY_*
+  double area_m; // Side of the square for random placement
+  double range_m; // Radio range, nodes closer than this are neighbours
+  double loss; // Frame loss on every link
+  double edge_loss; // Extra loss at the edge of range, grows with (distance / range)^2
+  double rssi_1m; // Received signal strength at 1 m, dBm
+  double path_loss_exp; // Log-distance path loss exponent
+  uint32_t latency_us; // Driver and propagation delay per frame
+  uint32_t bitrate; // Bits per second on air
+  bool task; // Nodes run the mesh task: Poll() per queued frame and every MESH_TASK_TICK_MS
+  uint32_t poll_ms; // Otherwise the cadence of each node's loop()
+  int routing; // SIM_ROUTING_*
+  bool etx; // Price hops by measured link quality instead of counting them
+  int flood; // FloodMode
+  int flood_dup_limit; // Broadcast floods: copies heard that cancel a relay, 0 -> never
+  int gossip_percent; // Broadcast floods: chance to relay at all
+  bool aggregate; // Unicasts to the same next hop share frames
+  uint32_t aggregate_ms; // ... waiting this much longer than the end of a poll for company
+  bool peer_evict; // Radio peer slots are swapped LRU on demand; off -> first come, first registered
+  int hop_retries; // Local resends of a unicast its next hop did not ack, 0 -> none
+  bool failover; // Table-routed packets given up at a hop try a loop-free alternate next hop
+  bool repair; // Path arrays broken at a hop are reported to the source and repaired there
+  int fail_node; // Goes dark fail_ms after the first message, -1 -> none, or SIM_FAIL_RELAY
+  uint32_t fail_ms; // 0 -> a quarter of the way through the messages
+  int flow; // Every message from node 0 to this node, -1 -> random pairs
+  uint32_t flush_ms; // Flash commits batched by DeferredFlash for this long, 0 -> every Commit() goes to flash
+  uint32_t commit_ms; // A flash commit stalls the node's task this long
+  uint32_t warmup_ms; // Run time before the first message, lets routes settle
+  int messages; // Reliable messages offered
+  int blob_bytes; // > 0: messages are buffers of this size sent with Send_Buffer
+  uint32_t interval_ms; // Mean gap between messages (exponential)
+  uint32_t drain_ms; // Run time after the last message
+  bool verbose; // Node logs to stdout
+} sim_config_t;
+
+typedef struct sim_report {
+  int links;
+  double mean_degree;
+  int components;
+  int32_t converged_ms; // Every node has a route to its whole component, -1 if never
+  uint32_t control_frames; // Route updates on air
+  uint32_t control_bytes;
+  int offered; // Messages handed to Send_Reliable
+  int refused; // Send window full
+  int reachable; // Offered between nodes in the same component
+  int delivered; // Reached the destination at least once
+  int corrupt; // Buffers reassembled with the wrong length or content
+  uint32_t frames; // Transmissions on air, every hop and retransmit
+  uint32_t frames_lost; // Receptions lost to the link model
+  uint64_t packet_bytes; // Frames carrying mesh packets (not route updates), with 802.11/ESP-NOW overhead
+  uint64_t payload_bytes; // Text and fragment bytes carried in them
+  uint32_t batches; // Frames carrying several packets
+  uint32_t batched; // Packets that travelled in a batch
+  uint32_t rx_drops; // Frames dropped by full receive queues
+  uint32_t tx_drops; // Frames dropped by full transmit queues
+  uint32_t retransmits;
+  uint32_t hop_retries; // Frames resent at the hop that lost them
+  uint32_t hop_recovered; // ... and acked then
+  uint32_t failovers; // Packets rerouted to an alternate next hop
+  uint32_t hop_losses; // Packets a hop gave up on with no alternate
+  uint32_t path_breaks; // Path-routed packets whose next hop stopped acking
+  uint32_t path_repairs; // ... sent on by a route of the breaking node
+  uint32_t path_rediscoveries; // ... flooded again from there
+  uint32_t route_errors; // Route errors sent to sources
+  uint32_t routes_invalidated; // Stored paths dropped for a broken link, all nodes
+  int failed_node; // -1 if none failed
+  uint32_t failed_at_ms;
+  int sent_after_failure; // Messages offered from then on
+  int delivered_after_failure; // ... and delivered
+  int32_t recovery_ms; // Failure until the first of them arrived, -1 if none did
+  uint32_t fragments; // Fragments handed to the mesh, first rounds and resends
+  uint32_t fragments_resent;
+  uint32_t flood_relays; // Flood frames relayed
+  uint32_t flood_suppressed; // Relays cancelled by overheard copies
+  uint32_t peer_registrations; // Radio peers added, all nodes
+  uint32_t peer_evictions; // ... deleted to make room
+  uint32_t peer_hits; // Sends that found their peer registered
+  uint32_t peer_failures; // Sends that found no slot
+  int peers_max; // Most neighbours any node keeps
+  uint32_t flash_requests; // Commit() calls of the mesh cores
+  uint32_t flash_commits; // Commits that reached flash
+  uint32_t flash_stall_ms; // Task time lost to them, all nodes
+  uint32_t flash_stall_max_ms; // Longest single stall
+  int flash_stale; // Nodes whose flash, replayed after the shutdown flush, misses routes they hold
+  double latency_p50_ms;
+  double latency_p90_ms;
+  double latency_p99_ms;
+  double latency_max_ms;
+  uint32_t sim_time_ms;
+  uint64_t events;
+} sim_report_t;
+
+// Defaults: 100 nodes, 40 m range in a 200 m square, ESP-NOW 1 Mbps
+void SimDefaultConfig(sim_config_t *config);
+
+/* DISCRETE-EVENT MESH SIMULATOR */
+// Runs one unmodified MeshNode per simulated node in a single process. Frames become
+// events on a time-ordered queue: a transmission occupies the sender for its airtime,
+// then reaches every neighbour in range after the link latency unless the link model
+// drops it. Nodes run the mesh task: a Poll() shortly after a frame is queued, and a tick
+// with a random phase; or, with task off, only a loop() cadence like the old firmware.
+// Flash commits take commit_ms of the node's task, during which frames only queue up;
+// with flush_ms set they are batched by a DeferredFlash flushed between the node's Polls.
+// A failed node stops at once, as if it lost power: no frames, no acks, no task.
+// All randomness comes from the seed, so a run is exactly reproducible.
+// Not modelled: collisions between different senders and capture effects.
+class MeshSim : public RadioMedium {
+public:
+  MeshSim(const sim_config_t &config);
+  ~MeshSim();
+
+  sim_report_t Run();
+
+  // RadioMedium
+  void Attach(FakeRadio *radio);
+  void Transmit(FakeRadio *from, const uint8_t *to, const uint8_t *data, size_t len);
+
+private:
+  enum sim_event_type { SIM_EVENT_RX, SIM_EVENT_TX_DONE, SIM_EVENT_POLL, SIM_EVENT_SEND, SIM_EVENT_CHECK, SIM_EVENT_FLUSH, SIM_EVENT_FAIL };
+
+  typedef struct sim_event {
+    uint64_t at_us;
+    uint64_t order; // FIFO among events at the same time
+    sim_event_type type;
+    int node;
+    int peer; // RX: sender, SEND: destination, POLL: 1 for a task wakeup
+    int message; // SEND: message index, TX_DONE: success flag, RX: RSSI in dBm
+    std::vector<uint8_t> frame;
+  } sim_event_t;
+
+  struct sim_event_later {
+    bool operator()(const sim_event_t *a, const sim_event_t *b) const {
+      return a->at_us != b->at_us ? a->at_us > b->at_us : a->order > b->order;
+    }
+  };
+
+  // What the radio callbacks notify: schedules a Poll() once the task would run
+  class SimSignal : public Signal {
+  public:
+    SimSignal(MeshSim *sim, int node) : sim(sim), node(node) {}
+    void Notify() { sim->Wake(node); }
+    bool Wait(uint32_t timeout_ms) { (void)timeout_ms; return false; } // Time only passes between events
+
+  private:
+    MeshSim *sim;
+    int node;
+  };
+
+  typedef struct sim_node {
+    MeshSim *sim;
+    int index;
+    double x;
+    double y;
+    int component;
+    uint64_t busy_until_us; // Radio is transmitting until then
+    bool wake_pending; // Task Poll() scheduled, later notifications fold into it
+    uint64_t stalled_until_us; // Task is inside a flash commit until then
+    bool dead; // Failed: hears, sends and runs nothing from then on
+    std::vector<int> neighbours;
+    FakeRadio *radio;
+    FakeClock *clock;
+    SlowFlash *flash;
+    DeferredFlash *deferred; // In front of flash when flush_ms is set
+    ConsoleLogger *log;
+    SimSignal *signal;
+    MeshNode *node;
+    char prefix[16];
+  } sim_node_t;
+
+  typedef struct sim_message {
+    uint64_t sent_us;
+    uint64_t delivered_us;
+    bool delivered;
+  } sim_message_t;
+
+  static void Delivered(void *ctx, const message_t *packet);
+  static void BufferReceived(void *ctx, const uint8_t *source, const uint8_t *data, size_t len);
+  void Arrived(int id);
+  void Wake(int node);
+  bool Stalled(const sim_event_t *event) const;
+  void CheckFlash();
+  int FlowRelay();
+
+  uint32_t Next();
+  double Uniform();
+  void Place();
+  void Connect();
+  int NodeIndex(const uint8_t *mac) const;
+  double LinkLoss(int a, int b) const;
+  bool CountPayload(const uint8_t *data, size_t len);
+  int LinkRssi(int a, int b);
+  bool Converged() const;
+  sim_event_t *Schedule(uint64_t at_us, sim_event_type type, int node, int peer, int message);
+  void Dispatch(sim_event_t *event);
+
+  sim_config_t config;
+  uint32_t rng[4]; // xoshiro128** state
+  uint64_t now_us;
+  uint64_t event_order;
+  std::priority_queue<sim_event_t *, std::vector<sim_event_t *>, sim_event_later> events;
+  std::vector<sim_node_t> nodes;
+  std::vector<int> component_size;
+  std::vector<sim_message_t> messages;
+  uint64_t fail_us; // When fail_node went dark
+  sim_report_t report;
+};
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef MESH_TASK_H
+#define MESH_TASK_H
+
+#include <atomic>
+#include <cstdint>
+#include "deferred_flash.h"
+#include "mesh_hal.h"
+#include "mesh_node.h"
+
+#define MESH_TASK_TICK_MS 10 // Longest sleep without frames, timers (retransmits, backoffs, route updates) run at least this often
+
+typedef struct mesh_task_stats {
+  uint32_t iterations; // Poll() calls
+  uint32_t wakeups; // ... of them started by a queued frame rather than the tick
+} mesh_task_stats_t;
+
+/* MESH TASK */
+// Runs the mesh core in a task of its own instead of loop(). The radio callbacks only
+// fill the SPSC rings and notify the signal, the task wakes up, Poll()s and goes back
+// to sleep, so a frame is routed as soon as the Wi-Fi task hands it over rather than on
+// the next loop() pass. Sends need no task of their own: the send callback notifies the
+// signal too, and the TX scheduler hands the next frame to the radio from Poll(). From
+// Start() on, the node belongs to the task; application code talks to it from the work
+// function, which runs in the task before every Poll(). A DeferredFlash the node writes
+// through is flushed here too, after Poll(), so no other context touches its RAM image;
+// Stop() makes the task flush whatever is still pending on its way out.
+class MeshTask {
+public:
+  // Runs in the task, may send through node
+  typedef void (*WorkFn)(void *ctx, MeshNode &node);
+
+  MeshTask(MeshNode &node, Signal &signal);
+
+  void SetWork(WorkFn fn, void *ctx);
+  // Flush() it between Poll()s. It must be the flash the node writes through
+  void SetFlash(DeferredFlash *deferred) { flash = deferred; }
+  // Task body: returns once Stop() was called
+  void Run();
+  // Any context: Run() returns after the current Poll(), with the flash committed
+  void Stop();
+  // Run() has returned, node and flash are free for other contexts
+  bool Stopped() const { return stopped.load(std::memory_order_acquire); }
+
+  const mesh_task_stats_t &Stats() const { return stats; }
+
+private:
+  MeshNode &node;
+  Signal &signal;
+  WorkFn work;
+  void *work_ctx;
+  DeferredFlash *flash; // NULL -> the node commits flash itself
+  std::atomic<bool> running;
+  std::atomic<bool> stopped;
+  mesh_task_stats_t stats;
+};
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef PACKET_POOL_H
+#define PACKET_POOL_H
+
+#include "block_pool.h"
+#include "mesh_packet.h"
+
+#ifndef PACKET_POOL_SIZE
+#define PACKET_POOL_SIZE 4 // Packets built at once: sends nest (Send_Reliable -> first transmission, ack -> retransmit)
+#endif
+
+// One packet the node builds, from Configure_Packet() until it is encoded for the radio
+typedef struct packet_ctx {
+  message_t packet;
+  bool dest_known; // Destination already has a stored path, don't collect one on the way
+} packet_ctx_t;
+
+/* PACKET CONTEXT POOL */
+// Each packet the node originates (data, acks, fragments, retransmissions, discovery)
+// is built in a context of its own rather than in one shared message, so a send that
+// starts while another is half built, e.g. the first transmission inside
+// Send_Reliable(), cannot overwrite it. Received packets are rewritten in their RX
+// slot instead.
+typedef BlockPool<packet_ctx_t, PACKET_POOL_SIZE> PacketPool;
+
+#endif
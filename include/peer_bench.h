@@ -0,0 +1,22 @@
+#ifndef PEER_BENCH_H
+#define PEER_BENCH_H
+
+#include <cstdint>
+
+#define PEER_BENCH_MAX 1000 // Largest table the benchmark fills
+
+typedef struct peer_bench_report {
+  int entries;
+  uint32_t lookups; // Per layout, half of them for MACs that are not in the table
+  double heap_scan_ns; // vector of malloc'd MACs, memcmp each (the original table)
+  double array_scan_ns; // Fixed MAC array, memcmp each
+  double sorted_ns; // PeerTable: binary search over packed keys
+} peer_bench_report_t;
+
+/* PEER LOOKUP BENCHMARK */
+// Times one "is this MAC a peer" lookup in three layouts of the same random table:
+// scattered heap MACs, an inline MAC array and the sorted PeerTable, with hits and
+// misses mixed. Wall clock, so only the ratios mean much across machines.
+peer_bench_report_t RunPeerBench(int entries, uint32_t lookups);
+
+#endif
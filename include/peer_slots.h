@@ -0,0 +1,75 @@
+#ifndef PEER_SLOTS_H
+#define PEER_SLOTS_H
+
+#include <cstddef>
+#include <cstdint>
+#include "mesh_hal.h"
+#include "mesh_packet.h"
+
+#ifndef PEER_SLOTS
+#define PEER_SLOTS 20 // ESP_NOW_MAX_TOTAL_PEER_NUM, the broadcast peer included
+#endif
+#ifndef PEER_ENCRYPTED_SLOTS
+#define PEER_ENCRYPTED_SLOTS 6 // ESP_NOW_MAX_ENCRYPT_PEER_NUM (configurable from IDF 4.4 on, 6 is the floor)
+#endif
+
+typedef struct peer_slot {
+  uint8_t mac[MAC_SIZE];
+  bool encrypt; // Registered with the LMK
+  bool pinned; // Never evicted (broadcast address)
+  uint32_t used; // Acquire() tick of the last send, orders evictions
+} peer_slot_t;
+
+typedef struct peer_slot_stats {
+  uint32_t hits; // Sends whose peer was registered as needed
+  uint32_t registrations; // Peers added to the radio
+  uint32_t evictions; // Peers deleted to make room
+  uint32_t rekeys; // Registered, but with the other encryption setting
+  uint32_t failures; // The radio refused a registration
+} peer_slot_stats_t;
+
+/* ESP-NOW PEER SLOTS */
+// ESP-NOW sends only to registered peers and registers few of them (fewer still with
+// encryption), so a node can have more neighbours than it can register at once. The
+// peer table (peer_table.h) is the neighbour set; this is the radio's peer list.
+// Acquire() makes sure a peer is registered, with the right encryption, right before a
+// frame is sent to it. When no slot is free, the least recently used one is evicted;
+// an encrypted peer evicts encrypted ones first, because they run out earlier.
+// The slots cache what was registered, so a hit costs no driver call, and they own the
+// radio's peer list: nothing else may add or delete peers. Acquire() runs only in the
+// one context that hands frames to the radio (TxScheduler), after the pins are set.
+// Receiving needs no slot for plain frames. An encrypted frame only decrypts at a
+// receiver that has the sender registered too, which this cannot know.
+class PeerSlots {
+public:
+  PeerSlots(Radio &radio);
+
+  // Register mac for good, before any Acquire()
+  bool Pin(const uint8_t *mac, bool encrypt);
+  // mac is registered with encrypt once this returns true
+  bool Acquire(const uint8_t *mac, bool encrypt);
+  // Off -> Acquire() fails once the slots are full instead of evicting (the old behaviour)
+  void SetEviction(bool enabled) { evict = enabled; }
+
+  bool Registered(const uint8_t *mac) const { return Find(mac) >= 0; }
+  size_t Count() const { return count; }
+  size_t Encrypted() const { return encrypted; }
+  const peer_slot_stats_t &Stats() const { return stats; }
+
+private:
+  int Find(const uint8_t *mac) const;
+  // Least recently used slot that may go, encrypted ones only if asked. -1 if none
+  int Victim(bool encrypted_only) const;
+  bool Evict(int i);
+  bool Register(const uint8_t *mac, bool encrypt, bool pinned);
+
+  Radio &radio;
+  peer_slot_t slots[PEER_SLOTS];
+  size_t count;
+  size_t encrypted;
+  uint32_t tick;
+  bool evict;
+  peer_slot_stats_t stats;
+};
+
+#endif
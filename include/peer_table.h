@@ -0,0 +1,145 @@
+#ifndef PEER_TABLE_H
+#define PEER_TABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "mesh_hal.h"
+#include "mesh_packet.h"
+
+typedef struct peer_info {
+  uint32_t last_seen; // millis() of the last frame from the peer, 0 -> never heard
+  uint32_t frames_received;
+  uint32_t sent; // Unicasts to the peer with a send result
+  uint32_t failed; // ... of which got no MAC-layer ack
+  int8_t rssi; // dBm of the last frame, RADIO_RSSI_UNKNOWN if none
+  bool encrypted; // Registered with the LMK
+} peer_info_t;
+
+/* SORTED PEER TABLE */
+// The ESP-NOW peers of this node, stored inline without heap. Each MAC is packed into a
+// 48-bit integer key. The keys are kept sorted in an array of their own, so a lookup is
+// a binary search that reads nothing but contiguous keys. The metadata sits at the same
+// index in a parallel array. Add and Remove shift the tail, which is cheap at the size
+// of a peer list. Indices run in MAC order and change on Add/Remove. N is the capacity;
+// a full table refuses new peers.
+template <size_t N>
+class PeerTable {
+public:
+  PeerTable() : count(0) {}
+
+  static uint64_t Key(const uint8_t *mac) {
+    uint64_t key = 0;
+    for(int i = 0; i < MAC_SIZE; i++) {
+      key = (key << 8) | mac[i]; // Big-endian, keys sort like the MACs
+    }
+    return key;
+  }
+
+  static void Mac(uint64_t key, uint8_t *mac) {
+    for(int i = MAC_SIZE - 1; i >= 0; i--) {
+      mac[i] = (uint8_t)key;
+      key >>= 8;
+    }
+  }
+
+  // Index of mac, -1 if it is not a peer
+  int Find(const uint8_t *mac) const { return FindKey(Key(mac)); }
+
+  int FindKey(uint64_t key) const {
+    size_t lo = LowerBound(key);
+    return lo < count && keys[lo] == key ? (int)lo : -1;
+  }
+
+  bool Contains(const uint8_t *mac) const { return Find(mac) >= 0; }
+
+  // Metadata of mac, NULL if it is not a peer
+  peer_info_t *Lookup(const uint8_t *mac) {
+    int i = Find(mac);
+    return i >= 0 ? &info[i] : NULL;
+  }
+
+  // Insert mac in order. True if it is in the table afterwards, false only when full
+  bool Add(const uint8_t *mac) {
+    uint64_t key = Key(mac);
+    size_t at = LowerBound(key);
+    if(at < count && keys[at] == key) {
+      return true;
+    }
+    if(count == N) {
+      return false;
+    }
+    memmove(&keys[at + 1], &keys[at], (count - at) * sizeof(keys[0]));
+    memmove(&info[at + 1], &info[at], (count - at) * sizeof(info[0]));
+    keys[at] = key;
+    memset(&info[at], 0, sizeof(info[at]));
+    info[at].rssi = RADIO_RSSI_UNKNOWN;
+    count++;
+    return true;
+  }
+
+  bool Remove(const uint8_t *mac) {
+    int i = Find(mac);
+    if(i < 0) {
+      return false;
+    }
+    count--;
+    memmove(&keys[i], &keys[i + 1], (count - i) * sizeof(keys[0]));
+    memmove(&info[i], &info[i + 1], (count - i) * sizeof(info[0]));
+    return true;
+  }
+
+  void Clear() { count = 0; }
+
+  // Frame heard from mac; nothing if it is not a peer
+  void OnReceive(const uint8_t *mac, int rssi, uint32_t now) {
+    peer_info_t *peer = Lookup(mac);
+    if(peer != NULL) {
+      peer->last_seen = now;
+      peer->frames_received++;
+      peer->rssi = (int8_t)(rssi < RADIO_RSSI_UNKNOWN ? RADIO_RSSI_UNKNOWN : (rssi > 127 ? 127 : rssi));
+    }
+  }
+
+  // Ack result of a unicast to mac
+  void OnSent(const uint8_t *mac, bool success) {
+    peer_info_t *peer = Lookup(mac);
+    if(peer != NULL) {
+      peer->sent++;
+      peer->failed += !success;
+    }
+  }
+
+  // Walk the table by index, 0 .. Count() - 1
+  uint64_t KeyAt(size_t i) const { return keys[i]; }
+  void MacAt(size_t i, uint8_t *mac) const { Mac(keys[i], mac); }
+  const peer_info_t &InfoAt(size_t i) const { return info[i]; }
+  peer_info_t &InfoAt(size_t i) { return info[i]; }
+
+  size_t Count() const { return count; }
+  bool Full() const { return count == N; }
+  static size_t Capacity() { return N; }
+
+private:
+  // First index whose key is not below key. The halving compiles to conditional moves,
+  // so a search costs log2(n) loads and no mispredicted branches
+  size_t LowerBound(uint64_t key) const {
+    if(count == 0) {
+      return 0;
+    }
+    const uint64_t *base = keys;
+    size_t n = count;
+    while(n > 1) {
+      size_t half = n / 2;
+      base = base[half] < key ? base + half : base;
+      n -= half;
+    }
+    return (size_t)(base - keys) + (*base < key);
+  }
+
+  uint64_t keys[N];
+  peer_info_t info[N];
+  size_t count;
+};
+
+#endif
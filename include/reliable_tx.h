@@ -0,0 +1,100 @@
+#ifndef RELIABLE_TX_H
+#define RELIABLE_TX_H
+
+#include <cstddef>
+#include <cstdint>
+#include "mesh_packet.h"
+#include "rto_estimator.h"
+
+#ifndef RTX_WINDOW
+#define RTX_WINDOW 8 // In-flight packets per destination (<= 32, the SACK width), the same on every node
+#endif
+#ifndef RTX_PEERS
+#define RTX_PEERS 4 // Destinations/sources with an open window
+#endif
+#ifndef RTX_MAX_TRIES
+#define RTX_MAX_TRIES 3 // Transmissions before a packet is given up
+#endif
+
+// One packet waiting for its ack
+typedef struct rtx_slot {
+  message_t packet;
+  uint32_t sent_at; // millis() of last transmission
+  uint8_t tries;
+  bool in_use;
+} rtx_slot_t;
+
+// Sender side: packets in flight to one destination
+typedef struct send_window {
+  uint8_t dest[MAC_SIZE];
+  uint16_t first_seq; // Seq the session started from
+  uint16_t base; // Oldest unacknowledged seq
+  uint16_t next_seq;
+  rtx_slot_t slots[RTX_WINDOW]; // Indexed by seq % RTX_WINDOW
+  rto_estimator_t rto; // Adapted from acks of packets sent once
+  bool used;
+} send_window_t;
+
+// Receiver side: what has arrived from one source
+typedef struct recv_window {
+  uint8_t source[MAC_SIZE];
+  uint16_t start; // Seq the session was picked up at
+  uint16_t expected; // Every seq below this was received or has left the sender's window
+  uint32_t received; // Bit i set -> expected + 1 + i was received
+  bool used;
+} recv_window_t;
+
+typedef struct rtx_stats {
+  uint32_t sent;
+  uint32_t retransmits;
+  uint32_t acked;
+  uint32_t failed; // Given up after RTX_MAX_TRIES
+  uint32_t duplicates; // Received again after delivery (ack was lost)
+  uint32_t rtt_samples;
+} rtx_stats_t;
+
+/* SLIDING WINDOW RELIABLE TRANSPORT */
+// Selective repeat with up to RTX_WINDOW packets in flight per destination. Data Acks
+// carry a cumulative ack_seq and a 32-bit selective ack bitmap, so one ack frees every
+// packet it covers and a single loss only retransmits that packet.
+class ReliableTransport {
+public:
+  // Hands a packet to the radio layer. Called for first transmissions and retransmits.
+  typedef bool (*TransmitFn)(const message_t *packet, void *ctx);
+
+  ReliableTransport(TransmitFn transmit, void *ctx);
+
+  // Assign a seq and transmit. Returns false when the window to that destination is full.
+  bool Send(const message_t *packet, uint32_t now);
+  // Receiver: record a reliable DATA packet and fill ack_seq/sack for the reply.
+  // Returns true if it is new, false if it was already delivered.
+  bool OnData(const message_t *packet, uint16_t *ack_seq, uint32_t *sack);
+  // Sender: free every in-flight packet covered by an ack from dest and sample the RTT
+  void OnAck(const uint8_t *dest, uint16_t ack_seq, uint32_t sack, uint32_t now);
+  // Retransmit packets whose timeout expired, give up after RTX_MAX_TRIES
+  void Poll(uint32_t now);
+
+  // Free window slots towards dest
+  size_t Available(const uint8_t *dest) const;
+  size_t InFlight() const;
+  // Smoothed RTT and current RTO towards dest in ms, 0 if no sample yet
+  uint32_t SmoothedRtt(const uint8_t *dest) const;
+  uint32_t CurrentRto(const uint8_t *dest) const;
+  const rtx_stats_t &Stats() const { return stats; }
+
+private:
+  send_window_t *SendWindow(const uint8_t *dest, bool create, uint16_t initial_seq);
+  const send_window_t *FindSendWindow(const uint8_t *dest) const;
+  recv_window_t *RecvWindow(const uint8_t *source);
+  void AdvanceBase(send_window_t *window);
+  uint32_t Timeout(const send_window_t *window, const rtx_slot_t *slot) const;
+
+  TransmitFn transmit;
+  void *ctx;
+  send_window_t send_windows[RTX_PEERS];
+  recv_window_t recv_windows[RTX_PEERS];
+  int recv_victim; // Next receive window to reuse when all are taken
+  rtx_stats_t stats;
+};
+
+#endif
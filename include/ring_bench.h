@@ -0,0 +1,22 @@
+#ifndef RING_BENCH_H
+#define RING_BENCH_H
+
+#include <cstdint>
+
+typedef struct ring_bench_report {
+  uint32_t frames; // Per run
+  double inline_ns; // Reserve, fill, Commit, Peek, Release on one thread, per frame
+  double threaded_fps; // Frames/s from a producer thread to a consumer thread
+  uint32_t full; // Reserve() calls the producer found the ring full, retried
+  uint32_t out_of_order; // Frames the consumer saw out of sequence, must be 0
+} ring_bench_report_t;
+
+/* RECEIVE RING BENCHMARK */
+// Pushes frames through the receive ring of MeshNode (rx_slot_t, RX_QUEUE_DEPTH) the
+// way On_Data_Receive and Poll() use it: once back to back on one thread, for the cost
+// of the ring itself, and once from a producer thread to a consumer thread, as the
+// Wi-Fi task and the mesh task do. Each frame carries a sequence number the consumer
+// checks. Wall clock, so only the ratios mean much across machines.
+ring_bench_report_t RunRingBench(uint32_t frames);
+
+#endif
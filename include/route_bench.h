@@ -0,0 +1,22 @@
+#ifndef ROUTE_BENCH_H
+#define ROUTE_BENCH_H
+
+#include <cstdint>
+
+#define ROUTE_BENCH_EEPROM 512 // Size of the original path store, its start address in the last byte
+
+typedef struct route_bench_report {
+  int entries; // Stored paths, 3 hops each
+  uint32_t lookups; // Per layout, half of them for destinations without a path
+  double scan_ns; // LoadPathFromEEPROM: byte scan of the EEPROM image into a vector
+  double cache_ns; // RouteCache::Lookup and the copy of its path into the packet
+} route_bench_report_t;
+
+/* ROUTE LOOKUP BENCHMARK */
+// Times "load the path to this destination into the packet" the way Send_Data did it
+// before the route cache, scanning the EEPROM image byte by byte through the flash
+// backend (EEPROM.read on the device), against RouteCache with the same paths.
+// Wall clock, so only the ratios mean much across machines.
+route_bench_report_t RunRouteBench(int entries, uint32_t lookups);
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef ROUTE_CACHE_H
+#define ROUTE_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include "mesh_packet.h"
+
+#ifndef ROUTE_CACHE_SIZE
+#define ROUTE_CACHE_SIZE 32 // Slots (Power of 2), keep well above the number of destinations
+#endif
+#define ROUTE_CACHE_MAX_DELETED (ROUTE_CACHE_SIZE / 4) // Tombstones a new destination finds before the table is rebuilt
+
+enum RouteSlotState {
+  ROUTE_SLOT_EMPTY,
+  ROUTE_SLOT_USED,
+  ROUTE_SLOT_DELETED, // Tombstone, keeps probe chains intact
+};
+
+// One Stored Route. path[0] is this node, path[path_len - 1] is the destination
+typedef struct route_entry {
+  uint8_t dest[MAC_SIZE];
+  uint8_t next_hop[MAC_SIZE];
+  uint8_t path[MAX_NODES][MAC_SIZE];
+  uint8_t path_len;
+  uint8_t state;
+  uint32_t learned; // millis() when the route was stored (age)
+} route_entry_t;
+
+/* IN-RAM ROUTE TABLE */
+// Fixed-size open addressing hash keyed by destination MAC with linear probing.
+// Sits in front of the EEPROM path store so the send path never scans flash.
+// Remove() leaves a tombstone unless it ends a probe chain, and never moves an entry,
+// so a walk over Slot() may remove as it goes. Tombstones left behind would make
+// misses scan the whole table: inserting a new destination rebuilds the table in
+// place once there are ROUTE_CACHE_MAX_DELETED of them, which may move entries.
+class RouteCache {
+  static_assert((ROUTE_CACHE_SIZE & (ROUTE_CACHE_SIZE - 1)) == 0, "Route cache size must be a power of two");
+
+public:
+  RouteCache() { Clear(); }
+
+  // Route to dest, NULL if unknown
+  route_entry_t *Lookup(const uint8_t *dest);
+  // Store a path (this node first, destination last). Returns false if the table is full or the path is invalid.
+  // Pointers from Lookup() and Slot() do not survive it
+  bool Insert(const uint8_t path[][MAC_SIZE], uint8_t path_len, uint32_t now);
+  bool Remove(const uint8_t *dest);
+  void Clear();
+
+  // Slot i if it holds a route, NULL otherwise (for walking the whole table)
+  const route_entry_t *Slot(size_t i) const {
+    return entries[i].state == ROUTE_SLOT_USED ? &entries[i] : NULL;
+  }
+
+  size_t Count() const { return count; }
+  size_t Deleted() const { return deleted; } // Tombstones
+  static size_t Capacity() { return ROUTE_CACHE_SIZE; }
+
+private:
+  static uint32_t Hash(const uint8_t *mac);
+  void Rebuild();
+
+  route_entry_t entries[ROUTE_CACHE_SIZE];
+  size_t count;
+  size_t deleted;
+};
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef ROUTE_STORE_H
+#define ROUTE_STORE_H
+
+#include <cstddef>
+#include <cstdint>
+#include "flash_backend.h"
+#include "route_cache.h"
+
+/* LOG-STRUCTURED ROUTE STORE */
+// The store region is split into ROUTE_STORE_BANKS equal banks. Only one bank is active:
+//
+//   bank header: 'R' 'S' version generation(4, LE) crc16(2)
+//   record:      length type payload[length] crc16(2)      (length 0xFF = end of log)
+//
+// Route updates are appended to the active bank. When it is full the live routes are
+// compacted into the next bank with generation + 1. The header is written last, so a
+// reset during compaction leaves the previous bank the newest. Both banks sit in the same
+// EEPROM image, which the Arduino emulation commits as one NVS blob: the banks protect
+// against torn writes, they do not spread wear (NVS does its own).
+// At boot the bank with a valid header and the highest generation is replayed; a record
+// with a bad CRC (torn write) ends the log.
+#define ROUTE_STORE_BANKS 2
+#define ROUTE_STORE_VERSION 1
+#define ROUTE_STORE_HEADER_SIZE 9
+#define ROUTE_RECORD_MAX (4 + 1 + MAX_NODES * MAC_SIZE) // Framing, then an ADD payload with a full path
+#ifndef ROUTE_STORE_BANK_SIZE
+#define ROUTE_STORE_BANK_SIZE (ROUTE_STORE_HEADER_SIZE + ROUTE_CACHE_SIZE * ROUTE_RECORD_MAX) // Compaction of a full cache fits
+#endif
+#define ROUTE_STORE_SIZE (ROUTE_STORE_BANKS * ROUTE_STORE_BANK_SIZE)
+
+static_assert(ROUTE_STORE_BANK_SIZE >= ROUTE_STORE_HEADER_SIZE + ROUTE_CACHE_SIZE * ROUTE_RECORD_MAX,
+              "Route store bank cannot hold a full route cache");
+
+#define ROUTE_RECORD_ADD 1 // payload: path_len, path_len MACs (this node first)
+#define ROUTE_RECORD_DEL 2 // payload: destination MAC
+
+typedef struct route_store_stats {
+  uint32_t commits;     // Flash commits issued
+  uint32_t compactions; // Bank switches
+  uint32_t bytes_written;
+  uint32_t records_replayed;
+  uint32_t records_corrupt; // Replay stopped at a bad CRC
+} route_store_stats_t;
+
+class RouteStore {
+public:
+  // Store occupies [base, base + size) of the flash image
+  RouteStore(FlashBackend &flash, size_t base, size_t size);
+
+  // Find the newest bank and replay it into cache. Formats the region if no bank is valid.
+  bool Mount(RouteCache &cache);
+  // Persist a route that has just been inserted/replaced in cache
+  bool SaveRoute(const route_entry_t *route, RouteCache &cache);
+  // Persist removal of a route that has just been removed from cache
+  bool RemoveRoute(const uint8_t *dest, RouteCache &cache);
+  // Erase all banks and start generation 1 in bank 0
+  bool Format();
+
+  const route_store_stats_t &Stats() const { return stats; }
+  size_t BankSize() const { return bank_size; }
+  size_t FreeBytes() const { return bank_size - write_offset; }
+
+private:
+  size_t BankAddr(int bank) const { return base + bank * bank_size; }
+  bool ReadHeader(int bank, uint32_t *generation) const;
+  void WriteHeader(int bank, uint32_t generation);
+  void EraseBank(int bank);
+  // Write one record at the log tail without committing. Returns false if the bank is full.
+  bool WriteRecord(uint8_t type, const uint8_t *payload, uint8_t len);
+  bool AppendRecord(uint8_t type, const uint8_t *payload, uint8_t len, RouteCache &cache);
+  // Move every live route in cache into the next bank
+  bool Compact(RouteCache &cache);
+  size_t Replay(int bank, RouteCache &cache);
+  bool Commit();
+
+  FlashBackend &flash;
+  size_t base;
+  size_t bank_size;
+  int active_bank;
+  uint32_t generation;
+  size_t write_offset; // Log tail, relative to the active bank
+  route_store_stats_t stats;
+};
+
+#endif
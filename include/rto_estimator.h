@@ -0,0 +1,63 @@
+#ifndef RTO_ESTIMATOR_H
+#define RTO_ESTIMATOR_H
+
+#include <cstdint>
+
+#define RTO_INITIAL_MS 1000 // Before the first RTT sample
+#define RTO_MIN_MS 20
+#define RTO_MAX_MS 12000
+#define RTO_GRANULARITY_MS 1 // millis() resolution
+
+/* RETRANSMISSION TIMEOUT ESTIMATOR (JACOBSON/KARELS, RFC 6298) */
+// One per destination. Fixed point: srtt is kept x8 and rttvar x4 so the 1/8 and 1/4
+// gains are shifts. Callers apply Karn's rule by only sampling packets sent once.
+typedef struct rto_estimator {
+  uint32_t srtt8;   // Smoothed RTT x8 (ms)
+  uint32_t rttvar4; // RTT variation x4 (ms)
+  uint32_t rto;     // Current timeout (ms)
+  bool sampled;     // At least one sample taken
+} rto_estimator_t;
+
+static inline uint32_t RtoClamp(uint32_t rto) {
+  if(rto < RTO_MIN_MS) {
+    return RTO_MIN_MS;
+  }
+  return rto > RTO_MAX_MS ? RTO_MAX_MS : rto;
+}
+
+static inline void RtoInit(rto_estimator_t *est) {
+  est->srtt8 = 0;
+  est->rttvar4 = 0;
+  est->rto = RTO_INITIAL_MS;
+  est->sampled = false;
+}
+
+static inline void RtoSample(rto_estimator_t *est, uint32_t rtt) {
+  if(!est->sampled) {
+    // First sample: SRTT = R, RTTVAR = R/2
+    est->srtt8 = rtt << 3;
+    est->rttvar4 = (rtt >> 1) << 2;
+    est->sampled = true;
+  } else {
+    int32_t err = (int32_t)rtt - (int32_t)(est->srtt8 >> 3);
+    est->srtt8 += err; // SRTT += (R - SRTT) / 8
+    if(err < 0) {
+      err = -err;
+    }
+    est->rttvar4 += err - (int32_t)(est->rttvar4 >> 2); // RTTVAR += (|R - SRTT| - RTTVAR) / 4
+  }
+
+  uint32_t var = est->rttvar4 > RTO_GRANULARITY_MS ? est->rttvar4 : RTO_GRANULARITY_MS; // max(G, 4 * RTTVAR)
+  est->rto = RtoClamp((est->srtt8 >> 3) + var);
+}
+
+// Timeout for a packet already sent tries times: exponential backoff on the current RTO
+static inline uint32_t RtoBackoff(const rto_estimator_t *est, uint8_t tries) {
+  uint32_t rto = est->rto;
+  for(uint8_t i = 1; i < tries && rto < RTO_MAX_MS; i++) {
+    rto <<= 1;
+  }
+  return RtoClamp(rto);
+}
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef RX_BENCH_H
+#define RX_BENCH_H
+
+#include <cstdint>
+
+#define RX_BENCH_CASES 3 // For this node, forwarded, TTL expired
+
+typedef struct rx_bench_case {
+  const char *name;
+  uint32_t legacy_frame_bytes; // On air
+  uint32_t frame_bytes;
+  uint32_t legacy_copied; // Bytes moved per frame by the original receive path
+  uint32_t copied; // ... by On_Data_Receive and Poll() now
+  uint32_t zeroed; // ... cleared by the decode now (the slot but its text is reset first)
+  double legacy_ns; // Per frame
+  double ns;
+  double legacy_cycles; // Per frame, time-stamp counter ticks; 0 where there is none
+  double cycles;
+} rx_bench_case_t;
+
+typedef struct rx_bench_report {
+  uint32_t frames; // Per case and path
+  rx_bench_case_t cases[RX_BENCH_CASES];
+} rx_bench_report_t;
+
+/* RECEIVE PATH BENCHMARK */
+// The receive callback as it was, on the raw struct frame: memcpy into the global
+// msg, field by field into a malloc'd queue node, and once more through
+// StoreContentsInNode for a forward. Against the path now: MessageView checks the
+// frame and decides on the header alone, and one decode moves it into a ring slot.
+// Bytes are counted per copy; times include the allocator on the old path and the
+// ring on the new one. Logging is left out of both. On x86, GCC inlines the decode's
+// variable-length copies as rep movs/stos, whose start-up cost dominates at these sizes;
+// -mstringop-strategy=libcall times it with libc memcpy, as the ESP32 build runs it.
+rx_bench_report_t RunRxBench(uint32_t frames);
+
+#endif
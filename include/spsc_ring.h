@@ -0,0 +1,74 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Keep producer and consumer indices on separate cache lines
+#ifndef MESH_CACHE_LINE
+#define MESH_CACHE_LINE 32
+#endif
+
+/* SINGLE PRODUCER / SINGLE CONSUMER RING */
+// Fixed number of preallocated slots. The producer (Wi-Fi task) fills a slot in place
+// and commits it, the consumer (loop) peeks the oldest slot and releases it when done.
+// No locks and no heap: head is only written by the producer, tail only by the consumer.
+template <typename T, size_t N>
+class SpscRing {
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "Ring capacity must be a power of two");
+
+public:
+  SpscRing() : head(0), enqueued(0), dropped(0), tail(0) {}
+
+  // Producer: Get the next free slot. Returns NULL (and counts a drop) when the ring is full
+  T *Reserve() {
+    uint32_t h = head.load(std::memory_order_relaxed);
+    if(h - tail.load(std::memory_order_acquire) >= N) {
+      dropped.fetch_add(1, std::memory_order_relaxed);
+      return NULL;
+    }
+    return &slots[h & (N - 1)];
+  }
+
+  // Producer: Publish the slot returned by Reserve()
+  void Commit() {
+    head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    enqueued.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // Consumer: Oldest committed slot, NULL if empty
+  T *Peek() {
+    uint32_t t = tail.load(std::memory_order_relaxed);
+    if(t == head.load(std::memory_order_acquire)) {
+      return NULL;
+    }
+    return &slots[t & (N - 1)];
+  }
+
+  // Consumer: Hand the slot returned by Peek() back to the producer
+  void Release() {
+    tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+  }
+
+  bool Empty() const {
+    return tail.load(std::memory_order_acquire) == head.load(std::memory_order_acquire);
+  }
+
+  size_t Size() const {
+    return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+  }
+
+  static size_t Capacity() { return N; }
+  uint32_t Enqueued() const { return enqueued.load(std::memory_order_relaxed); }
+  uint32_t Dropped() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+  alignas(MESH_CACHE_LINE) std::atomic<uint32_t> head; // Written by producer only
+  std::atomic<uint32_t> enqueued; // Frames accepted
+  std::atomic<uint32_t> dropped;  // Frames rejected because the ring was full
+  alignas(MESH_CACHE_LINE) std::atomic<uint32_t> tail; // Written by consumer only
+  alignas(MESH_CACHE_LINE) T slots[N];
+};
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef STORE_BENCH_H
+#define STORE_BENCH_H
+
+#include <cstddef>
+#include <cstdint>
+
+#define STORE_BENCH_EEPROM 512 // Size of the original path store, its start address in the last byte
+#define STORE_BENCH_DESTINATIONS 12 // Destinations whose paths keep changing
+#define STORE_BENCH_IMAGE "/tmp/mesh_store_bench.img" // File image, removed afterwards
+
+typedef struct store_bench_layout {
+  uint32_t commits; // Flash commits, each writes the file image out whole
+  uint32_t bytes_written; // Bytes written into the image
+  double update_us; // Per route update, file commits included
+  double boot_us; // Boot: the original wipes the image, the store replays its log
+  int current; // Destinations whose latest path flash held before the reboot
+  int recovered; // Routes known after the reboot
+} store_bench_layout_t;
+
+typedef struct store_bench_report {
+  uint32_t updates; // New paths, over STORE_BENCH_DESTINATIONS destinations
+  store_bench_layout_t eeprom; // Original 0x00-delimited layout
+  store_bench_layout_t store; // RouteStore
+  uint32_t compactions; // Bank switches of the store
+  bool replay_ok; // The store replayed exactly the routes the cache held
+} store_bench_report_t;
+
+/* ROUTE STORE BENCHMARK */
+// Persists the same stream of path updates with the original firmware's EEPROM layout
+// (scan for the destination, append at the first 0xFF, commit per path, wipe at boot)
+// and with RouteStore, both against a FileFlash image, then reboots from the file.
+// Wall clock, so only the ratios mean much across machines.
+store_bench_report_t RunStoreBench(uint32_t updates);
+
+#endif
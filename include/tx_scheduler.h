@@ -0,0 +1,140 @@
+#ifndef TX_SCHEDULER_H
+#define TX_SCHEDULER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "mesh_packet.h"
+#include "spsc_ring.h"
+#include "wire_format.h"
+
+#ifndef TX_CONTROL_DEPTH
+#define TX_CONTROL_DEPTH 8 // Acks, discovery and route updates (Power of 2)
+#endif
+#ifndef TX_FORWARD_DEPTH
+#define TX_FORWARD_DEPTH 16 // Frames relayed for other nodes (Power of 2)
+#endif
+#ifndef TX_ORIGIN_DEPTH
+#define TX_ORIGIN_DEPTH 8 // Frames this node originates (Power of 2)
+#endif
+#define TX_FORWARD_WEIGHT 3 // Forwarded frames sent per round while both data queues wait
+#define TX_ORIGIN_WEIGHT 1 // Originated frames per round, 0 -> only when nothing is forwarded
+#define TX_SENT_TIMEOUT_MS 100 // Send callback that never came, stop waiting for it
+#define TX_RESULT_COUNT_SHIFT 9 // Send results are published as (count << 9) | (last MAC byte << 1) | success
+#ifndef TX_HOP_RETRIES
+#define TX_HOP_RETRIES 3 // Resends of a unicast its next hop did not ack, 0 -> give up at once
+#endif
+#define TX_RETRY_BACKOFF_MS 2 // Wait before the first resend, doubles with each one
+#ifndef TX_FAILED_DEPTH
+#define TX_FAILED_DEPTH 4 // Frames given up on, waiting for the mesh core to reroute them (Power of 2)
+#endif
+
+// Most urgent first
+enum TxClass {
+  TX_CLASS_CONTROL, // Strict priority: a late ack costs a retransmission
+  TX_CLASS_FORWARD,
+  TX_CLASS_ORIGIN,
+  TX_CLASSES
+};
+
+// Frame waiting for the radio
+typedef struct tx_frame {
+  uint8_t mac[MAC_SIZE];
+  uint8_t len;
+  bool encrypt; // Receiver talks with the LMK, decides how a missing peer slot is registered
+  uint8_t cls; // TxClass it was queued with
+  uint8_t tries; // Resends so far
+  uint8_t data[WIRE_MAX_FRAME];
+} tx_frame_t;
+
+typedef struct tx_stats {
+  uint32_t queued[TX_CLASSES];
+  uint32_t sent[TX_CLASSES]; // Handed to the radio, send_errors included
+  uint32_t dropped[TX_CLASSES]; // Queue was full
+  uint32_t send_errors; // Rejected by the radio, never on air
+  uint32_t timeouts; // Send callbacks given up on, the frame counts as not acked
+  uint32_t retries; // Resends after a failed send result
+  uint32_t recovered; // Resent frames the next hop acked
+  uint32_t failed; // Frames still not acked after every resend, handed back
+  uint32_t failed_dropped; // ... lost because nobody took the earlier ones yet
+} tx_stats_t;
+
+/* TRANSMIT SCHEDULER */
+// Owns the radio: every frame is queued by class and sent one at a time, the next one
+// only after the radio reported the previous one (ESP-NOW's send callback), so a burst
+// cannot overrun the driver and nothing queued behind it waits longer than one frame.
+// Control frames always go first; forwarded and originated frames share what is left
+// by weighted round robin, so relaying for others cannot starve our own traffic and
+// the other way round. Only the mesh task touches the queues and the radio: the send
+// callback in the Wi-Fi task just records the result (OnSent()), Poll() acts on it and
+// sends the next frame. The callback carries no tag of the frame, so the results are
+// counted: they come in send order, one frame is outstanding at a time, so the latest
+// result is the outstanding frame's once the count moved on from the one it was sent
+// after. A frame whose result does not come within TX_SENT_TIMEOUT_MS counts as not
+// acked. Its result may be lost or only late: a late one that comes before the next
+// frame's own is told apart by the last byte of the hop's MAC, one that comes while
+// nothing is outstanding is skipped. Only a late result for the same hop can be taken
+// for the next frame's, which prices the same link either way.
+// A unicast the next hop did not ack is resent from here, up to TX_HOP_RETRIES times
+// with a doubling backoff, ahead of everything else once it is due; frames go out in
+// between. One frame waits for a resend at a time, one that fails meanwhile is given
+// up at once. Given up frames wait in PeekFailed() for the mesh core to reroute them,
+// so a lossy hop is repaired where it is instead of by an end-to-end retransmission.
+// Backoffs only run out when someone pumps the queues: at the latest the next Poll().
+class TxScheduler {
+public:
+  // Hands a frame to the radio. False -> it will not report this frame
+  typedef bool (*SendFn)(void *ctx, const uint8_t *mac, const uint8_t *frame, size_t len, bool encrypt);
+
+  TxScheduler(SendFn send, void *ctx);
+
+  // Frames of each data class per round, origin 0 -> forwarded frames always win
+  void Configure(uint8_t forward_weight, uint8_t origin_weight);
+  // Queue a frame, sent right away if the radio is idle. False if the class queue is full
+  bool Enqueue(TxClass cls, const uint8_t *mac, const uint8_t *frame, size_t len, uint32_t now, bool encrypt = false);
+  // Resends per frame, 0 -> report every failed send result at once
+  void SetRetries(uint8_t retries) { max_retries = retries; }
+  // Radio reported its next send result (Wi-Fi task), success is the MAC-layer ack.
+  // Only records it: Poll() acts on it, so wake the mesh task after this
+  void OnSent(const uint8_t *mac, bool success = true);
+  // Act on the outstanding frame's result or stop waiting for an overdue one, send what is queued
+  void Poll(uint32_t now);
+
+  size_t Queued(TxClass cls) const;
+  bool Busy() const { return busy; }
+  uint32_t Dropped() const;
+  const tx_stats_t &Stats() const { return stats; }
+
+  // Oldest frame that failed every resend, NULL if none. Release it once handled
+  const tx_frame_t *PeekFailed() { return failed.Peek(); }
+  void ReleaseFailed() { failed.Release(); }
+
+private:
+  void Pump(uint32_t now);
+  void Finish(uint32_t now, bool success);
+  tx_frame_t *Next(TxClass *cls);
+  void Release(TxClass cls);
+  void Unacked(uint32_t now);
+
+  SendFn send;
+  void *ctx;
+  uint8_t weight[TX_CLASSES];
+  uint8_t credit[TX_CLASSES]; // Frames each data class may still send this round
+  SpscRing<tx_frame_t, TX_CONTROL_DEPTH> control;
+  SpscRing<tx_frame_t, TX_FORWARD_DEPTH> forward;
+  SpscRing<tx_frame_t, TX_ORIGIN_DEPTH> origin;
+  bool busy; // A frame is with the radio, waiting for its result
+  uint32_t sent_at; // millis() the outstanding frame went to the radio
+  uint32_t reports; // Wi-Fi task only: send results reported so far
+  uint32_t synced; // Count of the latest result Poll() accounted for
+  std::atomic<uint32_t> result; // Latest send result, see TX_RESULT_COUNT_SHIFT
+  tx_frame_t inflight; // The outstanding frame, kept until its send result
+  tx_frame_t retry; // Waiting for its resend
+  bool retry_waiting;
+  uint32_t retry_at; // millis() the resend is due
+  uint8_t max_retries;
+  SpscRing<tx_frame_t, TX_FAILED_DEPTH> failed; // Frames given up on, emptied by the mesh core
+  tx_stats_t stats;
+};
+
+#endif
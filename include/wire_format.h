@@ -0,0 +1,120 @@
+#ifndef WIRE_FORMAT_H
+#define WIRE_FORMAT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "mesh_packet.h"
+
+/* ON-AIR FRAME LAYOUT (VERSION 2, ALL MULTI-BYTE FIELDS LITTLE-ENDIAN) */
+//  0      version
+//  1      flags (WIRE_FLAG_*)
+//  2      identification
+//  3      TTL
+//  4..7   packetID
+//  8..13  destination MAC
+//  14..19 source MAC
+//  20     Path_Index
+//  21     Path_Length (number of path entries carried)
+//  22     text length
+//  23..24 seq
+//  25..   text bytes, then Path_Length entries (6-byte MACs, or 1-byte node indices
+//         when WIRE_FLAG_PATH_INDEXED is set), then for reliable Data Acks the
+//         ack block: ack_seq(2) sack(4)
+#define WIRE_VERSION 2
+#define WIRE_HEADER_SIZE 25
+#define WIRE_ACK_BLOCK_SIZE 6
+#define WIRE_MAX_FRAME ESPNOW_MTU
+#define WIRE_MAX_TEXT (sizeof(((message_t *)0)->text) - 1)
+
+// Sizing from mesh_config.h must still give frames the radio can send
+static_assert(WIRE_HEADER_SIZE == MESH_HEADER_BYTES, "MESH_TEXT_SIZE is derived from the header size");
+static_assert(MAX_NODES >= 2 && MAX_NODES <= 0xFF, "Path index and length are carried in one byte");
+static_assert(MESH_TEXT_SIZE >= 2 && MESH_TEXT_SIZE - 1 <= 0xFF, "Text length is carried in one byte");
+static_assert(WIRE_HEADER_SIZE + (MESH_TEXT_SIZE - 1) + MAX_NODES * MAC_SIZE <= WIRE_MAX_FRAME,
+              "A full text with a full path of MACs must fit one ESP-NOW frame, lower MESH_TEXT_SIZE or MAX_NODES");
+
+#define WIRE_FLAG_BROADCAST_ACK 0x01
+#define WIRE_FLAG_DATA_ACK 0x02
+#define WIRE_FLAG_PATH_EXIST 0x04
+#define WIRE_FLAG_PATH_INDEXED 0x08
+#define WIRE_FLAG_RELIABLE 0x10
+#define WIRE_FLAG_ROUTED 0x20
+#define WIRE_FLAG_NEW_SESSION 0x40
+
+#define WIRE_OFF_VERSION 0
+#define WIRE_OFF_FLAGS 1
+#define WIRE_OFF_IDENTIFICATION 2
+#define WIRE_OFF_TTL 3
+#define WIRE_OFF_PACKET_ID 4
+#define WIRE_OFF_DEST 8
+#define WIRE_OFF_SOURCE 14
+#define WIRE_OFF_PATH_INDEX 20
+#define WIRE_OFF_PATH_LENGTH 21
+#define WIRE_OFF_TEXT_LENGTH 22
+#define WIRE_OFF_SEQ 23
+
+// Reliable Data Acks carry the ack block after the path
+#define WIRE_HAS_ACK_BLOCK(flags) (((flags) & (WIRE_FLAG_DATA_ACK | WIRE_FLAG_RELIABLE)) == (WIRE_FLAG_DATA_ACK | WIRE_FLAG_RELIABLE))
+
+// Node table shared by both ends. When every hop of a path is in the table,
+// the path is sent as 1-byte indices instead of 6-byte MACs.
+typedef struct wire_node_table {
+  const uint8_t (*macs)[MAC_SIZE];
+  uint8_t count;
+} wire_node_table_t;
+
+// Encode packet into out. Returns the frame length, 0 if it does not fit in cap.
+size_t EncodeMessage(const message_t *packet, const wire_node_table_t *table, uint8_t *out, size_t cap);
+// Decode a frame into packet. Returns false on a malformed or unknown-version frame.
+bool DecodeMessage(const uint8_t *data, size_t len, const wire_node_table_t *table, message_t *packet);
+// Encoded size of packet without encoding it
+size_t EncodedSize(const message_t *packet, const wire_node_table_t *table);
+
+/* READ-ONLY VIEW OVER A RECEIVED FRAME */
+// Reads header fields straight out of the radio buffer so the receive callback can decide
+// consume/forward/drop without decoding the frame first. Accessors are only meaningful when
+// Valid() is true, i.e. the version is known and len matches the lengths in the header.
+class MessageView {
+public:
+  MessageView(const uint8_t *data, int len) : data(data), len(len) {}
+
+  bool Valid() const {
+    if(data == NULL || len < WIRE_HEADER_SIZE || len > WIRE_MAX_FRAME) {
+      return false;
+    }
+    if(data[WIRE_OFF_VERSION] != WIRE_VERSION || PathLength() > MAX_NODES || TextLength() > WIRE_MAX_TEXT) {
+      return false;
+    }
+    // Receivers index Path_Array with it and append themselves after it
+    if(PathIndex() > PathLength() || PathIndex() >= MAX_NODES) {
+      return false;
+    }
+    size_t entry = (Flags() & WIRE_FLAG_PATH_INDEXED) ? 1 : MAC_SIZE;
+    size_t ack_block = WIRE_HAS_ACK_BLOCK(Flags()) ? WIRE_ACK_BLOCK_SIZE : 0;
+    return (size_t)len == WIRE_HEADER_SIZE + TextLength() + PathLength() * entry + ack_block;
+  }
+
+  uint8_t Flags() const { return data[WIRE_OFF_FLAGS]; }
+  int TTL() const { return data[WIRE_OFF_TTL]; }
+  int Identification() const { return data[WIRE_OFF_IDENTIFICATION]; }
+  int PacketID() const {
+    const uint8_t *p = data + WIRE_OFF_PACKET_ID;
+    return (int)((uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24));
+  }
+  uint16_t Seq() const { return data[WIRE_OFF_SEQ] | (data[WIRE_OFF_SEQ + 1] << 8); }
+  const uint8_t *DestinationMac() const { return data + WIRE_OFF_DEST; }
+  const uint8_t *SourceMac() const { return data + WIRE_OFF_SOURCE; }
+  uint8_t PathIndex() const { return data[WIRE_OFF_PATH_INDEX]; }
+  uint8_t PathLength() const { return data[WIRE_OFF_PATH_LENGTH]; }
+  uint8_t TextLength() const { return data[WIRE_OFF_TEXT_LENGTH]; }
+
+  const uint8_t *Raw() const { return data; }
+  int Length() const { return len; }
+
+private:
+  const uint8_t *data;
+  int len;
+};
+
+#endif
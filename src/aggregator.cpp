@@ -0,0 +1,175 @@
+#include <cstring>
+#include "aggregator.h"
+
+static_assert(WIRE_MAX_FRAME <= 0xFF, "Batch lengths are carried in one byte");
+static_assert(AGG_FRAME_MAGIC != WIRE_VERSION, "Batches must not look like wire frames");
+
+FrameAggregator::FrameAggregator(SendFn send, void *ctx) : send(send), ctx(ctx), enabled(true), delay(AGG_DELAY_MS) {
+  memset(queues, 0, sizeof(queues));
+  memset(&stats, 0, sizeof(stats));
+}
+
+void FrameAggregator::Configure(bool on, uint32_t delay_ms) {
+  if(!on) {
+    Flush();
+  }
+  enabled = on;
+  delay = delay_ms;
+}
+
+agg_queue_t *FrameAggregator::Find(const uint8_t *mac) {
+  for(int i = 0; i < AGG_QUEUES; i++) {
+    if(queues[i].used && memcmp(queues[i].mac, mac, MAC_SIZE) == 0) {
+      return &queues[i];
+    }
+  }
+  return NULL;
+}
+
+// Free queue for mac, or the one due first sent early to make room
+agg_queue_t *FrameAggregator::Open(const uint8_t *mac, uint32_t now, bool *ok) {
+  agg_queue_t *queue = NULL;
+  for(int i = 0; i < AGG_QUEUES; i++) {
+    agg_queue_t *q = &queues[i];
+    if(!q->used) {
+      queue = q;
+      break;
+    }
+    if(queue == NULL || (int32_t)(q->due - queue->due) < 0) {
+      queue = q;
+    }
+  }
+  if(queue->used && !Send(queue)) {
+    *ok = false;
+  }
+
+  memcpy(queue->mac, mac, MAC_SIZE);
+  queue->frame[0] = AGG_FRAME_MAGIC;
+  queue->len = AGG_HEADER_SIZE;
+  queue->count = 0;
+  queue->priority = 0xFF;
+  queue->due = now + delay;
+  queue->used = true;
+  return queue;
+}
+
+bool FrameAggregator::Add(const uint8_t *mac, const uint8_t *frame, size_t len, uint8_t priority, uint32_t now) {
+  bool ok = true;
+  agg_queue_t *queue = Find(mac);
+  stats.frames_in++;
+  stats.bytes_in += len;
+
+  // Too big to share a frame, or batching is off: goes alone, behind what is queued for mac
+  if(!enabled || AGG_HEADER_SIZE + AGG_ENTRY_OVERHEAD + len > WIRE_MAX_FRAME) {
+    if(queue != NULL && !Send(queue)) {
+      ok = false;
+    }
+    return SendFrame(mac, frame, len, priority) && ok;
+  }
+
+  if(queue != NULL && queue->len + AGG_ENTRY_OVERHEAD + len > WIRE_MAX_FRAME) {
+    stats.full++;
+    if(!Send(queue)) {
+      ok = false;
+    }
+    queue = NULL;
+  }
+  if(queue == NULL) {
+    queue = Open(mac, now, &ok);
+  }
+
+  queue->frame[queue->len] = (uint8_t)len;
+  memcpy(queue->frame + queue->len + AGG_ENTRY_OVERHEAD, frame, len);
+  queue->len += AGG_ENTRY_OVERHEAD + len;
+  queue->count++;
+  if(priority < queue->priority) {
+    queue->priority = priority;
+  }
+
+  // No frame fits any more, nothing to wait for
+  if(queue->len + AGG_MIN_ENTRY > WIRE_MAX_FRAME) {
+    stats.full++;
+    if(!Send(queue)) {
+      ok = false;
+    }
+  }
+  return ok;
+}
+
+bool FrameAggregator::SendFrame(const uint8_t *mac, const uint8_t *frame, size_t len, uint8_t priority) {
+  stats.frames_out++;
+  stats.bytes_out += len;
+  if(!send(ctx, mac, frame, len, priority)) {
+    stats.send_errors++;
+    return false;
+  }
+  return true;
+}
+
+bool FrameAggregator::Send(agg_queue_t *queue) {
+  queue->used = false;
+  if(queue->count == 1) {
+    // Alone after all: the plain frame, without the batch header
+    return SendFrame(queue->mac, queue->frame + AGG_HEADER_SIZE + AGG_ENTRY_OVERHEAD, queue->frame[AGG_HEADER_SIZE], queue->priority);
+  }
+  queue->frame[1] = queue->count;
+  stats.batches++;
+  return SendFrame(queue->mac, queue->frame, queue->len, queue->priority);
+}
+
+void FrameAggregator::Poll(uint32_t now) {
+  for(int i = 0; i < AGG_QUEUES; i++) {
+    if(queues[i].used && (int32_t)(now - queues[i].due) >= 0) {
+      Send(&queues[i]);
+    }
+  }
+}
+
+void FrameAggregator::Flush() {
+  for(int i = 0; i < AGG_QUEUES; i++) {
+    if(queues[i].used) {
+      Send(&queues[i]);
+    }
+  }
+}
+
+bool FrameAggregator::Unpack(const uint8_t *mac, const uint8_t *data, int len, int rssi, ReceiveFn receive, void *ctx) {
+  if(!IsBatch(data, len) || len > WIRE_MAX_FRAME || data[1] == 0) {
+    return false;
+  }
+
+  // Lengths must add up exactly before any frame is handed on
+  int offset = AGG_HEADER_SIZE;
+  for(int i = 0; i < data[1]; i++) {
+    if(offset + AGG_ENTRY_OVERHEAD > len) {
+      return false;
+    }
+    int entry = data[offset];
+    offset += AGG_ENTRY_OVERHEAD;
+    if(entry == 0 || offset + entry > len || IsBatch(data + offset, entry)) {
+      return false; // Batches never nest
+    }
+    offset += entry;
+  }
+  if(offset != len) {
+    return false;
+  }
+
+  offset = AGG_HEADER_SIZE;
+  for(int i = 0; i < data[1]; i++) {
+    int entry = data[offset];
+    receive(ctx, mac, data + offset + AGG_ENTRY_OVERHEAD, entry, rssi);
+    offset += AGG_ENTRY_OVERHEAD + entry;
+  }
+  return true;
+}
+
+size_t FrameAggregator::Pending() const {
+  size_t count = 0;
+  for(int i = 0; i < AGG_QUEUES; i++) {
+    if(queues[i].used) {
+      count += queues[i].count;
+    }
+  }
+  return count;
+}
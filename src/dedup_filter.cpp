@@ -0,0 +1,56 @@
+#include <cstring>
+#include "dedup_filter.h"
+
+uint32_t DedupFilter::Hash(const uint8_t *source, uint32_t packet_id) {
+  uint32_t hash = 2166136261u;
+  for(int i = 0; i < MAC_SIZE; i++) {
+    hash = (hash ^ source[i]) * 16777619u;
+  }
+  for(int i = 0; i < 4; i++) {
+    hash = (hash ^ ((packet_id >> (8 * i)) & 0xFF)) * 16777619u;
+  }
+  return hash;
+}
+
+bool DedupFilter::CheckAndInsert(const uint8_t *source, uint32_t packet_id, uint32_t now) {
+  uint32_t start = Hash(source, packet_id);
+  dedup_entry_t *free_slot = NULL;
+  dedup_entry_t *oldest = NULL;
+
+  stats.lookups++;
+
+  for(int probe = 0; probe < DEDUP_PROBE; probe++) {
+    dedup_entry_t *entry = &entries[(start + probe) & (DEDUP_SLOTS - 1)];
+    bool expired = !entry->used || (uint32_t)(now - entry->seen) >= DEDUP_LIFETIME_MS;
+
+    if(!expired && entry->packet_id == packet_id && memcmp(entry->source, source, MAC_SIZE) == 0) {
+      stats.duplicates++;
+      return true;
+    }
+
+    if(expired) {
+      if(free_slot == NULL) {
+        free_slot = entry;
+      }
+    } else if(oldest == NULL || (uint32_t)(now - entry->seen) > (uint32_t)(now - oldest->seen)) {
+      oldest = entry;
+    }
+  }
+
+  // Window full of live entries: forget the oldest one
+  if(free_slot == NULL) {
+    free_slot = oldest;
+    stats.evictions++;
+  }
+
+  free_slot->packet_id = packet_id;
+  free_slot->seen = now;
+  memcpy(free_slot->source, source, MAC_SIZE);
+  free_slot->used = true;
+  return false;
+}
+
+void DedupFilter::Clear() {
+  memset(entries, 0, sizeof(entries));
+  memset(&stats, 0, sizeof(stats));
+}
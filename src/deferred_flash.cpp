@@ -0,0 +1,87 @@
+#include <cstring>
+#include "deferred_flash.h"
+
+#define FLASH_SPAN_NONE 0xFFFFFFFFu // dirty_lo of an empty range
+
+static void Widen(std::atomic<uint32_t> &lo, std::atomic<uint32_t> &hi, uint32_t from, uint32_t to) {
+  uint32_t seen = lo.load(std::memory_order_relaxed);
+  while(from < seen && !lo.compare_exchange_weak(seen, from, std::memory_order_relaxed)) {
+  }
+  seen = hi.load(std::memory_order_relaxed);
+  while(to > seen && !hi.compare_exchange_weak(seen, to, std::memory_order_relaxed)) {
+  }
+}
+
+DeferredFlash::DeferredFlash(FlashBackend &backing, Clock &clock, uint32_t interval_ms)
+  : backing(backing), clock(clock), interval_ms(interval_ms), write_lo(FLASH_SPAN_NONE), write_hi(0), dirty_lo(FLASH_SPAN_NONE), dirty_hi(0),
+    requested(0), flushed(0), pending_since(0) {
+  memset(&stats, 0, sizeof(stats));
+}
+
+void DeferredFlash::Write(size_t addr, uint8_t value) {
+  if(addr >= backing.Size()) {
+    return;
+  }
+  if(backing.Read(addr) == value) {
+    stats.bytes_unchanged++; // Rewriting erased or unchanged bytes leaves nothing to commit
+    return;
+  }
+  backing.Write(addr, value);
+  stats.bytes_changed++;
+  if(addr < write_lo) {
+    write_lo = (uint32_t)addr;
+  }
+  if(addr + 1 > write_hi) {
+    write_hi = (uint32_t)addr + 1;
+  }
+}
+
+bool DeferredFlash::Commit() {
+  stats.requests++;
+  if(write_lo == FLASH_SPAN_NONE) {
+    return true; // Nothing changed since the last one
+  }
+
+  Widen(dirty_lo, dirty_hi, write_lo, write_hi);
+  write_lo = FLASH_SPAN_NONE;
+  write_hi = 0;
+  // The batch window opens with the first update flash has not seen
+  if(!Pending()) {
+    pending_since.store(clock.Millis(), std::memory_order_relaxed);
+  }
+  requested.fetch_add(1, std::memory_order_release);
+  return true;
+}
+
+bool DeferredFlash::Flush(bool force) {
+  uint32_t target = requested.load(std::memory_order_acquire);
+  if(target == flushed.load(std::memory_order_relaxed)) {
+    return true;
+  }
+  uint32_t start = clock.Millis();
+  if(!force && start - pending_since.load(std::memory_order_relaxed) < interval_ms) {
+    return true;
+  }
+
+  uint32_t lo = dirty_lo.exchange(FLASH_SPAN_NONE, std::memory_order_relaxed);
+  uint32_t hi = dirty_hi.exchange(0, std::memory_order_relaxed);
+  bool ok = backing.Commit();
+  uint32_t stall = clock.Millis() - start;
+  stats.commits++;
+  stats.stall_ms += stall;
+  if(stall > stats.stall_max_ms) {
+    stats.stall_max_ms = stall;
+  }
+
+  if(!ok) {
+    stats.failures++;
+    Widen(dirty_lo, dirty_hi, lo, hi); // Still dirty, next try after another interval
+    pending_since.store(clock.Millis(), std::memory_order_relaxed);
+    return false;
+  }
+  if(hi > lo) {
+    stats.bytes_flushed += hi - lo;
+  }
+  flushed.store(target, std::memory_order_release);
+  return true;
+}
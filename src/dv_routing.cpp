@@ -0,0 +1,263 @@
+#include <cstring>
+#include "dv_routing.h"
+
+static_assert((DV_ROUTES & (DV_ROUTES - 1)) == 0, "Route table size must be a power of two");
+
+DvRouter::DvRouter(BroadcastFn broadcast, void *ctx)
+  : broadcast(broadcast), ctx(ctx), own_seq(0), next_full(0), last_update(0), jitter_state(1), pending(false) {
+  memset(self, 0, sizeof(self));
+  memset(routes, 0, sizeof(routes));
+  memset(&stats, 0, sizeof(stats));
+}
+
+// FNV-1a over the 6 MAC bytes
+uint32_t DvRouter::Hash(const uint8_t *mac) {
+  uint32_t hash = 2166136261u;
+  for(int i = 0; i < MAC_SIZE; i++) {
+    hash ^= mac[i];
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+// 0..999 ms, keeps neighbours from dumping their tables in lockstep
+uint32_t DvRouter::Jitter() {
+  jitter_state ^= jitter_state << 13;
+  jitter_state ^= jitter_state >> 17;
+  jitter_state ^= jitter_state << 5;
+  return jitter_state % 1000;
+}
+
+void DvRouter::Begin(const uint8_t *mac, uint32_t now) {
+  memcpy(self, mac, MAC_SIZE);
+  jitter_state = Hash(mac) | 1;
+  own_seq = 0;
+  next_full = now + Jitter();
+  last_update = now - DV_TRIGGER_MS;
+}
+
+dv_route_t *DvRouter::Find(const uint8_t *dest, bool create) {
+  uint32_t slot = Hash(dest) & (DV_ROUTES - 1);
+
+  // Entries are never removed (broken routes stay as tombstones with an infinite
+  // metric), so the probe chain ends at the first unused slot
+  for(size_t probe = 0; probe < DV_ROUTES; probe++) {
+    dv_route_t *route = &routes[slot];
+    if(!route->used) {
+      return create ? route : NULL;
+    }
+    if(memcmp(route->dest, dest, MAC_SIZE) == 0) {
+      return route;
+    }
+    slot = (slot + 1) & (DV_ROUTES - 1);
+  }
+
+  if(create) {
+    stats.table_full++;
+  }
+  return NULL;
+}
+
+const dv_route_t *DvRouter::Lookup(const uint8_t *dest) const {
+  const dv_route_t *route = const_cast<DvRouter *>(this)->Find(dest, false);
+  return route != NULL && route->metric != DV_INFINITY ? route : NULL;
+}
+
+const uint8_t *DvRouter::Alternate(const uint8_t *dest, const uint8_t *avoid, uint32_t now) const {
+  const dv_route_t *route = Lookup(dest);
+  if(route == NULL) {
+    return NULL;
+  }
+  if(memcmp(route->next_hop, avoid, MAC_SIZE) != 0) {
+    return route->next_hop;
+  }
+  if(route->alt_metric == DV_INFINITY || memcmp(route->alt_hop, avoid, MAC_SIZE) == 0 ||
+     (uint32_t)(now - route->alt_heard) > DV_NEIGHBOUR_TIMEOUT_MS) {
+    return NULL;
+  }
+  return route->alt_hop;
+}
+
+size_t DvRouter::Reachable() const {
+  size_t count = 0;
+  for(size_t i = 0; i < DV_ROUTES; i++) {
+    count += routes[i].used && routes[i].metric != DV_INFINITY;
+  }
+  return count;
+}
+
+void DvRouter::Accept(dv_route_t *route, const uint8_t *next_hop, uint16_t seq, uint16_t metric, uint32_t now) {
+  bool fresh = !route->used;
+  int delta = (int)metric - (int)route->metric;
+  bool moved = fresh || memcmp(route->next_hop, next_hop, MAC_SIZE) != 0 || delta >= DV_TRIGGER_DELTA || delta <= -DV_TRIGGER_DELTA ||
+               (metric == DV_INFINITY) != (route->metric == DV_INFINITY);
+
+  // An alternate is only loop free against the sequence number and the metric it was
+  // offered under, a shorter route of ours may not be longer than its
+  if(fresh || seq != route->seq || metric < route->metric || memcmp(route->alt_hop, next_hop, MAC_SIZE) == 0) {
+    route->alt_metric = DV_INFINITY;
+  }
+
+  memcpy(route->next_hop, next_hop, MAC_SIZE);
+  route->seq = seq;
+  route->metric = metric;
+  route->heard = now;
+  route->used = true;
+
+  if(moved) {
+    route->changed = true;
+    pending = true;
+    stats.route_changes++;
+    stats.last_change = now;
+  }
+}
+
+bool DvRouter::OnUpdate(const uint8_t *neighbour, uint16_t link_cost, const uint8_t *frame, size_t len, uint32_t now) {
+  if(!IsUpdate(frame, len) || len != DV_FRAME_HEADER + (size_t)frame[1] * DV_ENTRY_SIZE) {
+    stats.frames_malformed++;
+    return false;
+  }
+  stats.frames_received++;
+
+  const uint8_t *p = frame + DV_FRAME_HEADER;
+  for(int i = 0; i < frame[1]; i++, p += DV_ENTRY_SIZE) {
+    const uint8_t *dest = p;
+    uint16_t seq = p[6] | (p[7] << 8);
+    uint16_t metric = p[8] | (p[9] << 8);
+
+    if(memcmp(dest, self, MAC_SIZE) == 0) {
+      // Someone has a newer number for us (reported broken, or we rebooted): jump past it
+      if((int16_t)(seq - own_seq) > 0) {
+        own_seq = (seq | 1) + 1;
+        next_full = now; // Re-announce with the new number right away
+      }
+      continue;
+    }
+
+    uint16_t cost = DV_INFINITY;
+    if(metric != DV_INFINITY) {
+      uint32_t total = (uint32_t)metric + link_cost;
+      cost = total >= DV_INFINITY ? DV_INFINITY - 1 : (uint16_t)total;
+    }
+
+    dv_route_t *route = Find(dest, cost != DV_INFINITY);
+    if(route == NULL) {
+      continue; // Unknown and unreachable, or no room
+    }
+
+    if(!route->used) {
+      memcpy(route->dest, dest, MAC_SIZE);
+      Accept(route, neighbour, seq, cost, now);
+      continue;
+    }
+
+    int diff = (int16_t)(seq - route->seq);
+    bool via = memcmp(route->next_hop, neighbour, MAC_SIZE) == 0;
+    bool better = via ? cost < route->metric : (uint32_t)cost + DV_SWITCH_MARGIN <= route->metric;
+    if(diff > 0 || (diff == 0 && better) || (diff == 0 && via && cost != route->metric)) {
+      Accept(route, neighbour, seq, cost, now);
+    } else if(diff == 0 && via) {
+      route->heard = now; // Current route confirmed
+    } else if(diff == 0) {
+      // Nearer to dest than we are, so never through us: the best one is the alternate
+      bool feasible = metric < route->metric && cost != DV_INFINITY;
+      bool same = memcmp(route->alt_hop, neighbour, MAC_SIZE) == 0;
+      if(same && !feasible) {
+        route->alt_metric = DV_INFINITY;
+      } else if(feasible && (route->alt_metric == DV_INFINITY || same || cost < route->alt_metric ||
+                             (uint32_t)(now - route->alt_heard) > DV_NEIGHBOUR_TIMEOUT_MS)) {
+        memcpy(route->alt_hop, neighbour, MAC_SIZE);
+        route->alt_metric = cost;
+        route->alt_heard = now;
+      }
+    }
+  }
+
+  return true;
+}
+
+void DvRouter::Flush(uint8_t *frame, int count) {
+  size_t len = DV_FRAME_HEADER + count * DV_ENTRY_SIZE;
+  frame[0] = DV_FRAME_MAGIC;
+  frame[1] = (uint8_t)count;
+  broadcast(ctx, frame, len);
+  stats.frames_sent++;
+  stats.bytes_sent += len;
+  stats.entries_sent += count;
+}
+
+void DvRouter::SendUpdate(bool full, uint32_t now) {
+  uint8_t frame[DV_FRAME_HEADER + DV_ENTRIES_PER_FRAME * DV_ENTRY_SIZE];
+  int count = 0;
+
+  // Own entry leads every full dump, then the table
+  for(int i = full ? -1 : 0; i < DV_ROUTES; i++) {
+    const uint8_t *dest;
+    uint16_t seq;
+    uint16_t metric;
+
+    if(i < 0) {
+      dest = self;
+      seq = own_seq;
+      metric = 0;
+    } else {
+      dv_route_t *route = &routes[i];
+      if(!route->used || (!full && !route->changed)) {
+        continue;
+      }
+      // Broken routes are advertised until every neighbour had time to hear it
+      if(route->metric == DV_INFINITY && !route->changed && (uint32_t)(now - route->heard) > DV_NEIGHBOUR_TIMEOUT_MS) {
+        continue;
+      }
+      route->changed = false;
+      dest = route->dest;
+      seq = route->seq;
+      metric = route->metric;
+    }
+
+    uint8_t *p = frame + DV_FRAME_HEADER + count * DV_ENTRY_SIZE;
+    memcpy(p, dest, MAC_SIZE);
+    p[6] = (uint8_t)seq;
+    p[7] = (uint8_t)(seq >> 8);
+    p[8] = (uint8_t)metric;
+    p[9] = (uint8_t)(metric >> 8);
+    count++;
+
+    if(count == DV_ENTRIES_PER_FRAME) {
+      Flush(frame, count);
+      count = 0;
+    }
+  }
+
+  if(count > 0) {
+    Flush(frame, count); // Last partial frame
+  }
+
+  pending = false;
+}
+
+void DvRouter::Poll(uint32_t now) {
+  // Routes nobody confirmed for a while are reported broken
+  for(size_t i = 0; i < DV_ROUTES; i++) {
+    dv_route_t *route = &routes[i];
+    if(route->used && route->metric != DV_INFINITY && (uint32_t)(now - route->heard) > DV_NEIGHBOUR_TIMEOUT_MS) {
+      route->seq |= 1; // Odd: broken, any newer even number from the destination replaces it
+      route->metric = DV_INFINITY;
+      route->heard = now;
+      route->changed = true;
+      pending = true;
+      stats.route_changes++;
+      stats.last_change = now;
+    }
+  }
+
+  if((int32_t)(now - next_full) >= 0) {
+    own_seq += 2;
+    SendUpdate(true, now);
+    next_full = now + DV_FULL_INTERVAL_MS + Jitter();
+    last_update = now;
+  } else if(pending && (uint32_t)(now - last_update) >= DV_TRIGGER_MS) {
+    SendUpdate(false, now);
+    last_update = now;
+  }
+}
@@ -0,0 +1,85 @@
+#include <cstring>
+#include "flood_control.h"
+
+FloodControl::FloodControl(RelayFn relay, void *ctx)
+  : relay(relay), ctx(ctx), dup_limit(FLOOD_DUP_LIMIT), gossip_percent(FLOOD_GOSSIP_PERCENT) {
+  memset(slots, 0, sizeof(slots));
+  memset(&stats, 0, sizeof(stats));
+}
+
+void FloodControl::Configure(uint8_t limit, uint8_t percent) {
+  dup_limit = limit;
+  gossip_percent = percent > 100 ? 100 : percent;
+}
+
+flood_slot_t *FloodControl::Find(const uint8_t *source, int packetID) {
+  for(int i = 0; i < FLOOD_PENDING; i++) {
+    flood_slot_t *slot = &slots[i];
+    if(slot->used && slot->packet.packetID == packetID && memcmp(slot->packet.source_mac, source, MAC_SIZE) == 0) {
+      return slot;
+    }
+  }
+  return NULL;
+}
+
+void FloodControl::Schedule(const message_t *packet, uint32_t now, uint32_t random) {
+  // Low bits decide the gossip toss, high bits the backoff
+  if(gossip_percent < 100 && (random & 0xFFFF) % 100 >= gossip_percent) {
+    stats.gossip_skipped++;
+    return;
+  }
+
+  flood_slot_t *slot = NULL;
+  for(int i = 0; i < FLOOD_PENDING && slot == NULL; i++) {
+    if(!slots[i].used) {
+      slot = &slots[i];
+    }
+  }
+  if(slot == NULL) {
+    stats.overflow++;
+    stats.sent++;
+    relay(packet, ctx); // Relaying late is worse than relaying redundantly
+    return;
+  }
+
+  memcpy(&slot->packet, packet, sizeof(slot->packet));
+  slot->due = now + (random >> 16) % FLOOD_BACKOFF_MS;
+  slot->copies = 1;
+  slot->used = true;
+  stats.scheduled++;
+}
+
+bool FloodControl::OnDuplicate(const uint8_t *source, int packetID) {
+  flood_slot_t *slot = Find(source, packetID);
+  if(slot == NULL) {
+    return false;
+  }
+  if(slot->copies < 0xFF) {
+    slot->copies++;
+  }
+  return true;
+}
+
+void FloodControl::Poll(uint32_t now) {
+  for(int i = 0; i < FLOOD_PENDING; i++) {
+    flood_slot_t *slot = &slots[i];
+    if(!slot->used || (int32_t)(now - slot->due) < 0) {
+      continue;
+    }
+    slot->used = false;
+    if(dup_limit > 0 && slot->copies >= dup_limit) {
+      stats.suppressed++;
+      continue;
+    }
+    stats.sent++;
+    relay(&slot->packet, ctx);
+  }
+}
+
+size_t FloodControl::Pending() const {
+  size_t count = 0;
+  for(int i = 0; i < FLOOD_PENDING; i++) {
+    count += slots[i].used;
+  }
+  return count;
+}
@@ -0,0 +1,273 @@
+#include <cstring>
+#include "fragment.h"
+
+static_assert(FRAG_MAX_FRAGMENTS <= 32, "Ack bitmap is 32 bits wide");
+static_assert(FRAG_MAX_BYTES <= 0xFFFF, "Buffer length is carried in 16 bits");
+static_assert(FRAG_CHUNK >= FRAG_ACK_SIZE, "MESH_TEXT_SIZE too small to carry fragments");
+
+FragmentTransport::FragmentTransport(TransmitFn transmit, void *ctx)
+  : transmit(transmit), ctx(ctx), on_receive(NULL), on_done(NULL), handler_ctx(NULL), next_transfer(0) {
+  memset(tx, 0, sizeof(tx));
+  memset(rx, 0, sizeof(rx));
+  memset(&stats, 0, sizeof(stats));
+}
+
+void FragmentTransport::SetHandlers(ReceiveFn receive, DoneFn done, void *context) {
+  on_receive = receive;
+  on_done = done;
+  handler_ctx = context;
+}
+
+int FragmentTransport::Send(const uint8_t *dest, const uint8_t *data, size_t len, uint32_t now) {
+  (void)now;
+  if(len == 0 || len > FRAG_MAX_BYTES) {
+    return -1;
+  }
+
+  frag_tx_t *t = NULL;
+  for(int i = 0; i < FRAG_TX_TRANSFERS && t == NULL; i++) {
+    if(!tx[i].used) {
+      t = &tx[i];
+    }
+  }
+  if(t == NULL) {
+    return -1;
+  }
+
+  memcpy(t->dest, dest, MAC_SIZE);
+  memcpy(t->data, data, len);
+  t->len = (uint16_t)len;
+  t->transfer = next_transfer++;
+  t->count = (uint8_t)((len + FRAG_CHUNK - 1) / FRAG_CHUNK);
+  t->rounds = 0;
+  t->acked = 0;
+  t->used = true;
+  StartRound(t);
+  stats.transfers++;
+  return t->transfer;
+}
+
+// Queue every fragment the receiver has not confirmed. False once the rounds are used up.
+bool FragmentTransport::StartRound(frag_tx_t *t) {
+  if(t->rounds >= FRAG_MAX_ROUNDS) {
+    return false;
+  }
+  t->queued = Mask(t->count) & ~t->acked;
+  t->waiting = false;
+  t->rounds++;
+  return true;
+}
+
+void FragmentTransport::Finish(frag_tx_t *t, bool delivered) {
+  if(delivered) {
+    stats.delivered++;
+  } else {
+    stats.failed++;
+  }
+  t->used = false;
+  if(on_done != NULL) {
+    on_done(handler_ctx, t->dest, t->transfer, delivered);
+  }
+}
+
+void FragmentTransport::SendAck(const frag_rx_t *r) {
+  uint8_t payload[FRAG_ACK_SIZE];
+  payload[0] = (uint8_t)r->transfer;
+  payload[1] = (uint8_t)(r->transfer >> 8);
+  payload[2] = r->count;
+  for(int i = 0; i < 4; i++) {
+    payload[3 + i] = (uint8_t)(r->received >> (8 * i));
+  }
+  // A refused ack is not retried here: the sender's next round asks for it again
+  if(transmit(ctx, r->source, payload, sizeof(payload), true)) {
+    stats.acks_sent++;
+  }
+}
+
+frag_rx_t *FragmentTransport::FindReassembly(const uint8_t *source, uint16_t transfer, uint32_t now, bool create) {
+  frag_rx_t *spare = NULL;
+  for(int i = 0; i < FRAG_RX_TRANSFERS; i++) {
+    frag_rx_t *r = &rx[i];
+    if(r->used && r->transfer == transfer && memcmp(r->source, source, MAC_SIZE) == 0) {
+      return r;
+    }
+    // A free slot, else the oldest one that is finished (only kept for re-acks) or stale
+    if(!r->used) {
+      spare = r;
+    } else if(spare == NULL || spare->used) {
+      bool reusable = r->complete || (uint32_t)(now - r->touched) > FRAG_RX_TIMEOUT_MS;
+      if(reusable && (spare == NULL || (uint32_t)(now - r->touched) > (uint32_t)(now - spare->touched))) {
+        spare = r;
+      }
+    }
+  }
+
+  if(!create) {
+    return NULL;
+  }
+  if(spare == NULL) {
+    stats.busy++;
+    return NULL; // Sender tries again next round
+  }
+  if(spare->used && !spare->complete) {
+    stats.expired++;
+  }
+  memset(spare, 0, sizeof(*spare));
+  return spare;
+}
+
+void FragmentTransport::OnFragment(const uint8_t *source, const uint8_t *payload, size_t len, uint32_t now) {
+  if(len < FRAG_HEADER_SIZE) {
+    stats.malformed++;
+    return;
+  }
+  uint16_t transfer = payload[0] | (payload[1] << 8);
+  uint8_t index = payload[2];
+  uint8_t count = payload[3];
+  uint8_t flags = payload[4];
+  size_t chunk = len - FRAG_HEADER_SIZE;
+
+  // Every fragment but the last is full, so offsets follow from the index
+  if(count == 0 || count > FRAG_MAX_FRAGMENTS || index >= count || chunk == 0 || chunk > FRAG_CHUNK ||
+     (index + 1 < count && chunk != FRAG_CHUNK)) {
+    stats.malformed++;
+    return;
+  }
+
+  frag_rx_t *r = FindReassembly(source, transfer, now, true);
+  if(r == NULL) {
+    return;
+  }
+  if(!r->used) {
+    memcpy(r->source, source, MAC_SIZE);
+    r->transfer = transfer;
+    r->count = count;
+    r->used = true;
+  } else if(r->count != count) {
+    stats.malformed++;
+    return;
+  }
+  r->touched = now;
+
+  if(r->complete) {
+    SendAck(r); // Our ack was lost, the sender is still retrying
+    return;
+  }
+
+  memcpy(r->data + index * FRAG_CHUNK, payload + FRAG_HEADER_SIZE, chunk);
+  r->received |= 1u << index;
+  if(index + 1 == count) {
+    r->len = (uint16_t)(index * FRAG_CHUNK + chunk);
+  }
+
+  if(r->received == Mask(count)) {
+    r->complete = true;
+    stats.reassembled++;
+    SendAck(r);
+    if(on_receive != NULL) {
+      on_receive(handler_ctx, r->source, r->data, r->len);
+    }
+  } else if(flags & FRAG_FLAG_ACK_REQUEST) {
+    SendAck(r); // Tells the sender what the next round needs
+  }
+}
+
+void FragmentTransport::OnAck(const uint8_t *source, const uint8_t *payload, size_t len, uint32_t now) {
+  (void)now;
+  if(len < FRAG_ACK_SIZE) {
+    stats.malformed++;
+    return;
+  }
+  uint16_t transfer = payload[0] | (payload[1] << 8);
+  uint32_t received = (uint32_t)payload[3] | ((uint32_t)payload[4] << 8) | ((uint32_t)payload[5] << 16) | ((uint32_t)payload[6] << 24);
+
+  for(int i = 0; i < FRAG_TX_TRANSFERS; i++) {
+    frag_tx_t *t = &tx[i];
+    if(!t->used || t->transfer != transfer || memcmp(t->dest, source, MAC_SIZE) != 0 || payload[2] != t->count) {
+      continue;
+    }
+
+    t->acked |= received & Mask(t->count);
+    t->queued &= ~t->acked; // Confirmed meanwhile, no need to send again
+    if(t->acked == Mask(t->count)) {
+      Finish(t, true);
+    } else if(t->waiting && !StartRound(t)) {
+      Finish(t, false);
+    }
+    return;
+  }
+}
+
+void FragmentTransport::OnFrame(const uint8_t *source, const uint8_t *payload, size_t len, bool ack, uint32_t now) {
+  if(ack) {
+    OnAck(source, payload, len, now);
+  } else {
+    OnFragment(source, payload, len, now);
+  }
+}
+
+void FragmentTransport::Poll(uint32_t now) {
+  int budget = FRAG_BURST;
+
+  for(int i = 0; i < FRAG_TX_TRANSFERS; i++) {
+    frag_tx_t *t = &tx[i];
+    if(!t->used) {
+      continue;
+    }
+
+    // Overdue ack: go again with whatever is still unconfirmed
+    if(t->waiting && (int32_t)(now - t->ack_due) >= 0 && !StartRound(t)) {
+      Finish(t, false);
+      continue;
+    }
+
+    while(t->queued != 0 && budget > 0) {
+      int index = __builtin_ctz(t->queued);
+      t->queued &= ~(1u << index);
+      size_t offset = (size_t)index * FRAG_CHUNK;
+      size_t chunk = t->len - offset < FRAG_CHUNK ? t->len - offset : FRAG_CHUNK;
+
+      uint8_t payload[FRAG_HEADER_SIZE + FRAG_CHUNK];
+      payload[0] = (uint8_t)t->transfer;
+      payload[1] = (uint8_t)(t->transfer >> 8);
+      payload[2] = (uint8_t)index;
+      payload[3] = t->count;
+      payload[4] = t->queued == 0 ? FRAG_FLAG_ACK_REQUEST : 0;
+      memcpy(payload + FRAG_HEADER_SIZE, t->data + offset, chunk);
+      if(!transmit(ctx, t->dest, payload, FRAG_HEADER_SIZE + chunk, false)) {
+        t->queued |= 1u << index; // No packet free, goes out with a later Poll()
+        budget = 0;
+        break;
+      }
+
+      stats.fragments_sent++;
+      if(t->rounds > 1) {
+        stats.fragments_resent++;
+      }
+      budget--;
+      if(t->queued == 0) {
+        t->waiting = true;
+        t->ack_due = now + FRAG_ACK_TIMEOUT_MS;
+      }
+    }
+  }
+
+  // Incomplete reassemblies nobody finishes, and finished ones nobody asks about any more
+  for(int i = 0; i < FRAG_RX_TRANSFERS; i++) {
+    frag_rx_t *r = &rx[i];
+    if(r->used && (uint32_t)(now - r->touched) > FRAG_RX_TIMEOUT_MS) {
+      if(!r->complete) {
+        stats.expired++;
+      }
+      r->used = false;
+    }
+  }
+}
+
+size_t FragmentTransport::InFlight() const {
+  size_t count = 0;
+  for(int i = 0; i < FRAG_TX_TRANSFERS; i++) {
+    count += tx[i].used;
+  }
+  return count;
+}
@@ -0,0 +1,115 @@
+#include <cstring>
+#include "link_quality.h"
+#include "mesh_hal.h"
+
+// FNV-1a over the 6 MAC bytes
+uint32_t LinkTable::Hash(const uint8_t *mac) {
+  uint32_t hash = 2166136261u;
+  for(int i = 0; i < MAC_SIZE; i++) {
+    hash ^= mac[i];
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+void LinkTable::Clear() {
+  memset(entries, 0, sizeof(entries));
+  count = 0;
+  untracked = 0;
+}
+
+link_entry_t *LinkTable::Find(const uint8_t *mac, bool create) {
+  uint32_t slot = Hash(mac) & (LINK_TABLE_SIZE - 1);
+
+  // Neighbours are never removed, so the probe chain ends at the first unused slot
+  for(size_t probe = 0; probe < LINK_TABLE_SIZE; probe++) {
+    link_entry_t *link = &entries[slot];
+    if(!link->used) {
+      if(!create) {
+        return NULL;
+      }
+      memcpy(link->mac, mac, MAC_SIZE);
+      link->used = true;
+      ++count;
+      return link;
+    }
+    if(memcmp(link->mac, mac, MAC_SIZE) == 0) {
+      return link;
+    }
+    slot = (slot + 1) & (LINK_TABLE_SIZE - 1);
+  }
+
+  if(create) {
+    ++untracked;
+  }
+  return NULL;
+}
+
+const link_entry_t *LinkTable::Lookup(const uint8_t *mac) const {
+  return const_cast<LinkTable *>(this)->Find(mac, false);
+}
+
+// Straight line from LINK_ETX_MAX at LINK_RSSI_POOR to a clean link at LINK_RSSI_GOOD
+uint16_t LinkTable::RssiRatio(int rssi4) {
+  const int floor = LINK_RATIO_ONE * LINK_ETX_ONE / LINK_ETX_MAX;
+  if(rssi4 >= LINK_RSSI_GOOD * 4) {
+    return LINK_RATIO_ONE;
+  }
+  if(rssi4 <= LINK_RSSI_POOR * 4) {
+    return floor;
+  }
+  return floor + (LINK_RATIO_ONE - floor) * (rssi4 - LINK_RSSI_POOR * 4) / ((LINK_RSSI_GOOD - LINK_RSSI_POOR) * 4);
+}
+
+// Best guess before (and as the start of) the measured ratio
+uint16_t LinkTable::Prior(const link_entry_t *link) {
+  return link->has_rssi ? RssiRatio(link->rssi4) : LINK_RATIO_ONE;
+}
+
+void LinkTable::OnSent(const uint8_t *mac, bool success) {
+  link_entry_t *link = Find(mac, true);
+  if(link == NULL) {
+    return;
+  }
+
+  if(!link->measured) {
+    link->ratio = Prior(link);
+    link->measured = true;
+  }
+  int target = success ? LINK_RATIO_ONE : 0;
+  link->ratio += (target - (int)link->ratio) >> LINK_EWMA_SHIFT;
+
+  ++link->sent;
+  if(!success) {
+    ++link->failed;
+  }
+}
+
+void LinkTable::OnReceive(const uint8_t *mac, int rssi, uint32_t now) {
+  link_entry_t *link = Find(mac, true);
+  if(link == NULL) {
+    return;
+  }
+
+  link->heard = now;
+  if(rssi == RADIO_RSSI_UNKNOWN) {
+    return;
+  }
+  if(!link->has_rssi) {
+    link->rssi4 = (int16_t)(rssi * 4);
+    link->has_rssi = true;
+  } else {
+    link->rssi4 += (rssi * 4 - link->rssi4) >> LINK_EWMA_SHIFT;
+  }
+}
+
+uint16_t LinkTable::Etx(const uint8_t *mac) const {
+  const link_entry_t *link = Lookup(mac);
+  if(link == NULL) {
+    return LINK_ETX_ONE;
+  }
+
+  uint32_t ratio = link->measured ? link->ratio : Prior(link);
+  uint32_t etx = ratio > 0 ? (uint32_t)LINK_ETX_ONE * LINK_RATIO_ONE / ratio : LINK_ETX_MAX;
+  return etx > LINK_ETX_MAX ? LINK_ETX_MAX : (uint16_t)etx;
+}
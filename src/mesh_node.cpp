@@ -0,0 +1,1078 @@
+#include <cstring>
+#include "mesh_node.h"
+
+#define MAC_FMT "%02X:%02X:%02X:%02X:%02X:%02X"
+#define MAC_ARGS(m) (m)[0], (m)[1], (m)[2], (m)[3], (m)[4], (m)[5]
+
+static_assert(ROUTE_STORE_BASE + ROUTE_STORE_BANKS * ROUTE_STORE_BANK_SIZE <= MESH_FLASH_SIZE,
+              "Flash image too small for the peer table and every route store bank");
+static_assert(MESH_MAX_PEERS <= 255, "Peer counts are kept in one byte");
+
+static const uint8_t broadcast_address[MAC_SIZE] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+
+MeshNode::MeshNode(Radio &radio, Clock &clock, FlashBackend &flash, Logger &log, const wire_node_table_t *node_table)
+  : radio(radio), clock(clock), flash(flash), log(log), node_table(node_table), on_deliver(NULL), deliver_ctx(NULL), signal(NULL), counter(1), slots(radio),
+    route_store(flash, ROUTE_STORE_BASE, ROUTE_STORE_SIZE),
+    reliable_tx(Transmit_Reliable, this), router(Broadcast_Routes, this), dv_enabled(true), etx_enabled(true), flood(Relay_Flood, this), flood_mode(MESH_FLOOD_BROADCAST ? FLOOD_BROADCAST : FLOOD_UNICAST), fragments(Transmit_Fragment, this), aggregator(Send_Frame, this), scheduler(Transmit_Frame, this), failover_enabled(true), repair_enabled(true), last_error_at(0), reported_drops(0), reported_tx_drops(0), malformed_frames(0), reported_failures(0), failovers(0), hop_losses(0) {
+  memset(baseMac, 0, sizeof(baseMac));
+  memset(&repairs, 0, sizeof(repairs));
+  memset(last_error_source, 0, sizeof(last_error_source));
+  memset(last_error_hop, 0, sizeof(last_error_hop));
+}
+
+bool MeshNode::Begin() {
+  memcpy(baseMac, radio.Address(), MAC_SIZE);
+  log.Printf("MAC Address: " MAC_FMT "\n", MAC_ARGS(baseMac));
+
+  // Replay Stored Routes into the Route Cache (Formats the Store on First Boot)
+  bool mounted = route_store.Mount(route_cache);
+  if(mounted) {
+    log.Printf("Routes Loaded from EEPROM: %d\n", (int)route_cache.Count());
+  } else {
+    log.Printf("Failed to Mount Route Store.\n");
+  }
+
+  // Route Updates go to the Broadcast Address, which Keeps its Slot
+  slots.Pin(broadcast_address, false);
+  router.Begin(baseMac, clock.Millis());
+  fragments.Begin((uint16_t)clock.Random());
+
+  radio.SetCallbacks(Receive_Callback, Sent_Callback, this);
+  return mounted;
+}
+
+void MeshNode::Poll() {
+  // Send Results first, so this Poll Prices Links with them
+  for(link_status_t *status = link_queue.Peek(); status != NULL; status = link_queue.Peek()) {
+    if(status->success) {
+      log.Printf("Packet Successfully Sent to: " MAC_FMT "\n", MAC_ARGS(status->mac));
+    } else {
+      log.Printf("Packet Delivery Failed to: " MAC_FMT "\n", MAC_ARGS(status->mac));
+    }
+    // Broadcasts are never Acked, only Unicasts Measure the Link
+    if(memcmp(status->mac, broadcast_address, 6) != 0) {
+      links.OnSent(status->mac, status->success);
+      peers.OnSent(status->mac, status->success);
+    }
+    link_queue.Release();
+  }
+
+  // Radio is Free Once its Result is in: Resend the Frame or Give it Up, Send the Next
+  scheduler.Poll(clock.Millis());
+
+  // Frames still not Acked after every Resend: Reroute them around their Next Hop
+  for(const tx_frame_t *frame = scheduler.PeekFailed(); frame != NULL; frame = scheduler.PeekFailed()) {
+    Fail_Over(this, frame->mac, frame->data, frame->len, RADIO_RSSI_UNKNOWN);
+    scheduler.ReleaseFailed();
+  }
+
+  while(!rx_queue.Empty()) {
+    log.Printf("%u\n", (unsigned)rx_queue.Size());
+    ProcessReceivedData();
+  }
+
+  // Report Frames Dropped Because the RX Queue was Full
+  if(rx_queue.Dropped() != reported_drops) {
+    reported_drops = rx_queue.Dropped();
+    log.Printf("RX Queue Drops: %u\n", (unsigned)reported_drops);
+  }
+
+  // Relay Floods whose Backoff Ended
+  flood.Poll(clock.Millis());
+
+  // Merge Route Updates, then Send Due Updates of our Own
+  for(ctrl_slot_t *slot = ctrl_queue.Peek(); slot != NULL; slot = ctrl_queue.Peek()) {
+    links.OnReceive(slot->mac, slot->rssi, clock.Millis());
+    peers.OnReceive(slot->mac, slot->rssi, clock.Millis());
+    if(!router.OnUpdate(slot->mac, LinkCost(slot->mac), slot->data, slot->len, clock.Millis())) {
+      ++malformed_frames;
+    }
+    ctrl_queue.Release();
+  }
+  if(dv_enabled) {
+    router.Poll(clock.Millis());
+  }
+
+  // Retransmit Unacknowledged Packets
+  reliable_tx.Poll(clock.Millis());
+  if(reliable_tx.Stats().failed != reported_failures) {
+    reported_failures = reliable_tx.Stats().failed;
+    log.Printf("Maximum Retransmission Attempts Reached. Packets Discarded: %u\n", (unsigned)reported_failures);
+  }
+
+  // Pace out Fragments and Retry Missing ones
+  fragments.Poll(clock.Millis());
+
+  // Send Batches whose Delay Ended, after everything this Poll Queued
+  aggregator.Poll(clock.Millis());
+
+  // Send what this Poll Queued, Keep the Radio Busy even if a Send Callback got Lost
+  scheduler.Poll(clock.Millis());
+  if(scheduler.Dropped() != reported_tx_drops) {
+    reported_tx_drops = scheduler.Dropped();
+    log.Printf("TX Queue Drops: %u\n", (unsigned)reported_tx_drops);
+  }
+}
+
+void MeshNode::SetDeliveryHandler(DeliverFn fn, void *ctx) {
+  on_deliver = fn;
+  deliver_ctx = ctx;
+}
+
+void MeshNode::Receive_Callback(void *ctx, const uint8_t *mac, const uint8_t *data, int len, int rssi) {
+  ((MeshNode *)ctx)->On_Data_Receive(mac, data, len, rssi);
+}
+
+void MeshNode::Sent_Callback(void *ctx, const uint8_t *mac, bool success) {
+  ((MeshNode *)ctx)->On_Data_Sent(mac, success);
+}
+
+bool MeshNode::AppendBaseMAC(message_t *packet, uint8_t index) {
+
+  log.Printf("Inside Append MAC\n");
+
+  if(index >= MAX_NODES) {
+    log.Printf("Max Nodes Reached. Cannot Append MAC Address.\n");
+    return false;
+  }
+
+  // Copy Base MAC Address to Path Array
+  memcpy(packet->Path_Array[index], baseMac, 6);
+  log.Printf("Appended MAC at index: %d\n", index);
+  packet->Path_Index = ++index; // Increment Index of Path Array
+  ++packet->Path_Length; // Increment Length of Path Array
+  return true;
+}
+
+// Send Data Function
+void MeshNode::Send_Data(message_t *packet, const uint8_t *mac)
+{
+  // Table Route: Frame Carries only the Destination
+  if(dv_enabled && router.Lookup(mac) != NULL) {
+    if(!packet->Routed) {
+      packet->TTL = DV_ROUTED_TTL; // Table Routes are Loop Free, TTL only Bounds Transients
+    }
+    Route_Packet(packet);
+    return;
+  }
+
+  bool dataLoaded = LoadPathFromCache(packet, mac); // Load Path Array from Route Cache
+  if(dataLoaded) {
+    log.Printf("Path Loaded from Route Cache successfully.\n");
+
+    packet->Path_Exist = true;
+
+    FollowPathArray(packet); // Follow Path Array
+
+    return;
+  }
+
+  log.Printf("Path Not Found in Route Cache.\n");
+
+  if(peers.Contains(mac)) {
+    if(Send_Packet(mac, packet)) { // Send data to 1st ESP32-32u
+      log.Printf("Sent with Success.\n");
+    } else {
+      log.Printf("Error while sending data.\n%s\n", radio.LastError());
+    }
+  } else {
+    Forward_Message(packet);  // Forward packet to connected Peers
+  }
+}
+
+// Context for a Packet this Node Builds, NULL if too many are in the Making
+packet_ctx_t *MeshNode::Acquire_Packet() {
+  packet_ctx_t *pkt = packets.Alloc();
+  if(pkt == NULL) {
+    log.Printf("Packet Pool Exhausted. Dropping Packet.\n");
+    return NULL;
+  }
+  pkt->dest_known = false;
+  return pkt;
+}
+
+bool MeshNode::Send_Reliable(const char *text, const uint8_t *destination_mac) {
+  packet_ctx_t *pkt = Acquire_Packet();
+  if(pkt == NULL) {
+    return false;
+  }
+  pkt->dest_known = CheckDestInPath(destination_mac);
+  Configure_Packet(pkt, text, 3, 2, false, false, destination_mac, baseMac, false); // Configure Packet
+  bool queued = reliable_tx.Send(&pkt->packet, clock.Millis()); // Window Keeps its own Copy
+  packets.Free(pkt);
+  return queued;
+}
+
+int MeshNode::Send_Buffer(const uint8_t *data, size_t len, const uint8_t *destination_mac) {
+  return fragments.Send(destination_mac, data, len, clock.Millis());
+}
+
+// Called by Fragment Transport for every Fragment and Fragment Ack
+bool MeshNode::Transmit_Fragment(void *ctx, const uint8_t *dest, const uint8_t *payload, size_t len, bool ack) {
+  MeshNode *node = (MeshNode *)ctx;
+  packet_ctx_t *pkt = node->Acquire_Packet();
+  if(pkt == NULL) {
+    return false;
+  }
+  node->Configure_Packet(pkt, "", FRAGMENT_TTL, 3, false, ack, dest, node->baseMac, false); // Configure Packet
+  memcpy(pkt->packet.text, payload, len); // Binary Payload
+  pkt->packet.Text_Length = (uint8_t)len;
+  node->Send_Data(&pkt->packet, dest);
+  node->packets.Free(pkt);
+  return true;
+}
+
+// Called by the Router for every Route Update Frame
+bool MeshNode::Broadcast_Routes(void *ctx, const uint8_t *frame, size_t len) {
+  MeshNode *node = (MeshNode *)ctx;
+  return node->scheduler.Enqueue(TX_CLASS_CONTROL, broadcast_address, frame, len, node->clock.Millis());
+}
+
+// Called by the Transport for First Transmissions and Retransmissions
+bool MeshNode::Transmit_Reliable(const message_t *packet, void *ctx) {
+  MeshNode *node = (MeshNode *)ctx;
+  packet_ctx_t *pkt = node->Acquire_Packet();
+  if(pkt == NULL) {
+    return false; // Goes Out with the Next Retransmission
+  }
+  memcpy(&pkt->packet, packet, sizeof(pkt->packet)); // The Window's Copy Stays as it is
+  pkt->packet.packetID = node->clock.Random(); // New ID so Retransmits are not Dropped as Flood Duplicates
+  node->Send_Data(&pkt->packet, pkt->packet.destination_mac);
+  node->packets.Free(pkt);
+  return true;
+}
+
+// Encode Packet in the Compact Wire Format and Send it
+bool MeshNode::Send_Packet(const uint8_t *mac, const message_t *packet) {
+  uint8_t frame[WIRE_MAX_FRAME];
+  size_t len = EncodeMessage(packet, node_table, frame, sizeof(frame));
+  if(len == 0) {
+    log.Printf("Packet Does Not Fit in a Frame.\n");
+    return false;
+  }
+  TxClass cls = ClassOf(packet);
+  // Broadcasts are not Batched, Flood Suppression Times them Already
+  if(memcmp(mac, broadcast_address, 6) == 0) {
+    return Send_Frame(this, mac, frame, len, cls);
+  }
+  return aggregator.Add(mac, frame, len, cls, clock.Millis()); // Batched with other Packets to the same Next Hop
+}
+
+// Acks, Discovery and Route Errors Jump the Queue, Relays for Others Share the Radio with our Own Packets
+TxClass MeshNode::ClassOf(const message_t *packet) const {
+  if(packet->Data_Ack || packet->broadcast_Ack || packet->identification == 1 || packet->identification == ROUTE_ERROR_ID) {
+    return TX_CLASS_CONTROL;
+  }
+  return memcmp(packet->source_mac, baseMac, 6) == 0 ? TX_CLASS_ORIGIN : TX_CLASS_FORWARD;
+}
+
+// Same Classes for a Frame Already Encoded
+TxClass MeshNode::ClassOf(const MessageView &view) const {
+  if((view.Flags() & (WIRE_FLAG_DATA_ACK | WIRE_FLAG_BROADCAST_ACK)) || view.Identification() == 1 || view.Identification() == ROUTE_ERROR_ID) {
+    return TX_CLASS_CONTROL;
+  }
+  return memcmp(view.SourceMac(), baseMac, 6) == 0 ? TX_CLASS_ORIGIN : TX_CLASS_FORWARD;
+}
+
+// Called by the Aggregator for every Batch and every Packet that goes Alone
+bool MeshNode::Send_Frame(void *ctx, const uint8_t *mac, const uint8_t *frame, size_t len, uint8_t priority) {
+  MeshNode *node = (MeshNode *)ctx;
+  const peer_info_t *peer = node->peers.Lookup(mac); // Read Here, the Peer Table Belongs to this Task
+  if(!node->scheduler.Enqueue((TxClass)priority, mac, frame, len, node->clock.Millis(), peer != NULL && peer->encrypted)) {
+    node->log.Printf("TX Queue Full. Dropping Frame.\n");
+    return false;
+  }
+  return true;
+}
+
+// Called by the Scheduler when the Radio is Free for the Next Frame
+bool MeshNode::Transmit_Frame(void *ctx, const uint8_t *mac, const uint8_t *frame, size_t len, bool encrypt) {
+  MeshNode *node = (MeshNode *)ctx;
+  if(!node->slots.Acquire(mac, encrypt)) {
+    node->log.Printf("No Radio Peer Slot for " MAC_FMT ".\n%s\n", MAC_ARGS(mac), node->radio.LastError());
+    return false;
+  }
+  if(!node->radio.Send(mac, frame, len)) {
+    node->log.Printf("Error while sending Frame.\n%s\n", node->radio.LastError());
+    return false;
+  }
+  return true;
+}
+
+// Called from Poll() for a Frame mac never Acked, not even when Resent. Table Routes
+// Carry only the Destination, so their Packets can go to another Next Hop as they are;
+// Path Arrays name every Hop, their Path is Repaired from here (Repair_Path)
+void MeshNode::Fail_Over(void *ctx, const uint8_t *mac, const uint8_t *data, int len, int rssi) {
+  MeshNode *node = (MeshNode *)ctx;
+  if(FrameAggregator::IsBatch(data, len)) {
+    FrameAggregator::Unpack(mac, data, len, rssi, Fail_Over, ctx); // Packets in a Batch may go Different Ways
+    return;
+  }
+
+  MessageView view(data, len);
+  if(node->repair_enabled && view.Valid() && (view.Flags() & (WIRE_FLAG_ROUTED | WIRE_FLAG_PATH_EXIST)) == WIRE_FLAG_PATH_EXIST) {
+    node->Repair_Path(view, mac);
+    return;
+  }
+  const uint8_t *next_hop = NULL;
+  if(node->failover_enabled && node->dv_enabled && view.Valid() && (view.Flags() & WIRE_FLAG_ROUTED)) {
+    next_hop = node->router.Alternate(view.DestinationMac(), mac, node->clock.Millis());
+  }
+  if(next_hop == NULL) {
+    ++node->hop_losses;
+    node->log.Printf("Next Hop " MAC_FMT " not Acking, no Alternate. Dropping Packet.\n", MAC_ARGS(mac));
+    return;
+  }
+
+  node->log.Printf("Next Hop " MAC_FMT " not Acking. Rerouting via " MAC_FMT "\n", MAC_ARGS(mac), MAC_ARGS(next_hop));
+  node->Check_Existing_Peer(next_hop);
+  if(Send_Frame(node, next_hop, data, len, node->ClassOf(view))) {
+    ++node->failovers;
+  }
+}
+
+// The Path of a Packet Broke at its Next Hop: Drop Stored Paths over the Link, Tell the
+// Source, and Get the Packet there Anyway: on a Route of our Own, or by Flooding it
+// again from here with a Short TTL, the Path so far Kept
+void MeshNode::Repair_Path(const MessageView &view, const uint8_t *broken_hop) {
+  ++repairs.breaks;
+  Invalidate_Link(baseMac, broken_hop);
+
+  packet_ctx_t *pkt = Acquire_Packet();
+  if(pkt == NULL) {
+    ++hop_losses;
+    return;
+  }
+  message_t *packet = &pkt->packet;
+  // The Frame was Sent by FollowPathArray: Path_Index is the Broken Hop, we are just Before
+  if(!DecodeMessage(view.Raw(), view.Length(), node_table, packet) || packet->Path_Index == 0 ||
+     memcmp(packet->Path_Array[packet->Path_Index - 1], baseMac, 6) != 0) {
+    ++hop_losses;
+    packets.Free(pkt);
+    return;
+  }
+  uint8_t here = packet->Path_Index - 1;
+  log.Printf("Path Broken at " MAC_FMT ". Repairing.\n", MAC_ARGS(broken_hop));
+
+  Send_Route_Error(packet, broken_hop);
+
+  const dv_route_t *table = dv_enabled ? router.Lookup(packet->destination_mac) : NULL;
+  route_entry_t *route = route_cache.Lookup(packet->destination_mac); // Paths over the Broken Link are Gone Already
+  if(table != NULL && memcmp(table->next_hop, broken_hop, 6) != 0) {
+    ++repairs.repaired;
+    packet->TTL = DV_ROUTED_TTL;
+    Route_Packet(packet);
+  } else if(route != NULL && here + route->path_len <= MAX_NODES) {
+    ++repairs.repaired;
+    memcpy(packet->Path_Array[here], route->path, route->path_len * MAC_SIZE); // Our Path Starts with Us
+    packet->Path_Length = here + route->path_len;
+    packet->Path_Index = here;
+    FollowPathArray(packet);
+  } else {
+    ++repairs.rediscoveries;
+    packet->Path_Exist = false;
+    packet->Path_Length = here + 1; // Up to this Node, Relays Append themselves
+    packet->Path_Index = here + 1;
+    packet->TTL = PATH_REPAIR_TTL;
+    Forward_Message(packet);
+  }
+  packets.Free(pkt);
+}
+
+// Route Error Back to the Packet's Source, along the Reversed Path it Came
+void MeshNode::Send_Route_Error(const message_t *packet, const uint8_t *broken_hop) {
+  uint8_t here = packet->Path_Index - 1;
+  if(here == 0 || memcmp(packet->source_mac, baseMac, 6) == 0) {
+    return; // We are the Source
+  }
+  uint32_t now = clock.Millis();
+  if(memcmp(last_error_source, packet->source_mac, 6) == 0 && memcmp(last_error_hop, broken_hop, 6) == 0 &&
+     (uint32_t)(now - last_error_at) < ROUTE_ERROR_HOLDOFF_MS) {
+    return; // Reported Already, the Packets Behind were Sent before the Source Knew
+  }
+
+  packet_ctx_t *pkt = Acquire_Packet();
+  if(pkt == NULL) {
+    return;
+  }
+  message_t *error = &pkt->packet;
+  Configure_Packet(pkt, "", ROUTE_ERROR_TTL, ROUTE_ERROR_ID, false, false, packet->source_mac, baseMac, true); // Configure Packet
+  memcpy(error->text, baseMac, MAC_SIZE); // Broken Link
+  memcpy(error->text + MAC_SIZE, broken_hop, MAC_SIZE);
+  error->Text_Length = 2 * MAC_SIZE;
+  for(int i = 0; i <= here; i++) {
+    memcpy(error->Path_Array[i], packet->Path_Array[here - i], MAC_SIZE);
+  }
+  error->Path_Length = here + 1;
+  error->Path_Index = 0;
+  FollowPathArray(error);
+  packets.Free(pkt);
+
+  ++repairs.errors_sent;
+  memcpy(last_error_source, packet->source_mac, 6);
+  memcpy(last_error_hop, broken_hop, 6);
+  last_error_at = now;
+}
+
+// Route Error Heard, at the Source or Forwarding it there: Forget Paths over the Link
+void MeshNode::Handle_Route_Error(const message_t *packet) {
+  if(packet->Text_Length != 2 * MAC_SIZE) {
+    ++malformed_frames;
+    return;
+  }
+  ++repairs.errors_received;
+  log.Printf("Route Error: Link " MAC_FMT " -> " MAC_FMT " Broken.\n", MAC_ARGS(packet->text), MAC_ARGS(packet->text + MAC_SIZE));
+  Invalidate_Link(packet->text, packet->text + MAC_SIZE);
+}
+
+// Remove every Stored Path that Uses the Link, from the Cache and the Route Log
+void MeshNode::Invalidate_Link(const uint8_t *from, const uint8_t *to) {
+  for(size_t i = 0; i < RouteCache::Capacity(); i++) {
+    const route_entry_t *route = route_cache.Slot(i);
+    if(route == NULL) {
+      continue;
+    }
+    bool broken = false;
+    for(int hop = 0; hop + 1 < route->path_len && !broken; hop++) {
+      broken = memcmp(route->path[hop], from, MAC_SIZE) == 0 && memcmp(route->path[hop + 1], to, MAC_SIZE) == 0;
+    }
+    if(!broken) {
+      continue;
+    }
+    uint8_t dest[MAC_SIZE];
+    memcpy(dest, route->dest, MAC_SIZE); // Removing Moves no other Route, the Walk Goes on
+    route_cache.Remove(dest);
+    if(!route_store.RemoveRoute(dest, route_cache)) {
+      log.Printf("Failed to Remove Path from EEPROM.\n");
+    }
+    ++repairs.routes_invalidated;
+    log.Printf("Path to " MAC_FMT " Removed.\n", MAC_ARGS(dest));
+  }
+}
+
+// Callback when data is sent (Radio Task): only Record the Result, Poll() Acts on it
+void MeshNode::On_Data_Sent(const uint8_t *mac_addr, bool success) {
+  link_status_t *status = link_queue.Reserve();
+  if(status != NULL) {
+    memcpy(status->mac, mac_addr, 6);
+    status->success = success;
+    link_queue.Commit();
+  }
+
+  scheduler.OnSent(mac_addr, success);
+  if(signal != NULL) {
+    signal->Notify(); // Radio is Free, Poll() Sends the Next Frame (or a Resend)
+  }
+}
+
+// Set Packet Contents
+bool MeshNode::Configure_Packet(packet_ctx_t *pkt, const char *text, int TTL, int identification, bool broadcast_Ack, bool Data_Ack, const uint8_t *destination_mac, const uint8_t *source_mac, bool path_exist) {
+  message_t *packet = &pkt->packet;
+
+  memset(packet, 0, sizeof(*packet)); // Clear Packet
+  strncpy((char *)packet->text, text, sizeof(packet->text) - 1); // Copy Data to Message
+  packet->text[sizeof(packet->text) - 1] = '\0'; // Null Terminate
+  packet->Text_Length = strlen((char *)packet->text); // Bytes on Air
+  packet->TTL = TTL; // Set Time to Live
+  packet->identification = identification; // Set Identification
+  packet->broadcast_Ack = broadcast_Ack; // Set Acknowledgement
+  packet->Data_Ack = Data_Ack; // Set Data Acknowledgement
+  packet->packetID = clock.Random(); // Set Packet ID
+  memcpy(packet->destination_mac, destination_mac, 6); // Set Destination MAC Address
+  memcpy(packet->source_mac, source_mac, 6); // Set Source MAC Address
+  packet->Path_Exist = path_exist; // Set Path Exist Flag
+  packet->Path_Length = 0; // Set Path Length
+
+  if(!path_exist && !broadcast_Ack && (identification == 2) && (!Data_Ack) && (!pkt->dest_known)) {
+    bool result = AppendBaseMAC(packet, 0); // Append Base MAC Address to Path Array
+    if(result) {
+      log.Printf("Appended MAC Successfully.\n");
+    } else {
+      log.Printf("Failed to Append MAC.\n");
+    }
+  }
+
+  return true;
+}
+
+// Check if Peer Already Exists
+void MeshNode::Check_Existing_Peer(const uint8_t* mac)
+{
+  if(!peers.Contains(mac)) {
+    log.Printf("New Peer Found.\nAdding Peer\n");
+    Add_Peer(mac);  // Add New Peer to network
+  }
+}
+
+// Callback when data is received
+void MeshNode::On_Data_Receive(const uint8_t* mac, const uint8_t* data, int len, int rssi) {
+  log.Printf("Inside On_Data_Receive Function\n");
+
+  // Route Updates are Queued as they are, the Router Runs in Poll()
+  if(DvRouter::IsUpdate(data, len)) {
+    if(!dv_enabled || len > DV_FRAME_MAX) {
+      return;
+    }
+    ctrl_slot_t *slot = ctrl_queue.Reserve();
+    if(slot != NULL) {
+      memcpy(slot->mac, mac, 6);
+      slot->rssi = (int16_t)rssi;
+      memcpy(slot->data, data, len);
+      slot->len = (uint8_t)len;
+      ctrl_queue.Commit();
+      if(signal != NULL) {
+        signal->Notify();
+      }
+    }
+    return;
+  }
+
+  // Batches are Split here, every Packet in them is Handled as if it came Alone
+  if(FrameAggregator::IsBatch(data, len)) {
+    if(!FrameAggregator::Unpack(mac, data, len, rssi, Receive_Callback, this)) {
+      ++malformed_frames;
+      log.Printf("Malformed Batch (%d bytes). Dropping Frame.\n", len);
+    }
+    return;
+  }
+
+  // Validate Version and Lengths against the Wire Layout before touching any field
+  MessageView view(data, len);
+  if(!view.Valid()) {
+    ++malformed_frames;
+    log.Printf("Malformed Frame (%d bytes). Dropping Frame.\n", len);
+    return;
+  }
+
+  // Only the header fields needed to route the frame are read from the radio buffer
+  const uint8_t *destination_mac = view.DestinationMac();
+  int TTL = view.TTL();
+  bool forward = false;
+
+  log.Printf("TTL: %d\n", TTL);
+  log.Printf("Destionation MAC Address: " MAC_FMT "\n", MAC_ARGS(destination_mac));
+
+  // Check if the message is for this node
+  if(memcmp(baseMac, destination_mac, 6) == 0) {
+    forward = false;
+  }
+  // Handle Broadcast Messages
+  else if(memcmp(destination_mac, broadcast_address, 6) == 0) {
+    log.Printf("Broadcast Message Received.\n");
+  }
+  // Handle Messages for Other Nodes
+  else if(TTL > 0) {
+    log.Printf("Forwarding Message.\n");
+    forward = true;
+  } else {
+    log.Printf("TTL Expired. Discarding Packet.\n");
+    return; // Dropped without copying the frame
+  }
+
+  // Handle Incoming Data
+  rx_slot_t *new_node = rx_queue.Reserve();
+  if(new_node == NULL) {
+    log.Printf("RX Queue Full. Dropping Frame.\n");
+    return;
+  }
+
+  // Single decode out of the radio buffer, which is only valid during this callback
+  if(!DecodeMessage(view.Raw(), view.Length(), node_table, &new_node->data)) {
+    ++malformed_frames;
+    log.Printf("Unknown Node Index in Path. Dropping Frame.\n");
+    return; // Slot is not committed
+  }
+  memcpy(new_node->mac, mac, 6);
+  new_node->rssi = (int16_t)rssi;
+  new_node->forward = forward;
+  if(forward) {
+    new_node->data.TTL = TTL - 1; // Decrement TTL
+  }
+
+  rx_queue.Commit(); // Publish Slot to Poll()
+  if(signal != NULL) {
+    signal->Notify(); // Wake the Mesh Task
+  }
+}
+
+// Process Received Data
+void MeshNode::ProcessReceivedData() {
+  rx_slot_t *temp = rx_queue.Peek();
+
+  if(temp == NULL) {
+    log.Printf("Queue is empty. No Data to Process\n");
+    return;
+  }
+
+  log.Printf("Packet ID: %d\n", temp->data.packetID);
+  links.OnReceive(temp->mac, temp->rssi, clock.Millis()); // Duplicates still Tell us about the Link
+  peers.OnReceive(temp->mac, temp->rssi, clock.Millis());
+
+  // Check if Packet is already received, Mark it as Received otherwise
+  if(receivedpackets.CheckAndInsert(temp->data.source_mac, temp->data.packetID, clock.Millis())) {
+    log.Printf("Packet Already Received. Discarding Duplicate Packet.\n");
+    flood.OnDuplicate(temp->data.source_mac, temp->data.packetID); // Counts towards Cancelling our Relay
+    rx_queue.Release(); // Free Slot
+    return;
+  }
+
+  log.Printf("Inside Processing Function\n");
+
+  // Packet Forwarding
+  if(temp->forward) {
+    if(temp->data.Routed) {
+      if(!Route_Packet(&temp->data)) { // Next Hop from the Table
+        log.Printf("No Route to Destination. Dropping Packet.\n");
+      }
+    } else if(!temp->data.Path_Exist) {
+      uint8_t last_index = temp->data.Path_Index;
+      bool result = AppendBaseMAC(&temp->data, last_index); // Append Base MAC Address to Path Array, in the Slot
+      if(result) {
+        log.Printf("Appended MAC Successfully.\n");
+      } else {
+        log.Printf("Failed to Append MAC.\n");
+      }
+      PrintArray(temp->data.Path_Array, last_index);
+      Send_Data(&temp->data, temp->data.destination_mac); // Forward Data to Destination
+    } else {
+      log.Printf("Path Exists. Forwarding to Next Node.\n");
+      if(temp->data.identification == ROUTE_ERROR_ID) {
+        Handle_Route_Error(&temp->data); // Paths of this Node over the Link are Broken too
+      }
+      FollowPathArray(&temp->data); // Forward the Slot in Place
+    }
+    rx_queue.Release(); // Free Slot
+    return;
+  }
+
+  switch(temp->data.identification) {
+    case 2: // DATA is Received
+      log.Printf("*************************************************\n\n");
+      log.Printf("Session: %d\nSession Started\n", counter);
+      log.Printf("Sender MAC Address: " MAC_FMT "\n", MAC_ARGS(temp->data.source_mac));
+      log.Printf("Packet ID: %d\n", temp->data.packetID);
+      log.Printf("Smoothed RTT: %u\n", (unsigned)reliable_tx.SmoothedRtt(temp->data.source_mac)); // Per Destination, from Reliable Acks
+      if(temp->data.broadcast_Ack) {  // Process Broadcast Acknowledgement
+        log.Printf("Broadcast Acknowldgement Received: %d\n", temp->data.broadcast_Ack);
+        log.Printf("%s\n", (char *) temp->data.text);
+        Check_Existing_Peer(temp->mac); // Check if Peer Exists else Add Peer
+        SwitchToEncryption(temp->mac); // Switch to encryption mode
+        log.Printf("*************************************************\n");
+      } else if(temp->data.Data_Ack) {  // Process Data Acknowledgement
+        log.Printf("Data Acknowledgement Received: %d\n", temp->data.Data_Ack);
+        log.Printf("%s\n", (char *) temp->data.text);
+        log.Printf("Session Terminated\n\n*************************************************\n");
+        if(temp->data.Reliable) {
+          reliable_tx.OnAck(temp->data.source_mac, temp->data.ack_seq, temp->data.sack, clock.Millis()); // Free Acknowledged Packets
+        }
+        if(!temp->data.Routed) { // Routed Acks Carry no Path
+          ReverseArray(temp->data.Path_Index, temp->data.Path_Array); // Reverse the Path Array
+          PrintArray(temp->data.Path_Array, temp->data.Path_Index);  // Print Reversed Array
+          SavePathToEEPROM(temp->data.Path_Array, temp->data.Path_Index); // Save Path Array to EEPROM
+        }
+      }
+      else {
+        uint16_t ack_seq = 0;
+        uint32_t sack = 0;
+        bool fresh = !temp->data.Reliable || reliable_tx.OnData(&temp->data, &ack_seq, &sack);
+        if(fresh) {
+          log.Printf("Data Received: %s\n", (char*) temp->data.text);
+          if(on_deliver != NULL) {
+            on_deliver(deliver_ctx, &temp->data);
+          }
+        } else {
+          log.Printf("Duplicate Data (Acknowledgement Lost). Acknowledging Again.\n");
+        }
+        log.Printf("Session Terminated\n\n*************************************************\n");
+        // Handle Sending Acknowledgement here for Data
+        uint8_t last_index = temp->data.Path_Index;
+        AppendBaseMAC(&temp->data, last_index); // Append Dst Base MAC Address to Path Array
+        temp->data.Path_Index = last_index; // Keep Index of Last Hop (This Node)
+        PrintArray(temp->data.Path_Array, temp->data.Path_Index);  // Print Path Array
+        ReverseArray(temp->data.Path_Index, temp->data.Path_Array); // Reverse the Path Array
+        PrintArray(temp->data.Path_Array, temp->data.Path_Index);  // Print Reversed Array
+        if(!temp->data.Routed) { // Routed Data Carries no Path to Learn
+          log.Printf("Saving Path to EEPROM\n");
+          SavePathToEEPROM(temp->data.Path_Array, temp->data.Path_Index); // Save Path Array to EEPROM
+        }
+        // Check if Dest MAC already in Path Array. True -> Don't Save in EEPROM False -> Save in EEPROM
+        packet_ctx_t *pkt = Acquire_Packet();
+        if(pkt == NULL) {
+          break; // Sender Retransmits, we Ack the Duplicate
+        }
+        message_t *ack = &pkt->packet;
+        Configure_Packet(pkt, "Ack from Node 3", 10, 2, false, true, temp->data.source_mac, baseMac, true); // Configure Packet
+        ack->Reliable = temp->data.Reliable; // Ack Carries the Receive Window State
+        ack->ack_seq = ack_seq;
+        ack->sack = sack;
+
+        // Ack Follows the Table Back when there is a Route
+        if(dv_enabled && router.Lookup(ack->destination_mac) != NULL) {
+          ack->Path_Exist = false;
+          ack->TTL = DV_ROUTED_TTL;
+          Route_Packet(ack);
+          packets.Free(pkt);
+          break;
+        }
+
+        ack->Path_Index = temp->data.Path_Index;  // Copy Path Index to Packet
+        // Copy Path to Packet
+        for(int i=0;i<=ack->Path_Index;i++) {
+          log.Printf("Copying data at index: %d\n", i);
+          memcpy(ack->Path_Array[i], temp->data.Path_Array[i], MAC_SIZE);
+        }
+        ack->Path_Length = ack->Path_Index + 1; // Hops Carried on Air
+
+        // Reset index to 0
+        ack->Path_Index = 0;  // Reset Path Index
+        // Send Data according to Path
+        FollowPathArray(ack);
+        packets.Free(pkt);
+      }
+    break;
+    case 1: { // BROADCAST is Received
+      log.Printf("Broadcast Message Received\n");
+      log.Printf("Data Identification Number: %d\n", temp->data.identification);
+      Check_Existing_Peer(temp->mac); // Check if Peer Exists
+      packet_ctx_t *pkt = Acquire_Packet();
+      if(pkt != NULL) {
+        Configure_Packet(pkt, "Acknowledgement from Node 2", 0, 2, true, false, temp->mac, baseMac, false); // Configure Packet
+        pkt->packet.Path_Index = 0;  // Set Path Index to 0
+        Send_Data(&pkt->packet, temp->mac); // Send Data to Sender
+        packets.Free(pkt);
+      }
+      SwitchToEncryption(temp->mac); // Switch to encryption mode
+    }
+    break;
+    case 3: // FRAGMENT or Fragment Ack is Received
+      fragments.OnFrame(temp->data.source_mac, temp->data.text, temp->data.Text_Length, temp->data.Data_Ack, clock.Millis());
+    break;
+    case ROUTE_ERROR_ID: // Path to a Destination Broke on the Way
+      Handle_Route_Error(&temp->data);
+    break;
+    default:  // Unknown Message
+      log.Printf("Unknown Message Received\n");
+    break;
+  }
+
+  counter++;  // Increment session counter
+
+  rx_queue.Release(); // Free Slot
+}
+
+// Add Peer to Routing Table
+// Neighbour Set Only: the Radio Registers the Peer when a Frame Goes to it (PeerSlots)
+void MeshNode::Add_Peer(const uint8_t* mac) {
+  // Store the MAC in the Peer Table, Plain until SwitchToEncryption
+  if(peers.Add(mac)) {
+    log.Printf("Peer Added Successfully\nPeer MAC: " MAC_FMT "\n", MAC_ARGS(mac));
+  } else {
+    log.Printf("Peer Table Full. MAC not Stored.\n");
+  }
+}
+
+// Broadcast Message
+void MeshNode::broadcast()
+{
+  packet_ctx_t *pkt = Acquire_Packet();
+  if(pkt == NULL) {
+    return;
+  }
+
+  // Prepare Broadcast Data
+  Configure_Packet(pkt, "Broadcast_Msg", 0, 1, false, false, broadcast_address, baseMac, false); // Configure Packet
+  // Send Message
+  if(Send_Packet(broadcast_address, &pkt->packet)) {
+    log.Printf("Broadcast Message Sent Successfully.\n");
+  } else {
+    log.Printf("Error while sending broadcast message.\n%s\n", radio.LastError());
+  }
+  packets.Free(pkt);
+}
+
+// Packet Forwarding Function
+void MeshNode::Forward_Message(const message_t *packet)
+{
+  if(packet->TTL <= 0) {
+    log.Printf("TTL Expired. Discarding Packet.\n");
+    return;
+  }
+
+  // Relays Wait out a Backoff so Overheard Copies can Cancel them, the Originator Sends Right Away
+  if(flood_mode == FLOOD_BROADCAST && memcmp(packet->source_mac, baseMac, 6) != 0) {
+    flood.Schedule(packet, clock.Millis(), clock.Random());
+    return;
+  }
+
+  Flood_Packet(packet);
+}
+
+// Called by Flood Control when a Relay's Backoff Ends
+void MeshNode::Relay_Flood(const message_t *packet, void *ctx) {
+  ((MeshNode *)ctx)->Flood_Packet(packet);
+}
+
+void MeshNode::Flood_Packet(const message_t *packet)
+{
+  if(flood_mode == FLOOD_BROADCAST) {
+    // One Frame Reaches every Neighbour, Peer or not
+    if(Send_Packet(broadcast_address, packet)) {
+      log.Printf("Message Flooded by Broadcast.\n");
+    } else {
+      log.Printf("Error flooding message.\n%s\n", radio.LastError());
+    }
+    return;
+  }
+
+  if(peers.Count() == 0) {
+    log.Printf("No Connected Nodes to Forward Message.\n");
+    return;
+  }
+
+  log.Printf("Forwarding Message to Connected Nodes.\n");
+  // Forward Data to Connected Nodes
+  uint64_t source = peers.Key(packet->source_mac);
+  for(size_t n = 0; n < peers.Count(); n++) {
+    uint8_t peer[MAC_SIZE];
+    peers.MacAt(n, peer);
+    if(peers.KeyAt(n) != source) {  // Avoid Retransmitting to Source
+      if(Send_Packet(peer, packet)) {
+        log.Printf("Message forwarded successfully to peer with MAC: " MAC_FMT "\n", MAC_ARGS(peer));
+      } else {
+        log.Printf("Error forwarding message.\n%s\n", radio.LastError());
+      }
+    }
+  }
+}
+
+// Only Marks the Peer: its Slot is Registered with the LMK before the Next Frame to it
+void MeshNode::SwitchToEncryption(const uint8_t *mac) {
+  peer_info_t *peer = peers.Lookup(mac);
+  if(peer == NULL) {
+    return;
+  }
+
+  if(peer->encrypted) {
+    log.Printf("Encryption Mode Already Enabled.\nPeer MAC: " MAC_FMT "\n", MAC_ARGS(mac));
+    return; // Return if Encryption Mode is already enabled
+  }
+
+  peer->encrypted = true;
+  log.Printf("Encryption Mode Successfully Enabled.\n");
+}
+
+void MeshNode::SaveDataToEEPROM() {
+  int addr = 0;
+  int node_count = 0;
+  // Save number of nodes on address 0x00. Used for Retrieval Later
+  uint8_t num_nodes = peers.Count() < PEER_FLASH_SLOTS ? (uint8_t)peers.Count() : PEER_FLASH_SLOTS;
+  flash.Write(addr, num_nodes);
+  addr += sizeof(uint8_t);
+
+  // Save each Node, in MAC Order
+  for(int n = 0; n < num_nodes; n++) {
+    uint8_t node[MAC_SIZE];
+    peers.MacAt(n, node);
+    flash.WriteBlock(addr, node, MAC_SIZE);
+    addr += MAC_SIZE;
+    node_count++;
+  }
+
+  flash.Commit();  // Commit changes to EEPROM
+  log.Printf("Number of Nodes Saved: %d\n", node_count);
+  log.Printf("Successfully Saved Data to EEPROM.\n");
+}
+
+void MeshNode::LoadDataFromEEPROM() {
+  int addr = 0;
+  uint8_t num_nodes = flash.Read(addr);  // Retrieve number of nodes
+  addr += sizeof(uint8_t);  // Move to next address
+  if(num_nodes > PEER_FLASH_SLOTS) {
+    num_nodes = 0; // Erased Flash, no Table Saved Yet
+  }
+  peers.Clear(); // Clear the Table before loading new data
+
+  // Load each node
+  for (int i = 0; i < num_nodes; i++) {
+    uint8_t node[MAC_SIZE];
+    for (int j = 0; j < MAC_SIZE; j++) {
+      node[j] = flash.Read(addr);
+      addr += sizeof(uint8_t);
+    }
+
+    // Check for duplicates before adding
+    if (!peers.Contains(node)) {
+      Add_Peer(node);
+      SwitchToEncryption(node);
+      log.Printf("Node Added to Peer Table.\n");
+    } else {
+      log.Printf("Node Already Exists in Peer Table.\n");
+    }
+  }
+
+  log.Printf("Successfully Loaded Data from EEPROM.\n");
+}
+
+void MeshNode::PrintMACTable() {
+  int nodes = 0;
+  log.Printf("Connected Nodes:\n");
+
+  for(size_t n = 0; n < peers.Count(); n++) {
+    uint8_t mac[MAC_SIZE];
+    const peer_info_t &peer = peers.InfoAt(n);
+    peers.MacAt(n, mac);
+    ++nodes;
+    log.Printf("MAC: " MAC_FMT " %s, Last Seen %u ms, %u Frames In, %u/%u Sends Failed, RSSI %d\n", MAC_ARGS(mac),
+               peer.encrypted ? "Encrypted" : "Plain", (unsigned)peer.last_seen, (unsigned)peer.frames_received, (unsigned)peer.failed,
+               (unsigned)peer.sent, peer.rssi);
+  }
+
+  log.Printf("Total Nodes: %d", nodes);
+}
+
+void MeshNode::AddToRoutingAndEEPROM(const uint8_t *mac) {
+  Add_Peer(mac); // Add Peer to ESP-NOW Routing Table
+  SwitchToEncryption(mac); // Switch to Encryption Mode
+  SaveDataToEEPROM(); // Save Data to EEPROM
+}
+
+void MeshNode::PrintMACPath(const message_t *packet, uint8_t index) {
+  log.Printf("Message Index(+1): %d\n", packet->Path_Index);
+  log.Printf("Path Index in Queue Node: %d\n", index);
+  log.Printf("Path Array:\n");
+  for(int i=0;i<=index;i++) {
+    log.Printf("MAC at index %d: " MAC_FMT "\n", i, MAC_ARGS(packet->Path_Array[i]));
+  }
+}
+
+void MeshNode::ReverseArray(uint8_t index, uint8_t path_arr[MAX_NODES][MAC_SIZE]) {
+  uint8_t temp[MAC_SIZE];
+  if(index >= MAX_NODES) {
+    index = MAX_NODES - 1; // Never past the Array, whatever the Frame Claimed
+  }
+  uint8_t size = index;
+  ++size;
+  for (int i = 0; i < size/2; ++i) {
+      memcpy(temp, path_arr[i], MAC_SIZE);  // Copy current to temp
+      memcpy(path_arr[i], path_arr[size - 1 - i], MAC_SIZE);  // Copy last element to current index
+      memcpy(path_arr[size - 1 - i], temp, MAC_SIZE);  // Copy current element to last index
+  }
+
+  log.Printf("Row reversed Successfully.\n");
+}
+
+void MeshNode::PrintArray(uint8_t path_arr[MAX_NODES][MAC_SIZE], uint8_t index) {
+  for(int i=0;i<=index;i++) {
+    log.Printf("MAC at index %d: " MAC_FMT "\n", i, MAC_ARGS(path_arr[i]));
+  }
+}
+
+void MeshNode::SavePathToEEPROM(uint8_t path_arr[MAX_NODES][MAC_SIZE], uint8_t index) {
+
+  // Check Route Cache For Destination MAC Address
+  route_entry_t *stored = route_cache.Lookup(path_arr[index]);
+
+  /* Don't save if destination Exists, unless the New Path is Clearly Cheaper */
+  if(stored != NULL) {
+    uint16_t stored_cost = PathCost(stored->path, stored->path_len - 1);
+    uint16_t new_cost = PathCost(path_arr, index);
+    if(new_cost + PATH_SWITCH_MARGIN > stored_cost) {
+      log.Printf("Destination MAC Already Exists in Path Array. Not Saving to EEPROM.\n");
+      return; // Exit
+    }
+    log.Printf("Cheaper Path Found (ETX %u < %u). Replacing Stored Path.\n", (unsigned)new_cost, (unsigned)stored_cost);
+  }
+
+  if(!route_cache.Insert(path_arr, index + 1, clock.Millis())) {
+    log.Printf("Route Cache Full or Invalid Path. Not Saving to EEPROM.\n");
+    return; // Exit
+  }
+
+  // Append the Route to the Log in EEPROM
+  if(route_store.SaveRoute(route_cache.Lookup(path_arr[index]), route_cache)) {
+    log.Printf("Path Array Saved to EEPROM Successfully.\n");
+  } else {
+    log.Printf("Failed to Save Path to EEPROM.\n"); // Route stays usable from the cache
+  }
+}
+
+// Path Cost: Measured ETX of our own First Hop, Perfect Links beyond (we cannot see them)
+uint16_t MeshNode::PathCost(uint8_t path_arr[MAX_NODES][MAC_SIZE], uint8_t index) const {
+  if(index == 0) {
+    return 0;
+  }
+  return LinkCost(path_arr[1]) + (index - 1) * LINK_ETX_ONE;
+}
+
+bool MeshNode::CheckDestInPath(const uint8_t *mac) {
+  return route_cache.Lookup(mac) != NULL;
+}
+
+void MeshNode::FollowPathArray(message_t *packet) {
+
+    log.Printf("Inside Follow Path Array.\n");
+    PrintArray(packet->Path_Array, MAX_NODES - 1);
+
+    if(packet->Path_Index + 1 >= packet->Path_Length) {
+      log.Printf("End of Path Reached. Nothing to Forward.\n");
+      return;
+    }
+
+    ++packet->Path_Index; // Increment Path Index (1)
+    const uint8_t *next_hop = packet->Path_Array[packet->Path_Index];
+
+    log.Printf("Sending to MAC: " MAC_FMT " at index %d\n", MAC_ARGS(next_hop), packet->Path_Index);
+
+    // Send Packet to Next MAC in Path Array
+    if(Send_Packet(next_hop, packet)) {
+      log.Printf("Acknowledgement Sent with Success to MAC: " MAC_FMT "\n", MAC_ARGS(next_hop));
+    } else {
+      log.Printf("Error while sending Data to Path.\n%s\n", radio.LastError());
+    }
+
+}
+
+void MeshNode::ResetEEPROMLocations() {
+  for(size_t i=0;i<flash.Size();i++) {
+    flash.Write(i, 0xFF);
+  }
+  flash.Commit();
+}
+
+// Send Packet to the Next Hop of its Destination in the Distance-Vector Table
+bool MeshNode::Route_Packet(message_t *packet) {
+  const dv_route_t *route = router.Lookup(packet->destination_mac);
+  if(!dv_enabled || route == NULL) {
+    return false;
+  }
+
+  packet->Routed = true;
+  packet->Path_Exist = false;
+  packet->Path_Length = 0; // No Path on Air
+  packet->Path_Index = 0;
+
+  Check_Existing_Peer(route->next_hop); // Next Hop is Known from its Updates, may not be a Peer Yet
+  log.Printf("Routing to MAC: " MAC_FMT " (Metric %u)\n", MAC_ARGS(route->next_hop), (unsigned)route->metric);
+  if(!Send_Packet(route->next_hop, packet)) {
+    log.Printf("Error while sending Data to Next Hop.\n%s\n", radio.LastError());
+  }
+  return true;
+}
+
+bool MeshNode::LoadPathFromCache(message_t *packet, const uint8_t *mac) {
+
+  route_entry_t *route = route_cache.Lookup(mac);
+  if(route == NULL) {
+    return false;  // Return false if Path is not found
+  }
+
+  log.Printf("Destination MAC Found in Route Cache.\nStoring Path in Packet.\n");
+
+  /* Store Path in Packet */
+  memcpy(packet->Path_Array, route->path, route->path_len * MAC_SIZE);
+  packet->Path_Length = route->path_len; // Hops Carried on Air
+  packet->Path_Index = 0; // This Node is the First Hop
+  PrintArray(packet->Path_Array, route->path_len - 1);
+
+  return true;  // Return true if Path is found & Stored
+}
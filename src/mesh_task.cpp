@@ -0,0 +1,40 @@
+#include <cstring>
+#include "mesh_task.h"
+
+MeshTask::MeshTask(MeshNode &node, Signal &signal) : node(node), signal(signal), work(NULL), work_ctx(NULL), flash(NULL), running(true), stopped(false) {
+  memset(&stats, 0, sizeof(stats));
+  node.SetSignal(&signal);
+}
+
+void MeshTask::SetWork(WorkFn fn, void *ctx) {
+  work = fn;
+  work_ctx = ctx;
+}
+
+void MeshTask::Run() {
+  bool woken = false;
+  while(running.load(std::memory_order_acquire)) {
+    // Work first, so what it sends goes out with this Poll() rather than a tick later
+    if(work != NULL) {
+      work(work_ctx, node);
+    }
+    node.Poll();
+    // Between Poll()s the image is consistent, and nothing else writes it
+    if(flash != NULL) {
+      flash->Flush();
+    }
+    stats.iterations++;
+    stats.wakeups += woken;
+    woken = signal.Wait(MESH_TASK_TICK_MS);
+  }
+  // Stopped for a restart: pending updates go out now, still from this task
+  if(flash != NULL) {
+    flash->Flush(true);
+  }
+  stopped.store(true, std::memory_order_release);
+}
+
+void MeshTask::Stop() {
+  running.store(false, std::memory_order_release);
+  signal.Notify();
+}
@@ -0,0 +1,116 @@
+#include <chrono>
+#include <cstring>
+#include <map>
+#include "dedup_bench.h"
+#include "dedup_filter.h"
+
+#define DEDUP_BENCH_SOURCES 8
+#define DEDUP_BENCH_LAG 2 // Each further copy arrives this many packets after the previous one
+
+static size_t map_heap_bytes;
+
+// Counts what the map takes from the heap, the way the old firmware grew it
+template <typename T>
+struct CountingAllocator {
+  typedef T value_type;
+  CountingAllocator() {}
+  template <typename U>
+  CountingAllocator(const CountingAllocator<U> &) {}
+  T *allocate(size_t n) {
+    map_heap_bytes += n * sizeof(T);
+    return static_cast<T *>(::operator new(n * sizeof(T)));
+  }
+  void deallocate(T *p, size_t n) {
+    map_heap_bytes -= n * sizeof(T);
+    ::operator delete(p);
+  }
+  template <typename U>
+  bool operator==(const CountingAllocator<U> &) const { return true; }
+  template <typename U>
+  bool operator!=(const CountingAllocator<U> &) const { return false; }
+};
+
+typedef std::map<int, bool, std::less<int>, CountingAllocator<std::pair<const int, bool> > > LegacyMap;
+
+typedef struct bench_rx {
+  uint32_t packet_id;
+  uint8_t source;
+  uint32_t now;
+} bench_rx_t;
+
+static uint32_t BenchRandom(uint32_t *state) {
+  *state ^= *state << 13;
+  *state ^= *state >> 17;
+  *state ^= *state << 5;
+  return *state;
+}
+
+// Receive order: copy c of packet p lands at step p + c * LAG, so copies of neighbours interleave
+static bench_rx_t *BuildTrace(uint32_t packets, size_t *length) {
+  size_t total = (size_t)packets * DEDUP_BENCH_COPIES;
+  bench_rx_t *trace = new bench_rx_t[total];
+  uint32_t *ids = new uint32_t[packets];
+  uint32_t state = 0xD0D0 + packets;
+  for(uint32_t p = 0; p < packets; p++) {
+    ids[p] = BenchRandom(&state);
+  }
+  size_t n = 0;
+  for(uint32_t step = 0; n < total; step++) {
+    for(int copy = 0; copy < DEDUP_BENCH_COPIES; copy++) {
+      int64_t p = (int64_t)step - copy * DEDUP_BENCH_LAG;
+      if(p < 0 || p >= (int64_t)packets) {
+        continue;
+      }
+      trace[n].packet_id = ids[p];
+      trace[n].source = (uint8_t)(ids[p] % DEDUP_BENCH_SOURCES);
+      trace[n].now = step * 50;
+      n++;
+    }
+  }
+  delete[] ids;
+  *length = n;
+  return trace;
+}
+
+dedup_bench_report_t RunDedupBench(uint32_t packets) {
+  static DedupFilter filter;
+  uint8_t sources[DEDUP_BENCH_SOURCES][MAC_SIZE];
+  for(int s = 0; s < DEDUP_BENCH_SOURCES; s++) {
+    memset(sources[s], 0x30 + s, MAC_SIZE);
+  }
+
+  dedup_bench_report_t report;
+  memset(&report, 0, sizeof(report));
+  report.packets = packets;
+  size_t length;
+  bench_rx_t *trace = BuildTrace(packets, &length);
+
+  // Original: if(receivedpackets[id]) drop; ... receivedpackets[id] = true;
+  map_heap_bytes = 0;
+  {
+    LegacyMap receivedpackets;
+    auto start = std::chrono::steady_clock::now();
+    for(size_t i = 0; i < length; i++) {
+      int id = (int)trace[i].packet_id;
+      if(receivedpackets[id]) {
+        continue;
+      }
+      receivedpackets[id] = true;
+    }
+    report.map_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / length;
+    report.map_bytes = map_heap_bytes;
+  }
+
+  filter.Clear();
+  uint32_t dropped = 0;
+  auto start = std::chrono::steady_clock::now();
+  for(size_t i = 0; i < length; i++) {
+    dropped += filter.CheckAndInsert(sources[trace[i].source], trace[i].packet_id, trace[i].now);
+  }
+  report.filter_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / length;
+  report.filter_bytes = DedupFilter::MemoryBytes();
+  report.missed = (uint32_t)(length - packets) - dropped;
+
+  delete[] trace;
+  return report;
+}
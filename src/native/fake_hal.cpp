@@ -0,0 +1,301 @@
+#include <cstdio>
+#include <cstring>
+#include "fake_hal.h"
+
+#define FAKE_MAX_PEERS 20 // ESP-NOW peer list limit
+#define FAKE_MAX_ENCRYPTED 6 // ... of which registered with a key
+#define FAKE_MAX_FRAME 250
+
+static const uint8_t broadcast_address[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+
+FileFlash::FileFlash(const char *path, size_t size) : RamFlash(size), path(path), loaded(false) {
+  FILE *file = fopen(path, "rb");
+  if(file == NULL) {
+    return;
+  }
+  std::vector<uint8_t> stored(size + 1);
+  if(fread(stored.data(), 1, stored.size(), file) == size) {
+    memcpy(image.data(), stored.data(), size);
+    loaded = true;
+  }
+  fclose(file);
+}
+
+bool FileFlash::Commit() {
+  FILE *file = fopen(path, "wb");
+  if(file == NULL) {
+    return false;
+  }
+  bool ok = fwrite(image.data(), 1, image.size(), file) == image.size();
+  ok = fclose(file) == 0 && ok;
+  return ok && RamFlash::Commit();
+}
+
+void ConsoleLogger::Write(const char *text) {
+  // Prefix every line so interleaved output of several nodes stays readable
+  for(const char *p = text; *p != '\0'; p++) {
+    if(at_line_start) {
+      fputs(prefix, stdout);
+      at_line_start = false;
+    }
+    fputc(*p, stdout);
+    at_line_start = (*p == '\n');
+  }
+}
+
+void ThreadSignal::Notify() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    pending = true;
+  }
+  cv.notify_one();
+}
+
+bool ThreadSignal::Wait(uint32_t timeout_ms) {
+  std::unique_lock<std::mutex> lock(mutex);
+  bool notified = cv.wait_for(lock, std::chrono::milliseconds(timeout_ms), [this] { return pending; });
+  pending = false;
+  return notified;
+}
+
+void FakeAir::Attach(FakeRadio *radio) {
+  radios.push_back(radio);
+  for(size_t i = 0; i < links.size(); i++) {
+    links[i].push_back(false);
+  }
+  links.push_back(std::vector<bool>(radios.size(), false));
+}
+
+int FakeAir::IndexOf(const FakeRadio *radio) const {
+  for(size_t i = 0; i < radios.size(); i++) {
+    if(radios[i] == radio) {
+      return (int)i;
+    }
+  }
+  return -1;
+}
+
+void FakeAir::Link(FakeRadio *a, FakeRadio *b, bool up) {
+  int i = IndexOf(a);
+  int j = IndexOf(b);
+  if(i >= 0 && j >= 0) {
+    links[i][j] = links[j][i] = up;
+  }
+}
+
+bool FakeAir::Linked(const FakeRadio *a, const FakeRadio *b) const {
+  int i = IndexOf(a);
+  int j = IndexOf(b);
+  return i >= 0 && j >= 0 && links[i][j];
+}
+
+void FakeAir::Transmit(FakeRadio *from, const uint8_t *to, const uint8_t *data, size_t len) {
+  frame_t frame;
+  frame.from = from;
+  memcpy(frame.to, to, 6);
+  frame.data.assign(data, data + len);
+  pending.push_back(frame);
+  frames_sent++;
+}
+
+size_t FakeAir::Deliver() {
+  size_t count = pending.size();
+
+  for(size_t n = 0; n < count; n++) {
+    frame_t frame = pending.front();
+    pending.pop_front();
+
+    bool broadcast = memcmp(frame.to, broadcast_address, 6) == 0;
+    bool acked = false;
+    for(size_t i = 0; i < radios.size(); i++) {
+      FakeRadio *radio = radios[i];
+      if(radio == frame.from || !Linked(frame.from, radio)) {
+        continue;
+      }
+      if(broadcast || memcmp(radio->Address(), frame.to, 6) == 0) {
+        radio->Receive(frame.from->Address(), frame.data.data(), (int)frame.data.size());
+        frames_delivered++;
+        acked = true;
+      }
+    }
+    // Unicast success means the MAC-layer ack came back, broadcast always "succeeds"
+    frame.from->Sent(frame.to, broadcast || acked);
+  }
+
+  return count;
+}
+
+void ThreadedAir::Attach(FakeRadio *radio) {
+  radios.push_back(radio);
+  for(size_t i = 0; i < links.size(); i++) {
+    links[i].push_back(false);
+  }
+  links.push_back(std::vector<bool>(radios.size(), false));
+}
+
+void ThreadedAir::Link(FakeRadio *a, FakeRadio *b) {
+  int i = -1;
+  int j = -1;
+  for(size_t k = 0; k < radios.size(); k++) {
+    if(radios[k] == a) i = (int)k;
+    if(radios[k] == b) j = (int)k;
+  }
+  if(i >= 0 && j >= 0) {
+    links[i][j] = links[j][i] = true;
+  }
+}
+
+void ThreadedAir::Transmit(FakeRadio *from, const uint8_t *to, const uint8_t *data, size_t len) {
+  frame_t frame;
+  frame.from = from;
+  memcpy(frame.to, to, 6);
+  frame.data.assign(data, data + len);
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    pending.push_back(frame);
+  }
+  frames_sent.fetch_add(1, std::memory_order_relaxed);
+  cv.notify_one();
+}
+
+void ThreadedAir::Start() {
+  std::lock_guard<std::mutex> lock(mutex);
+  if(!running) {
+    running = true;
+    driver = std::thread(&ThreadedAir::Drive, this);
+  }
+}
+
+void ThreadedAir::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    running = false;
+  }
+  cv.notify_one();
+  if(driver.joinable()) {
+    driver.join();
+  }
+}
+
+void ThreadedAir::Drive() {
+  for(;;) {
+    frame_t frame;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      cv.wait(lock, [this] { return !pending.empty() || !running; });
+      if(!running) {
+        return;
+      }
+      frame = pending.front();
+      pending.pop_front();
+    }
+
+    // Callbacks run without the lock, a node may send in the meantime
+    int from = -1;
+    for(size_t k = 0; k < radios.size(); k++) {
+      if(radios[k] == frame.from) from = (int)k;
+    }
+    bool broadcast = memcmp(frame.to, broadcast_address, 6) == 0;
+    bool acked = false;
+    for(size_t i = 0; i < radios.size() && from >= 0; i++) {
+      if(!links[from][i] || (!broadcast && memcmp(radios[i]->Address(), frame.to, 6) != 0)) {
+        continue;
+      }
+      radios[i]->Receive(frame.from->Address(), frame.data.data(), (int)frame.data.size());
+      acked = true;
+    }
+    frame.from->Sent(frame.to, broadcast || acked);
+  }
+}
+
+FakeRadio::FakeRadio(RadioMedium &air, const uint8_t *address)
+  : air(air), on_receive(NULL), on_sent(NULL), ctx(NULL), last_error("ESP_OK") {
+  memcpy(mac, address, 6);
+  peers.reserve(FAKE_MAX_PEERS); // Peers come and go while the mesh runs, without touching the heap
+  air.Attach(this);
+}
+
+int FakeRadio::FindPeer(const uint8_t *peer) const {
+  for(size_t i = 0; i < peers.size(); i++) {
+    if(memcmp(peers[i].mac, peer, 6) == 0) {
+      return (int)i;
+    }
+  }
+  return -1;
+}
+
+bool FakeRadio::Send(const uint8_t *dest, const uint8_t *data, size_t len) {
+  if(len > FAKE_MAX_FRAME) {
+    last_error = "ESP_ERR_ESPNOW_ARG";
+    return false;
+  }
+  if(FindPeer(dest) < 0) {
+    last_error = "ESP_ERR_ESPNOW_NOT_FOUND";
+    return false;
+  }
+  air.Transmit(this, dest, data, len);
+  return true;
+}
+
+bool FakeRadio::AddPeer(const uint8_t *peer, bool encrypt) {
+  if(FindPeer(peer) >= 0) {
+    last_error = "ESP_ERR_ESPNOW_EXIST";
+    return false;
+  }
+  if(peers.size() >= FAKE_MAX_PEERS) {
+    last_error = "ESP_ERR_ESPNOW_FULL";
+    return false;
+  }
+  if(encrypt) {
+    size_t encrypted = 0;
+    for(size_t i = 0; i < peers.size(); i++) {
+      encrypted += peers[i].encrypt;
+    }
+    if(encrypted >= FAKE_MAX_ENCRYPTED) {
+      last_error = "ESP_ERR_ESPNOW_FULL";
+      return false;
+    }
+  }
+  peer_t entry;
+  memcpy(entry.mac, peer, 6);
+  entry.encrypt = encrypt;
+  peers.push_back(entry);
+  return true;
+}
+
+bool FakeRadio::DeletePeer(const uint8_t *peer) {
+  int i = FindPeer(peer);
+  if(i < 0) {
+    last_error = "ESP_ERR_ESPNOW_NOT_FOUND";
+    return false;
+  }
+  peers.erase(peers.begin() + i);
+  return true;
+}
+
+bool FakeRadio::PeerExists(const uint8_t *peer) const {
+  return FindPeer(peer) >= 0;
+}
+
+bool FakeRadio::PeerEncrypted(const uint8_t *peer) const {
+  int i = FindPeer(peer);
+  return i >= 0 && peers[i].encrypt;
+}
+
+void FakeRadio::SetCallbacks(ReceiveFn receive, SentFn sent, void *context) {
+  on_receive = receive;
+  on_sent = sent;
+  ctx = context;
+}
+
+void FakeRadio::Receive(const uint8_t *from, const uint8_t *data, int len, int rssi) {
+  if(on_receive != NULL) {
+    on_receive(ctx, from, data, len, rssi);
+  }
+}
+
+void FakeRadio::Sent(const uint8_t *dest, bool success) {
+  if(on_sent != NULL) {
+    on_sent(ctx, dest, success);
+  }
+}
@@ -0,0 +1,388 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "fake_hal.h"
+#include "host_pipeline.h"
+#include "mesh_node.h"
+#include "mesh_task.h"
+
+#define PIPELINE_ROUTE_WAIT_MS 20000 // Start sending without a table route after this
+#define STRESS_TEXT_BYTES 64 // Payload per stress message, long enough to catch a half-overwritten packet
+
+typedef std::chrono::steady_clock steady;
+
+// Shared by the node threads, the mutex guards the timestamps
+typedef struct pipeline_run {
+  const pipeline_config_t *config;
+  uint8_t last_mac[MAC_SIZE];
+  steady::time_point start;
+  std::mutex mutex;
+  std::vector<steady::time_point> sent_at;
+  std::vector<double> latency_ms; // < 0 until delivered
+  std::atomic<int> sent;
+  std::atomic<int> delivered;
+  uint32_t next_send_ms; // First node's thread only
+} pipeline_run_t;
+
+// Locally administered MACs 02:00:00:00:00:index + 1
+static void PipelineMac(int index, uint8_t *mac) {
+  static const uint8_t base[MAC_SIZE] = {0x02, 0x00, 0x00, 0x00, 0x00, 0x00};
+  memcpy(mac, base, MAC_SIZE);
+  mac[4] = (uint8_t)((index + 1) >> 8);
+  mac[5] = (uint8_t)(index + 1);
+}
+
+static uint32_t ElapsedMs(const pipeline_run_t *run) {
+  return (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(steady::now() - run->start).count();
+}
+
+// First node, in its task: one message per interval once the route is there
+static void SendWork(void *ctx, MeshNode &node) {
+  pipeline_run_t *run = (pipeline_run_t *)ctx;
+  int id = run->sent.load(std::memory_order_relaxed);
+  uint32_t now = ElapsedMs(run);
+  if(id >= run->config->messages || now < run->next_send_ms) {
+    return;
+  }
+  if(node.Router().Lookup(run->last_mac) == NULL && now < PIPELINE_ROUTE_WAIT_MS) {
+    return;
+  }
+
+  char text[24];
+  snprintf(text, sizeof(text), "pipe %d", id);
+  {
+    std::lock_guard<std::mutex> lock(run->mutex);
+    run->sent_at[id] = steady::now();
+  }
+  if(node.Send_Reliable(text, run->last_mac)) { // Window full -> again next iteration
+    run->sent.store(id + 1, std::memory_order_release);
+    run->next_send_ms = now + run->config->interval_ms;
+  }
+}
+
+// Last node, in its task
+static void Delivered(void *ctx, const message_t *packet) {
+  pipeline_run_t *run = (pipeline_run_t *)ctx;
+  int id;
+  if(sscanf((const char *)packet->text, "pipe %d", &id) != 1 || id < 0 || id >= run->config->messages) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(run->mutex);
+  if(run->latency_ms[id] < 0) {
+    run->latency_ms[id] = std::chrono::duration<double, std::milli>(steady::now() - run->sent_at[id]).count();
+    run->delivered.fetch_add(1, std::memory_order_release);
+  }
+}
+
+// A line of nodes, each with its own mesh task, on one ThreadedAir
+class ThreadedLine {
+public:
+  ThreadedLine(int nodes);
+  ~ThreadedLine();
+
+  // Air and, unless the caller Polls the nodes itself, one thread per mesh task
+  void Start(bool run_tasks);
+  void Stop();
+
+  int Size() const { return (int)meshes.size(); }
+  MeshNode &Node(int i) { return *meshes[i]; }
+  MeshTask &Task(int i) { return *tasks[i]; }
+  uint32_t FramesSent() const { return air.FramesSent(); }
+
+private:
+  ThreadedAir air;
+  std::vector<FakeRadio *> radios;
+  std::vector<RamFlash *> flashes;
+  std::vector<SteadyClock *> clocks;
+  std::vector<ConsoleLogger *> logs;
+  std::vector<MeshNode *> meshes;
+  std::vector<ThreadSignal *> signals;
+  std::vector<MeshTask *> tasks;
+  std::vector<std::thread> threads;
+};
+
+ThreadedLine::ThreadedLine(int nodes) {
+  for(int i = 0; i < nodes; i++) {
+    uint8_t mac[MAC_SIZE];
+    PipelineMac(i, mac);
+    radios.push_back(new FakeRadio(air, mac));
+    flashes.push_back(new RamFlash(MESH_FLASH_SIZE));
+    clocks.push_back(new SteadyClock(0x9E3779B9u * (i + 1)));
+    logs.push_back(new ConsoleLogger("", false));
+    meshes.push_back(new MeshNode(*radios[i], *clocks[i], *flashes[i], *logs[i], NULL));
+    signals.push_back(new ThreadSignal());
+    tasks.push_back(new MeshTask(*meshes[i], *signals[i]));
+    meshes[i]->Begin();
+  }
+  // Peers and links only between neighbours, everything else is routed
+  for(int i = 0; i + 1 < nodes; i++) {
+    uint8_t mac[MAC_SIZE];
+    air.Link(radios[i], radios[i + 1]);
+    PipelineMac(i + 1, mac);
+    meshes[i]->Add_Peer(mac);
+    meshes[i]->SwitchToEncryption(mac);
+    PipelineMac(i, mac);
+    meshes[i + 1]->Add_Peer(mac);
+    meshes[i + 1]->SwitchToEncryption(mac);
+  }
+}
+
+ThreadedLine::~ThreadedLine() {
+  Stop();
+  for(size_t i = 0; i < meshes.size(); i++) {
+    delete tasks[i];
+    delete signals[i];
+    delete meshes[i];
+    delete logs[i];
+    delete clocks[i];
+    delete flashes[i];
+    delete radios[i];
+  }
+}
+
+void ThreadedLine::Start(bool run_tasks) {
+  air.Start();
+  for(size_t i = 0; run_tasks && i < tasks.size(); i++) {
+    threads.push_back(std::thread(&MeshTask::Run, tasks[i]));
+  }
+}
+
+void ThreadedLine::Stop() {
+  for(size_t i = 0; i < tasks.size(); i++) {
+    tasks[i]->Stop();
+  }
+  for(size_t i = 0; i < threads.size(); i++) {
+    threads[i].join();
+  }
+  threads.clear();
+  air.Stop();
+}
+
+// Until done() holds, or progress() stopped changing for timeout_ms
+template <typename Done, typename Progress>
+static void WaitFor(uint32_t timeout_ms, Done done, Progress progress) {
+  auto last_change = steady::now();
+  int seen = progress();
+  while(!done()) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    int now_seen = progress();
+    if(now_seen != seen) {
+      seen = now_seen;
+      last_change = steady::now();
+    } else if(steady::now() - last_change > std::chrono::milliseconds(timeout_ms)) {
+      break;
+    }
+  }
+}
+
+pipeline_report_t RunPipeline(const pipeline_config_t &config) {
+  pipeline_report_t report;
+  memset(&report, 0, sizeof(report));
+  if(config.nodes < 2 || config.messages <= 0) {
+    return report;
+  }
+
+  pipeline_run_t run;
+  run.config = &config;
+  run.start = steady::now();
+  run.sent_at.assign(config.messages, run.start);
+  run.latency_ms.assign(config.messages, -1.0);
+  run.sent = 0;
+  run.delivered = 0;
+  run.next_send_ms = 0;
+  PipelineMac(config.nodes - 1, run.last_mac);
+
+  ThreadedLine line(config.nodes);
+  line.Task(0).SetWork(SendWork, &run);
+  line.Node(config.nodes - 1).SetDeliveryHandler(Delivered, &run);
+
+  // Loop mode: the same nodes without the signal, like loop() with delay(poll_ms)
+  std::atomic<bool> looping(true);
+  std::vector<uint32_t> loops(config.nodes, 0); // Each written by its own thread only
+  std::vector<std::thread> threads;
+  line.Start(config.poll_ms == 0);
+  for(int i = 0; config.poll_ms > 0 && i < config.nodes; i++) {
+    threads.push_back(std::thread([&, i] {
+      while(looping.load(std::memory_order_acquire)) {
+        if(i == 0) {
+          SendWork(&run, line.Node(i));
+        }
+        line.Node(i).Poll();
+        loops[i]++;
+        std::this_thread::sleep_for(std::chrono::milliseconds(config.poll_ms));
+      }
+    }));
+  }
+
+  WaitFor(config.timeout_ms,
+          [&] { return run.delivered.load(std::memory_order_acquire) >= config.messages; },
+          [&] { return run.delivered.load(std::memory_order_acquire) + run.sent.load(std::memory_order_acquire); });
+
+  looping.store(false, std::memory_order_release);
+  for(size_t i = 0; i < threads.size(); i++) {
+    threads[i].join();
+  }
+  line.Stop();
+
+  std::vector<double> latencies;
+  for(int m = 0; m < config.messages; m++) {
+    if(run.latency_ms[m] >= 0) {
+      latencies.push_back(run.latency_ms[m]);
+    }
+  }
+  std::sort(latencies.begin(), latencies.end());
+  report.sent = run.sent.load();
+  report.delivered = (int)latencies.size();
+  if(!latencies.empty()) {
+    report.latency_p50_ms = latencies[latencies.size() * 50 / 100];
+    report.latency_p90_ms = latencies[latencies.size() * 90 / 100];
+    report.latency_max_ms = latencies.back();
+    report.hop_p50_ms = report.latency_p50_ms / (config.nodes - 1);
+  }
+  report.frames = line.FramesSent();
+  for(int i = 0; i < config.nodes; i++) {
+    report.iterations += line.Task(i).Stats().iterations + loops[i];
+    report.wakeups += line.Task(i).Stats().wakeups;
+  }
+  return report;
+}
+
+// Shared by the node threads of RunStress(), the mutex guards seen
+typedef struct stress_run {
+  const stress_config_t *config;
+  std::mutex mutex;
+  std::vector<uint8_t> seen; // Per source and message number
+  std::atomic<int> sent;
+  std::atomic<int> delivered;
+  std::atomic<int> corrupt;
+  std::atomic<int> misrouted;
+  steady::time_point start;
+} stress_run_t;
+
+// Per node: what it sent so far and where it is in the schedule
+typedef struct stress_node {
+  stress_run_t *run;
+  int index;
+  int next; // Next message number
+  uint32_t next_send_ms;
+} stress_node_t;
+
+// Destination and text of message number id from node src, both sides derive them
+static int StressDest(int nodes, int src, int id) {
+  return (src + 1 + id % (nodes - 1)) % nodes;
+}
+
+static void StressText(int src, int id, char *text) {
+  int len = snprintf(text, STRESS_TEXT_BYTES + 1, "s%d m%d ", src, id);
+  for(int i = len; i < STRESS_TEXT_BYTES; i++) {
+    text[i] = (char)('a' + (src * 7 + id * 13 + i) % 26);
+  }
+  text[STRESS_TEXT_BYTES] = '\0';
+}
+
+// Every node, in its task: a message per interval, to a destination that changes each time
+static void StressWork(void *ctx, MeshNode &node) {
+  stress_node_t *self = (stress_node_t *)ctx;
+  stress_run_t *run = self->run;
+  uint32_t now = (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(steady::now() - run->start).count();
+  if(self->next >= run->config->messages || now < self->next_send_ms) {
+    return;
+  }
+
+  char text[STRESS_TEXT_BYTES + 1];
+  uint8_t dest[MAC_SIZE];
+  StressText(self->index, self->next, text);
+  PipelineMac(StressDest(run->config->nodes, self->index, self->next), dest);
+  if(node.Send_Reliable(text, dest)) { // Window full -> again next iteration
+    self->next++;
+    self->next_send_ms = now + run->config->interval_ms;
+    run->sent.fetch_add(1, std::memory_order_release);
+  }
+}
+
+static void StressDelivered(void *ctx, const message_t *packet) {
+  stress_node_t *self = (stress_node_t *)ctx;
+  stress_run_t *run = self->run;
+  int src, id;
+  if(sscanf((const char *)packet->text, "s%d m%d ", &src, &id) != 2 || src < 0 || src >= run->config->nodes ||
+     id < 0 || id >= run->config->messages) {
+    run->corrupt.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  // The whole text, the source and this node must match what src sent
+  char expected[STRESS_TEXT_BYTES + 1];
+  uint8_t source[MAC_SIZE];
+  StressText(src, id, expected);
+  PipelineMac(src, source);
+  if(strcmp((const char *)packet->text, expected) != 0 || memcmp(packet->source_mac, source, MAC_SIZE) != 0) {
+    run->corrupt.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  if(StressDest(run->config->nodes, src, id) != self->index) {
+    run->misrouted.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(run->mutex);
+  uint8_t &mark = run->seen[src * run->config->messages + id];
+  if(!mark) {
+    mark = 1;
+    run->delivered.fetch_add(1, std::memory_order_release);
+  }
+}
+
+stress_report_t RunStress(const stress_config_t &config) {
+  stress_report_t report;
+  memset(&report, 0, sizeof(report));
+  if(config.nodes < 2 || config.messages <= 0) {
+    return report;
+  }
+
+  stress_run_t run;
+  run.config = &config;
+  run.seen.assign(config.nodes * config.messages, 0);
+  run.sent = 0;
+  run.delivered = 0;
+  run.corrupt = 0;
+  run.misrouted = 0;
+  run.start = steady::now();
+
+  ThreadedLine line(config.nodes);
+  std::vector<stress_node_t> nodes(config.nodes);
+  for(int i = 0; i < config.nodes; i++) {
+    nodes[i].run = &run;
+    nodes[i].index = i;
+    nodes[i].next = 0;
+    nodes[i].next_send_ms = 0;
+    line.Task(i).SetWork(StressWork, &nodes[i]);
+    line.Node(i).SetDeliveryHandler(StressDelivered, &nodes[i]);
+  }
+
+  int total = config.nodes * config.messages;
+  line.Start(true);
+  WaitFor(config.timeout_ms,
+          [&] { return run.delivered.load(std::memory_order_acquire) >= total; },
+          [&] { return run.delivered.load(std::memory_order_acquire) + run.sent.load(std::memory_order_acquire); });
+  line.Stop();
+
+  report.sent = run.sent.load();
+  report.delivered = run.delivered.load();
+  report.corrupt = run.corrupt.load();
+  report.misrouted = run.misrouted.load();
+  report.frames = line.FramesSent();
+  for(int i = 0; i < config.nodes; i++) {
+    pool_stats_t pool = line.Node(i).Packets().Stats();
+    if(pool.high_water > report.pool_high_water) {
+      report.pool_high_water = (uint8_t)pool.high_water;
+    }
+    report.pool_exhausted += pool.failures;
+    report.rx_drops += line.Node(i).RxDrops();
+  }
+  return report;
+}
@@ -0,0 +1,479 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "dedup_bench.h"
+#include "host_pipeline.h"
+#include "mesh_sim.h"
+#include "mesh_task.h"
+#include "peer_bench.h"
+#include "ring_bench.h"
+#include "route_bench.h"
+#include "rx_bench.h"
+#include "store_bench.h"
+
+// pio test builds src/ into every test, which brings its own main()
+#ifndef PIO_UNIT_TESTING
+
+/* HOST RUN OF THE MESH CORE */
+// Runs the discrete-event simulator (mesh_sim.h) and prints its report.
+//   program [--nodes N] [--seed S] [--topology random|line|grid] [--area M] [--range M]
+//           [--loss P] [--edge-loss P] [--latency US] [--bitrate BPS] [--poll MS]
+//           [--routing path|dv] [--metric hops|etx] [--flood unicast|broadcast]
+//           [--flood-k N] [--gossip PERCENT] [--aggregate off|MS] [--warmup MS] [--messages N]
+//           [--interval MS] [--blob BYTES] [--drain MS] [--flush MS] [--commit-ms MS] [--peer-evict on|off] [--hop-retries N] [--failover on|off]
+//           [--flow N] [--fail N|relay] [--fail-at MS] [--repair on|off] [--sweep] [--threads] [--stress]
+//           [--sizes] [--peer-bench] [--ring-bench] [--rx-bench] [--route-bench] [--dedup-bench] [--store-bench] [-v]
+// --poll MS runs the nodes the old way, Poll() from loop() every MS instead of the mesh task.
+// --threads runs a line of --nodes nodes on real threads instead (host_pipeline.h) and
+// reports wall-clock latency per hop, e.g. program --threads against program --threads --poll 50
+// --stress has every node of that line send to all others at once and checks each delivery
+// byte for byte, e.g. program --stress --nodes 6 --messages 50 --interval 5
+// --sizes prints the capacities and RAM of this build (mesh_config.h), e.g. built with
+// -DMESH_PROFILE=MESH_PROFILE_TINY against the default
+// --flush MS batches each node's flash commits for up to MS (DeferredFlash), 0 commits on every
+// update as before; each commit stalls the node --commit-ms. Compare RX drops and latency with
+// path routing, which stores a path per delivery: program --routing path --flush 0
+// --peer-evict off registers radio peers first come, first served and fails sends once the
+// ESP-NOW slots are gone, instead of swapping the least recently used peer out; compare in a
+// dense mesh, e.g. program --area 120 --flood unicast --peer-evict off
+// --hop-retries N resends a frame its next hop did not ack from that hop, --failover off stops
+// rerouting what still fails to an alternate next hop; --hop-retries 0 --failover off leaves
+// losses to end-to-end retransmission as before, e.g. program --topology line --nodes 8 --loss 0.2
+// --flow N sends every message from node 0 to node N. --fail N takes node N down --fail-at MS
+// after the first message (default a quarter of the way in), relay the node that node 0 sends
+// the flow through then. --repair off leaves broken paths stored and unreported. Recovery after
+// a relay failure on path routes, e.g.
+//   program --routing path --topology grid --nodes 25 --flow 7 --interval 100 --fail relay
+// --peer-bench times peer lookups in the sorted table against linear scans, 20 to 1000 peers
+// --ring-bench pushes frames through the receive ring, on one thread and between two
+// --rx-bench counts bytes copied and time per received frame, original receive path against now
+// --route-bench times path lookups in the route cache against the original EEPROM scan
+// --dedup-bench times duplicate checks and counts their memory, dedup filter against the original map
+// --store-bench persists path changes through a file image and reboots, original EEPROM layout against the route store
+// --blob sends each message as a buffer through fragmentation and checks it arrives intact.
+// --aggregate off sends every packet in its own frame; compare payload efficiency and latency
+// against the default under load, e.g. program --interval 20 --aggregate off
+// --sweep runs both flood modes over a range of node counts in the same area, e.g. the
+// flooding cost versus density: program --routing path --sweep
+
+static const int sweep_nodes[] = {25, 50, 100, 150, 200, 300};
+static const int bench_peers[] = {20, 100, 1000};
+static const int bench_routes[] = {4, 12, 24};
+static const uint32_t bench_packets[] = {1000, 10000, 100000};
+static const uint32_t bench_updates[] = {100, 1000, 10000};
+
+static void Usage(const char *program) {
+  fprintf(stderr, "usage: %s [--nodes N] [--seed S] [--topology random|line|grid] [--area M] [--range M]\n"
+                  "          [--loss P] [--edge-loss P] [--latency US] [--bitrate BPS] [--poll MS]\n"
+                  "          [--routing path|dv] [--metric hops|etx] [--flood unicast|broadcast]\n"
+                  "          [--flood-k N] [--gossip PERCENT] [--aggregate off|MS] [--warmup MS] [--messages N]\n"
+                  "          [--interval MS] [--blob BYTES] [--drain MS] [--flush MS] [--commit-ms MS] [--peer-evict on|off] [--hop-retries N] [--failover on|off]\n"
+                  "          [--flow N] [--fail N|relay] [--fail-at MS] [--repair on|off] [--sweep] [--threads] [--stress]\n"
+                  "          [--sizes] [--peer-bench] [--ring-bench] [--rx-bench] [--route-bench] [--dedup-bench] [--store-bench] [-v]\n", program);
+}
+
+static double DeliveryRatio(const sim_report_t &r) {
+  return r.reachable > 0 ? (double)r.delivered / r.reachable : 0.0;
+}
+
+static double FramesPerDelivery(const sim_report_t &r) {
+  return r.delivered > 0 ? (double)r.frames / r.delivered : 0.0;
+}
+
+// Flooding cost versus density: unicast floods against suppressed broadcast floods
+static void Sweep(sim_config_t config) {
+  printf("%6s %7s | %-27s | %-27s | %s\n", "nodes", "degree", "unicast flood", "broadcast flood", "suppressed");
+  printf("%6s %7s | %8s %9s %8s | %8s %9s %8s |\n", "", "", "delivery", "frames/d", "p50 ms", "delivery", "frames/d", "p50 ms");
+
+  for(size_t i = 0; i < sizeof(sweep_nodes) / sizeof(sweep_nodes[0]); i++) {
+    config.nodes = sweep_nodes[i];
+
+    config.flood = FLOOD_UNICAST;
+    MeshSim unicast_sim(config);
+    sim_report_t u = unicast_sim.Run();
+
+    config.flood = FLOOD_BROADCAST;
+    MeshSim broadcast_sim(config);
+    sim_report_t b = broadcast_sim.Run();
+
+    printf("%6d %7.1f | %8.3f %9.1f %8.1f | %8.3f %9.1f %8.1f | %u of %u\n", config.nodes, u.mean_degree,
+           DeliveryRatio(u), FramesPerDelivery(u), u.latency_p50_ms, DeliveryRatio(b), FramesPerDelivery(b), b.latency_p50_ms,
+           (unsigned)b.flood_suppressed, (unsigned)(b.flood_suppressed + b.flood_relays));
+    fflush(stdout);
+  }
+}
+
+// Same core on std::threads, wall clock instead of simulated time
+static void Threads(const sim_config_t &config) {
+  pipeline_config_t pipeline;
+  pipeline.nodes = config.nodes;
+  pipeline.messages = config.messages;
+  pipeline.interval_ms = config.interval_ms;
+  pipeline.poll_ms = config.task ? 0 : config.poll_ms;
+  pipeline.timeout_ms = config.drain_ms;
+
+  auto start = std::chrono::steady_clock::now();
+  pipeline_report_t r = RunPipeline(pipeline);
+  double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  printf("nodes:               %d in a line (%d hops), one thread each\n", config.nodes, config.nodes - 1);
+  if(config.task) {
+    printf("scheduling:          mesh task, woken per frame (%d ms tick)\n", MESH_TASK_TICK_MS);
+  } else {
+    printf("scheduling:          loop() every %u ms\n", (unsigned)config.poll_ms);
+  }
+  printf("delivered:           %d of %d\n", r.delivered, r.sent);
+  printf("latency p50/p90:     %.2f / %.2f ms (max %.2f)\n", r.latency_p50_ms, r.latency_p90_ms, r.latency_max_ms);
+  printf("per hop p50:         %.3f ms\n", r.hop_p50_ms);
+  printf("frames on air:       %u\n", (unsigned)r.frames);
+  printf("poll passes:         %u (%u woken by a frame)\n", (unsigned)r.iterations, (unsigned)r.wakeups);
+  printf("wall time:           %.3f s\n", elapsed);
+}
+
+// Every node sends at once on std::threads, deliveries checked against what was sent
+static int Stress(const sim_config_t &config) {
+  stress_config_t stress;
+  stress.nodes = config.nodes;
+  stress.messages = config.messages;
+  stress.interval_ms = config.interval_ms;
+  stress.timeout_ms = config.drain_ms;
+
+  auto start = std::chrono::steady_clock::now();
+  stress_report_t r = RunStress(stress);
+  double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  printf("nodes:               %d in a line, all sending at once\n", config.nodes);
+  printf("delivered:           %d of %d\n", r.delivered, r.sent);
+  printf("corrupt:             %d (%d misrouted)\n", r.corrupt, r.misrouted);
+  printf("packet contexts:     %u of %u at most in use, %u sends without one\n", (unsigned)r.pool_high_water, (unsigned)PacketPool::Capacity(),
+         (unsigned)r.pool_exhausted);
+  printf("frames on air:       %u (%u lost in full RX queues)\n", (unsigned)r.frames, (unsigned)r.rx_drops);
+  printf("wall time:           %.3f s\n", elapsed);
+  return r.corrupt == 0 && r.misrouted == 0 ? 0 : 1;
+}
+
+// Peer lookup cost per table layout
+static int PeerBench() {
+  printf("%8s | %12s %12s %12s\n", "peers", "heap scan", "array scan", "sorted");
+  int result = 0;
+  for(size_t i = 0; i < sizeof(bench_peers) / sizeof(bench_peers[0]); i++) {
+    peer_bench_report_t r = RunPeerBench(bench_peers[i], 1 << 22);
+    if(r.sorted_ns < 0) {
+      printf("%8d | lookups disagree\n", r.entries);
+      result = 1;
+      continue;
+    }
+    printf("%8d | %9.1f ns %9.1f ns %9.1f ns\n", r.entries, r.heap_scan_ns, r.array_scan_ns, r.sorted_ns);
+  }
+  return result;
+}
+
+// Receive ring throughput, one thread and producer to consumer
+static int RingBench() {
+  ring_bench_report_t r = RunRingBench(1 << 22);
+  printf("frames:              %u of %d bytes, %d slots\n", (unsigned)r.frames, (int)sizeof(rx_slot_t), RX_QUEUE_DEPTH);
+  printf("one thread:          %.1f ns per frame in and out (%.1f M frames/s)\n", r.inline_ns, r.inline_ns > 0 ? 1000.0 / r.inline_ns : 0.0);
+  printf("two threads:         %.2f M frames/s, ring full %u times\n", r.threaded_fps / 1e6, (unsigned)r.full);
+  printf("out of order:        %u\n", (unsigned)r.out_of_order);
+  return r.out_of_order == 0 ? 0 : 1;
+}
+
+// Receive path cost per frame, the original copies against the view and one decode
+static int RxBench() {
+  rx_bench_report_t r = RunRxBench(1 << 20);
+  printf("%-14s | %-24s | %-31s | %s\n", "frame", "bytes on air / copied", "ns per frame", "cycles per frame");
+  printf("%-14s | %11s %12s | %9s %9s %11s | %9s %9s\n", "", "before", "after", "before", "after", "", "before", "after");
+  for(int c = 0; c < RX_BENCH_CASES; c++) {
+    const rx_bench_case_t *k = &r.cases[c];
+    printf("%-14s | %4u / %4u  %4u / %4u  | %9.1f %9.1f (%4.1fx) | %9.0f %9.0f\n", k->name, (unsigned)k->legacy_frame_bytes,
+           (unsigned)k->legacy_copied, (unsigned)k->frame_bytes, (unsigned)k->copied, k->legacy_ns, k->ns,
+           k->ns > 0 ? k->legacy_ns / k->ns : 0.0, k->legacy_cycles, k->cycles);
+  }
+  printf("a decode also clears %d bytes of its slot\n", (int)r.cases[0].zeroed);
+  return 0;
+}
+
+// Path lookup rate, EEPROM scan against the route cache
+static int RouteBench() {
+  printf("%8s | %16s %16s\n", "paths", "eeprom scan", "route cache");
+  int result = 0;
+  for(size_t i = 0; i < sizeof(bench_routes) / sizeof(bench_routes[0]); i++) {
+    route_bench_report_t r = RunRouteBench(bench_routes[i], 1 << 20);
+    if(r.cache_ns < 0) {
+      printf("%8d | lookups disagree\n", r.entries);
+      result = 1;
+      continue;
+    }
+    printf("%8d | %9.2f M/s %12.2f M/s (%.0fx)\n", r.entries, 1000.0 / r.scan_ns, 1000.0 / r.cache_ns, r.scan_ns / r.cache_ns);
+  }
+  return result;
+}
+
+// Duplicate check rate and memory, receivedpackets map against the dedup filter
+static int DedupBench() {
+  printf("%8s | %12s %12s | %12s %12s | %s\n", "packets", "map", "map bytes", "filter", "filter bytes", "missed");
+  for(size_t i = 0; i < sizeof(bench_packets) / sizeof(bench_packets[0]); i++) {
+    dedup_bench_report_t r = RunDedupBench(bench_packets[i]);
+    printf("%8u | %8.2f M/s %12zu | %8.2f M/s %12zu | %u\n", r.packets, 1000.0 / r.map_ns, r.map_bytes, 1000.0 / r.filter_ns,
+           r.filter_bytes, r.missed);
+  }
+  printf("%d copies of each packet; missed counts copies the filter let through\n", DEDUP_BENCH_COPIES);
+  return 0;
+}
+
+// Route persistence: commits and time per update, then what a reboot gets back
+static int StoreBench() {
+  printf("%8s | %-6s %8s %10s %12s %10s %8s %10s\n", "updates", "layout", "commits", "bytes", "update", "boot", "current", "recovered");
+  int result = 0;
+  for(size_t i = 0; i < sizeof(bench_updates) / sizeof(bench_updates[0]); i++) {
+    store_bench_report_t r = RunStoreBench(bench_updates[i]);
+    const store_bench_layout_t *rows[] = {&r.eeprom, &r.store};
+    const char *names[] = {"eeprom", "store"};
+    for(int l = 0; l < 2; l++) {
+      const store_bench_layout_t *k = rows[l];
+      printf("%8u | %-6s %8u %10u %9.2f us %7.1f us %5d/%d %10d\n", r.updates, names[l], k->commits, k->bytes_written, k->update_us,
+             k->boot_us, k->current, STORE_BENCH_DESTINATIONS, k->recovered);
+    }
+    printf("%8s | %u bank switches\n", "", r.compactions);
+    if(!r.replay_ok) {
+      printf("%8u | store replay does not match the cache\n", r.updates);
+      result = 1;
+    }
+  }
+  printf("current counts destinations whose latest path flash held before the reboot\n");
+  return result;
+}
+
+static const char *ProfileName() {
+  switch(MESH_PROFILE) {
+    case MESH_PROFILE_TINY: return "tiny";
+    case MESH_PROFILE_LARGE: return "large";
+    default: return "default";
+  }
+}
+
+// What this build's sizing costs, part by part
+static void Sizes() {
+  printf("profile:             %s\n", ProfileName());
+  printf("path length:         %d hops, %d text bytes, %u-byte frames\n", MAX_NODES, (int)WIRE_MAX_TEXT, (unsigned)WIRE_MAX_FRAME);
+  printf("capacities:          %d peers, %d routes, %d links, %d cached paths, %d dedup slots\n", MESH_MAX_PEERS, DV_ROUTES,
+         LINK_TABLE_SIZE, ROUTE_CACHE_SIZE, DEDUP_SLOTS);
+  printf("radio peers:         %d slots, %d of them encrypted\n", PEER_SLOTS, PEER_ENCRYPTED_SLOTS);
+  printf("queues:              rx %d, control %d, tx %d/%d/%d, %d send windows of %d\n", RX_QUEUE_DEPTH, CTRL_QUEUE_DEPTH,
+         TX_CONTROL_DEPTH, TX_FORWARD_DEPTH, TX_ORIGIN_DEPTH, RTX_PEERS, RTX_WINDOW);
+  printf("flash image:         %d bytes\n", MESH_FLASH_SIZE);
+  printf("\n%-20s %8s\n", "RAM", "bytes");
+  printf("%-20s %8zu\n", "message_t", sizeof(message_t));
+  printf("%-20s %8zu\n", "rx queue", sizeof(SpscRing<rx_slot_t, RX_QUEUE_DEPTH>));
+  printf("%-20s %8zu\n", "packet pool", sizeof(PacketPool));
+  printf("%-20s %8zu\n", "peer table", sizeof(PeerTable<MESH_MAX_PEERS>));
+  printf("%-20s %8zu\n", "peer slots", sizeof(PeerSlots));
+  printf("%-20s %8zu\n", "tx scheduler", sizeof(TxScheduler));
+  printf("%-20s %8zu\n", "aggregator", sizeof(FrameAggregator));
+  printf("%-20s %8zu\n", "reliable transport", sizeof(ReliableTransport));
+  printf("%-20s %8zu\n", "fragments", sizeof(FragmentTransport));
+  printf("%-20s %8zu\n", "dv router", sizeof(DvRouter));
+  printf("%-20s %8zu\n", "route cache", sizeof(RouteCache));
+  printf("%-20s %8zu\n", "link table", sizeof(LinkTable));
+  printf("%-20s %8zu\n", "dedup filter", sizeof(DedupFilter));
+  printf("%-20s %8zu\n", "flood control", sizeof(FloodControl));
+  printf("%-20s %8zu\n", "MeshNode total", sizeof(MeshNode));
+}
+
+int main(int argc, char **argv) {
+  sim_config_t config;
+  SimDefaultConfig(&config);
+  bool sweep = false;
+  bool threads = false;
+  bool stress = false;
+
+  for(int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+
+    if(strcmp(arg, "-v") == 0) {
+      config.verbose = true;
+      continue;
+    }
+    if(strcmp(arg, "--sweep") == 0) {
+      sweep = true;
+      continue;
+    }
+    if(strcmp(arg, "--threads") == 0) {
+      threads = true;
+      continue;
+    }
+    if(strcmp(arg, "--stress") == 0) {
+      stress = true;
+      continue;
+    }
+    if(strcmp(arg, "--sizes") == 0) {
+      Sizes();
+      return 0;
+    }
+    if(strcmp(arg, "--peer-bench") == 0) {
+      return PeerBench();
+    }
+    if(strcmp(arg, "--ring-bench") == 0) {
+      return RingBench();
+    }
+    if(strcmp(arg, "--rx-bench") == 0) {
+      return RxBench();
+    }
+    if(strcmp(arg, "--route-bench") == 0) {
+      return RouteBench();
+    }
+    if(strcmp(arg, "--dedup-bench") == 0) {
+      return DedupBench();
+    }
+    if(strcmp(arg, "--store-bench") == 0) {
+      return StoreBench();
+    }
+    if(value == NULL) {
+      Usage(argv[0]);
+      return 2;
+    }
+    i++;
+
+    if(strcmp(arg, "--nodes") == 0) config.nodes = atoi(value);
+    else if(strcmp(arg, "--seed") == 0) config.seed = strtoul(value, NULL, 0);
+    else if(strcmp(arg, "--area") == 0) config.area_m = atof(value);
+    else if(strcmp(arg, "--range") == 0) config.range_m = atof(value);
+    else if(strcmp(arg, "--loss") == 0) config.loss = atof(value);
+    else if(strcmp(arg, "--edge-loss") == 0) config.edge_loss = atof(value);
+    else if(strcmp(arg, "--latency") == 0) config.latency_us = strtoul(value, NULL, 0);
+    else if(strcmp(arg, "--bitrate") == 0) config.bitrate = strtoul(value, NULL, 0);
+    else if(strcmp(arg, "--poll") == 0) {
+      config.task = false;
+      config.poll_ms = strtoul(value, NULL, 0);
+    }
+    else if(strcmp(arg, "--metric") == 0) config.etx = strcmp(value, "hops") != 0;
+    else if(strcmp(arg, "--flood") == 0) config.flood = strcmp(value, "unicast") == 0 ? FLOOD_UNICAST : FLOOD_BROADCAST;
+    else if(strcmp(arg, "--flood-k") == 0) config.flood_dup_limit = atoi(value);
+    else if(strcmp(arg, "--gossip") == 0) config.gossip_percent = atoi(value);
+    else if(strcmp(arg, "--aggregate") == 0) {
+      config.aggregate = strcmp(value, "off") != 0;
+      config.aggregate_ms = config.aggregate ? strtoul(value, NULL, 0) : 0;
+    }
+    else if(strcmp(arg, "--warmup") == 0) config.warmup_ms = strtoul(value, NULL, 0);
+    else if(strcmp(arg, "--messages") == 0) config.messages = atoi(value);
+    else if(strcmp(arg, "--interval") == 0) config.interval_ms = strtoul(value, NULL, 0);
+    else if(strcmp(arg, "--blob") == 0) config.blob_bytes = atoi(value);
+    else if(strcmp(arg, "--drain") == 0) config.drain_ms = strtoul(value, NULL, 0);
+    else if(strcmp(arg, "--flush") == 0) config.flush_ms = strtoul(value, NULL, 0);
+    else if(strcmp(arg, "--commit-ms") == 0) config.commit_ms = strtoul(value, NULL, 0);
+    else if(strcmp(arg, "--peer-evict") == 0) config.peer_evict = strcmp(value, "off") != 0;
+    else if(strcmp(arg, "--hop-retries") == 0) config.hop_retries = atoi(value);
+    else if(strcmp(arg, "--failover") == 0) config.failover = strcmp(value, "off") != 0;
+    else if(strcmp(arg, "--flow") == 0) config.flow = atoi(value);
+    else if(strcmp(arg, "--fail") == 0) config.fail_node = strcmp(value, "relay") == 0 ? SIM_FAIL_RELAY : atoi(value);
+    else if(strcmp(arg, "--fail-at") == 0) config.fail_ms = strtoul(value, NULL, 0);
+    else if(strcmp(arg, "--repair") == 0) config.repair = strcmp(value, "off") != 0;
+    else if(strcmp(arg, "--routing") == 0) config.routing = strcmp(value, "path") == 0 ? SIM_ROUTING_PATH : SIM_ROUTING_DV;
+    else if(strcmp(arg, "--topology") == 0) {
+      if(strcmp(value, "line") == 0) config.topology = SIM_TOPOLOGY_LINE;
+      else if(strcmp(value, "grid") == 0) config.topology = SIM_TOPOLOGY_GRID;
+      else config.topology = SIM_TOPOLOGY_RANDOM;
+    } else {
+      Usage(argv[0]);
+      return 2;
+    }
+  }
+
+  if(config.nodes < 2 || config.hop_retries < 0 || config.hop_retries > 255 || config.range_m <= 0 || config.bitrate == 0 || config.poll_ms == 0 ||
+     config.blob_bytes < 0 || config.blob_bytes > (int)FRAG_MAX_BYTES || config.flood_dup_limit < 0 || config.flood_dup_limit > 255 || config.gossip_percent < 0 || config.gossip_percent > 100) {
+    Usage(argv[0]);
+    return 2;
+  }
+
+  if(sweep) {
+    Sweep(config);
+    return 0;
+  }
+  if(threads) {
+    Threads(config);
+    return 0;
+  }
+  if(stress) {
+    return Stress(config);
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  MeshSim sim(config);
+  sim_report_t r = sim.Run();
+  double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  int sent = r.offered - r.refused;
+  printf("nodes:               %d (%d links, mean degree %.1f)\n", config.nodes, r.links, r.mean_degree);
+  printf("seed:                %u\n", (unsigned)config.seed);
+  if(config.task) {
+    printf("scheduling:          mesh task, woken per frame (%d ms tick)\n", MESH_TASK_TICK_MS);
+  } else {
+    printf("scheduling:          loop() every %u ms\n", (unsigned)config.poll_ms);
+  }
+  printf("routing:             %s, %s metric\n", config.routing == SIM_ROUTING_DV ? "distance vector" : "path arrays", config.etx ? "etx" : "hop count");
+  if(config.routing == SIM_ROUTING_DV) {
+    if(r.converged_ms >= 0) {
+      printf("converged:           %d ms (%d components)\n", (int)r.converged_ms, r.components);
+    } else {
+      printf("converged:           never (%d components)\n", r.components);
+    }
+    printf("control overhead:    %u frames, %u bytes (%.1f bytes/node/s)\n", (unsigned)r.control_frames, (unsigned)r.control_bytes,
+           r.sim_time_ms > 0 ? r.control_bytes * 1000.0 / r.sim_time_ms / config.nodes : 0.0);
+  }
+  if(config.flood == FLOOD_BROADCAST) {
+    printf("flooding:            broadcast, %u relays, %u suppressed (k %d, gossip %d%%)\n", (unsigned)r.flood_relays,
+           (unsigned)r.flood_suppressed, config.flood_dup_limit, config.gossip_percent);
+  } else {
+    printf("flooding:            unicast to every peer\n");
+  }
+  printf("offered:             %d (%d reachable, %d refused by a full window)\n", r.offered, r.reachable, r.refused);
+  printf("delivered:           %d\n", r.delivered);
+  if(config.blob_bytes > 0) {
+    printf("buffers:             %d bytes, %u fragments (%u resent), %d corrupt\n", config.blob_bytes, (unsigned)r.fragments,
+           (unsigned)r.fragments_resent, r.corrupt);
+  }
+  printf("delivery ratio:      %.3f of sent, %.3f of reachable\n", sent > 0 ? (double)r.delivered / sent : 0.0, DeliveryRatio(r));
+  printf("latency p50/p90/p99: %.1f / %.1f / %.1f ms (max %.1f)\n", r.latency_p50_ms, r.latency_p90_ms, r.latency_p99_ms, r.latency_max_ms);
+  printf("frames on air:       %u (%.1f per delivered message)\n", (unsigned)r.frames, FramesPerDelivery(r));
+  printf("payload efficiency:  %.1f%% (%llu payload of %llu packet bytes on air)\n", r.packet_bytes > 0 ? 100.0 * r.payload_bytes / r.packet_bytes : 0.0,
+         (unsigned long long)r.payload_bytes, (unsigned long long)r.packet_bytes);
+  if(config.aggregate) {
+    printf("aggregation:         +%u ms, %u batches carrying %u packets\n", (unsigned)config.aggregate_ms, (unsigned)r.batches, (unsigned)r.batched);
+  } else {
+    printf("aggregation:         off\n");
+  }
+  printf("frames lost:         %u on links, %u in full RX queues, %u in full TX queues\n", (unsigned)r.frames_lost, (unsigned)r.rx_drops,
+         (unsigned)r.tx_drops);
+  printf("retransmits:         %u end to end\n", (unsigned)r.retransmits);
+  printf("hop recovery:        %u resends (%u acked), %u rerouted, %u lost at a hop\n", (unsigned)r.hop_retries, (unsigned)r.hop_recovered,
+         (unsigned)r.failovers, (unsigned)r.hop_losses);
+  printf("path repair:         %u breaks, %u repaired, %u re-flooded, %u route errors, %u stored paths dropped\n", (unsigned)r.path_breaks,
+         (unsigned)r.path_repairs, (unsigned)r.path_rediscoveries, (unsigned)r.route_errors, (unsigned)r.routes_invalidated);
+  if(r.failed_node >= 0) {
+    printf("node failure:        node %d at %u ms, %d of %d later messages delivered", r.failed_node, (unsigned)r.failed_at_ms,
+           r.delivered_after_failure, r.sent_after_failure);
+    if(r.recovery_ms >= 0) {
+      printf(", the first %d ms after", (int)r.recovery_ms);
+    }
+    printf("\n");
+  } else if(config.fail_node != -1) {
+    printf("node failure:        none, no relay on the flow's route\n");
+  }
+  printf("peer slots:          %u registered, %u evicted, %u hits, %u sends without a slot (up to %d peers)\n",
+         (unsigned)r.peer_registrations, (unsigned)r.peer_evictions, (unsigned)r.peer_hits, (unsigned)r.peer_failures, r.peers_max);
+  if(config.flush_ms > 0) {
+    printf("flash:               %u commits for %u updates (batched up to %u ms)\n", (unsigned)r.flash_commits, (unsigned)r.flash_requests,
+           (unsigned)config.flush_ms);
+  } else {
+    printf("flash:               %u commits, one per update\n", (unsigned)r.flash_commits);
+  }
+  printf("flash stalls:        %u ms over all nodes, %u ms at most, %d nodes stale after shutdown\n", (unsigned)r.flash_stall_ms,
+         (unsigned)r.flash_stall_max_ms, r.flash_stale);
+  printf("simulated time:      %u ms (%llu events)\n", (unsigned)r.sim_time_ms, (unsigned long long)r.events);
+  printf("wall time:           %.3f s\n", elapsed);
+  return 0;
+}
+
+#endif
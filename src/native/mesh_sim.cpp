@@ -0,0 +1,667 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "mesh_sim.h"
+#include "mesh_task.h"
+
+#define SIM_FRAME_OVERHEAD 43 // 802.11 action frame + ESP-NOW header bytes around the payload
+#define SIM_TASK_WAKE_US 50 // Semaphore given in the Wi-Fi task until the mesh task runs
+#define SIM_RSSI_JITTER 3 // dB of fading on top of the path loss, uniform +-
+#define SIM_COMMIT_MS 10 // EEPROM.commit(): the whole image rewritten as one NVS blob
+
+static const uint8_t broadcast_address[MAC_SIZE] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+
+void SimDefaultConfig(sim_config_t *config) {
+  memset(config, 0, sizeof(*config));
+  config->seed = 1;
+  config->nodes = 100;
+  config->topology = SIM_TOPOLOGY_RANDOM;
+  config->area_m = 200;
+  config->range_m = 40;
+  config->loss = 0.05;
+  config->edge_loss = 0.2;
+  config->rssi_1m = -40;
+  config->path_loss_exp = 3.0; // 40 m range -> about -88 dBm at the edge
+  config->latency_us = 500;
+  config->bitrate = 1000000;
+  config->task = true;
+  config->poll_ms = 50;
+  config->routing = SIM_ROUTING_DV;
+  config->etx = true;
+  config->flood = MESH_FLOOD_BROADCAST ? FLOOD_BROADCAST : FLOOD_UNICAST;
+  config->flood_dup_limit = FLOOD_DUP_LIMIT;
+  config->gossip_percent = FLOOD_GOSSIP_PERCENT;
+  config->aggregate = true;
+  config->aggregate_ms = AGG_DELAY_MS;
+  config->peer_evict = true;
+  config->hop_retries = TX_HOP_RETRIES;
+  config->failover = true;
+  config->repair = true;
+  config->fail_node = -1;
+  config->flow = -1;
+  config->flush_ms = FLASH_FLUSH_MS;
+  config->commit_ms = SIM_COMMIT_MS;
+  config->warmup_ms = 10000;
+  config->messages = 200;
+  config->interval_ms = 1000;
+  config->drain_ms = 30000;
+}
+
+// Locally administered MACs 02:00:00:00:hi:lo carrying index + 1
+static void SimMac(int index, uint8_t *mac) {
+  mac[0] = 0x02;
+  mac[1] = mac[2] = mac[3] = 0x00;
+  mac[4] = (uint8_t)((index + 1) >> 8);
+  mac[5] = (uint8_t)(index + 1);
+}
+
+MeshSim::MeshSim(const sim_config_t &config) : config(config), now_us(0), event_order(0), nodes(config.nodes), fail_us(0) {
+  memset(&report, 0, sizeof(report));
+
+  // Seed xoshiro128** through splitmix32 so nearby seeds give unrelated runs
+  uint32_t s = config.seed;
+  for(int i = 0; i < 4; i++) {
+    s += 0x9E3779B9;
+    uint32_t z = s;
+    z = (z ^ (z >> 16)) * 0x85EBCA6B;
+    z = (z ^ (z >> 13)) * 0xC2B2AE35;
+    rng[i] = z ^ (z >> 16);
+  }
+
+  for(int i = 0; i < config.nodes; i++) {
+    sim_node_t *n = &nodes[i];
+    uint8_t mac[MAC_SIZE];
+    SimMac(i, mac);
+    snprintf(n->prefix, sizeof(n->prefix), "[%d] ", i);
+    n->sim = this;
+    n->index = i;
+    n->busy_until_us = 0;
+    n->wake_pending = false;
+    n->dead = false;
+    n->radio = new FakeRadio(*this, mac);
+    n->clock = new FakeClock(Next());
+    n->flash = new SlowFlash(MESH_FLASH_SIZE, *n->clock, config.commit_ms);
+    n->deferred = config.flush_ms > 0 ? new DeferredFlash(*n->flash, *n->clock, config.flush_ms) : NULL;
+    n->log = new ConsoleLogger(n->prefix, config.verbose);
+    n->signal = new SimSignal(this, i);
+    n->node = new MeshNode(*n->radio, *n->clock, n->deferred != NULL ? (FlashBackend &)*n->deferred : *n->flash, *n->log, NULL);
+    if(config.task) {
+      n->node->SetSignal(n->signal);
+    }
+    n->node->SetDeliveryHandler(Delivered, n);
+    n->node->SetBufferHandlers(BufferReceived, NULL, n);
+    n->node->SetDistanceVector(config.routing == SIM_ROUTING_DV);
+    n->node->SetLinkMetric(config.etx);
+    n->node->SetFloodMode((FloodMode)config.flood);
+    n->node->SetFloodSuppression((uint8_t)config.flood_dup_limit, (uint8_t)config.gossip_percent);
+    n->node->SetAggregation(config.aggregate, config.aggregate_ms);
+    n->node->SetPeerEviction(config.peer_evict);
+    n->node->SetHopRecovery((uint8_t)config.hop_retries, config.failover);
+    n->node->SetPathRepair(config.repair);
+    // Before the peer lists, so the broadcast peer gets its slot
+    n->clock->Set(0);
+    n->node->Begin();
+    n->stalled_until_us = (uint64_t)n->clock->Millis() * 1000; // Formatting the route store on first boot
+  }
+
+  Place();
+  Connect();
+}
+
+MeshSim::~MeshSim() {
+  while(!events.empty()) {
+    delete events.top();
+    events.pop();
+  }
+  for(size_t i = 0; i < nodes.size(); i++) {
+    delete nodes[i].node;
+    delete nodes[i].signal;
+    delete nodes[i].log;
+    delete nodes[i].deferred;
+    delete nodes[i].flash;
+    delete nodes[i].clock;
+    delete nodes[i].radio;
+  }
+}
+
+uint32_t MeshSim::Next() {
+  uint32_t result = rng[1] * 5;
+  result = ((result << 7) | (result >> 25)) * 9;
+  uint32_t t = rng[1] << 9;
+  rng[2] ^= rng[0];
+  rng[3] ^= rng[1];
+  rng[1] ^= rng[2];
+  rng[0] ^= rng[3];
+  rng[2] ^= t;
+  rng[3] = (rng[3] << 11) | (rng[3] >> 21);
+  return result;
+}
+
+double MeshSim::Uniform() {
+  return Next() / 4294967296.0; // [0, 1)
+}
+
+void MeshSim::Place() {
+  int side = (int)ceil(sqrt((double)config.nodes));
+  double spacing = config.range_m * 0.8; // Only direct neighbours in range
+
+  for(int i = 0; i < config.nodes; i++) {
+    sim_node_t *n = &nodes[i];
+    if(config.topology == SIM_TOPOLOGY_LINE) {
+      n->x = i * spacing;
+      n->y = 0;
+    } else if(config.topology == SIM_TOPOLOGY_GRID) {
+      n->x = (i % side) * spacing;
+      n->y = (i / side) * spacing;
+    } else {
+      n->x = Uniform() * config.area_m;
+      n->y = Uniform() * config.area_m;
+    }
+  }
+}
+
+void MeshSim::Connect() {
+  for(int i = 0; i < config.nodes; i++) {
+    for(int j = 0; j < config.nodes; j++) {
+      double d = hypot(nodes[i].x - nodes[j].x, nodes[i].y - nodes[j].y);
+      if(i != j && d <= config.range_m) {
+        nodes[i].neighbours.push_back(j);
+      }
+    }
+    report.links += nodes[i].neighbours.size();
+  }
+  report.links /= 2;
+  report.mean_degree = config.nodes > 0 ? 2.0 * report.links / config.nodes : 0;
+
+  // Peer lists as a deployment would set them up: nearest neighbours first, until the
+  // peer table is full. The radio registers them as frames go out
+  for(int i = 0; i < config.nodes; i++) {
+    sim_node_t *n = &nodes[i];
+    std::vector<int> order = n->neighbours;
+    std::sort(order.begin(), order.end(), [&](int a, int b) {
+      return hypot(n->x - nodes[a].x, n->y - nodes[a].y) < hypot(n->x - nodes[b].x, n->y - nodes[b].y);
+    });
+    for(size_t k = 0; k < order.size(); k++) {
+      uint8_t mac[MAC_SIZE];
+      SimMac(order[k], mac);
+      if(n->node->Peers().Contains(mac)) {
+        continue;
+      }
+      n->node->Add_Peer(mac);
+      n->node->SwitchToEncryption(mac);
+    }
+  }
+
+  // Connected components, to tell routing failures from partitions
+  for(int i = 0; i < config.nodes; i++) {
+    nodes[i].component = -1;
+  }
+  int components = 0;
+  for(int i = 0; i < config.nodes; i++) {
+    if(nodes[i].component >= 0) {
+      continue;
+    }
+    std::vector<int> stack(1, i);
+    nodes[i].component = components;
+    while(!stack.empty()) {
+      int at = stack.back();
+      stack.pop_back();
+      for(size_t k = 0; k < nodes[at].neighbours.size(); k++) {
+        int next = nodes[at].neighbours[k];
+        if(nodes[next].component < 0) {
+          nodes[next].component = components;
+          stack.push_back(next);
+        }
+      }
+    }
+    component_size.push_back(0);
+    components++;
+  }
+  for(int i = 0; i < config.nodes; i++) {
+    component_size[nodes[i].component]++;
+  }
+  report.components = components;
+}
+
+bool MeshSim::Converged() const {
+  for(int i = 0; i < config.nodes; i++) {
+    if(nodes[i].node->Router().Reachable() < (size_t)(component_size[nodes[i].component] - 1)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+int MeshSim::NodeIndex(const uint8_t *mac) const {
+  if(mac[0] != 0x02 || mac[1] != 0 || mac[2] != 0 || mac[3] != 0) {
+    return -1;
+  }
+  int index = ((mac[4] << 8) | mac[5]) - 1;
+  return index >= 0 && index < config.nodes ? index : -1;
+}
+
+double MeshSim::LinkLoss(int a, int b) const {
+  double d = hypot(nodes[a].x - nodes[b].x, nodes[a].y - nodes[b].y) / config.range_m;
+  return config.loss + config.edge_loss * d * d;
+}
+
+// Application bytes in a frame: the text of every mesh packet in it. False for route updates
+bool MeshSim::CountPayload(const uint8_t *data, size_t len) {
+  if(FrameAggregator::IsBatch(data, (int)len)) {
+    report.batches++;
+    size_t offset = AGG_HEADER_SIZE;
+    for(int i = 0; i < data[1] && offset + AGG_ENTRY_OVERHEAD < len; i++) {
+      size_t entry = std::min((size_t)data[offset], len - offset - AGG_ENTRY_OVERHEAD);
+      report.batched++;
+      CountPayload(data + offset + AGG_ENTRY_OVERHEAD, entry);
+      offset += AGG_ENTRY_OVERHEAD + entry;
+    }
+    return true;
+  }
+  MessageView view(data, (int)len);
+  if(!view.Valid()) {
+    return false;
+  }
+  report.payload_bytes += view.TextLength();
+  return true;
+}
+
+// Log-distance path loss with some fading, what the receiver reports
+int MeshSim::LinkRssi(int a, int b) {
+  double d = std::max(1.0, hypot(nodes[a].x - nodes[b].x, nodes[a].y - nodes[b].y));
+  double rssi = config.rssi_1m - 10 * config.path_loss_exp * log10(d) + (Uniform() * 2 - 1) * SIM_RSSI_JITTER;
+  return (int)lround(rssi);
+}
+
+MeshSim::sim_event_t *MeshSim::Schedule(uint64_t at_us, sim_event_type type, int node, int peer, int message) {
+  sim_event_t *event = new sim_event_t;
+  event->at_us = at_us;
+  event->order = event_order++;
+  event->type = type;
+  event->node = node;
+  event->peer = peer;
+  event->message = message;
+  events.push(event);
+  return event;
+}
+
+void MeshSim::Attach(FakeRadio *radio) {
+  (void)radio; // Nodes are found by MAC
+}
+
+void MeshSim::Transmit(FakeRadio *from, const uint8_t *to, const uint8_t *data, size_t len) {
+  int sender = NodeIndex(from->Address());
+  if(sender < 0) {
+    return;
+  }
+
+  // Frames from one radio go out back to back
+  sim_node_t *n = &nodes[sender];
+  uint64_t airtime_us = (uint64_t)(len + SIM_FRAME_OVERHEAD) * 8 * 1000000 / config.bitrate;
+  uint64_t start = std::max(now_us, n->busy_until_us);
+  uint64_t end = start + airtime_us;
+  n->busy_until_us = end;
+  report.frames++;
+  if(CountPayload(data, len)) {
+    report.packet_bytes += len + SIM_FRAME_OVERHEAD;
+  }
+
+  bool broadcast = memcmp(to, broadcast_address, MAC_SIZE) == 0;
+  int dest = NodeIndex(to);
+  bool received = false;
+
+  for(size_t k = 0; k < n->neighbours.size(); k++) {
+    int peer = n->neighbours[k];
+    if((!broadcast && peer != dest) || nodes[peer].dead) {
+      continue;
+    }
+    if(Uniform() < LinkLoss(sender, peer)) {
+      report.frames_lost++;
+      continue;
+    }
+    sim_event_t *rx = Schedule(end + config.latency_us, SIM_EVENT_RX, peer, sender, LinkRssi(sender, peer));
+    rx->frame.assign(data, data + len); // Radio buffer is only valid during this call
+    received = true;
+  }
+
+  // The send callback reports the MAC-layer ack of a unicast
+  Schedule(end, SIM_EVENT_TX_DONE, sender, dest, broadcast || received);
+}
+
+void MeshSim::Wake(int node) {
+  sim_node_t *n = &nodes[node];
+  if(!n->wake_pending) {
+    n->wake_pending = true;
+    Schedule(now_us + SIM_TASK_WAKE_US, SIM_EVENT_POLL, node, 1, 0);
+  }
+}
+
+void MeshSim::Arrived(int id) {
+  if(id < 0 || id >= (int)messages.size()) {
+    return;
+  }
+  sim_message_t *m = &messages[id];
+  if(!m->delivered) {
+    m->delivered = true;
+    m->delivered_us = now_us;
+  }
+}
+
+// Buffer content: message index (4 bytes), then a pattern derived from it
+static void SimBlob(int id, std::vector<uint8_t> *blob, size_t len) {
+  blob->resize(len);
+  for(size_t i = 0; i < len; i++) {
+    (*blob)[i] = i < 4 ? (uint8_t)(id >> (8 * i)) : (uint8_t)(id * 31 + i * 7);
+  }
+}
+
+void MeshSim::Delivered(void *ctx, const message_t *packet) {
+  sim_node_t *n = (sim_node_t *)ctx;
+  int id;
+  if(sscanf((const char *)packet->text, "sim %d", &id) == 1) {
+    n->sim->Arrived(id);
+  }
+}
+
+void MeshSim::BufferReceived(void *ctx, const uint8_t *source, const uint8_t *data, size_t len) {
+  sim_node_t *n = (sim_node_t *)ctx;
+  MeshSim *sim = n->sim;
+  (void)source;
+  if(len < 4) {
+    sim->report.corrupt++;
+    return;
+  }
+
+  // Round trip check: exactly what was sent, byte for byte
+  int id = (int)((uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24));
+  std::vector<uint8_t> expected;
+  SimBlob(id, &expected, sim->config.blob_bytes);
+  if(len != expected.size() || memcmp(data, expected.data(), len) != 0) {
+    sim->report.corrupt++;
+    return;
+  }
+  sim->Arrived(id);
+}
+
+// Task-side events wait out a flash commit, the Wi-Fi task (receive, send results) does not
+bool MeshSim::Stalled(const sim_event_t *event) const {
+  if(event->type != SIM_EVENT_POLL && event->type != SIM_EVENT_SEND && event->type != SIM_EVENT_FLUSH) {
+    return false;
+  }
+  return nodes[event->node].stalled_until_us > now_us;
+}
+
+// Where node 0 sends the flow next: its table next hop, else the second node of its stored
+// path. -1 if that is the destination itself or there is no route
+int MeshSim::FlowRelay() {
+  if(config.flow <= 0 || config.flow >= config.nodes) {
+    return -1;
+  }
+  uint8_t dest[MAC_SIZE];
+  SimMac(config.flow, dest);
+  const MeshNode *source = nodes[0].node;
+  const dv_route_t *table = config.routing == SIM_ROUTING_DV ? source->Router().Lookup(dest) : NULL;
+  if(table != NULL) {
+    int relay = NodeIndex(table->next_hop);
+    return relay == config.flow ? -1 : relay;
+  }
+  for(size_t s = 0; s < RouteCache::Capacity(); s++) {
+    const route_entry_t *route = source->Routes().Slot(s);
+    if(route != NULL && memcmp(route->dest, dest, MAC_SIZE) == 0 && route->path_len > 2) {
+      return NodeIndex(route->path[1]);
+    }
+  }
+  return -1;
+}
+
+void MeshSim::Dispatch(sim_event_t *event) {
+  sim_node_t *n = &nodes[event->node];
+  if(n->dead && event->type != SIM_EVENT_CHECK) {
+    return;
+  }
+  if(Stalled(event)) {
+    sim_event_t *later = Schedule(n->stalled_until_us, event->type, event->node, event->peer, event->message);
+    later->frame.swap(event->frame);
+    return;
+  }
+  n->clock->Set((uint32_t)(std::max(now_us, n->stalled_until_us) / 1000));
+
+  switch(event->type) {
+    case SIM_EVENT_RX: {
+      uint8_t mac[MAC_SIZE];
+      SimMac(event->peer, mac);
+      n->radio->Receive(mac, event->frame.data(), (int)event->frame.size(), event->message);
+      break;
+    }
+    case SIM_EVENT_TX_DONE: {
+      uint8_t mac[MAC_SIZE];
+      if(event->peer >= 0) {
+        SimMac(event->peer, mac);
+      } else {
+        memcpy(mac, broadcast_address, MAC_SIZE);
+      }
+      n->radio->Sent(mac, event->message != 0);
+      break;
+    }
+    case SIM_EVENT_POLL:
+      if(event->peer) {
+        n->wake_pending = false; // Woken by a frame, the tick goes on separately
+        n->node->Poll();
+        break;
+      }
+      n->node->Poll();
+      Schedule(now_us + (uint64_t)(config.task ? MESH_TASK_TICK_MS : config.poll_ms) * 1000, SIM_EVENT_POLL, event->node, 0, 0);
+      break;
+    case SIM_EVENT_SEND: {
+      uint8_t mac[MAC_SIZE];
+      char text[16];
+      SimMac(event->peer, mac);
+      snprintf(text, sizeof(text), "sim %d", event->message);
+      report.offered++;
+      if(n->component == nodes[event->peer].component) {
+        report.reachable++;
+      }
+      bool accepted;
+      if(config.blob_bytes > 0) {
+        std::vector<uint8_t> blob;
+        SimBlob(event->message, &blob, config.blob_bytes);
+        accepted = n->node->Send_Buffer(blob.data(), blob.size(), mac) >= 0;
+      } else {
+        accepted = n->node->Send_Reliable(text, mac);
+      }
+      if(accepted) {
+        messages[event->message].sent_us = now_us;
+      } else {
+        report.refused++;
+      }
+      break;
+    }
+    case SIM_EVENT_CHECK:
+      if(Converged()) {
+        report.converged_ms = (int32_t)(now_us / 1000);
+      } else {
+        Schedule(now_us + SIM_CHECK_MS * 1000, SIM_EVENT_CHECK, 0, 0, 0);
+      }
+      break;
+    case SIM_EVENT_FLUSH:
+      n->deferred->Flush();
+      Schedule(now_us + FLASH_POLL_MS * 1000, SIM_EVENT_FLUSH, event->node, 0, 0);
+      break;
+    case SIM_EVENT_FAIL: {
+      int victim = event->peer == SIM_FAIL_RELAY ? FlowRelay() : event->peer;
+      if(victim >= 0 && victim < config.nodes) {
+        nodes[victim].dead = true;
+        report.failed_node = victim;
+        report.failed_at_ms = (uint32_t)(now_us / 1000);
+        fail_us = now_us;
+      }
+      break;
+    }
+  }
+
+  // A commit moved the clock on: the task spent that long in flash
+  uint64_t clock_us = (uint64_t)n->clock->Millis() * 1000;
+  if(clock_us > now_us && clock_us > n->stalled_until_us) {
+    n->stalled_until_us = clock_us;
+  }
+}
+
+// Shutdown: flush, then replay every node's flash as a reboot would and compare with its cache
+void MeshSim::CheckFlash() {
+  for(int i = 0; i < config.nodes; i++) {
+    sim_node_t *n = &nodes[i];
+    if(n->deferred != NULL) {
+      n->deferred->Flush(true);
+    }
+    RouteCache replayed;
+    RouteStore store(*n->flash, ROUTE_STORE_BASE, ROUTE_STORE_SIZE);
+    store.Mount(replayed);
+
+    const RouteCache &live = n->node->Routes();
+    bool stale = replayed.Count() != live.Count();
+    for(size_t s = 0; s < RouteCache::Capacity() && !stale; s++) {
+      const route_entry_t *route = live.Slot(s);
+      if(route == NULL) {
+        continue;
+      }
+      const route_entry_t *stored = replayed.Lookup(route->dest);
+      stale = stored == NULL || stored->path_len != route->path_len || memcmp(stored->path, route->path, route->path_len * MAC_SIZE) != 0;
+    }
+    report.flash_stale += stale;
+  }
+}
+
+sim_report_t MeshSim::Run() {
+  report.converged_ms = -1;
+  if(config.routing == SIM_ROUTING_DV) {
+    Schedule(0, SIM_EVENT_CHECK, 0, 0, 0);
+  }
+
+  for(int i = 0; i < config.nodes; i++) {
+    // Random loop() phase so nodes do not poll in lockstep
+    Schedule((uint64_t)(Uniform() * (config.task ? MESH_TASK_TICK_MS : config.poll_ms) * 1000), SIM_EVENT_POLL, i, 0, 0);
+  }
+  for(int i = 0; i < config.nodes && config.flush_ms > 0; i++) {
+    Schedule((uint64_t)(Uniform() * FLASH_POLL_MS * 1000), SIM_EVENT_FLUSH, i, 0, 0);
+  }
+
+  // Offered load: random source/destination pairs (or the one flow), exponential gaps
+  messages.assign(config.messages, sim_message_t());
+  uint64_t at = (uint64_t)config.warmup_ms * 1000;
+  uint64_t first = 0;
+  for(int m = 0; m < config.messages && config.nodes > 1; m++) {
+    at += (uint64_t)(-log(1.0 - Uniform()) * config.interval_ms * 1000);
+    int source = Next() % config.nodes;
+    int dest = Next() % (config.nodes - 1);
+    dest += dest >= source; // Never to itself
+    if(config.flow > 0 && config.flow < config.nodes) {
+      source = 0;
+      dest = config.flow;
+    }
+    Schedule(at, SIM_EVENT_SEND, source, dest, m);
+    if(m == 0) {
+      first = at;
+    }
+  }
+  uint64_t end = at + (uint64_t)config.drain_ms * 1000;
+
+  report.failed_node = -1;
+  report.recovery_ms = -1;
+  if(config.fail_node != -1) {
+    uint64_t fail_at = first + (config.fail_ms > 0 ? (uint64_t)config.fail_ms * 1000 : (at - first) / 4);
+    Schedule(fail_at, SIM_EVENT_FAIL, 0, config.fail_node, 0);
+  }
+
+  while(!events.empty() && events.top()->at_us <= end) {
+    sim_event_t *event = events.top();
+    events.pop();
+    now_us = event->at_us;
+    Dispatch(event);
+    delete event;
+    report.events++;
+  }
+  report.sim_time_ms = (uint32_t)(now_us / 1000);
+
+  std::vector<double> latencies;
+  for(size_t m = 0; m < messages.size(); m++) {
+    if(messages[m].delivered) {
+      latencies.push_back((messages[m].delivered_us - messages[m].sent_us) / 1000.0);
+    }
+  }
+  report.delivered = (int)latencies.size();
+
+  // Recovery: how long after the failure messages got through again
+  uint64_t recovered_us = 0;
+  for(size_t m = 0; m < messages.size() && report.failed_node >= 0; m++) {
+    if(messages[m].sent_us == 0 || messages[m].sent_us < fail_us) {
+      continue; // Refused, or sent before
+    }
+    report.sent_after_failure++;
+    if(messages[m].delivered) {
+      report.delivered_after_failure++;
+      recovered_us = recovered_us == 0 ? messages[m].delivered_us : std::min(recovered_us, messages[m].delivered_us);
+    }
+  }
+  if(recovered_us > 0) {
+    report.recovery_ms = (int32_t)((recovered_us - fail_us) / 1000);
+  }
+  std::sort(latencies.begin(), latencies.end());
+  if(!latencies.empty()) {
+    report.latency_p50_ms = latencies[latencies.size() * 50 / 100];
+    report.latency_p90_ms = latencies[latencies.size() * 90 / 100];
+    report.latency_p99_ms = latencies[latencies.size() * 99 / 100];
+    report.latency_max_ms = latencies.back();
+  }
+
+  for(int i = 0; i < config.nodes; i++) {
+    report.rx_drops += nodes[i].node->RxDrops();
+    report.tx_drops += nodes[i].node->Scheduler().Dropped();
+    report.retransmits += nodes[i].node->Transport().Stats().retransmits;
+    report.hop_retries += nodes[i].node->Scheduler().Stats().retries;
+    report.hop_recovered += nodes[i].node->Scheduler().Stats().recovered;
+    report.failovers += nodes[i].node->Failovers();
+    report.hop_losses += nodes[i].node->HopLosses();
+    const repair_stats_t &repairs = nodes[i].node->Repairs();
+    report.path_breaks += repairs.breaks;
+    report.path_repairs += repairs.repaired;
+    report.path_rediscoveries += repairs.rediscoveries;
+    report.route_errors += repairs.errors_sent;
+    report.routes_invalidated += repairs.routes_invalidated;
+    report.fragments += nodes[i].node->Fragments().Stats().fragments_sent;
+    report.fragments_resent += nodes[i].node->Fragments().Stats().fragments_resent;
+    report.flood_relays += nodes[i].node->Flooding().Stats().sent;
+    report.flood_suppressed += nodes[i].node->Flooding().Stats().suppressed;
+    report.control_frames += nodes[i].node->Router().Stats().frames_sent;
+    report.control_bytes += nodes[i].node->Router().Stats().bytes_sent;
+    const peer_slot_stats_t &slots = nodes[i].node->Slots().Stats();
+    report.peer_registrations += slots.registrations;
+    report.peer_evictions += slots.evictions;
+    report.peer_hits += slots.hits;
+    report.peer_failures += slots.failures;
+    report.peers_max = std::max(report.peers_max, (int)nodes[i].node->Peers().Count());
+  }
+
+  CheckFlash();
+  for(int i = 0; i < config.nodes; i++) {
+    const sim_node_t *n = &nodes[i];
+    if(n->deferred != NULL) {
+      flash_stats_t stats = n->deferred->Stats();
+      report.flash_requests += stats.requests;
+      report.flash_commits += stats.commits;
+      report.flash_stall_ms += stats.stall_ms;
+      report.flash_stall_max_ms = std::max(report.flash_stall_max_ms, stats.stall_max_ms);
+    } else {
+      // Every request was a commit of its own
+      uint32_t commits = n->flash->Commits();
+      report.flash_requests += commits;
+      report.flash_commits += commits;
+      report.flash_stall_ms += commits * config.commit_ms;
+      if(commits > 0) {
+        report.flash_stall_max_ms = std::max(report.flash_stall_max_ms, config.commit_ms);
+      }
+    }
+  }
+  return report;
+}
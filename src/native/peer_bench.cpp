@@ -0,0 +1,96 @@
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "peer_bench.h"
+#include "peer_table.h"
+
+#define PEER_BENCH_QUERIES 1024 // Distinct MACs looked up, in turn
+
+static uint32_t BenchRandom(uint32_t *state) {
+  *state ^= *state << 13;
+  *state ^= *state >> 17;
+  *state ^= *state << 5;
+  return *state;
+}
+
+static void BenchMac(uint32_t *state, uint8_t *mac) {
+  uint32_t a = BenchRandom(state);
+  uint32_t b = BenchRandom(state);
+  mac[0] = 0x02; // Locally administered, unicast
+  mac[1] = (uint8_t)(b >> 8);
+  memcpy(mac + 2, &a, 4);
+}
+
+// ns per lookup of fn over the queries, repeated until lookups are done
+template <typename Fn>
+static double TimeLookups(const uint8_t (*queries)[MAC_SIZE], uint32_t lookups, int *found, Fn fn) {
+  auto start = std::chrono::steady_clock::now();
+  int hits = 0;
+  for(uint32_t i = 0; i < lookups; i++) {
+    hits += fn(queries[i % PEER_BENCH_QUERIES]);
+  }
+  double elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+  *found = hits;
+  return elapsed / lookups;
+}
+
+peer_bench_report_t RunPeerBench(int entries, uint32_t lookups) {
+  static PeerTable<PEER_BENCH_MAX> sorted;
+  static uint8_t array[PEER_BENCH_MAX][MAC_SIZE];
+  static uint8_t queries[PEER_BENCH_QUERIES][MAC_SIZE];
+  std::vector<uint8_t *> heap;
+  uint32_t state = 0x5EED + entries;
+
+  peer_bench_report_t report;
+  memset(&report, 0, sizeof(report));
+  entries = entries < 1 ? 1 : (entries > PEER_BENCH_MAX ? PEER_BENCH_MAX : entries);
+  report.entries = entries;
+  report.lookups = lookups;
+
+  sorted.Clear();
+  for(int i = 0; i < entries; i++) {
+    BenchMac(&state, array[i]);
+    sorted.Add(array[i]);
+    uint8_t *mac = (uint8_t *)malloc(MAC_SIZE);
+    memcpy(mac, array[i], MAC_SIZE);
+    heap.push_back(mac);
+  }
+  // Every other query is a peer, the rest (almost surely) are not
+  for(int q = 0; q < PEER_BENCH_QUERIES; q++) {
+    if(q % 2 == 0) {
+      memcpy(queries[q], array[BenchRandom(&state) % entries], MAC_SIZE);
+    } else {
+      BenchMac(&state, queries[q]);
+    }
+  }
+
+  int heap_hits, array_hits, sorted_hits;
+  report.heap_scan_ns = TimeLookups(queries, lookups, &heap_hits, [&](const uint8_t *mac) {
+    for(size_t n = 0; n < heap.size(); n++) {
+      if(memcmp(heap[n], mac, MAC_SIZE) == 0) {
+        return 1;
+      }
+    }
+    return 0;
+  });
+  report.array_scan_ns = TimeLookups(queries, lookups, &array_hits, [&](const uint8_t *mac) {
+    for(int n = 0; n < entries; n++) {
+      if(memcmp(array[n], mac, MAC_SIZE) == 0) {
+        return 1;
+      }
+    }
+    return 0;
+  });
+  report.sorted_ns = TimeLookups(queries, lookups, &sorted_hits, [&](const uint8_t *mac) {
+    return (int)sorted.Contains(mac);
+  });
+  if(heap_hits != sorted_hits || array_hits != sorted_hits) {
+    report.sorted_ns = -1; // Layouts disagree, the table is broken
+  }
+
+  for(size_t n = 0; n < heap.size(); n++) {
+    free(heap[n]);
+  }
+  return report;
+}
@@ -0,0 +1,75 @@
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include "mesh_node.h"
+#include "ring_bench.h"
+
+typedef SpscRing<rx_slot_t, RX_QUEUE_DEPTH> BenchRing;
+
+// As On_Data_Receive fills a slot: sender, RSSI and the header fields Poll() reads
+static void Fill(rx_slot_t *slot, uint32_t seq) {
+  memset(slot->mac, 0x02, sizeof(slot->mac));
+  slot->rssi = -60;
+  slot->forward = false;
+  slot->data.packetID = (int)seq;
+  slot->data.TTL = 3;
+  slot->data.Text_Length = 0;
+}
+
+ring_bench_report_t RunRingBench(uint32_t frames) {
+  static BenchRing ring; // Too large for the stack at big RX_QUEUE_DEPTH
+  ring_bench_report_t report;
+  memset(&report, 0, sizeof(report));
+  report.frames = frames;
+
+  uint32_t expected = 0;
+  auto start = std::chrono::steady_clock::now();
+  for(uint32_t seq = 0; seq < frames; seq++) {
+    rx_slot_t *slot = ring.Reserve();
+    if(slot == NULL) {
+      report.full++; // Cannot happen, every frame is taken out again
+      continue;
+    }
+    Fill(slot, seq);
+    ring.Commit();
+    slot = ring.Peek();
+    report.out_of_order += (uint32_t)slot->data.packetID != expected++;
+    ring.Release();
+  }
+  report.inline_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / frames;
+
+  // Producer and consumer on threads of their own; neither ever waits on the other
+  // except for a full or an empty ring
+  uint32_t full = 0;
+  uint32_t out_of_order = 0;
+  start = std::chrono::steady_clock::now();
+  std::thread producer([&] {
+    for(uint32_t seq = 0; seq < frames; seq++) {
+      rx_slot_t *slot;
+      while((slot = ring.Reserve()) == NULL) {
+        full++;
+        std::this_thread::yield();
+      }
+      Fill(slot, seq);
+      ring.Commit();
+    }
+  });
+  std::thread consumer([&] {
+    for(uint32_t seq = 0; seq < frames;) {
+      rx_slot_t *slot = ring.Peek();
+      if(slot == NULL) {
+        std::this_thread::yield();
+        continue;
+      }
+      out_of_order += (uint32_t)slot->data.packetID != seq++;
+      ring.Release();
+    }
+  });
+  producer.join();
+  consumer.join();
+  double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  report.threaded_fps = elapsed > 0 ? frames / elapsed : 0.0;
+  report.full = full;
+  report.out_of_order += out_of_order;
+  return report;
+}
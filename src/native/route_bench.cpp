@@ -0,0 +1,130 @@
+#include <chrono>
+#include <cstring>
+#include <vector>
+#include "fake_hal.h"
+#include "route_bench.h"
+#include "route_cache.h"
+
+#define ROUTE_BENCH_HOPS 3
+#define ROUTE_BENCH_QUERIES 256 // Distinct destinations looked up, in turn
+
+static uint32_t BenchRandom(uint32_t *state) {
+  *state ^= *state << 13;
+  *state ^= *state >> 17;
+  *state ^= *state << 5;
+  return *state;
+}
+
+// The old store ends a path at 0x00 and the image at 0xFF, so neither is in a MAC
+static void BenchMac(uint32_t *state, uint8_t *mac) {
+  for(int i = 0; i < MAC_SIZE; i++) {
+    mac[i] = (uint8_t)(1 + BenchRandom(state) % 0xFE);
+  }
+}
+
+// LoadPathFromEEPROM of the original firmware, logging left out
+static bool ScanEeprom(const FlashBackend &eeprom, const uint8_t *mac, message_t *packet) {
+  int addr = eeprom.Read(ROUTE_BENCH_EEPROM - 1);
+  if(addr == 0xFF) {
+    return false;
+  }
+  std::vector<uint8_t> Temp_Arr;
+  for(int i = addr; eeprom.Read(i) != 0xFF; i++) {
+    if(eeprom.Read(i) == 0x00) {
+      size_t lastMACIndex = Temp_Arr.size() - MAC_SIZE;
+      if(memcmp(Temp_Arr.data() + lastMACIndex, mac, MAC_SIZE) == 0) {
+        for(size_t b = 0; b < Temp_Arr.size(); b++) {
+          packet->Path_Array[b / MAC_SIZE][b % MAC_SIZE] = Temp_Arr[b];
+        }
+        return true;
+      }
+      Temp_Arr.clear();
+    } else {
+      Temp_Arr.push_back(eeprom.Read(i));
+    }
+  }
+  return false;
+}
+
+// LoadPathFromCache, logging left out
+static bool LookupCache(RouteCache &cache, const uint8_t *mac, message_t *packet) {
+  route_entry_t *route = cache.Lookup(mac);
+  if(route == NULL) {
+    return false;
+  }
+  memcpy(packet->Path_Array, route->path, route->path_len * MAC_SIZE);
+  packet->Path_Length = route->path_len;
+  packet->Path_Index = 0;
+  return true;
+}
+
+template <typename Fn>
+static double TimeLookups(const uint8_t (*queries)[MAC_SIZE], uint32_t lookups, int *found, Fn fn) {
+  auto start = std::chrono::steady_clock::now();
+  int hits = 0;
+  for(uint32_t i = 0; i < lookups; i++) {
+    hits += fn(queries[i % ROUTE_BENCH_QUERIES]);
+  }
+  double elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+  *found = hits;
+  return elapsed / lookups;
+}
+
+route_bench_report_t RunRouteBench(int entries, uint32_t lookups) {
+  static RouteCache cache;
+  static uint8_t dests[ROUTE_CACHE_SIZE][MAC_SIZE];
+  static uint8_t queries[ROUTE_BENCH_QUERIES][MAC_SIZE];
+  static message_t packet;
+  RamFlash eeprom(ROUTE_BENCH_EEPROM);
+  uint32_t state = 0x5EED + entries;
+
+  // Both stores hold the same paths: as many as the old image and the cache take
+  int fit = (ROUTE_BENCH_EEPROM - 1) / (ROUTE_BENCH_HOPS * MAC_SIZE + 1);
+  entries = entries < 1 ? 1 : entries;
+  entries = entries > fit ? fit : entries;
+  entries = entries > ROUTE_CACHE_SIZE * 3 / 4 ? ROUTE_CACHE_SIZE * 3 / 4 : entries;
+
+  route_bench_report_t report;
+  memset(&report, 0, sizeof(report));
+  report.entries = entries;
+  report.lookups = lookups;
+
+  cache.Clear();
+  uint8_t path[ROUTE_BENCH_HOPS][MAC_SIZE];
+  BenchMac(&state, path[0]); // This node
+  size_t addr = 0;
+  eeprom.Write(ROUTE_BENCH_EEPROM - 1, 0); // Paths start at 0
+  for(int e = 0; e < entries; e++) {
+    for(int h = 1; h < ROUTE_BENCH_HOPS; h++) {
+      BenchMac(&state, path[h]);
+    }
+    memcpy(dests[e], path[ROUTE_BENCH_HOPS - 1], MAC_SIZE);
+    cache.Insert(path, ROUTE_BENCH_HOPS, 0);
+    for(int h = 0; h < ROUTE_BENCH_HOPS; h++) {
+      for(int b = 0; b < MAC_SIZE; b++) {
+        eeprom.Write(addr++, path[h][b]);
+      }
+    }
+    eeprom.Write(addr++, 0x00);
+  }
+  // Every other query has a path, the rest (almost surely) have not
+  for(int q = 0; q < ROUTE_BENCH_QUERIES; q++) {
+    if(q % 2 == 0) {
+      memcpy(queries[q], dests[BenchRandom(&state) % entries], MAC_SIZE);
+    } else {
+      BenchMac(&state, queries[q]);
+    }
+  }
+
+  int scan_hits, cache_hits;
+  report.scan_ns = TimeLookups(queries, lookups, &scan_hits, [&](const uint8_t *mac) {
+    return (int)ScanEeprom(eeprom, mac, &packet);
+  });
+  report.cache_ns = TimeLookups(queries, lookups, &cache_hits, [&](const uint8_t *mac) {
+    return (int)LookupCache(cache, mac, &packet);
+  });
+  if(scan_hits != cache_hits) {
+    report.cache_ns = -1; // Stores disagree
+  }
+  return report;
+}
@@ -0,0 +1,211 @@
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include "mesh_node.h"
+#include "rx_bench.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define RX_BENCH_TSC 1
+#endif
+
+#define LEGACY_TEXT 64
+#define LEGACY_NODES 9
+
+// message_t as it went on air before the wire format, the whole struct per frame
+typedef struct legacy_message {
+  unsigned char text[LEGACY_TEXT];
+  int TTL;
+  int identification;
+  bool broadcast_Ack;
+  bool Data_Ack;
+  uint8_t destination_mac[6];
+  uint8_t source_mac[6];
+  int packetID;
+  uint8_t Path_Array[LEGACY_NODES][MAC_SIZE];
+  uint8_t Path_Index;
+  uint8_t Path_Length;
+  bool Path_Exist;
+} legacy_message_t;
+
+typedef struct legacy_node {
+  legacy_message_t data;
+  uint8_t mac[6];
+  struct legacy_node *next;
+} legacy_node_t;
+
+// Bytes one field-by-field copy into a queue node writes (the text strncpy pads out)
+#define LEGACY_NODE_COPY (LEGACY_TEXT - 1 + 6 + 4 + 1 + 1 + 4 + 4 + 6 + 6 + 1 + 1 + 1 + LEGACY_NODES * MAC_SIZE)
+
+static const uint8_t here[MAC_SIZE] = {0x02, 0, 0, 0, 0, 0x01};
+static const uint8_t sender[MAC_SIZE] = {0x02, 0, 0, 0, 0, 0x02};
+static const uint8_t other[MAC_SIZE] = {0x02, 0, 0, 0, 0, 0x03};
+static const char bench_text[] = "temperature 21.5";
+
+static legacy_message_t legacy_msg; // The global the old callback wrote
+static volatile uint32_t sink;
+
+static inline uint64_t Ticks() {
+#ifdef RX_BENCH_TSC
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
+
+static void LegacyStore(const legacy_message_t *msg, legacy_node_t *node) {
+  memcpy(node->data.text, msg->text, sizeof(node->data.text) - 1); // strncpy, padded to the same 63 bytes
+  memcpy(node->mac, msg->source_mac, 6);
+  node->data.identification = msg->identification;
+  node->data.broadcast_Ack = msg->broadcast_Ack;
+  node->data.Data_Ack = msg->Data_Ack;
+  node->data.TTL = msg->TTL;
+  node->data.packetID = msg->packetID;
+  memcpy(node->data.destination_mac, msg->destination_mac, 6);
+  memcpy(node->data.source_mac, msg->source_mac, 6);
+  node->data.Path_Index = msg->Path_Index;
+  node->data.Path_Length = msg->Path_Length;
+  node->data.Path_Exist = msg->Path_Exist;
+  for(int i = 0; i < LEGACY_NODES; i++) {
+    memcpy(node->data.Path_Array[i], msg->Path_Array[i], MAC_SIZE);
+  }
+}
+
+// On_Data_Receive of the original firmware; the forward is StoreContentsInNode in loop()
+static uint32_t LegacyReceive(const uint8_t *mac, const uint8_t *data) {
+  memcpy(&legacy_msg, data, sizeof(legacy_msg));
+  uint32_t copied = sizeof(legacy_msg);
+
+  legacy_node_t *node = (legacy_node_t *)malloc(sizeof(legacy_node_t));
+  if(node == NULL) {
+    return copied;
+  }
+  LegacyStore(&legacy_msg, node);
+  memcpy(node->mac, mac, 6);
+  node->next = NULL;
+  copied += LEGACY_NODE_COPY;
+
+  bool forward = false;
+  if(memcmp(here, legacy_msg.destination_mac, 6) == 0) {
+    sink = sink + node->data.packetID;
+  } else if(legacy_msg.TTL > 0) {
+    legacy_msg.TTL--;
+    forward = true;
+  } else {
+    memset(&legacy_msg, 0, sizeof(legacy_msg));
+  }
+  free(node);
+
+  if(forward) {
+    legacy_node_t *out = (legacy_node_t *)malloc(sizeof(legacy_node_t));
+    if(out != NULL) {
+      LegacyStore(&legacy_msg, out);
+      copied += LEGACY_NODE_COPY;
+      sink = sink + out->data.Path_Index;
+      free(out);
+    }
+  }
+  return copied;
+}
+
+typedef SpscRing<rx_slot_t, RX_QUEUE_DEPTH> BenchRing;
+
+// On_Data_Receive now, then Poll() taking the slot; counts bytes moved and cleared
+static uint32_t Receive(BenchRing *ring, const uint8_t *mac, const uint8_t *data, int len, uint32_t *zeroed) {
+  *zeroed = 0;
+  MessageView view(data, len);
+  if(!view.Valid()) {
+    return 0;
+  }
+  bool forward = false;
+  if(memcmp(here, view.DestinationMac(), 6) != 0) {
+    if(view.TTL() <= 0) {
+      return 0; // Dropped on the header alone
+    }
+    forward = true;
+  }
+  rx_slot_t *slot = ring->Reserve();
+  if(slot == NULL || !DecodeMessage(view.Raw(), view.Length(), NULL, &slot->data)) {
+    return 0;
+  }
+  memcpy(slot->mac, mac, 6);
+  slot->rssi = -60;
+  slot->forward = forward;
+  ring->Commit();
+
+  // Poll(): a forward goes out of the slot as it is, nothing is copied again
+  rx_slot_t *taken = ring->Peek();
+  sink = sink + taken->data.packetID;
+  ring->Release();
+
+  *zeroed = sizeof(message_t) - offsetof(message_t, Text_Length);
+  return (uint32_t)len + MAC_SIZE;
+}
+
+rx_bench_report_t RunRxBench(uint32_t frames) {
+  static const char *names[RX_BENCH_CASES] = {"for this node", "forwarded", "TTL expired"};
+  static BenchRing ring;
+  rx_bench_report_t report;
+  memset(&report, 0, sizeof(report));
+  report.frames = frames;
+
+  for(int c = 0; c < RX_BENCH_CASES; c++) {
+    rx_bench_case_t *r = &report.cases[c];
+    r->name = names[c];
+
+    // The same packet both ways: short text, a path of three MACs
+    message_t packet;
+    memset(&packet, 0, sizeof(packet));
+    memcpy(packet.text, bench_text, sizeof(bench_text) - 1);
+    packet.Text_Length = sizeof(bench_text) - 1;
+    packet.TTL = c == 2 ? 0 : 3;
+    packet.identification = 2;
+    memcpy(packet.destination_mac, c == 0 ? here : other, MAC_SIZE);
+    memcpy(packet.source_mac, sender, MAC_SIZE);
+    packet.packetID = 12345;
+    packet.Path_Length = 3;
+    packet.Path_Index = 1;
+    packet.Path_Exist = true;
+    memcpy(packet.Path_Array[0], sender, MAC_SIZE);
+    memcpy(packet.Path_Array[1], here, MAC_SIZE);
+    memcpy(packet.Path_Array[2], other, MAC_SIZE);
+
+    uint8_t frame[WIRE_MAX_FRAME];
+    size_t len = EncodeMessage(&packet, NULL, frame, sizeof(frame));
+
+    legacy_message_t legacy;
+    memset(&legacy, 0, sizeof(legacy));
+    memcpy(legacy.text, bench_text, sizeof(bench_text));
+    legacy.TTL = packet.TTL;
+    legacy.identification = packet.identification;
+    memcpy(legacy.destination_mac, packet.destination_mac, MAC_SIZE);
+    memcpy(legacy.source_mac, sender, MAC_SIZE);
+    legacy.packetID = packet.packetID;
+    memcpy(legacy.Path_Array, packet.Path_Array, 3 * MAC_SIZE);
+    legacy.Path_Index = 1;
+    legacy.Path_Length = 3;
+    legacy.Path_Exist = true;
+    uint8_t legacy_frame[sizeof(legacy_message_t)];
+    memcpy(legacy_frame, &legacy, sizeof(legacy));
+
+    r->legacy_frame_bytes = sizeof(legacy_frame);
+    r->frame_bytes = (uint32_t)len;
+
+    auto start = std::chrono::steady_clock::now();
+    uint64_t ticks = Ticks();
+    for(uint32_t i = 0; i < frames; i++) {
+      r->legacy_copied = LegacyReceive(sender, legacy_frame);
+    }
+    r->legacy_cycles = (double)(Ticks() - ticks) / frames;
+    r->legacy_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / frames;
+
+    start = std::chrono::steady_clock::now();
+    ticks = Ticks();
+    for(uint32_t i = 0; i < frames; i++) {
+      r->copied = Receive(&ring, sender, frame, (int)len, &r->zeroed);
+    }
+    r->cycles = (double)(Ticks() - ticks) / frames;
+    r->ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / frames;
+  }
+  return report;
+}
@@ -0,0 +1,184 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include "fake_hal.h"
+#include "route_store.h"
+#include "store_bench.h"
+
+#define STORE_BENCH_HOPS 3
+#define STORE_BENCH_RELAYS 8
+
+typedef std::chrono::steady_clock bench_clock;
+
+static uint32_t BenchRandom(uint32_t *state) {
+  *state ^= *state << 13;
+  *state ^= *state >> 17;
+  *state ^= *state << 5;
+  return *state;
+}
+
+// The old store ends a path at 0x00 and the image at 0xFF, so neither is in a MAC
+static void BenchMac(uint8_t kind, uint8_t n, uint8_t *mac) {
+  const uint8_t prefix[MAC_SIZE] = {0x24, 0x6F, 0x28, 0x10, 0x20, 0x30};
+  memcpy(mac, prefix, MAC_SIZE);
+  mac[4] = kind;
+  mac[5] = (uint8_t)(1 + n);
+}
+
+static double Micros(bench_clock::time_point start) {
+  return std::chrono::duration<double, std::micro>(bench_clock::now() - start).count();
+}
+
+// CheckDestInPath of the original firmware: the stored path whose last hop is mac, or -1
+static int FindStored(const FlashBackend &eeprom, const uint8_t *mac) {
+  int addr = eeprom.Read(STORE_BENCH_EEPROM - 1);
+  if(addr == 0xFF) {
+    return -1;
+  }
+  int start = addr;
+  for(int i = addr; i < STORE_BENCH_EEPROM - 1 && eeprom.Read(i) != 0xFF; i++) {
+    if(eeprom.Read(i) == 0x00) {
+      if(i - start >= MAC_SIZE) {
+        uint8_t last[MAC_SIZE];
+        eeprom.ReadBlock(i - MAC_SIZE, last, MAC_SIZE);
+        if(memcmp(last, mac, MAC_SIZE) == 0) {
+          return start;
+        }
+      }
+      start = i + 1;
+    }
+  }
+  return -1;
+}
+
+// SavePathToEEPROM of the original firmware, logging left out: a known destination keeps
+// its first path, a new one goes to the first 0xFF byte and is committed
+static void SaveOriginal(FileFlash &eeprom, const uint8_t path[][MAC_SIZE], int len, uint32_t *bytes) {
+  if(FindStored(eeprom, path[len - 1]) >= 0) {
+    return;
+  }
+  int addr = -1;
+  for(int i = 0; i < STORE_BENCH_EEPROM; i++) {
+    if(eeprom.Read(i) == 0xFF) {
+      addr = i;
+      break;
+    }
+  }
+  if(addr < 0 || addr + len * MAC_SIZE + 1 > STORE_BENCH_EEPROM - 1) {
+    return; // Full, the original never frees space
+  }
+  if(eeprom.Read(STORE_BENCH_EEPROM - 1) == 0xFF) {
+    eeprom.Write(STORE_BENCH_EEPROM - 1, (uint8_t)addr);
+    (*bytes)++;
+  }
+  eeprom.WriteBlock(addr, &path[0][0], len * MAC_SIZE);
+  eeprom.Write(addr + len * MAC_SIZE, 0x00);
+  *bytes += len * MAC_SIZE + 1;
+  eeprom.Commit();
+}
+
+// Path i of the stream: this node, a relay that changes, the destination
+static void BenchPath(uint32_t *state, uint8_t path[][MAC_SIZE], uint8_t *dest) {
+  *dest = (uint8_t)(BenchRandom(state) % STORE_BENCH_DESTINATIONS);
+  BenchMac(0x01, 0, path[0]);
+  BenchMac(0x02, (uint8_t)(BenchRandom(state) % STORE_BENCH_RELAYS), path[1]);
+  BenchMac(0x03, *dest, path[2]);
+}
+
+static void RunOriginal(uint32_t updates, uint8_t latest[][STORE_BENCH_HOPS][MAC_SIZE], store_bench_layout_t *out) {
+  remove(STORE_BENCH_IMAGE);
+  uint32_t state = 0x5EED;
+  {
+    FileFlash eeprom(STORE_BENCH_IMAGE, STORE_BENCH_EEPROM);
+    bench_clock::time_point start = bench_clock::now();
+    for(uint32_t i = 0; i < updates; i++) {
+      uint8_t path[STORE_BENCH_HOPS][MAC_SIZE];
+      uint8_t dest;
+      BenchPath(&state, path, &dest);
+      memcpy(latest[dest], path, sizeof(path));
+      SaveOriginal(eeprom, path, STORE_BENCH_HOPS, &out->bytes_written);
+    }
+    out->update_us = Micros(start) / updates;
+    out->commits = eeprom.Commits();
+
+    for(int d = 0; d < STORE_BENCH_DESTINATIONS; d++) {
+      int at = FindStored(eeprom, latest[d][STORE_BENCH_HOPS - 1]);
+      uint8_t stored[STORE_BENCH_HOPS * MAC_SIZE];
+      if(at >= 0) {
+        eeprom.ReadBlock(at, stored, sizeof(stored));
+        out->current += memcmp(stored, latest[d], sizeof(stored)) == 0;
+      }
+    }
+  }
+
+  // Reboot: setup() wiped the image with ResetEEPROMLocations()
+  FileFlash eeprom(STORE_BENCH_IMAGE, STORE_BENCH_EEPROM);
+  bench_clock::time_point start = bench_clock::now();
+  for(int i = 0; i < STORE_BENCH_EEPROM; i++) {
+    eeprom.Write(i, 0xFF);
+  }
+  eeprom.Commit();
+  out->boot_us = Micros(start);
+  out->recovered = 0;
+}
+
+static void RunStore(uint32_t updates, uint8_t latest[][STORE_BENCH_HOPS][MAC_SIZE], store_bench_report_t *report) {
+  store_bench_layout_t *out = &report->store;
+  static RouteCache cache, replayed; // Too big for some stacks
+  remove(STORE_BENCH_IMAGE);
+  uint32_t state = 0x5EED;
+  {
+    FileFlash flash(STORE_BENCH_IMAGE, ROUTE_STORE_SIZE);
+    RouteStore store(flash, 0, ROUTE_STORE_SIZE);
+    store.Mount(cache);
+    uint32_t format_commits = flash.Commits();
+    uint32_t format_bytes = store.Stats().bytes_written;
+
+    bench_clock::time_point start = bench_clock::now();
+    for(uint32_t i = 0; i < updates; i++) {
+      uint8_t path[STORE_BENCH_HOPS][MAC_SIZE];
+      uint8_t dest;
+      BenchPath(&state, path, &dest);
+      memcpy(latest[dest], path, sizeof(path));
+      if(cache.Insert(path, STORE_BENCH_HOPS, i)) {
+        store.SaveRoute(cache.Lookup(path[STORE_BENCH_HOPS - 1]), cache);
+      }
+    }
+    out->update_us = Micros(start) / updates;
+    out->commits = flash.Commits() - format_commits;
+    out->bytes_written = store.Stats().bytes_written - format_bytes;
+    report->compactions = store.Stats().compactions;
+  }
+
+  // Reboot: replay whatever reached the file
+  FileFlash flash(STORE_BENCH_IMAGE, ROUTE_STORE_SIZE);
+  RouteStore store(flash, 0, ROUTE_STORE_SIZE);
+  bench_clock::time_point start = bench_clock::now();
+  store.Mount(replayed);
+  out->boot_us = Micros(start);
+  out->recovered = (int)replayed.Count();
+
+  report->replay_ok = flash.Loaded() && replayed.Count() == cache.Count();
+  for(int d = 0; d < STORE_BENCH_DESTINATIONS; d++) {
+    const route_entry_t *route = replayed.Lookup(latest[d][STORE_BENCH_HOPS - 1]);
+    bool current = route != NULL && memcmp(route->path, latest[d], sizeof(latest[d])) == 0;
+    out->current += current;
+    report->replay_ok = report->replay_ok && (current || cache.Lookup(latest[d][STORE_BENCH_HOPS - 1]) == NULL);
+  }
+  cache.Clear();
+  replayed.Clear();
+}
+
+store_bench_report_t RunStoreBench(uint32_t updates) {
+  store_bench_report_t report;
+  memset(&report, 0, sizeof(report));
+  report.updates = updates;
+
+  uint8_t latest[STORE_BENCH_DESTINATIONS][STORE_BENCH_HOPS][MAC_SIZE];
+  memset(latest, 0, sizeof(latest)); // A destination the stream never picked matches nothing
+  RunOriginal(updates, latest, &report.eeprom);
+  memset(latest, 0, sizeof(latest));
+  RunStore(updates, latest, &report);
+  remove(STORE_BENCH_IMAGE);
+  return report;
+}
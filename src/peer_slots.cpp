@@ -0,0 +1,101 @@
+#include <cstring>
+#include "peer_slots.h"
+
+static_assert(PEER_ENCRYPTED_SLOTS >= 1 && PEER_ENCRYPTED_SLOTS < PEER_SLOTS, "Encrypted peers share the peer slots");
+
+PeerSlots::PeerSlots(Radio &radio) : radio(radio), count(0), encrypted(0), tick(0), evict(true) {
+  memset(slots, 0, sizeof(slots));
+  memset(&stats, 0, sizeof(stats));
+}
+
+int PeerSlots::Find(const uint8_t *mac) const {
+  for(size_t i = 0; i < count; i++) {
+    if(memcmp(slots[i].mac, mac, MAC_SIZE) == 0) {
+      return (int)i;
+    }
+  }
+  return -1;
+}
+
+int PeerSlots::Victim(bool encrypted_only) const {
+  int victim = -1;
+  for(size_t i = 0; i < count; i++) {
+    if(slots[i].pinned || (encrypted_only && !slots[i].encrypt)) {
+      continue;
+    }
+    if(victim < 0 || (uint32_t)(tick - slots[i].used) > (uint32_t)(tick - slots[victim].used)) {
+      victim = (int)i;
+    }
+  }
+  return victim;
+}
+
+bool PeerSlots::Evict(int i) {
+  if(!radio.DeletePeer(slots[i].mac)) {
+    return false;
+  }
+  encrypted -= slots[i].encrypt;
+  slots[i] = slots[--count]; // Order does not matter, the ticks keep the LRU
+  return true;
+}
+
+bool PeerSlots::Register(const uint8_t *mac, bool encrypt, bool pinned) {
+  // Make room: encrypted peers have their own, smaller limit
+  if(encrypt && encrypted == PEER_ENCRYPTED_SLOTS) {
+    int victim = evict ? Victim(true) : -1;
+    if(victim < 0 || !Evict(victim)) {
+      stats.failures++;
+      return false;
+    }
+    stats.evictions++;
+  }
+  if(count == PEER_SLOTS) {
+    int victim = evict ? Victim(false) : -1;
+    if(victim < 0 || !Evict(victim)) {
+      stats.failures++;
+      return false;
+    }
+    stats.evictions++;
+  }
+
+  if(!radio.AddPeer(mac, encrypt)) {
+    stats.failures++;
+    return false;
+  }
+  peer_slot_t *slot = &slots[count++];
+  memcpy(slot->mac, mac, MAC_SIZE);
+  slot->encrypt = encrypt;
+  slot->pinned = pinned;
+  slot->used = tick;
+  encrypted += encrypt;
+  stats.registrations++;
+  return true;
+}
+
+bool PeerSlots::Pin(const uint8_t *mac, bool encrypt) {
+  int i = Find(mac);
+  if(i >= 0) {
+    slots[i].pinned = true;
+    return true;
+  }
+  return Register(mac, encrypt, true);
+}
+
+bool PeerSlots::Acquire(const uint8_t *mac, bool encrypt) {
+  tick++;
+  int i = Find(mac);
+  if(i >= 0) {
+    if(slots[i].encrypt == encrypt || slots[i].pinned) {
+      slots[i].used = tick;
+      stats.hits++;
+      return true;
+    }
+    // Key change: re-register with the other setting
+    stats.rekeys++;
+    if(!Evict(i)) {
+      stats.failures++;
+      return false;
+    }
+  }
+  return Register(mac, encrypt, false);
+}
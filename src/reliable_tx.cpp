@@ -0,0 +1,252 @@
+#include <cstring>
+#include "reliable_tx.h"
+
+static_assert(RTX_WINDOW <= 32 && (RTX_WINDOW & (RTX_WINDOW - 1)) == 0, "Send window must be a power of two no larger than the SACK width");
+
+// Sequence numbers this far behind the receive window are duplicates, anything further
+// away means the sender started a new session (reboot or window eviction)
+#define RTX_DUPLICATE_SPAN 64
+
+ReliableTransport::ReliableTransport(TransmitFn transmit, void *ctx) : transmit(transmit), ctx(ctx), recv_victim(0) {
+  memset(send_windows, 0, sizeof(send_windows));
+  memset(recv_windows, 0, sizeof(recv_windows));
+  memset(&stats, 0, sizeof(stats));
+}
+
+send_window_t *ReliableTransport::SendWindow(const uint8_t *dest, bool create, uint16_t initial_seq) {
+  send_window_t *idle = NULL;
+
+  for(int i = 0; i < RTX_PEERS; i++) {
+    send_window_t *window = &send_windows[i];
+    if(window->used && memcmp(window->dest, dest, MAC_SIZE) == 0) {
+      return window;
+    }
+    // Unused windows first, then windows with nothing in flight
+    if(!window->used && (idle == NULL || idle->used)) {
+      idle = window;
+    } else if(window->used && window->base == window->next_seq && idle == NULL) {
+      idle = window;
+    }
+  }
+
+  if(!create || idle == NULL) {
+    return NULL;
+  }
+
+  memset(idle, 0, sizeof(*idle));
+  memcpy(idle->dest, dest, MAC_SIZE);
+  idle->first_seq = idle->base = idle->next_seq = initial_seq;
+  RtoInit(&idle->rto);
+  idle->used = true;
+  return idle;
+}
+
+const send_window_t *ReliableTransport::FindSendWindow(const uint8_t *dest) const {
+  for(int i = 0; i < RTX_PEERS; i++) {
+    if(send_windows[i].used && memcmp(send_windows[i].dest, dest, MAC_SIZE) == 0) {
+      return &send_windows[i];
+    }
+  }
+  return NULL;
+}
+
+recv_window_t *ReliableTransport::RecvWindow(const uint8_t *source) {
+  recv_window_t *window = NULL;
+
+  for(int i = 0; i < RTX_PEERS; i++) {
+    if(recv_windows[i].used && memcmp(recv_windows[i].source, source, MAC_SIZE) == 0) {
+      return &recv_windows[i];
+    }
+    if(!recv_windows[i].used && window == NULL) {
+      window = &recv_windows[i];
+    }
+  }
+
+  // Table full: reuse windows round robin, the evicted source simply resyncs
+  if(window == NULL) {
+    window = &recv_windows[recv_victim];
+    recv_victim = (recv_victim + 1) % RTX_PEERS;
+  }
+
+  memset(window, 0, sizeof(*window));
+  memcpy(window->source, source, MAC_SIZE);
+  return window; // Not marked used until the first packet sets expected
+}
+
+uint32_t ReliableTransport::Timeout(const send_window_t *window, const rtx_slot_t *slot) const {
+  return RtoBackoff(&window->rto, slot->tries);
+}
+
+void ReliableTransport::AdvanceBase(send_window_t *window) {
+  while(window->base != window->next_seq && !window->slots[window->base % RTX_WINDOW].in_use) {
+    window->base++;
+  }
+}
+
+bool ReliableTransport::Send(const message_t *packet, uint32_t now) {
+  // A new window starts from a random seq so the receiver can tell a new session
+  send_window_t *window = SendWindow(packet->destination_mac, true, (uint16_t)packet->packetID);
+  if(window == NULL) {
+    return false; // Every window busy
+  }
+
+  if((uint16_t)(window->next_seq - window->base) >= RTX_WINDOW) {
+    return false; // Window Full
+  }
+
+  rtx_slot_t *slot = &window->slots[window->next_seq % RTX_WINDOW];
+  memcpy(&slot->packet, packet, sizeof(*packet));
+  slot->packet.seq = window->next_seq++;
+  slot->packet.Reliable = true;
+  slot->packet.New_Session = (uint16_t)(slot->packet.seq - window->first_seq) < RTX_WINDOW;
+  slot->tries = 1;
+  slot->sent_at = now;
+  slot->in_use = true;
+
+  stats.sent++;
+  transmit(&slot->packet, ctx);
+  return true;
+}
+
+// Move expected past count seqs, then past every seq after them that was already received
+static void SlideWindow(recv_window_t *window, int count) {
+  if(count > 32) {
+    window->expected += count; // Beyond the bitmap, nothing to carry over
+    window->received = 0;
+    return;
+  }
+  bool next;
+  do {
+    window->expected++;
+    next = window->received & 1;
+    window->received >>= 1;
+  } while(--count > 0 || next);
+}
+
+bool ReliableTransport::OnData(const message_t *packet, uint16_t *ack_seq, uint32_t *sack) {
+  recv_window_t *window = RecvWindow(packet->source_mac);
+  int diff = (int16_t)(packet->seq - window->expected);
+  bool fresh = true;
+
+  // The first RTX_WINDOW packets of a session are flagged. One that is not within a window of
+  // where this session was picked up comes from a new one, e.g. after the sender evicted its window
+  int from_start = (int16_t)(packet->seq - window->start);
+  bool restarted = packet->New_Session && (from_start >= RTX_WINDOW || from_start <= -RTX_WINDOW);
+
+  if(!window->used || restarted || diff < -RTX_DUPLICATE_SPAN) {
+    // First packet of a session. The sender may have up to RTX_WINDOW - 1 earlier packets
+    // still on their way (reordered, or sent before this window was evicted)
+    window->used = true;
+    window->start = packet->seq;
+    window->expected = packet->seq - (RTX_WINDOW - 1);
+    window->received = 0;
+  } else if(diff >= RTX_WINDOW) {
+    // The sender's window reaches seq, so everything RTX_WINDOW below it was acked or given up
+    SlideWindow(window, diff - (RTX_WINDOW - 1));
+  }
+  diff = (int16_t)(packet->seq - window->expected);
+
+  if(diff < 0) {
+    fresh = false; // Delivered before, the ack got lost
+  } else if(diff == 0) {
+    SlideWindow(window, 1); // In order: also slides past everything received out of order
+  } else {
+    uint32_t bit = 1u << (diff - 1);
+    fresh = (window->received & bit) == 0;
+    window->received |= bit;
+  }
+
+  if(!fresh) {
+    stats.duplicates++;
+  }
+  *ack_seq = window->expected;
+  *sack = window->received;
+  return fresh;
+}
+
+void ReliableTransport::OnAck(const uint8_t *dest, uint16_t ack_seq, uint32_t sack, uint32_t now) {
+  send_window_t *window = SendWindow(dest, false, 0);
+  if(window == NULL) {
+    return;
+  }
+
+  for(uint16_t seq = window->base; seq != window->next_seq; seq++) {
+    rtx_slot_t *slot = &window->slots[seq % RTX_WINDOW];
+    if(!slot->in_use) {
+      continue;
+    }
+    int diff = (int16_t)(seq - ack_seq);
+    bool acked = diff < 0 || (diff >= 1 && diff <= 32 && (sack & (1u << (diff - 1))));
+    if(acked) {
+      // Karn's rule: an ack for a retransmitted packet could belong to any copy
+      if(slot->tries == 1) {
+        RtoSample(&window->rto, now - slot->sent_at);
+        stats.rtt_samples++;
+      }
+      slot->in_use = false;
+      stats.acked++;
+    }
+  }
+
+  AdvanceBase(window);
+}
+
+void ReliableTransport::Poll(uint32_t now) {
+  for(int i = 0; i < RTX_PEERS; i++) {
+    send_window_t *window = &send_windows[i];
+    if(!window->used) {
+      continue;
+    }
+
+    for(uint16_t seq = window->base; seq != window->next_seq; seq++) {
+      rtx_slot_t *slot = &window->slots[seq % RTX_WINDOW];
+      if(!slot->in_use || (uint32_t)(now - slot->sent_at) < Timeout(window, slot)) {
+        continue;
+      }
+
+      if(slot->tries >= RTX_MAX_TRIES) {
+        slot->in_use = false; // Maximum Retransmission Attempts Reached
+        stats.failed++;
+        continue;
+      }
+
+      slot->tries++;
+      slot->sent_at = now;
+      stats.retransmits++;
+      transmit(&slot->packet, ctx);
+    }
+
+    AdvanceBase(window);
+  }
+}
+
+size_t ReliableTransport::Available(const uint8_t *dest) const {
+  const send_window_t *window = FindSendWindow(dest);
+  if(window == NULL) {
+    return RTX_WINDOW;
+  }
+  return RTX_WINDOW - (uint16_t)(window->next_seq - window->base);
+}
+
+uint32_t ReliableTransport::SmoothedRtt(const uint8_t *dest) const {
+  const send_window_t *window = FindSendWindow(dest);
+  if(window == NULL || !window->rto.sampled) {
+    return 0;
+  }
+  return window->rto.srtt8 >> 3;
+}
+
+uint32_t ReliableTransport::CurrentRto(const uint8_t *dest) const {
+  const send_window_t *window = FindSendWindow(dest);
+  return window == NULL ? RTO_INITIAL_MS : window->rto.rto;
+}
+
+size_t ReliableTransport::InFlight() const {
+  size_t count = 0;
+  for(int i = 0; i < RTX_PEERS; i++) {
+    for(int j = 0; j < RTX_WINDOW; j++) {
+      count += send_windows[i].used && send_windows[i].slots[j].in_use;
+    }
+  }
+  return count;
+}
@@ -0,0 +1,128 @@
+#include <cstring>
+#include "route_cache.h"
+
+// FNV-1a over the 6 MAC bytes
+uint32_t RouteCache::Hash(const uint8_t *mac) {
+  uint32_t hash = 2166136261u;
+  for(int i = 0; i < MAC_SIZE; i++) {
+    hash ^= mac[i];
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+route_entry_t *RouteCache::Lookup(const uint8_t *dest) {
+  uint32_t slot = Hash(dest) & (ROUTE_CACHE_SIZE - 1);
+
+  for(size_t probe = 0; probe < ROUTE_CACHE_SIZE; probe++) {
+    route_entry_t *entry = &entries[slot];
+    if(entry->state == ROUTE_SLOT_EMPTY) {
+      return NULL; // End of probe chain
+    }
+    if(entry->state == ROUTE_SLOT_USED && memcmp(entry->dest, dest, MAC_SIZE) == 0) {
+      return entry;
+    }
+    slot = (slot + 1) & (ROUTE_CACHE_SIZE - 1);
+  }
+
+  return NULL;
+}
+
+bool RouteCache::Insert(const uint8_t path[][MAC_SIZE], uint8_t path_len, uint32_t now) {
+  if(path_len < 2 || path_len > MAX_NODES) {
+    return false;
+  }
+
+  const uint8_t *dest = path[path_len - 1];
+  route_entry_t *entry = Lookup(dest);
+
+  // New destination: take the first free or deleted slot on the probe chain
+  if(entry == NULL) {
+    if(deleted >= ROUTE_CACHE_MAX_DELETED) {
+      Rebuild();
+    }
+    uint32_t slot = Hash(dest) & (ROUTE_CACHE_SIZE - 1);
+    for(size_t probe = 0; probe < ROUTE_CACHE_SIZE; probe++) {
+      if(entries[slot].state != ROUTE_SLOT_USED) {
+        entry = &entries[slot];
+        break;
+      }
+      slot = (slot + 1) & (ROUTE_CACHE_SIZE - 1);
+    }
+    if(entry == NULL) {
+      return false; // Table Full
+    }
+    if(entry->state == ROUTE_SLOT_DELETED) {
+      --deleted;
+    }
+    ++count;
+  }
+
+  memcpy(entry->dest, dest, MAC_SIZE);
+  memcpy(entry->next_hop, path[1], MAC_SIZE);
+  memcpy(entry->path, path, path_len * MAC_SIZE);
+  entry->path_len = path_len;
+  entry->learned = now;
+  entry->state = ROUTE_SLOT_USED;
+  return true;
+}
+
+bool RouteCache::Remove(const uint8_t *dest) {
+  route_entry_t *entry = Lookup(dest);
+  if(entry == NULL) {
+    return false;
+  }
+  entry->state = ROUTE_SLOT_DELETED;
+  --count;
+  ++deleted;
+  if(count == 0) {
+    Clear(); // Nothing left to keep a chain for, not even in a table that was full
+    return true;
+  }
+
+  // No chain goes on past an empty slot: tombstones right before one keep nothing intact
+  size_t slot = entry - entries;
+  if(entries[(slot + 1) & (ROUTE_CACHE_SIZE - 1)].state == ROUTE_SLOT_EMPTY) {
+    while(entries[slot].state == ROUTE_SLOT_DELETED) {
+      entries[slot].state = ROUTE_SLOT_EMPTY;
+      --deleted;
+      slot = (slot - 1) & (ROUTE_CACHE_SIZE - 1);
+    }
+  }
+  return true;
+}
+
+// Drop every tombstone, then move each entry back to the first empty slot of its probe
+// chain until no chain has a gap. Every move shortens a chain, so this ends
+void RouteCache::Rebuild() {
+  for(size_t i = 0; i < ROUTE_CACHE_SIZE; i++) {
+    if(entries[i].state == ROUTE_SLOT_DELETED) {
+      entries[i].state = ROUTE_SLOT_EMPTY;
+    }
+  }
+  deleted = 0;
+
+  bool moved = true;
+  while(moved) {
+    moved = false;
+    for(size_t i = 0; i < ROUTE_CACHE_SIZE; i++) {
+      if(entries[i].state != ROUTE_SLOT_USED) {
+        continue;
+      }
+      for(uint32_t slot = Hash(entries[i].dest) & (ROUTE_CACHE_SIZE - 1); slot != i; slot = (slot + 1) & (ROUTE_CACHE_SIZE - 1)) {
+        if(entries[slot].state == ROUTE_SLOT_EMPTY) {
+          memcpy(&entries[slot], &entries[i], sizeof(entries[i]));
+          entries[i].state = ROUTE_SLOT_EMPTY;
+          moved = true;
+          break;
+        }
+      }
+    }
+  }
+}
+
+void RouteCache::Clear() {
+  memset(entries, 0, sizeof(entries));
+  count = 0;
+  deleted = 0;
+}
@@ -0,0 +1,190 @@
+#include <cstring>
+#include "route_store.h"
+
+// CRC-16/CCITT-FALSE
+static uint16_t Crc16(const uint8_t *data, size_t len, uint16_t crc = 0xFFFF) {
+  for(size_t i = 0; i < len; i++) {
+    crc ^= (uint16_t)data[i] << 8;
+    for(int bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+  }
+  return crc;
+}
+
+RouteStore::RouteStore(FlashBackend &flash, size_t base, size_t size)
+  : flash(flash), base(base), bank_size(size / ROUTE_STORE_BANKS), active_bank(0), generation(0),
+    write_offset(ROUTE_STORE_HEADER_SIZE) {
+  memset(&stats, 0, sizeof(stats));
+}
+
+bool RouteStore::ReadHeader(int bank, uint32_t *gen) const {
+  uint8_t header[ROUTE_STORE_HEADER_SIZE];
+  flash.ReadBlock(BankAddr(bank), header, sizeof(header));
+
+  if(header[0] != 'R' || header[1] != 'S' || header[2] != ROUTE_STORE_VERSION) {
+    return false;
+  }
+  uint16_t crc = header[7] | (header[8] << 8);
+  if(Crc16(header, 7) != crc) {
+    return false;
+  }
+  *gen = header[3] | (header[4] << 8) | (header[5] << 16) | ((uint32_t)header[6] << 24);
+  return true;
+}
+
+void RouteStore::WriteHeader(int bank, uint32_t gen) {
+  uint8_t header[ROUTE_STORE_HEADER_SIZE] = {'R', 'S', ROUTE_STORE_VERSION,
+    (uint8_t)gen, (uint8_t)(gen >> 8), (uint8_t)(gen >> 16), (uint8_t)(gen >> 24)};
+  uint16_t crc = Crc16(header, 7);
+  header[7] = (uint8_t)crc;
+  header[8] = (uint8_t)(crc >> 8);
+  flash.WriteBlock(BankAddr(bank), header, sizeof(header));
+  stats.bytes_written += sizeof(header);
+}
+
+void RouteStore::EraseBank(int bank) {
+  for(size_t i = 0; i < bank_size; i++) {
+    if(flash.Read(BankAddr(bank) + i) != 0xFF) { // Skip bytes that are already erased
+      flash.Write(BankAddr(bank) + i, 0xFF);
+    }
+  }
+}
+
+bool RouteStore::Commit() {
+  stats.commits++;
+  return flash.Commit();
+}
+
+bool RouteStore::Format() {
+  for(int bank = 0; bank < ROUTE_STORE_BANKS; bank++) {
+    EraseBank(bank);
+  }
+  active_bank = 0;
+  generation = 1;
+  write_offset = ROUTE_STORE_HEADER_SIZE;
+  WriteHeader(active_bank, generation);
+  return Commit();
+}
+
+size_t RouteStore::Replay(int bank, RouteCache &cache) {
+  size_t offset = ROUTE_STORE_HEADER_SIZE;
+  uint8_t record[2 + 255 + 2];
+
+  // Records are replayed oldest first, so a newer ADD for a destination replaces the older one
+  while(offset + 4 <= bank_size) {
+    uint8_t len = flash.Read(BankAddr(bank) + offset);
+    if(len == 0xFF || offset + 4 + len > bank_size) {
+      break; // End of Log
+    }
+
+    flash.ReadBlock(BankAddr(bank) + offset, record, len + 4);
+    uint16_t crc = record[len + 2] | (record[len + 3] << 8);
+    if(Crc16(record, len + 2) != crc) {
+      stats.records_corrupt++;
+      break; // Torn Write, Newer Records are Unreliable
+    }
+
+    uint8_t type = record[1];
+    const uint8_t *payload = record + 2;
+    if(type == ROUTE_RECORD_ADD && len >= 1 && len == 1 + payload[0] * MAC_SIZE) {
+      cache.Insert((const uint8_t (*)[MAC_SIZE])(payload + 1), payload[0], 0);
+    } else if(type == ROUTE_RECORD_DEL && len == MAC_SIZE) {
+      cache.Remove(payload);
+    }
+
+    stats.records_replayed++;
+    offset += len + 4;
+  }
+
+  return offset;
+}
+
+bool RouteStore::Mount(RouteCache &cache) {
+  int newest = -1;
+  uint32_t newest_gen = 0;
+
+  for(int bank = 0; bank < ROUTE_STORE_BANKS; bank++) {
+    uint32_t gen;
+    if(ReadHeader(bank, &gen) && (newest < 0 || gen > newest_gen)) {
+      newest = bank;
+      newest_gen = gen;
+    }
+  }
+
+  cache.Clear();
+  if(newest < 0) {
+    return Format(); // Blank or Foreign Layout
+  }
+
+  active_bank = newest;
+  generation = newest_gen;
+  write_offset = Replay(active_bank, cache);
+  return true;
+}
+
+bool RouteStore::WriteRecord(uint8_t type, const uint8_t *payload, uint8_t len) {
+  if(write_offset + 4 + len > bank_size) {
+    return false;
+  }
+
+  uint8_t record[2 + 255 + 2];
+  record[0] = len;
+  record[1] = type;
+  memcpy(record + 2, payload, len);
+  uint16_t crc = Crc16(record, len + 2);
+  record[len + 2] = (uint8_t)crc;
+  record[len + 3] = (uint8_t)(crc >> 8);
+
+  flash.WriteBlock(BankAddr(active_bank) + write_offset, record, len + 4);
+  write_offset += len + 4;
+  stats.bytes_written += len + 4;
+  return true;
+}
+
+bool RouteStore::Compact(RouteCache &cache) {
+  int target = (active_bank + 1) % ROUTE_STORE_BANKS;
+  bool complete = true;
+
+  EraseBank(target);
+  active_bank = target;
+  write_offset = ROUTE_STORE_HEADER_SIZE;
+
+  // Only the latest version of each live route is carried over
+  for(size_t i = 0; i < RouteCache::Capacity(); i++) {
+    const route_entry_t *route = cache.Slot(i);
+    if(route == NULL) {
+      continue;
+    }
+    uint8_t payload[1 + MAX_NODES * MAC_SIZE];
+    payload[0] = route->path_len;
+    memcpy(payload + 1, route->path, route->path_len * MAC_SIZE);
+    if(!WriteRecord(ROUTE_RECORD_ADD, payload, 1 + route->path_len * MAC_SIZE)) {
+      complete = false; // Live set larger than a bank, rest stays RAM only
+      break;
+    }
+  }
+
+  // Header last: until it is committed the previous bank is still the newest
+  WriteHeader(active_bank, ++generation);
+  stats.compactions++;
+  return Commit() && complete;
+}
+
+bool RouteStore::AppendRecord(uint8_t type, const uint8_t *payload, uint8_t len, RouteCache &cache) {
+  if(WriteRecord(type, payload, len)) {
+    return Commit();
+  }
+  return Compact(cache); // Cache already holds the update, compaction persists it
+}
+
+bool RouteStore::SaveRoute(const route_entry_t *route, RouteCache &cache) {
+  uint8_t payload[1 + MAX_NODES * MAC_SIZE];
+  payload[0] = route->path_len;
+  memcpy(payload + 1, route->path, route->path_len * MAC_SIZE);
+  return AppendRecord(ROUTE_RECORD_ADD, payload, 1 + route->path_len * MAC_SIZE, cache);
+}
+
+bool RouteStore::RemoveRoute(const uint8_t *dest, RouteCache &cache) {
+  return AppendRecord(ROUTE_RECORD_DEL, dest, MAC_SIZE, cache);
+}
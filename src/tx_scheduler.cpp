@@ -0,0 +1,210 @@
+#include <cstring>
+#include "tx_scheduler.h"
+
+static_assert(WIRE_MAX_FRAME <= 0xFF, "Frame lengths are kept in one byte");
+
+TxScheduler::TxScheduler(SendFn send, void *ctx)
+  : send(send), ctx(ctx), busy(false), sent_at(0), reports(0), synced(0), result(0), retry_waiting(false), retry_at(0),
+    max_retries(TX_HOP_RETRIES) {
+  memset(&inflight, 0, sizeof(inflight));
+  memset(&retry, 0, sizeof(retry));
+  memset(weight, 0, sizeof(weight));
+  memset(credit, 0, sizeof(credit));
+  memset(&stats, 0, sizeof(stats));
+  Configure(TX_FORWARD_WEIGHT, TX_ORIGIN_WEIGHT);
+}
+
+void TxScheduler::Configure(uint8_t forward_weight, uint8_t origin_weight) {
+  weight[TX_CLASS_FORWARD] = forward_weight;
+  weight[TX_CLASS_ORIGIN] = origin_weight;
+  credit[TX_CLASS_FORWARD] = 0; // Next round starts with the new weights
+  credit[TX_CLASS_ORIGIN] = 0;
+}
+
+bool TxScheduler::Enqueue(TxClass cls, const uint8_t *mac, const uint8_t *frame, size_t len, uint32_t now, bool encrypt) {
+  if(len == 0 || len > WIRE_MAX_FRAME) {
+    return false;
+  }
+
+  tx_frame_t *slot;
+  switch(cls) {
+    case TX_CLASS_CONTROL: slot = control.Reserve(); break;
+    case TX_CLASS_FORWARD: slot = forward.Reserve(); break;
+    default: cls = TX_CLASS_ORIGIN; slot = origin.Reserve(); break;
+  }
+  if(slot == NULL) {
+    stats.dropped[cls]++;
+    return false;
+  }
+
+  memcpy(slot->mac, mac, MAC_SIZE);
+  memcpy(slot->data, frame, len);
+  slot->len = (uint8_t)len;
+  slot->encrypt = encrypt;
+  slot->cls = (uint8_t)cls;
+  slot->tries = 0;
+  switch(cls) {
+    case TX_CLASS_CONTROL: control.Commit(); break;
+    case TX_CLASS_FORWARD: forward.Commit(); break;
+    default: origin.Commit(); break;
+  }
+  stats.queued[cls]++;
+
+  Poll(now);
+  return true;
+}
+
+// Oldest frame of the class whose turn it is, NULL if nothing waits
+tx_frame_t *TxScheduler::Next(TxClass *cls) {
+  tx_frame_t *frame = control.Peek();
+  if(frame != NULL) {
+    *cls = TX_CLASS_CONTROL;
+    return frame;
+  }
+
+  tx_frame_t *relay = forward.Peek();
+  tx_frame_t *own = origin.Peek();
+  if(relay == NULL || own == NULL) {
+    *cls = relay != NULL ? TX_CLASS_FORWARD : TX_CLASS_ORIGIN;
+    return relay != NULL ? relay : own; // No contention, no credit spent
+  }
+
+  // Both wait: weighted round robin
+  if(credit[TX_CLASS_FORWARD] == 0 && credit[TX_CLASS_ORIGIN] == 0) {
+    credit[TX_CLASS_FORWARD] = weight[TX_CLASS_FORWARD];
+    credit[TX_CLASS_ORIGIN] = weight[TX_CLASS_ORIGIN];
+  }
+  if(credit[TX_CLASS_FORWARD] > 0 || credit[TX_CLASS_ORIGIN] == 0) {
+    if(credit[TX_CLASS_FORWARD] > 0) {
+      credit[TX_CLASS_FORWARD]--;
+    }
+    *cls = TX_CLASS_FORWARD;
+    return relay;
+  }
+  credit[TX_CLASS_ORIGIN]--;
+  *cls = TX_CLASS_ORIGIN;
+  return own;
+}
+
+void TxScheduler::Release(TxClass cls) {
+  switch(cls) {
+    case TX_CLASS_CONTROL: control.Release(); break;
+    case TX_CLASS_FORWARD: forward.Release(); break;
+    default: origin.Release(); break;
+  }
+}
+
+void TxScheduler::Pump(uint32_t now) {
+  while(!busy) {
+    // A due resend goes before anything queued, it is older
+    TxClass cls;
+    tx_frame_t *slot;
+    if(retry_waiting && (int32_t)(now - retry_at) >= 0) {
+      slot = &retry;
+      cls = (TxClass)retry.cls;
+    } else {
+      slot = Next(&cls);
+    }
+    if(slot == NULL) {
+      return;
+    }
+
+    // Kept until the send result, the queue slot is free for the next frame
+    tx_frame_t &frame = inflight;
+    memcpy(frame.mac, slot->mac, MAC_SIZE);
+    memcpy(frame.data, slot->data, slot->len);
+    frame.len = slot->len;
+    frame.encrypt = slot->encrypt;
+    frame.cls = slot->cls;
+    frame.tries = slot->tries;
+    if(slot == &retry) {
+      retry_waiting = false;
+    } else {
+      Release(cls);
+    }
+
+    stats.sent[cls]++;
+    if(send(ctx, frame.mac, frame.data, frame.len, frame.encrypt)) {
+      busy = true; // Until Poll() sees its result
+      sent_at = now;
+      return;
+    }
+    stats.send_errors++; // No result will come for it, go on with the next
+  }
+}
+
+// Outstanding frame not acked: resend it later, or hand it back
+void TxScheduler::Unacked(uint32_t now) {
+  if(inflight.tries < max_retries && !retry_waiting) {
+    memcpy(&retry, &inflight, offsetof(tx_frame_t, data) + inflight.len);
+    retry.tries++;
+    retry_at = now + (TX_RETRY_BACKOFF_MS << inflight.tries);
+    retry_waiting = true;
+    stats.retries++;
+    return;
+  }
+
+  stats.failed++;
+  tx_frame_t *slot = failed.Reserve();
+  if(slot == NULL) {
+    stats.failed_dropped++;
+    return;
+  }
+  memcpy(slot, &inflight, offsetof(tx_frame_t, data) + inflight.len);
+  failed.Commit();
+}
+
+// Outstanding frame reported: done, or resent later / handed back
+void TxScheduler::Finish(uint32_t now, bool success) {
+  busy = false;
+  if(!success) {
+    Unacked(now);
+  } else if(inflight.tries > 0) {
+    stats.recovered++;
+  }
+}
+
+void TxScheduler::OnSent(const uint8_t *mac, bool success) {
+  reports++;
+  result.store((reports << TX_RESULT_COUNT_SHIFT) | ((uint32_t)mac[MAC_SIZE - 1] << 1) | (success ? 1 : 0), std::memory_order_release);
+}
+
+void TxScheduler::Poll(uint32_t now) {
+  uint32_t latest = result.load(std::memory_order_acquire);
+  uint32_t count = latest >> TX_RESULT_COUNT_SHIFT;
+  uint32_t ahead = (count - synced) & (UINT32_MAX >> TX_RESULT_COUNT_SHIFT);
+
+  if(!busy) {
+    synced = count; // Nothing outstanding: whatever came was late
+  } else if(ahead > 1 || (ahead == 1 && (uint8_t)(latest >> 1) == inflight.mac[MAC_SIZE - 1])) {
+    // Results come in send order, the outstanding frame's is the last one
+    synced = count;
+    Finish(now, latest & 1);
+  } else if(ahead == 1) {
+    synced = count; // Late result of a frame that timed out, sent to another hop
+  }
+
+  if(busy && (uint32_t)(now - sent_at) > TX_SENT_TIMEOUT_MS) {
+    // Counts as not acked. synced stays: a lost callback costs nothing later, a late one
+    // is told apart by its hop or comes before the next frame's own result
+    stats.timeouts++;
+    Finish(now, false);
+  }
+  Pump(now);
+}
+
+size_t TxScheduler::Queued(TxClass cls) const {
+  switch(cls) {
+    case TX_CLASS_CONTROL: return control.Size();
+    case TX_CLASS_FORWARD: return forward.Size();
+    default: return origin.Size();
+  }
+}
+
+uint32_t TxScheduler::Dropped() const {
+  uint32_t count = 0;
+  for(int i = 0; i < TX_CLASSES; i++) {
+    count += stats.dropped[i];
+  }
+  return count;
+}
@@ -0,0 +1,165 @@
+#include "wire_format.h"
+
+// Index of mac in the node table, -1 if it is not known
+static int NodeIndex(const wire_node_table_t *table, const uint8_t *mac) {
+  if(table == NULL) {
+    return -1;
+  }
+  for(int i = 0; i < table->count; i++) {
+    if(memcmp(table->macs[i], mac, MAC_SIZE) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+// Path can be sent as node indices only if every hop is in the table
+static bool PathIndexable(const message_t *packet, const wire_node_table_t *table) {
+  if(table == NULL || packet->Path_Length == 0) {
+    return false;
+  }
+  for(int i = 0; i < packet->Path_Length; i++) {
+    if(NodeIndex(table, packet->Path_Array[i]) < 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static size_t TextLength(const message_t *packet) {
+  return packet->Text_Length > WIRE_MAX_TEXT ? WIRE_MAX_TEXT : packet->Text_Length;
+}
+
+static uint8_t ClampByte(int value) {
+  if(value < 0) {
+    return 0;
+  }
+  return value > 0xFF ? 0xFF : (uint8_t)value;
+}
+
+static uint8_t Flags(const message_t *packet, bool indexed) {
+  uint8_t flags = 0;
+  if(packet->broadcast_Ack) flags |= WIRE_FLAG_BROADCAST_ACK;
+  if(packet->Data_Ack) flags |= WIRE_FLAG_DATA_ACK;
+  if(packet->Path_Exist) flags |= WIRE_FLAG_PATH_EXIST;
+  if(indexed) flags |= WIRE_FLAG_PATH_INDEXED;
+  if(packet->Reliable) flags |= WIRE_FLAG_RELIABLE;
+  if(packet->Routed) flags |= WIRE_FLAG_ROUTED;
+  if(packet->New_Session) flags |= WIRE_FLAG_NEW_SESSION;
+  return flags;
+}
+
+size_t EncodedSize(const message_t *packet, const wire_node_table_t *table) {
+  bool indexed = PathIndexable(packet, table);
+  size_t ack_block = WIRE_HAS_ACK_BLOCK(Flags(packet, indexed)) ? WIRE_ACK_BLOCK_SIZE : 0;
+  return WIRE_HEADER_SIZE + TextLength(packet) + packet->Path_Length * (indexed ? 1 : MAC_SIZE) + ack_block;
+}
+
+size_t EncodeMessage(const message_t *packet, const wire_node_table_t *table, uint8_t *out, size_t cap) {
+  if(packet->Path_Length > MAX_NODES || packet->Path_Index > packet->Path_Length || packet->Path_Index >= MAX_NODES) {
+    return 0; // No receiver would take it
+  }
+
+  bool indexed = PathIndexable(packet, table);
+  uint8_t flags = Flags(packet, indexed);
+  size_t text_len = TextLength(packet);
+  size_t size = EncodedSize(packet, table);
+  if(size > cap || size > WIRE_MAX_FRAME) {
+    return 0;
+  }
+
+  uint32_t id = (uint32_t)packet->packetID;
+  out[WIRE_OFF_VERSION] = WIRE_VERSION;
+  out[WIRE_OFF_FLAGS] = flags;
+  out[WIRE_OFF_IDENTIFICATION] = ClampByte(packet->identification);
+  out[WIRE_OFF_TTL] = ClampByte(packet->TTL);
+  out[WIRE_OFF_PACKET_ID + 0] = (uint8_t)(id);
+  out[WIRE_OFF_PACKET_ID + 1] = (uint8_t)(id >> 8);
+  out[WIRE_OFF_PACKET_ID + 2] = (uint8_t)(id >> 16);
+  out[WIRE_OFF_PACKET_ID + 3] = (uint8_t)(id >> 24);
+  memcpy(out + WIRE_OFF_DEST, packet->destination_mac, MAC_SIZE);
+  memcpy(out + WIRE_OFF_SOURCE, packet->source_mac, MAC_SIZE);
+  out[WIRE_OFF_PATH_INDEX] = packet->Path_Index;
+  out[WIRE_OFF_PATH_LENGTH] = packet->Path_Length;
+  out[WIRE_OFF_TEXT_LENGTH] = (uint8_t)text_len;
+  out[WIRE_OFF_SEQ] = (uint8_t)packet->seq;
+  out[WIRE_OFF_SEQ + 1] = (uint8_t)(packet->seq >> 8);
+
+  uint8_t *p = out + WIRE_HEADER_SIZE;
+  memcpy(p, packet->text, text_len);
+  p += text_len;
+
+  // Only the hops actually on the path go on air
+  for(int i = 0; i < packet->Path_Length; i++) {
+    if(indexed) {
+      *p++ = (uint8_t)NodeIndex(table, packet->Path_Array[i]);
+    } else {
+      memcpy(p, packet->Path_Array[i], MAC_SIZE);
+      p += MAC_SIZE;
+    }
+  }
+
+  if(WIRE_HAS_ACK_BLOCK(flags)) {
+    *p++ = (uint8_t)packet->ack_seq;
+    *p++ = (uint8_t)(packet->ack_seq >> 8);
+    for(int i = 0; i < 4; i++) {
+      *p++ = (uint8_t)(packet->sack >> (8 * i));
+    }
+  }
+
+  return size;
+}
+
+bool DecodeMessage(const uint8_t *data, size_t len, const wire_node_table_t *table, message_t *packet) {
+  MessageView view(data, (int)len);
+  if(!view.Valid()) {
+    return false;
+  }
+
+  uint8_t flags = view.Flags();
+  uint8_t text_len = view.TextLength();
+  uint8_t path_len = view.PathLength();
+
+  // Everything but the text is reset; the text is only ever read up to Text_Length or its NUL
+  memset((uint8_t *)packet + offsetof(message_t, Text_Length), 0, sizeof(*packet) - offsetof(message_t, Text_Length));
+  packet->identification = view.Identification();
+  packet->TTL = view.TTL();
+  packet->packetID = view.PacketID();
+  packet->broadcast_Ack = (flags & WIRE_FLAG_BROADCAST_ACK) != 0;
+  packet->Data_Ack = (flags & WIRE_FLAG_DATA_ACK) != 0;
+  packet->Path_Exist = (flags & WIRE_FLAG_PATH_EXIST) != 0;
+  packet->Reliable = (flags & WIRE_FLAG_RELIABLE) != 0;
+  packet->Routed = (flags & WIRE_FLAG_ROUTED) != 0;
+  packet->New_Session = (flags & WIRE_FLAG_NEW_SESSION) != 0;
+  packet->seq = view.Seq();
+  memcpy(packet->destination_mac, view.DestinationMac(), MAC_SIZE);
+  memcpy(packet->source_mac, view.SourceMac(), MAC_SIZE);
+  packet->Path_Index = view.PathIndex();
+  packet->Path_Length = path_len;
+
+  const uint8_t *p = data + WIRE_HEADER_SIZE;
+  memcpy(packet->text, p, text_len);
+  packet->text[text_len] = 0; // Null terminated, text_len <= WIRE_MAX_TEXT
+  packet->Text_Length = text_len;
+  p += text_len;
+
+  for(int i = 0; i < path_len; i++) {
+    if(flags & WIRE_FLAG_PATH_INDEXED) {
+      if(table == NULL || *p >= table->count) {
+        return false; // Sender knows a node we don't
+      }
+      memcpy(packet->Path_Array[i], table->macs[*p], MAC_SIZE);
+      p++;
+    } else {
+      memcpy(packet->Path_Array[i], p, MAC_SIZE);
+      p += MAC_SIZE;
+    }
+  }
+
+  if(WIRE_HAS_ACK_BLOCK(flags)) {
+    packet->ack_seq = p[0] | (p[1] << 8);
+    packet->sack = (uint32_t)p[2] | ((uint32_t)p[3] << 8) | ((uint32_t)p[4] << 16) | ((uint32_t)p[5] << 24);
+  }
+
+  return true;
+}
@@ -0,0 +1,248 @@
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include "alloc_check.h"
+#include "fake_hal.h"
+#include "mesh_node.h"
+
+#define ALLOC_AIR_FRAMES 64 // Frames in flight on the medium at once
+#define ALLOC_MAX_NODES 16
+#define ALLOC_MESSAGE_MS 20 // Gap between reliable messages
+#define ALLOC_BUFFER_MS 500 // Gap between buffers
+#define ALLOC_BUFFER_BYTES 1000
+
+static std::atomic<bool> counting(false);
+static std::atomic<uint32_t> allocations(0);
+
+static void CountAllocation() {
+  if(counting.load(std::memory_order_relaxed)) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+// malloc() is counted where no sanitizer owns it, operator new everywhere else
+#if defined(__GLIBC__) && !defined(__SANITIZE_ADDRESS__) && !defined(__SANITIZE_THREAD__)
+#define ALLOC_TRACK_MALLOC 1
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *p, size_t size);
+
+void *malloc(size_t size) {
+  CountAllocation();
+  return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) {
+  CountAllocation();
+  return __libc_calloc(count, size);
+}
+
+void *realloc(void *p, size_t size) {
+  CountAllocation();
+  return __libc_realloc(p, size);
+}
+}
+#else
+#define ALLOC_TRACK_MALLOC 0
+#endif
+
+// The array and nothrow forms go through these two
+void *operator new(size_t size) {
+  if(!ALLOC_TRACK_MALLOC) {
+    CountAllocation();
+  }
+  void *p = malloc(size ? size : 1);
+  if(p == NULL) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+// GCC flags free() on pointers it saw come from new, which is exactly what replacing both does
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void operator delete(void *p) noexcept {
+  free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+  operator delete(p);
+}
+
+/* FIXED MEDIUM */
+// FakeAir without the heap: a ring of frames, delivered to linked radios in order
+class FixedAir : public RadioMedium {
+public:
+  FixedAir() : count(0), head(0), used(0), frames_sent(0) { memset(links, 0, sizeof(links)); }
+
+  void Attach(FakeRadio *radio) {
+    if(count < ALLOC_MAX_NODES) {
+      radios[count++] = radio;
+    }
+  }
+
+  void Link(int a, int b) { links[a][b] = links[b][a] = true; }
+
+  void Transmit(FakeRadio *from, const uint8_t *to, const uint8_t *data, size_t len) {
+    if(used == ALLOC_AIR_FRAMES || len > WIRE_MAX_FRAME) {
+      from->Sent(to, false); // Lost, the sender still hears about it
+      return;
+    }
+    frame_t *frame = &frames[(head + used++) % ALLOC_AIR_FRAMES];
+    frame->from = IndexOf(from);
+    memcpy(frame->to, to, MAC_SIZE);
+    memcpy(frame->data, data, len);
+    frame->len = len;
+    frames_sent++;
+  }
+
+  // Every frame queued so far. Frames sent by receivers wait for the next call
+  void Deliver() {
+    static const uint8_t broadcast[MAC_SIZE] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+    for(int n = used; n > 0; n--) {
+      frame_t frame = frames[head];
+      head = (head + 1) % ALLOC_AIR_FRAMES;
+      used--;
+
+      FakeRadio *from = radios[frame.from];
+      bool to_all = memcmp(frame.to, broadcast, MAC_SIZE) == 0;
+      bool acked = false;
+      for(int i = 0; i < count; i++) {
+        if(i != frame.from && links[frame.from][i] && (to_all || memcmp(radios[i]->Address(), frame.to, MAC_SIZE) == 0)) {
+          radios[i]->Receive(from->Address(), frame.data, (int)frame.len);
+          acked = true;
+        }
+      }
+      from->Sent(frame.to, to_all || acked);
+    }
+  }
+
+  uint32_t FramesSent() const { return frames_sent; }
+
+private:
+  struct frame_t {
+    int from;
+    uint8_t to[MAC_SIZE];
+    uint8_t data[WIRE_MAX_FRAME];
+    size_t len;
+  };
+
+  int IndexOf(const FakeRadio *radio) const {
+    for(int i = 0; i < count; i++) {
+      if(radios[i] == radio) {
+        return i;
+      }
+    }
+    return 0;
+  }
+
+  FakeRadio *radios[ALLOC_MAX_NODES];
+  bool links[ALLOC_MAX_NODES][ALLOC_MAX_NODES];
+  int count;
+  frame_t frames[ALLOC_AIR_FRAMES];
+  int head;
+  int used;
+  uint32_t frames_sent;
+};
+
+static void AllocMac(int index, uint8_t *mac) {
+  static const uint8_t base[MAC_SIZE] = {0x02, 0xA1, 0x10, 0x00, 0x00, 0x00};
+  memcpy(mac, base, MAC_SIZE);
+  mac[5] = (uint8_t)(index + 1);
+}
+
+static void CountDelivery(void *ctx, const message_t *packet) {
+  (void)packet;
+  ++*(int *)ctx;
+}
+
+static void CountBuffer(void *ctx, const uint8_t *source, const uint8_t *data, size_t len) {
+  (void)source;
+  (void)data;
+  if(len == ALLOC_BUFFER_BYTES) {
+    ++*(int *)ctx;
+  }
+}
+
+alloc_report_t RunAllocCheck(const alloc_config_t &config) {
+  alloc_report_t report;
+  memset(&report, 0, sizeof(report));
+  report.tracked = ALLOC_TRACK_MALLOC;
+  int nodes = config.nodes < 2 ? 2 : (config.nodes > ALLOC_MAX_NODES ? ALLOC_MAX_NODES : config.nodes);
+
+  allocations.store(0);
+  counting.store(true);
+
+  // Everything the run needs, allocated up front like the firmware's globals
+  FixedAir air;
+  FakeClock *clocks[ALLOC_MAX_NODES];
+  FakeRadio *radios[ALLOC_MAX_NODES];
+  RamFlash *flashes[ALLOC_MAX_NODES];
+  ConsoleLogger *logs[ALLOC_MAX_NODES];
+  MeshNode *meshes[ALLOC_MAX_NODES];
+  for(int i = 0; i < nodes; i++) {
+    uint8_t mac[MAC_SIZE];
+    AllocMac(i, mac);
+    clocks[i] = new FakeClock(0x51ED + i);
+    radios[i] = new FakeRadio(air, mac);
+    flashes[i] = new RamFlash(MESH_FLASH_SIZE);
+    logs[i] = new ConsoleLogger("", false);
+    meshes[i] = new MeshNode(*radios[i], *clocks[i], *flashes[i], *logs[i], NULL);
+    meshes[i]->Begin();
+  }
+  for(int i = 0; i + 1 < nodes; i++) {
+    uint8_t mac[MAC_SIZE];
+    air.Link(i, i + 1);
+    AllocMac(i + 1, mac);
+    meshes[i]->Add_Peer(mac);
+    meshes[i]->SwitchToEncryption(mac);
+    AllocMac(i, mac);
+    meshes[i + 1]->Add_Peer(mac);
+    meshes[i + 1]->SwitchToEncryption(mac);
+  }
+  meshes[nodes - 1]->SetDeliveryHandler(CountDelivery, &report.delivered);
+  meshes[nodes - 1]->SetBufferHandlers(CountBuffer, NULL, &report.buffers_delivered);
+
+  static uint8_t buffer[ALLOC_BUFFER_BYTES];
+  for(size_t i = 0; i < sizeof(buffer); i++) {
+    buffer[i] = (uint8_t)(i * 31);
+  }
+  uint8_t last[MAC_SIZE];
+  AllocMac(nodes - 1, last);
+
+  report.setup_allocs = allocations.exchange(0);
+  for(uint32_t now = 0; now < config.warmup_ms + config.run_ms; now++) {
+    if(now == config.warmup_ms) {
+      report.warmup_allocs = allocations.exchange(0);
+    }
+    for(int i = 0; i < nodes; i++) {
+      clocks[i]->Set(now);
+    }
+    if(now >= config.warmup_ms && now % ALLOC_MESSAGE_MS == 0) {
+      report.sent += meshes[0]->Send_Reliable("steady state", last);
+    }
+    if(now >= config.warmup_ms && now % ALLOC_BUFFER_MS == 0) {
+      report.buffers_sent += meshes[0]->Send_Buffer(buffer, sizeof(buffer), last) >= 0;
+    }
+    air.Deliver();
+    for(int i = 0; i < nodes; i++) {
+      meshes[i]->Poll();
+    }
+  }
+  report.steady_allocs = allocations.exchange(0);
+  counting.store(false);
+  report.frames = air.FramesSent();
+
+  for(int i = 0; i < nodes; i++) {
+    delete meshes[i];
+    delete logs[i];
+    delete flashes[i];
+    delete radios[i];
+    delete clocks[i];
+  }
+  return report;
+}
@@ -0,0 +1,33 @@
+#ifndef ALLOC_CHECK_H
+#define ALLOC_CHECK_H
+
+#include <cstdint>
+
+typedef struct alloc_config {
+  int nodes; // In a line
+  uint32_t warmup_ms; // Routes converge, windows open; allocations here are not counted
+  uint32_t run_ms; // Counted part
+} alloc_config_t;
+
+typedef struct alloc_report {
+  uint32_t setup_allocs; // Constructors, Begin(), peers: allowed
+  uint32_t warmup_allocs;
+  uint32_t steady_allocs; // Must be 0
+  uint32_t tracked; // false -> only operator new was counted (sanitizer builds own malloc)
+  int sent;
+  int delivered;
+  int buffers_sent;
+  int buffers_delivered;
+  uint32_t frames;
+} alloc_report_t;
+
+/* HEAP USE IN STEADY STATE */
+// Runs a line of nodes on a fixed-capacity medium with a manual clock, so nothing but
+// the mesh core can allocate, and counts every malloc()/operator new from the first
+// Poll() after warm-up on: reliable messages and fragmented buffers end to end, with
+// forwarding, acks, retransmissions and route updates on the way. Anything above zero
+// means a hot path went back to the heap. Lives with test_alloc, the only build whose
+// malloc() and operator new it replaces.
+alloc_report_t RunAllocCheck(const alloc_config_t &config);
+
+#endif
@@ -0,0 +1,40 @@
+#include <unity.h>
+#include "alloc_check.h"
+
+#define ALLOC_WARMUP_MS 10000
+#define ALLOC_RUN_MS 30000
+
+static void Check(int nodes) {
+  alloc_config_t config;
+  config.nodes = nodes;
+  config.warmup_ms = ALLOC_WARMUP_MS;
+  config.run_ms = ALLOC_RUN_MS;
+  alloc_report_t r = RunAllocCheck(config);
+
+  TEST_ASSERT_TRUE(r.setup_allocs > 0); // The hooks are live: constructors and Begin() allocate
+  TEST_ASSERT_EQUAL(0, r.steady_allocs);
+  TEST_ASSERT_TRUE(r.sent > 0);
+  TEST_ASSERT_EQUAL(r.sent, r.delivered);
+  TEST_ASSERT_TRUE(r.buffers_sent > 0);
+  TEST_ASSERT_EQUAL(r.buffers_sent, r.buffers_delivered);
+}
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+static void test_two_nodes(void) {
+  Check(2);
+}
+
+// Relays forward, ack and retransmit for others too
+static void test_line_of_relays(void) {
+  Check(8);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_two_nodes);
+  RUN_TEST(test_line_of_relays);
+  return UNITY_END();
+}
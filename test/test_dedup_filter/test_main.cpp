@@ -0,0 +1,99 @@
+#include <cstring>
+#include <unity.h>
+#include "dedup_filter.h"
+
+static DedupFilter filter;
+
+static const uint8_t source_a[MAC_SIZE] = {0x24, 0x6F, 0x28, 0x01, 0x02, 0x03};
+static const uint8_t source_b[MAC_SIZE] = {0x24, 0x6F, 0x28, 0x0A, 0x0B, 0x0C};
+
+void setUp(void) {
+  filter.Clear();
+}
+
+void tearDown(void) {}
+
+static void test_second_sighting_is_duplicate(void) {
+  TEST_ASSERT_FALSE(filter.CheckAndInsert(source_a, 1234, 0));
+  TEST_ASSERT_TRUE(filter.CheckAndInsert(source_a, 1234, 10));
+  TEST_ASSERT_TRUE(filter.CheckAndInsert(source_a, 1234, 20));
+  TEST_ASSERT_EQUAL(3, filter.Stats().lookups);
+  TEST_ASSERT_EQUAL(2, filter.Stats().duplicates);
+}
+
+static void test_sources_are_independent(void) {
+  TEST_ASSERT_FALSE(filter.CheckAndInsert(source_a, 77, 0));
+  TEST_ASSERT_FALSE(filter.CheckAndInsert(source_b, 77, 0));
+  TEST_ASSERT_TRUE(filter.CheckAndInsert(source_b, 77, 1));
+  TEST_ASSERT_TRUE(filter.CheckAndInsert(source_a, 77, 1));
+}
+
+// Copies arrive over different paths, so a later packet often overtakes an earlier one
+static void test_reordered_copies(void) {
+  const int count = DEDUP_SLOTS / 2;
+  for(int i = 0; i < count; i++) {
+    TEST_ASSERT_FALSE(filter.CheckAndInsert(source_a, 1000 + i * 7919, i));
+  }
+  TEST_ASSERT_EQUAL(0, filter.Stats().evictions);
+
+  // Second copies in reverse, then interleaved with new packets out of order
+  for(int i = count - 1; i >= 0; i--) {
+    TEST_ASSERT_TRUE(filter.CheckAndInsert(source_a, 1000 + i * 7919, 100 + i));
+  }
+  TEST_ASSERT_FALSE(filter.CheckAndInsert(source_b, 9, 200));
+  TEST_ASSERT_FALSE(filter.CheckAndInsert(source_b, 3, 201));
+  TEST_ASSERT_TRUE(filter.CheckAndInsert(source_a, 1000, 202));
+  TEST_ASSERT_TRUE(filter.CheckAndInsert(source_b, 9, 203));
+  TEST_ASSERT_TRUE(filter.CheckAndInsert(source_b, 3, 204));
+  TEST_ASSERT_EQUAL(count + 3, filter.Stats().duplicates);
+}
+
+// IDs are random, so neighbours across the 32-bit wrap are unrelated packets
+static void test_packet_id_wraparound(void) {
+  TEST_ASSERT_FALSE(filter.CheckAndInsert(source_a, 0xFFFFFFFFu, 0));
+  TEST_ASSERT_FALSE(filter.CheckAndInsert(source_a, 0, 0));
+  TEST_ASSERT_TRUE(filter.CheckAndInsert(source_a, 0xFFFFFFFFu, 1));
+  TEST_ASSERT_TRUE(filter.CheckAndInsert(source_a, 0, 1));
+}
+
+static void test_entries_expire(void) {
+  TEST_ASSERT_FALSE(filter.CheckAndInsert(source_a, 42, 1000));
+  TEST_ASSERT_TRUE(filter.CheckAndInsert(source_a, 42, 1000 + DEDUP_LIFETIME_MS - 1));
+  TEST_ASSERT_FALSE(filter.CheckAndInsert(source_a, 42, 1000 + DEDUP_LIFETIME_MS));
+}
+
+// millis() wraps after 49.7 days; ages are unsigned differences, so an entry seen just
+// before the wrap stays a duplicate just after it and expires on time
+static void test_clock_wraparound(void) {
+  uint32_t seen = 0xFFFFFFFFu - 500;
+  TEST_ASSERT_FALSE(filter.CheckAndInsert(source_a, 5, seen));
+  TEST_ASSERT_TRUE(filter.CheckAndInsert(source_a, 5, seen + 1000)); // Wrapped to 499
+  TEST_ASSERT_TRUE(filter.CheckAndInsert(source_a, 5, seen + DEDUP_LIFETIME_MS - 1));
+  TEST_ASSERT_FALSE(filter.CheckAndInsert(source_a, 5, seen + DEDUP_LIFETIME_MS));
+
+  // Inserted after the wrap, not mistaken for expired against a pre-wrap clock
+  TEST_ASSERT_FALSE(filter.CheckAndInsert(source_b, 6, 10));
+  TEST_ASSERT_TRUE(filter.CheckAndInsert(source_b, 6, 20));
+}
+
+// A packet storm evicts the oldest entries, never grows, and keeps the newest
+static void test_bounded_under_load(void) {
+  for(uint32_t i = 0; i < 20000; i++) {
+    TEST_ASSERT_FALSE(filter.CheckAndInsert(source_a, 0x10000 + i, i / 10));
+  }
+  TEST_ASSERT_TRUE(filter.Stats().evictions > 0);
+  TEST_ASSERT_EQUAL(sizeof(dedup_entry_t) * DEDUP_SLOTS, DedupFilter::MemoryBytes());
+  TEST_ASSERT_TRUE(filter.CheckAndInsert(source_a, 0x10000 + 19999, 2000));
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_second_sighting_is_duplicate);
+  RUN_TEST(test_sources_are_independent);
+  RUN_TEST(test_reordered_copies);
+  RUN_TEST(test_packet_id_wraparound);
+  RUN_TEST(test_entries_expire);
+  RUN_TEST(test_clock_wraparound);
+  RUN_TEST(test_bounded_under_load);
+  return UNITY_END();
+}
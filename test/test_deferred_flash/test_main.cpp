@@ -0,0 +1,180 @@
+#include <cstring>
+#include <unity.h>
+#include "deferred_flash.h"
+#include "fake_hal.h"
+#include "mesh_task.h"
+
+#define IMAGE_SIZE 256
+#define INTERVAL_MS 1000
+
+// RamFlash whose commits can be made to fail
+class FailingFlash : public RamFlash {
+public:
+  FailingFlash(size_t size) : RamFlash(size), fail(false) {}
+  bool Commit() { return !fail && RamFlash::Commit(); }
+  bool fail;
+};
+
+static FakeClock *fake_clock;
+static FailingFlash *ram;
+static DeferredFlash *flash;
+
+static void Update(size_t addr, uint8_t value) {
+  flash->Write(addr, value);
+  TEST_ASSERT_TRUE(flash->Commit());
+}
+
+void setUp(void) {
+  fake_clock = new FakeClock(1);
+  ram = new FailingFlash(IMAGE_SIZE);
+  flash = new DeferredFlash(*ram, *fake_clock, INTERVAL_MS);
+}
+
+void tearDown(void) {
+  delete flash;
+  delete ram;
+  delete fake_clock;
+}
+
+// Commit() only marks the update; flash sees it once it has waited the interval
+static void test_commit_is_deferred(void) {
+  Update(10, 0x42);
+  TEST_ASSERT_EQUAL(0x42, flash->Read(10)); // Reads see the RAM image at once
+  TEST_ASSERT_TRUE(flash->Pending());
+  fake_clock->Advance(INTERVAL_MS - 1);
+  TEST_ASSERT_TRUE(flash->Flush());
+  TEST_ASSERT_EQUAL(0, ram->Commits());
+
+  fake_clock->Advance(1);
+  TEST_ASSERT_TRUE(flash->Flush());
+  TEST_ASSERT_EQUAL(1, ram->Commits());
+  TEST_ASSERT_FALSE(flash->Pending());
+  TEST_ASSERT_TRUE(flash->Flush());
+  TEST_ASSERT_EQUAL(1, ram->Commits()); // Nothing new
+}
+
+// A burst of updates costs one flash commit, timed from the first of them
+static void test_commits_coalesce(void) {
+  for(int i = 0; i < 10; i++) {
+    Update(20 + i * 10, (uint8_t)i);
+    fake_clock->Advance(INTERVAL_MS / 20);
+    flash->Flush();
+  }
+  TEST_ASSERT_EQUAL(0, ram->Commits());
+  fake_clock->Advance(INTERVAL_MS / 2);
+  flash->Flush();
+  TEST_ASSERT_EQUAL(1, ram->Commits());
+
+  const flash_stats_t &stats = flash->Stats();
+  TEST_ASSERT_EQUAL(10, stats.requests);
+  TEST_ASSERT_EQUAL(1, stats.commits);
+  TEST_ASSERT_EQUAL(10, stats.bytes_changed);
+  TEST_ASSERT_EQUAL(9 * 10 + 1, stats.bytes_flushed); // One span from the first byte to the last
+}
+
+// Writes that leave the image as it is give Flush() nothing to do
+static void test_unchanged_writes(void) {
+  Update(5, 0xFF); // Already erased
+  TEST_ASSERT_FALSE(flash->Pending());
+  Update(5, 0x01);
+  flash->Flush(true);
+  Update(5, 0x01);
+  TEST_ASSERT_FALSE(flash->Pending());
+  TEST_ASSERT_EQUAL(1, ram->Commits());
+  TEST_ASSERT_EQUAL(2, flash->Stats().bytes_unchanged);
+  TEST_ASSERT_EQUAL(3, flash->Stats().requests);
+}
+
+static void test_force_flush(void) {
+  TEST_ASSERT_TRUE(flash->Flush(true));
+  TEST_ASSERT_EQUAL(0, ram->Commits()); // Forced, but nothing pending
+  Update(1, 0x11);
+  TEST_ASSERT_TRUE(flash->Flush(true));
+  TEST_ASSERT_EQUAL(1, ram->Commits());
+  TEST_ASSERT_FALSE(flash->Pending());
+}
+
+// A failed commit keeps the update and tries again one interval later
+static void test_failed_commit_retried(void) {
+  Update(30, 0x33);
+  fake_clock->Advance(INTERVAL_MS);
+  ram->fail = true;
+  TEST_ASSERT_FALSE(flash->Flush());
+  TEST_ASSERT_TRUE(flash->Pending());
+  TEST_ASSERT_EQUAL(1, flash->Stats().failures);
+
+  ram->fail = false;
+  fake_clock->Advance(INTERVAL_MS / 2);
+  flash->Flush();
+  TEST_ASSERT_EQUAL(0, ram->Commits());
+  fake_clock->Advance(INTERVAL_MS / 2);
+  TEST_ASSERT_TRUE(flash->Flush());
+  TEST_ASSERT_EQUAL(1, ram->Commits());
+  TEST_ASSERT_FALSE(flash->Pending());
+}
+
+typedef struct task_run {
+  MeshTask *task;
+  ThreadSignal *signal;
+  int iterations;
+  uint32_t commits[4]; // ram->Commits() seen by the work function, before each Poll()
+} task_run_t;
+
+// Iteration 0 updates the image, 1 waits out the interval, 2 updates again and stops the task
+static void Work(void *ctx, MeshNode &node) {
+  task_run_t *run = (task_run_t *)ctx;
+  run->commits[run->iterations] = ram->Commits();
+  if(run->iterations == 0 || run->iterations == 2) {
+    Update(100 + run->iterations, 0x55);
+  }
+  if(run->iterations == 1) {
+    fake_clock->Advance(INTERVAL_MS);
+  }
+  if(run->iterations == 2) {
+    run->task->Stop();
+  }
+  run->iterations++;
+  run->signal->Notify(); // Next iteration without the tick
+}
+
+// The mesh task flushes after Poll() once an update is due, and everything on Stop()
+static void test_mesh_task_flushes(void) {
+  const uint8_t mac[MAC_SIZE] = {0x24, 0x6F, 0x28, 0x00, 0x00, 0x01};
+  FakeAir air;
+  FakeRadio radio(air, mac);
+  ConsoleLogger log("", false);
+  MeshNode node(radio, *fake_clock, *flash, log, NULL);
+  node.Begin();
+  flash->Flush(true); // Route store formatted on blank flash
+  uint32_t formatted = ram->Commits();
+
+  ThreadSignal signal;
+  MeshTask task(node, signal);
+  task_run_t run;
+  memset(&run, 0, sizeof(run));
+  run.task = &task;
+  run.signal = &signal;
+  task.SetWork(Work, &run);
+  task.SetFlash(flash);
+  TEST_ASSERT_FALSE(task.Stopped());
+  task.Run();
+
+  TEST_ASSERT_TRUE(task.Stopped());
+  TEST_ASSERT_EQUAL(3, run.iterations);
+  TEST_ASSERT_EQUAL(formatted, run.commits[1]); // Not due after the first Poll()
+  TEST_ASSERT_EQUAL(formatted + 1, run.commits[2]); // Due after the second
+  TEST_ASSERT_EQUAL(formatted + 2, ram->Commits()); // Stop() flushed the last update at once
+  TEST_ASSERT_FALSE(flash->Pending());
+  TEST_ASSERT_EQUAL(0x55, ram->Read(102));
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_commit_is_deferred);
+  RUN_TEST(test_commits_coalesce);
+  RUN_TEST(test_unchanged_writes);
+  RUN_TEST(test_force_flush);
+  RUN_TEST(test_failed_commit_retried);
+  RUN_TEST(test_mesh_task_flushes);
+  return UNITY_END();
+}
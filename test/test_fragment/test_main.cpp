@@ -0,0 +1,242 @@
+#include <cstring>
+#include <unity.h>
+#include "fragment.h"
+
+#define LINK_FRAMES 64 // Frames in the air at once, either direction
+#define BUFFER_BYTES (10 * FRAG_CHUNK + 17) // Eleven fragments, the last one short
+#define POLL_MS 10
+
+static const uint8_t sender_mac[MAC_SIZE] = {0x24, 0x6F, 0x28, 0x00, 0x00, 0x01};
+static const uint8_t receiver_mac[MAC_SIZE] = {0x24, 0x6F, 0x28, 0x00, 0x00, 0x02};
+
+typedef struct link_frame {
+  uint8_t payload[FRAG_HEADER_SIZE + FRAG_CHUNK];
+  size_t len;
+  bool ack;
+  bool to_receiver;
+} link_frame_t;
+
+// Lossless link that loses what the test tells it to; frames arrive on Deliver()
+typedef struct link {
+  link_frame_t frames[LINK_FRAMES];
+  int count;
+  uint32_t drop; // Bit i -> the next copy of fragment i is lost
+  int drop_acks; // Acks still to lose
+  bool refuse; // Transmit fails, as when the node has no packet free
+} link_t;
+
+static link_t link;
+static FragmentTransport *sender, *receiver;
+static uint8_t data[BUFFER_BYTES];
+static uint8_t received[FRAG_MAX_BYTES];
+static size_t received_len;
+static int done, delivered;
+
+// ctx is the MAC of the sending side
+static bool Transmit(void *ctx, const uint8_t *dest, const uint8_t *payload, size_t len, bool ack) {
+  if(link.refuse) {
+    return false;
+  }
+  bool to_receiver = memcmp(dest, receiver_mac, MAC_SIZE) == 0;
+  TEST_ASSERT_EQUAL(ctx == sender_mac, to_receiver);
+  if(ack && link.drop_acks > 0) {
+    link.drop_acks--;
+    return true;
+  }
+  if(!ack && (link.drop & (1u << payload[2])) != 0) {
+    link.drop &= ~(1u << payload[2]);
+    return true;
+  }
+  TEST_ASSERT_TRUE(link.count < LINK_FRAMES);
+  link_frame_t *frame = &link.frames[link.count++];
+  memcpy(frame->payload, payload, len);
+  frame->len = len;
+  frame->ack = ack;
+  frame->to_receiver = to_receiver;
+  return true;
+}
+
+static void OnReceive(void *ctx, const uint8_t *source, const uint8_t *buffer, size_t len) {
+  TEST_ASSERT_EQUAL_MEMORY(sender_mac, source, MAC_SIZE);
+  memcpy(received, buffer, len);
+  received_len = len;
+}
+
+static void OnDone(void *ctx, const uint8_t *dest, uint16_t transfer, bool ok) {
+  TEST_ASSERT_EQUAL_MEMORY(receiver_mac, dest, MAC_SIZE);
+  done++;
+  delivered += ok;
+}
+
+// Hand every frame in the air to its side
+static void Deliver(uint32_t now) {
+  static link_frame_t frames[LINK_FRAMES];
+  int count = link.count;
+  memcpy(frames, link.frames, sizeof(frames));
+  link.count = 0;
+  for(int i = 0; i < count; i++) {
+    if(frames[i].to_receiver) {
+      receiver->OnFrame(sender_mac, frames[i].payload, frames[i].len, frames[i].ack, now);
+    } else {
+      sender->OnFrame(receiver_mac, frames[i].payload, frames[i].len, frames[i].ack, now);
+    }
+  }
+}
+
+// Poll both sides every POLL_MS until the transfer is done or ms have passed
+static uint32_t Run(uint32_t now, uint32_t ms) {
+  for(uint32_t end = now + ms; now < end && done == 0; now += POLL_MS) {
+    sender->Poll(now);
+    receiver->Poll(now);
+    Deliver(now);
+    Deliver(now); // Answers to what just arrived
+  }
+  return now;
+}
+
+void setUp(void) {
+  memset(&link, 0, sizeof(link));
+  sender = new FragmentTransport(Transmit, (void *)sender_mac);
+  receiver = new FragmentTransport(Transmit, (void *)receiver_mac);
+  sender->SetHandlers(NULL, OnDone, NULL);
+  receiver->SetHandlers(OnReceive, NULL, NULL);
+  for(size_t i = 0; i < sizeof(data); i++) {
+    data[i] = (uint8_t)(i * 7 + i / 251);
+  }
+  memset(received, 0, sizeof(received));
+  received_len = 0;
+  done = 0;
+  delivered = 0;
+}
+
+void tearDown(void) {
+  delete sender;
+  delete receiver;
+}
+
+static void test_round_trip(void) {
+  TEST_ASSERT_TRUE(sender->Send(receiver_mac, data, sizeof(data), 0) >= 0);
+  TEST_ASSERT_EQUAL(1, sender->InFlight());
+  Run(0, 1000);
+
+  TEST_ASSERT_EQUAL(1, delivered);
+  TEST_ASSERT_EQUAL(0, sender->InFlight());
+  TEST_ASSERT_EQUAL(sizeof(data), received_len);
+  TEST_ASSERT_EQUAL_MEMORY(data, received, sizeof(data));
+  TEST_ASSERT_EQUAL(11, sender->Stats().fragments_sent);
+  TEST_ASSERT_EQUAL(0, sender->Stats().fragments_resent);
+  TEST_ASSERT_EQUAL(1, receiver->Stats().reassembled);
+  TEST_ASSERT_EQUAL(1, receiver->Stats().acks_sent); // Only the one for the complete buffer
+}
+
+static void test_too_big_or_busy(void) {
+  TEST_ASSERT_EQUAL(-1, sender->Send(receiver_mac, data, 0, 0));
+  static uint8_t big[FRAG_MAX_BYTES + 1];
+  TEST_ASSERT_EQUAL(-1, sender->Send(receiver_mac, big, sizeof(big), 0));
+  for(int i = 0; i < FRAG_TX_TRANSFERS; i++) {
+    TEST_ASSERT_TRUE(sender->Send(receiver_mac, data, 10, 0) >= 0);
+  }
+  TEST_ASSERT_EQUAL(-1, sender->Send(receiver_mac, data, 10, 0));
+}
+
+// The round's bitmap asks for exactly the lost fragments
+static void test_loss_resends_missing(void) {
+  link.drop = (1u << 2) | (1u << 5);
+  sender->Send(receiver_mac, data, sizeof(data), 0);
+  Run(0, 1000);
+
+  TEST_ASSERT_EQUAL(1, delivered);
+  TEST_ASSERT_EQUAL_MEMORY(data, received, sizeof(data));
+  TEST_ASSERT_EQUAL(13, sender->Stats().fragments_sent);
+  TEST_ASSERT_EQUAL(2, sender->Stats().fragments_resent);
+  TEST_ASSERT_EQUAL(2, receiver->Stats().acks_sent); // Bitmap after round one, then complete
+}
+
+// The last fragment carries the ack request: losing it, and then the ack, costs a timeout each
+static void test_lost_ack_request_and_ack(void) {
+  link.drop = 1u << 10;
+  sender->Send(receiver_mac, data, sizeof(data), 0);
+  uint32_t now = Run(0, FRAG_ACK_TIMEOUT_MS / 2);
+  TEST_ASSERT_EQUAL(0, done);
+  TEST_ASSERT_EQUAL(0, receiver->Stats().acks_sent); // Nothing asked for one yet
+
+  link.drop_acks = 1;
+  now = Run(now, FRAG_ACK_TIMEOUT_MS);
+  TEST_ASSERT_EQUAL(0, done);
+  TEST_ASSERT_EQUAL(1, receiver->Stats().reassembled); // Complete, but the sender does not know
+
+  Run(now, 2 * FRAG_ACK_TIMEOUT_MS);
+  TEST_ASSERT_EQUAL(1, delivered);
+  TEST_ASSERT_EQUAL(1, receiver->Stats().reassembled); // Repeats only re-ack
+  // No bitmap came back, so round two repeats all eleven; the re-ack ends round three after one burst
+  TEST_ASSERT_EQUAL(11 + FRAG_BURST, sender->Stats().fragments_resent);
+}
+
+static void test_gives_up(void) {
+  link.drop_acks = FRAG_MAX_ROUNDS;
+  sender->Send(receiver_mac, data, 10, 0);
+  Run(0, (FRAG_MAX_ROUNDS + 1) * (FRAG_ACK_TIMEOUT_MS + POLL_MS));
+  TEST_ASSERT_EQUAL(1, done);
+  TEST_ASSERT_EQUAL(0, delivered);
+  TEST_ASSERT_EQUAL(1, sender->Stats().failed);
+  TEST_ASSERT_EQUAL(FRAG_MAX_ROUNDS, sender->Stats().fragments_sent);
+}
+
+// A refused fragment stays queued and goes out once the node has packets again
+static void test_transmit_refused(void) {
+  link.refuse = true;
+  sender->Send(receiver_mac, data, sizeof(data), 0);
+  sender->Poll(0);
+  TEST_ASSERT_EQUAL(0, sender->Stats().fragments_sent);
+
+  link.refuse = false;
+  Run(POLL_MS, 1000);
+  TEST_ASSERT_EQUAL(1, delivered);
+  TEST_ASSERT_EQUAL(11, sender->Stats().fragments_sent);
+  TEST_ASSERT_EQUAL(0, sender->Stats().fragments_resent);
+  TEST_ASSERT_EQUAL_MEMORY(data, received, sizeof(data));
+}
+
+// A reassembly whose sender went away is dropped, and its slot serves the next transfer
+static void test_rx_timeout(void) {
+  uint8_t fragment[FRAG_HEADER_SIZE + FRAG_CHUNK] = {0x34, 0x12, 0, 2, 0};
+  receiver->OnFrame(sender_mac, fragment, sizeof(fragment), false, 100);
+  receiver->Poll(100 + FRAG_RX_TIMEOUT_MS);
+  TEST_ASSERT_EQUAL(0, receiver->Stats().expired);
+  receiver->Poll(101 + FRAG_RX_TIMEOUT_MS);
+  TEST_ASSERT_EQUAL(1, receiver->Stats().expired);
+
+  // The rest of the old transfer starts over and cannot complete on its own
+  fragment[2] = 1;
+  fragment[4] = FRAG_FLAG_ACK_REQUEST;
+  receiver->OnFrame(sender_mac, fragment, FRAG_HEADER_SIZE + 3, false, 200 + FRAG_RX_TIMEOUT_MS);
+  TEST_ASSERT_EQUAL(0, receiver->Stats().reassembled);
+  TEST_ASSERT_EQUAL(1, link.count); // Ack request answered with a bitmap of fragment 1 only
+  TEST_ASSERT_TRUE(link.frames[0].ack);
+  TEST_ASSERT_EQUAL(0x02, link.frames[0].payload[3]);
+}
+
+static void test_malformed(void) {
+  uint8_t fragment[FRAG_HEADER_SIZE + FRAG_CHUNK] = {0, 0, 3, 2, 0}; // Index past count
+  receiver->OnFrame(sender_mac, fragment, sizeof(fragment), false, 0);
+  fragment[2] = 0;
+  receiver->OnFrame(sender_mac, fragment, FRAG_HEADER_SIZE + 1, false, 0); // Short, not last
+  receiver->OnFrame(sender_mac, fragment, FRAG_HEADER_SIZE - 1, false, 0);
+  sender->OnFrame(receiver_mac, fragment, FRAG_ACK_SIZE - 1, true, 0);
+  TEST_ASSERT_EQUAL(3, receiver->Stats().malformed);
+  TEST_ASSERT_EQUAL(1, sender->Stats().malformed);
+  TEST_ASSERT_EQUAL(0, link.count);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_round_trip);
+  RUN_TEST(test_too_big_or_busy);
+  RUN_TEST(test_loss_resends_missing);
+  RUN_TEST(test_lost_ack_request_and_ack);
+  RUN_TEST(test_gives_up);
+  RUN_TEST(test_transmit_refused);
+  RUN_TEST(test_rx_timeout);
+  RUN_TEST(test_malformed);
+  return UNITY_END();
+}
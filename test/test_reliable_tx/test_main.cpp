@@ -0,0 +1,289 @@
+#include <cstdio>
+#include <cstring>
+#include <unity.h>
+#include "reliable_tx.h"
+
+#define LINK_DELAY_MS 20 // One way, so the RTT is 40 ms
+#define LINK_FRAMES 128 // Frames in the air at once, either direction
+#define RUN_MS 60000
+
+static const uint8_t sender_mac[MAC_SIZE] = {0x24, 0x6F, 0x28, 0x00, 0x00, 0x01};
+static const uint8_t receiver_mac[MAC_SIZE] = {0x24, 0x6F, 0x28, 0x00, 0x00, 0x02};
+
+typedef struct link_frame {
+  uint32_t arrive_at;
+  uint16_t seq; // Data
+  bool new_session;
+  uint16_t ack_seq; // Ack
+  uint32_t sack;
+  bool is_ack;
+  bool used;
+} link_frame_t;
+
+// Lossy point-to-point link with a fixed delay, the same loss rate each way
+typedef struct link {
+  link_frame_t frames[LINK_FRAMES];
+  uint32_t now;
+  uint32_t rng;
+  float loss;
+  uint32_t lost;
+} link_t;
+
+static link_t link;
+
+static bool Lose(link_t *l) {
+  l->rng ^= l->rng << 13;
+  l->rng ^= l->rng >> 17;
+  l->rng ^= l->rng << 5;
+  return (l->rng % 10000) < (uint32_t)(l->loss * 10000);
+}
+
+static void Put(link_t *l, const link_frame_t *frame) {
+  if(Lose(l)) {
+    l->lost++;
+    return;
+  }
+  for(int i = 0; i < LINK_FRAMES; i++) {
+    if(!l->frames[i].used) {
+      l->frames[i] = *frame;
+      l->frames[i].arrive_at = l->now + LINK_DELAY_MS;
+      l->frames[i].used = true;
+      return;
+    }
+  }
+  TEST_FAIL_MESSAGE("link full");
+}
+
+static bool SendData(const message_t *packet, void *ctx) {
+  link_frame_t frame;
+  memset(&frame, 0, sizeof(frame));
+  frame.seq = packet->seq;
+  frame.new_session = packet->New_Session;
+  Put((link_t *)ctx, &frame);
+  return true;
+}
+
+static bool NoTransmit(const message_t *packet, void *ctx) {
+  return true;
+}
+
+static ReliableTransport sender(SendData, &link);
+static ReliableTransport receiver(NoTransmit, NULL);
+
+void setUp(void) {}
+void tearDown(void) {}
+
+typedef struct run_result {
+  uint32_t delivered; // New packets handed up at the receiver
+  uint32_t duplicates; // Handed up twice, must stay 0
+  rtx_stats_t stats;
+} run_result_t;
+
+// Sender keeps at most window packets in flight for RUN_MS; the receiver acks every data frame
+static run_result_t Run(int window, float loss) {
+  static uint8_t delivered[1 << 16]; // Per seq, no wrap within RUN_MS
+  sender = ReliableTransport(SendData, &link);
+  receiver = ReliableTransport(NoTransmit, NULL);
+  memset(delivered, 0, sizeof(delivered));
+  memset(&link, 0, sizeof(link));
+  link.rng = 0x1234567u;
+  link.loss = loss;
+
+  run_result_t result;
+  memset(&result, 0, sizeof(result));
+  message_t packet;
+  memset(&packet, 0, sizeof(packet));
+  memcpy(packet.source_mac, sender_mac, MAC_SIZE);
+  memcpy(packet.destination_mac, receiver_mac, MAC_SIZE);
+  packet.packetID = 1000;
+
+  for(link.now = 0; link.now < RUN_MS; link.now++) {
+    while(sender.InFlight() < (size_t)window && sender.Send(&packet, link.now)) {
+    }
+    sender.Poll(link.now);
+
+    for(int i = 0; i < LINK_FRAMES; i++) {
+      link_frame_t *frame = &link.frames[i];
+      if(!frame->used || frame->arrive_at > link.now) {
+        continue;
+      }
+      frame->used = false;
+      if(frame->is_ack) {
+        sender.OnAck(receiver_mac, frame->ack_seq, frame->sack, link.now);
+        continue;
+      }
+      message_t data;
+      memset(&data, 0, sizeof(data));
+      memcpy(data.source_mac, sender_mac, MAC_SIZE);
+      data.seq = frame->seq;
+      data.New_Session = frame->new_session;
+      link_frame_t ack;
+      memset(&ack, 0, sizeof(ack));
+      ack.is_ack = true;
+      if(receiver.OnData(&data, &ack.ack_seq, &ack.sack)) {
+        result.delivered++;
+        result.duplicates += delivered[data.seq]++ > 0;
+      }
+      Put(&link, &ack);
+    }
+  }
+  result.stats = sender.Stats();
+  return result;
+}
+
+static double Goodput(const run_result_t &r) {
+  return r.delivered * 1000.0 / RUN_MS;
+}
+
+// Without loss the window is the only limit: throughput grows with it, nothing is resent
+static void test_lossless_goodput_scales_with_window(void) {
+  double previous = 0;
+  for(int window = 1; window <= RTX_WINDOW; window *= 2) {
+    run_result_t r = Run(window, 0);
+    printf("loss 0%%  window %d: %7.1f packets/s\n", window, Goodput(r));
+    TEST_ASSERT_EQUAL(0, r.stats.retransmits);
+    TEST_ASSERT_EQUAL(0, r.stats.failed);
+    TEST_ASSERT_EQUAL(0, r.duplicates);
+    TEST_ASSERT_TRUE(Goodput(r) > previous * 1.8);
+    previous = Goodput(r);
+  }
+  // One packet per RTT at window 1
+  TEST_ASSERT_INT_WITHIN(2, 1000 / (2 * LINK_DELAY_MS), (int)Goodput(Run(1, 0)));
+}
+
+// 20% loss each way: the window keeps the link busy while single losses are repaired
+static void test_lossy_goodput_scales_with_window(void) {
+  double goodput[RTX_WINDOW + 1];
+  for(int window = 1; window <= RTX_WINDOW; window *= 2) {
+    run_result_t r = Run(window, 0.2f);
+    goodput[window] = Goodput(r);
+    printf("loss 20%% window %d: %7.1f packets/s, %u retransmits, %u given up\n", window, goodput[window],
+           r.stats.retransmits, r.stats.failed);
+    TEST_ASSERT_EQUAL(0, r.duplicates);
+    TEST_ASSERT_TRUE(r.stats.retransmits > 0);
+    // Every packet is either acked, given up, or still in flight at the end
+    TEST_ASSERT_TRUE(r.stats.acked + r.stats.failed <= r.stats.sent);
+    TEST_ASSERT_TRUE(r.stats.sent - r.stats.acked - r.stats.failed <= (uint32_t)window);
+  }
+  TEST_ASSERT_TRUE(goodput[RTX_WINDOW] > 3 * goodput[1]);
+}
+
+// Selective acks: a lost data frame costs one retransmission, not the rest of the window
+static void test_single_loss_resends_one_packet(void) {
+  run_result_t r = Run(RTX_WINDOW, 0.02f);
+  TEST_ASSERT_EQUAL(0, r.duplicates);
+  // Retransmits are caused by lost data and lost acks; go-back-N would resend whole windows
+  TEST_ASSERT_TRUE(r.stats.retransmits <= link.lost);
+  TEST_ASSERT_TRUE(r.stats.rtt_samples > 0);
+  TEST_ASSERT_INT_WITHIN(2, 2 * LINK_DELAY_MS, (int)sender.SmoothedRtt(receiver_mac));
+}
+
+static bool Receive(uint8_t source, uint16_t seq, uint16_t *ack_seq, uint32_t *sack, bool new_session = false) {
+  message_t data;
+  memset(&data, 0, sizeof(data));
+  memcpy(data.source_mac, sender_mac, MAC_SIZE);
+  data.source_mac[0] = source;
+  data.seq = seq;
+  data.New_Session = new_session;
+  return receiver.OnData(&data, ack_seq, sack);
+}
+
+// True if the ack tells the sender seq arrived
+static bool Covers(uint16_t ack_seq, uint32_t sack, uint16_t seq) {
+  int diff = (int16_t)(seq - ack_seq);
+  return diff < 0 || (diff >= 1 && diff <= 32 && (sack & (1u << (diff - 1))));
+}
+
+// The first packet of a session overtook the one before it: both are new, and the ack
+// only covers what arrived
+static void test_reordered_session_start(void) {
+  receiver = ReliableTransport(NoTransmit, NULL);
+  uint16_t ack_seq;
+  uint32_t sack;
+  TEST_ASSERT_TRUE(Receive(1, 101, &ack_seq, &sack));
+  TEST_ASSERT_TRUE(Covers(ack_seq, sack, 101));
+  TEST_ASSERT_FALSE(Covers(ack_seq, sack, 100));
+  TEST_ASSERT_TRUE(Receive(1, 100, &ack_seq, &sack));
+  TEST_ASSERT_TRUE(Covers(ack_seq, sack, 100));
+  TEST_ASSERT_FALSE(Receive(1, 100, &ack_seq, &sack));
+  TEST_ASSERT_FALSE(Receive(1, 101, &ack_seq, &sack));
+}
+
+// A packet the sender gave up on never arrives; the window moves on without it
+static void test_given_up_packet_does_not_stall(void) {
+  receiver = ReliableTransport(NoTransmit, NULL);
+  uint16_t ack_seq;
+  uint32_t sack;
+  for(uint16_t seq = 0; seq < 100; seq++) {
+    if(seq != 5) {
+      TEST_ASSERT_TRUE(Receive(1, seq, &ack_seq, &sack));
+    }
+  }
+  TEST_ASSERT_EQUAL(100, ack_seq);
+  TEST_ASSERT_EQUAL(0, sack);
+}
+
+// More sources than receive windows: evicted sources restart their session, and packets
+// reordered around the restart are still delivered once
+static void test_more_sources_than_windows(void) {
+  receiver = ReliableTransport(NoTransmit, NULL);
+  uint16_t ack_seq;
+  uint32_t sack;
+  for(int round = 0; round < 10; round++) {
+    for(uint8_t source = 0; source <= RTX_PEERS; source++) {
+      uint16_t seq = (uint16_t)(1000 * source + 2 * round);
+      TEST_ASSERT_TRUE(Receive(source, seq + 1, &ack_seq, &sack));
+      TEST_ASSERT_TRUE(Receive(source, seq, &ack_seq, &sack));
+    }
+  }
+}
+
+static message_t last_sent;
+
+static bool Capture(const message_t *packet, void *ctx) {
+  last_sent = *packet;
+  return true;
+}
+
+// The sender flags the first window of a session, and again once an idle window is reused
+static void test_sender_flags_new_sessions(void) {
+  static ReliableTransport transport(Capture, NULL);
+  transport = ReliableTransport(Capture, NULL);
+  message_t packet;
+  memset(&packet, 0, sizeof(packet));
+  memcpy(packet.destination_mac, receiver_mac, MAC_SIZE);
+  packet.packetID = 500;
+  for(int i = 0; i < 3 * RTX_WINDOW; i++) {
+    TEST_ASSERT_TRUE(transport.Send(&packet, 0));
+    TEST_ASSERT_EQUAL(i < RTX_WINDOW, last_sent.New_Session);
+    transport.OnAck(receiver_mac, last_sent.seq + 1, 0, 1);
+  }
+}
+
+// The sender reused its window towards us and restarted at a seq just behind what we have:
+// without the flag that looks like a late duplicate and is acked but never handed up
+static void test_restarted_session_behind_the_window(void) {
+  receiver = ReliableTransport(NoTransmit, NULL);
+  uint16_t ack_seq;
+  uint32_t sack;
+  for(uint16_t seq = 2000; seq < 2020; seq++) {
+    TEST_ASSERT_TRUE(Receive(1, seq, &ack_seq, &sack, seq < 2000 + RTX_WINDOW));
+  }
+  TEST_ASSERT_TRUE(Receive(1, 1990, &ack_seq, &sack, true));
+  TEST_ASSERT_TRUE(Covers(ack_seq, sack, 1990));
+  TEST_ASSERT_TRUE(Receive(1, 1991, &ack_seq, &sack, true));
+  TEST_ASSERT_FALSE(Receive(1, 1990, &ack_seq, &sack, true));
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_lossless_goodput_scales_with_window);
+  RUN_TEST(test_lossy_goodput_scales_with_window);
+  RUN_TEST(test_single_loss_resends_one_packet);
+  RUN_TEST(test_reordered_session_start);
+  RUN_TEST(test_given_up_packet_does_not_stall);
+  RUN_TEST(test_more_sources_than_windows);
+  RUN_TEST(test_sender_flags_new_sessions);
+  RUN_TEST(test_restarted_session_behind_the_window);
+  return UNITY_END();
+}
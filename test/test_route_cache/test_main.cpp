@@ -0,0 +1,132 @@
+#include <cstring>
+#include <unity.h>
+#include "route_cache.h"
+
+static RouteCache cache;
+
+static const uint8_t self[MAC_SIZE] = {0x24, 0x6F, 0x28, 0x00, 0x00, 0x01};
+
+static void Mac(uint32_t n, uint8_t *mac) {
+  mac[0] = 0x24;
+  mac[1] = 0x6F;
+  mac[2] = (uint8_t)(n >> 24);
+  mac[3] = (uint8_t)(n >> 16);
+  mac[4] = (uint8_t)(n >> 8);
+  mac[5] = (uint8_t)n;
+}
+
+// Two-hop path from self to destination n over a relay
+static bool Insert(uint32_t n) {
+  uint8_t path[3][MAC_SIZE];
+  memcpy(path[0], self, MAC_SIZE);
+  Mac(0xFFFF0000u | (n & 0xFF), path[1]);
+  Mac(n, path[2]);
+  return cache.Insert(path, 3, n);
+}
+
+static bool Contains(uint32_t n) {
+  uint8_t mac[MAC_SIZE];
+  Mac(n, mac);
+  route_entry_t *route = cache.Lookup(mac);
+  return route != NULL && route->learned == n && memcmp(route->dest, mac, MAC_SIZE) == 0;
+}
+
+static bool Remove(uint32_t n) {
+  uint8_t mac[MAC_SIZE];
+  Mac(n, mac);
+  return cache.Remove(mac);
+}
+
+void setUp(void) {
+  cache.Clear();
+}
+
+void tearDown(void) {}
+
+static void test_insert_lookup_remove(void) {
+  TEST_ASSERT_TRUE(Insert(1));
+  TEST_ASSERT_TRUE(Insert(2));
+  TEST_ASSERT_TRUE(Contains(1));
+  TEST_ASSERT_TRUE(Contains(2));
+  TEST_ASSERT_FALSE(Contains(3));
+  TEST_ASSERT_TRUE(Remove(1));
+  TEST_ASSERT_FALSE(Remove(1));
+  TEST_ASSERT_FALSE(Contains(1));
+  TEST_ASSERT_TRUE(Contains(2));
+  TEST_ASSERT_EQUAL(1, cache.Count());
+}
+
+static void test_full_table(void) {
+  for(uint32_t n = 0; n < ROUTE_CACHE_SIZE; n++) {
+    TEST_ASSERT_TRUE(Insert(n));
+  }
+  TEST_ASSERT_FALSE(Insert(ROUTE_CACHE_SIZE));
+  TEST_ASSERT_TRUE(Insert(5)); // Known destination, path replaced in place
+  TEST_ASSERT_EQUAL(ROUTE_CACHE_SIZE, cache.Count());
+}
+
+// Destinations come and go: tombstones stay bounded and every route stays reachable
+static void test_churn_reclaims_tombstones(void) {
+  const uint32_t live = ROUTE_CACHE_SIZE / 2;
+  for(uint32_t n = 0; n < live; n++) {
+    TEST_ASSERT_TRUE(Insert(n));
+  }
+  for(uint32_t n = live; n < live + 5000; n++) {
+    TEST_ASSERT_TRUE(Remove(n - live));
+    TEST_ASSERT_TRUE(Insert(n));
+    TEST_ASSERT_TRUE(cache.Deleted() <= ROUTE_CACHE_MAX_DELETED);
+    TEST_ASSERT_EQUAL(live, cache.Count());
+  }
+  for(uint32_t n = 5000; n < live + 5000; n++) {
+    TEST_ASSERT_TRUE(Contains(n));
+  }
+  for(uint32_t n = 0; n < 5000; n++) {
+    TEST_ASSERT_FALSE(Contains(n));
+  }
+}
+
+// Removing while walking the slots moves no other route
+static void test_remove_during_walk(void) {
+  for(uint32_t n = 0; n < ROUTE_CACHE_SIZE - 2; n++) {
+    TEST_ASSERT_TRUE(Insert(n));
+  }
+  size_t visited = 0;
+  for(size_t i = 0; i < RouteCache::Capacity(); i++) {
+    const route_entry_t *route = cache.Slot(i);
+    if(route == NULL) {
+      continue;
+    }
+    visited++;
+    if(route->learned % 2 == 0) {
+      uint8_t dest[MAC_SIZE];
+      memcpy(dest, route->dest, MAC_SIZE);
+      TEST_ASSERT_TRUE(cache.Remove(dest));
+    }
+  }
+  TEST_ASSERT_EQUAL(ROUTE_CACHE_SIZE - 2, visited);
+  for(uint32_t n = 0; n < ROUTE_CACHE_SIZE - 2; n++) {
+    TEST_ASSERT_EQUAL(n % 2 == 1, Contains(n));
+  }
+}
+
+// Emptying the table leaves no tombstones at all
+static void test_remove_all(void) {
+  for(uint32_t n = 0; n < ROUTE_CACHE_SIZE; n++) {
+    TEST_ASSERT_TRUE(Insert(n));
+  }
+  for(uint32_t n = 0; n < ROUTE_CACHE_SIZE; n++) {
+    TEST_ASSERT_TRUE(Remove(n));
+  }
+  TEST_ASSERT_EQUAL(0, cache.Count());
+  TEST_ASSERT_EQUAL(0, cache.Deleted());
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_insert_lookup_remove);
+  RUN_TEST(test_full_table);
+  RUN_TEST(test_churn_reclaims_tombstones);
+  RUN_TEST(test_remove_during_walk);
+  RUN_TEST(test_remove_all);
+  return UNITY_END();
+}
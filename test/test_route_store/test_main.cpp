@@ -0,0 +1,200 @@
+#include <cstdio>
+#include <cstring>
+#include <unity.h>
+#include "fake_hal.h"
+#include "route_store.h"
+
+#define HOPS 3
+#define RECORD_SIZE (4 + 1 + HOPS * MAC_SIZE) // ADD record of a HOPS path
+#define BANK_RECORDS 5
+#define REGION_SIZE (ROUTE_STORE_BANKS * (ROUTE_STORE_HEADER_SIZE + BANK_RECORDS * RECORD_SIZE))
+#define IMAGE_PATH "test_route_store.img"
+
+static RamFlash *flash;
+static RouteCache cache, replayed;
+
+static const uint8_t self[MAC_SIZE] = {0x24, 0x6F, 0x28, 0x00, 0x00, 0x01};
+
+static void Mac(uint8_t kind, uint8_t n, uint8_t *mac) {
+  const uint8_t prefix[MAC_SIZE] = {0x24, 0x6F, 0x28, 0x10, 0x00, 0x00};
+  memcpy(mac, prefix, MAC_SIZE);
+  mac[4] = kind;
+  mac[5] = n;
+}
+
+// Route to destination n over relay r, inserted into cache and saved
+static bool Save(RouteStore &store, uint8_t n, uint8_t r) {
+  uint8_t path[HOPS][MAC_SIZE];
+  memcpy(path[0], self, MAC_SIZE);
+  Mac(0x02, r, path[1]);
+  Mac(0x03, n, path[2]);
+  TEST_ASSERT_TRUE(cache.Insert(path, HOPS, 0));
+  return store.SaveRoute(cache.Lookup(path[2]), cache);
+}
+
+static bool Remove(RouteStore &store, uint8_t n) {
+  uint8_t dest[MAC_SIZE];
+  Mac(0x03, n, dest);
+  TEST_ASSERT_TRUE(cache.Remove(dest));
+  return store.RemoveRoute(dest, cache);
+}
+
+// Relay of the replayed route to n, -1 if it has none
+static int Relay(uint8_t n) {
+  uint8_t dest[MAC_SIZE];
+  Mac(0x03, n, dest);
+  const route_entry_t *route = replayed.Lookup(dest);
+  if(route == NULL) {
+    return -1;
+  }
+  TEST_ASSERT_EQUAL(HOPS, route->path_len);
+  TEST_ASSERT_EQUAL_MEMORY(self, route->path[0], MAC_SIZE);
+  return route->path[1][5];
+}
+
+// Reboot: a fresh store over the same image
+static RouteStore Remount(FlashBackend &image) {
+  RouteStore store(image, 0, REGION_SIZE);
+  TEST_ASSERT_TRUE(store.Mount(replayed));
+  return store;
+}
+
+void setUp(void) {
+  flash = new RamFlash(REGION_SIZE);
+  cache.Clear();
+  replayed.Clear();
+}
+
+void tearDown(void) {
+  delete flash;
+}
+
+static void test_format_blank(void) {
+  RouteStore store(*flash, 0, REGION_SIZE);
+  TEST_ASSERT_TRUE(store.Mount(cache));
+  TEST_ASSERT_EQUAL(1, flash->Commits());
+  TEST_ASSERT_EQUAL('R', flash->Read(0));
+  TEST_ASSERT_EQUAL(0xFF, flash->Read(store.BankSize())); // Second bank stays erased
+  TEST_ASSERT_EQUAL(BANK_RECORDS * RECORD_SIZE, store.FreeBytes());
+
+  Remount(*flash);
+  TEST_ASSERT_EQUAL(1, flash->Commits()); // Valid bank found, no second format
+  TEST_ASSERT_EQUAL(0, replayed.Count());
+}
+
+// Newer records win: a replaced path and a removal replay in order
+static void test_replay_in_order(void) {
+  RouteStore store(*flash, 0, REGION_SIZE);
+  store.Mount(cache);
+  TEST_ASSERT_TRUE(Save(store, 1, 1));
+  TEST_ASSERT_TRUE(Save(store, 2, 1));
+  TEST_ASSERT_TRUE(Save(store, 1, 7));
+  TEST_ASSERT_TRUE(Remove(store, 2));
+  TEST_ASSERT_EQUAL(0, store.Stats().compactions);
+
+  RouteStore again = Remount(*flash);
+  TEST_ASSERT_EQUAL(4, again.Stats().records_replayed);
+  TEST_ASSERT_EQUAL(0, again.Stats().records_corrupt);
+  TEST_ASSERT_EQUAL(1, replayed.Count());
+  TEST_ASSERT_EQUAL(7, Relay(1));
+  TEST_ASSERT_EQUAL(-1, Relay(2));
+  TEST_ASSERT_EQUAL(store.FreeBytes(), again.FreeBytes()); // Appends continue at the same tail
+}
+
+// A torn last record ends the log: only it is lost, and the next append overwrites it
+static void test_torn_record(void) {
+  RouteStore store(*flash, 0, REGION_SIZE);
+  store.Mount(cache);
+  Save(store, 1, 1);
+  Save(store, 2, 1);
+  size_t crc = ROUTE_STORE_HEADER_SIZE + 2 * RECORD_SIZE - 1;
+  flash->Write(crc, flash->Read(crc) ^ 0x5A);
+
+  RouteStore again = Remount(*flash);
+  TEST_ASSERT_EQUAL(1, again.Stats().records_replayed);
+  TEST_ASSERT_EQUAL(1, again.Stats().records_corrupt);
+  TEST_ASSERT_EQUAL(1, Relay(1));
+  TEST_ASSERT_EQUAL(-1, Relay(2));
+  TEST_ASSERT_EQUAL(store.FreeBytes() + RECORD_SIZE, again.FreeBytes());
+
+  cache.Clear();
+  Save(again, 3, 4); // Lands where the torn record was
+  replayed.Clear();
+  RouteStore third = Remount(*flash);
+  TEST_ASSERT_EQUAL(0, third.Stats().records_corrupt);
+  TEST_ASSERT_EQUAL(2, replayed.Count());
+  TEST_ASSERT_EQUAL(1, Relay(1));
+  TEST_ASSERT_EQUAL(4, Relay(3));
+}
+
+// A full bank moves the live routes into the other one, and back again
+static void test_compaction_switches_banks(void) {
+  RouteStore store(*flash, 0, REGION_SIZE);
+  store.Mount(cache);
+  for(uint8_t i = 0; i < 40; i++) {
+    TEST_ASSERT_TRUE(Save(store, i % 3, i));
+  }
+  TEST_ASSERT_TRUE(store.Stats().compactions >= 2);
+
+  RouteStore again = Remount(*flash);
+  TEST_ASSERT_EQUAL(3, replayed.Count());
+  TEST_ASSERT_EQUAL(39, Relay(0)); // 39 % 3 == 0
+  TEST_ASSERT_EQUAL(37, Relay(1));
+  TEST_ASSERT_EQUAL(38, Relay(2));
+  TEST_ASSERT_EQUAL(0, again.Stats().records_corrupt);
+}
+
+// Reset before the new bank's header was good: the previous bank is still the newest
+static void test_bad_header_keeps_previous_bank(void) {
+  RouteStore store(*flash, 0, REGION_SIZE);
+  store.Mount(cache);
+  for(uint8_t n = 0; n < BANK_RECORDS; n++) {
+    Save(store, n, 1);
+  }
+  TEST_ASSERT_EQUAL(0, store.FreeBytes());
+  Save(store, 0, 9);
+  TEST_ASSERT_EQUAL(1, store.Stats().compactions);
+  flash->Write(store.BankSize() + ROUTE_STORE_HEADER_SIZE - 1, flash->Read(store.BankSize() + ROUTE_STORE_HEADER_SIZE - 1) ^ 1);
+
+  Remount(*flash);
+  TEST_ASSERT_EQUAL(BANK_RECORDS, replayed.Count());
+  TEST_ASSERT_EQUAL(1, Relay(0)); // Update that forced the compaction is lost
+  TEST_ASSERT_EQUAL(1, Relay(BANK_RECORDS - 1));
+}
+
+// Committed writes survive in the file, uncommitted ones are gone with the object
+static void test_file_flash(void) {
+  remove(IMAGE_PATH);
+  {
+    FileFlash image(IMAGE_PATH, REGION_SIZE);
+    TEST_ASSERT_FALSE(image.Loaded());
+    RouteStore store(image, 0, REGION_SIZE);
+    store.Mount(cache);
+    Save(store, 1, 2);
+    image.Write(ROUTE_STORE_HEADER_SIZE + RECORD_SIZE, 0x00); // Never committed
+  }
+  {
+    FileFlash image(IMAGE_PATH, REGION_SIZE);
+    TEST_ASSERT_TRUE(image.Loaded());
+    TEST_ASSERT_EQUAL(0xFF, image.Read(ROUTE_STORE_HEADER_SIZE + RECORD_SIZE));
+    Remount(image);
+    TEST_ASSERT_EQUAL(1, replayed.Count());
+    TEST_ASSERT_EQUAL(2, Relay(1));
+  }
+  {
+    FileFlash other(IMAGE_PATH, REGION_SIZE / 2); // Wrong size, starts erased
+    TEST_ASSERT_FALSE(other.Loaded());
+  }
+  remove(IMAGE_PATH);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_format_blank);
+  RUN_TEST(test_replay_in_order);
+  RUN_TEST(test_torn_record);
+  RUN_TEST(test_compaction_switches_banks);
+  RUN_TEST(test_bad_header_keeps_previous_bank);
+  RUN_TEST(test_file_flash);
+  return UNITY_END();
+}
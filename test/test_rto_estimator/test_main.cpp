@@ -0,0 +1,203 @@
+#include <cstring>
+#include <unity.h>
+#include "reliable_tx.h"
+#include "rto_estimator.h"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static uint32_t rng;
+
+static uint32_t Random(uint32_t low, uint32_t high) {
+  rng ^= rng << 13;
+  rng ^= rng >> 17;
+  rng ^= rng << 5;
+  return low + rng % (high - low + 1);
+}
+
+// RFC 6298 in floating point, what the fixed-point estimator approximates
+typedef struct reference {
+  double srtt;
+  double rttvar;
+  bool sampled;
+} reference_t;
+
+static double ReferenceSample(reference_t *ref, double rtt) {
+  if(!ref->sampled) {
+    ref->srtt = rtt;
+    ref->rttvar = rtt / 2;
+    ref->sampled = true;
+  } else {
+    ref->rttvar = 0.75 * ref->rttvar + 0.25 * (ref->srtt > rtt ? ref->srtt - rtt : rtt - ref->srtt);
+    ref->srtt = 0.875 * ref->srtt + 0.125 * rtt;
+  }
+  double var = 4 * ref->rttvar > RTO_GRANULARITY_MS ? 4 * ref->rttvar : RTO_GRANULARITY_MS;
+  double rto = ref->srtt + var;
+  return rto < RTO_MIN_MS ? RTO_MIN_MS : rto > RTO_MAX_MS ? RTO_MAX_MS : rto;
+}
+
+static void test_initial_timeout(void) {
+  rto_estimator_t est;
+  RtoInit(&est);
+  TEST_ASSERT_FALSE(est.sampled);
+  TEST_ASSERT_EQUAL(RTO_INITIAL_MS, est.rto);
+}
+
+// First sample: SRTT = R, RTTVAR = R/2, so RTO = 3R
+static void test_first_sample(void) {
+  rto_estimator_t est;
+  RtoInit(&est);
+  RtoSample(&est, 100);
+  TEST_ASSERT_TRUE(est.sampled);
+  TEST_ASSERT_EQUAL(100, est.srtt8 >> 3);
+  TEST_ASSERT_EQUAL(300, est.rto);
+}
+
+// A steady link: the variation decays and the timeout settles just above the RTT
+static void test_constant_trace_converges(void) {
+  rto_estimator_t est;
+  RtoInit(&est);
+  for(int i = 0; i < 100; i++) {
+    RtoSample(&est, 50);
+  }
+  TEST_ASSERT_EQUAL(50, est.srtt8 >> 3);
+  TEST_ASSERT_UINT32_WITHIN(4, 50, est.rto);
+  TEST_ASSERT_TRUE(est.rto > 50);
+}
+
+// Jittery traces stay within rounding of the floating-point RFC 6298 estimator
+static void test_jitter_trace_tracks_reference(void) {
+  const uint32_t bands[][2] = {{5, 15}, {40, 60}, {100, 400}, {800, 2500}};
+  rng = 0xC0FFEE;
+  for(size_t b = 0; b < sizeof(bands) / sizeof(bands[0]); b++) {
+    rto_estimator_t est;
+    reference_t ref;
+    RtoInit(&est);
+    memset(&ref, 0, sizeof(ref));
+    for(int i = 0; i < 500; i++) {
+      uint32_t rtt = Random(bands[b][0], bands[b][1]);
+      RtoSample(&est, rtt);
+      double expected = ReferenceSample(&ref, rtt);
+      // Truncating shifts lose under 1 ms on SRTT and 4 ms on 4 x RTTVAR
+      TEST_ASSERT_UINT32_WITHIN(6, (uint32_t)(expected + 0.5), est.rto);
+    }
+  }
+}
+
+// With the RTO above the jitter, almost no sample would have timed out spuriously
+static void test_jitter_rarely_times_out(void) {
+  rto_estimator_t est;
+  RtoInit(&est);
+  rng = 0xBEEF;
+  int spurious = 0;
+  for(int i = 0; i < 2000; i++) {
+    uint32_t rtt = Random(40, 60);
+    if(i >= 10 && rtt >= est.rto) {
+      spurious++;
+    }
+    RtoSample(&est, rtt);
+  }
+  TEST_ASSERT_TRUE(spurious < 20);
+}
+
+// A route change raises the RTT from 30 to 200 ms: SRTT follows within a few dozen samples
+static void test_step_increase(void) {
+  rto_estimator_t est;
+  RtoInit(&est);
+  for(int i = 0; i < 50; i++) {
+    RtoSample(&est, 30);
+  }
+  int samples = 0;
+  while((est.srtt8 >> 3) < 180) {
+    RtoSample(&est, 200);
+    samples++;
+    TEST_ASSERT_TRUE(samples < 30);
+  }
+  TEST_ASSERT_TRUE(est.rto >= 200);
+}
+
+// One outlier inflates the timeout, which then decays back towards the steady RTT
+static void test_spike_decays(void) {
+  rto_estimator_t est;
+  RtoInit(&est);
+  for(int i = 0; i < 50; i++) {
+    RtoSample(&est, 50);
+  }
+  uint32_t steady = est.rto;
+  RtoSample(&est, 1000);
+  uint32_t peak = est.rto;
+  TEST_ASSERT_TRUE(peak > 500);
+  for(int i = 0; i < 40; i++) {
+    RtoSample(&est, 50);
+  }
+  TEST_ASSERT_TRUE(est.rto < peak / 4);
+  TEST_ASSERT_UINT32_WITHIN(10, steady, est.rto);
+}
+
+static void test_clamped(void) {
+  rto_estimator_t est;
+  RtoInit(&est);
+  for(int i = 0; i < 20; i++) {
+    RtoSample(&est, 1);
+  }
+  TEST_ASSERT_EQUAL(RTO_MIN_MS, est.rto);
+
+  RtoInit(&est);
+  RtoSample(&est, 20000);
+  TEST_ASSERT_EQUAL(RTO_MAX_MS, est.rto);
+}
+
+static void test_backoff_doubles_to_the_cap(void) {
+  rto_estimator_t est;
+  RtoInit(&est);
+  RtoSample(&est, 100); // RTO 300
+  TEST_ASSERT_EQUAL(300, RtoBackoff(&est, 1));
+  TEST_ASSERT_EQUAL(600, RtoBackoff(&est, 2));
+  TEST_ASSERT_EQUAL(1200, RtoBackoff(&est, 3));
+  TEST_ASSERT_EQUAL(RTO_MAX_MS, RtoBackoff(&est, 10));
+}
+
+static const uint8_t dest[MAC_SIZE] = {0x24, 0x6F, 0x28, 0x00, 0x00, 0x02};
+
+static bool Drop(const message_t *packet, void *ctx) {
+  return true;
+}
+
+// Karn's rule: the ack of a retransmitted packet is not sampled, it could belong to either copy
+static void test_transport_skips_retransmitted_samples(void) {
+  static ReliableTransport transport(Drop, NULL);
+  transport = ReliableTransport(Drop, NULL);
+  message_t packet;
+  memset(&packet, 0, sizeof(packet));
+  memcpy(packet.destination_mac, dest, MAC_SIZE);
+  packet.packetID = 7;
+
+  uint32_t start = 0xFFFFFF00u; // millis() wraps during the exchange
+  TEST_ASSERT_TRUE(transport.Send(&packet, start));
+  transport.OnAck(dest, 8, 0, start + 80);
+  TEST_ASSERT_EQUAL(1, transport.Stats().rtt_samples);
+  TEST_ASSERT_EQUAL(80, transport.SmoothedRtt(dest));
+
+  TEST_ASSERT_TRUE(transport.Send(&packet, start + 100)); // seq 8
+  transport.Poll(start + 100 + transport.CurrentRto(dest)); // Retransmitted
+  TEST_ASSERT_EQUAL(1, transport.Stats().retransmits);
+  transport.OnAck(dest, 9, 0, start + 2000);
+  TEST_ASSERT_EQUAL(1, transport.Stats().rtt_samples);
+  TEST_ASSERT_EQUAL(80, transport.SmoothedRtt(dest));
+  TEST_ASSERT_EQUAL(0, transport.InFlight());
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_initial_timeout);
+  RUN_TEST(test_first_sample);
+  RUN_TEST(test_constant_trace_converges);
+  RUN_TEST(test_jitter_trace_tracks_reference);
+  RUN_TEST(test_jitter_rarely_times_out);
+  RUN_TEST(test_step_increase);
+  RUN_TEST(test_spike_decays);
+  RUN_TEST(test_clamped);
+  RUN_TEST(test_backoff_doubles_to_the_cap);
+  RUN_TEST(test_transport_skips_retransmitted_samples);
+  return UNITY_END();
+}
@@ -0,0 +1,141 @@
+#include <cstring>
+#include <thread>
+#include <unity.h>
+#include "spsc_ring.h"
+
+typedef struct frame {
+  uint32_t seq;
+  uint8_t payload[60];
+} frame_t;
+
+typedef SpscRing<frame_t, 8> Ring;
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static void Push(Ring *ring, uint32_t seq) {
+  frame_t *slot = ring->Reserve();
+  TEST_ASSERT_NOT_NULL(slot);
+  slot->seq = seq;
+  memset(slot->payload, (uint8_t)seq, sizeof(slot->payload));
+  ring->Commit();
+}
+
+static uint32_t Pop(Ring *ring) {
+  frame_t *slot = ring->Peek();
+  TEST_ASSERT_NOT_NULL(slot);
+  uint32_t seq = slot->seq;
+  ring->Release();
+  return seq;
+}
+
+static void test_empty_ring(void) {
+  Ring ring;
+  TEST_ASSERT_TRUE(ring.Empty());
+  TEST_ASSERT_EQUAL(0, ring.Size());
+  TEST_ASSERT_NULL(ring.Peek());
+  TEST_ASSERT_EQUAL(0, ring.Dropped());
+}
+
+static void test_fifo_order(void) {
+  Ring ring;
+  for(uint32_t seq = 1; seq <= 5; seq++) {
+    Push(&ring, seq);
+  }
+  TEST_ASSERT_EQUAL(5, ring.Size());
+  for(uint32_t seq = 1; seq <= 5; seq++) {
+    TEST_ASSERT_EQUAL(seq, Pop(&ring));
+  }
+  TEST_ASSERT_TRUE(ring.Empty());
+  TEST_ASSERT_EQUAL(5, ring.Enqueued());
+}
+
+// Peek does not consume: the same slot comes back until it is released
+static void test_peek_until_release(void) {
+  Ring ring;
+  Push(&ring, 7);
+  TEST_ASSERT_TRUE(ring.Peek() == ring.Peek());
+  TEST_ASSERT_EQUAL(7, ring.Peek()->seq);
+  ring.Release();
+  TEST_ASSERT_NULL(ring.Peek());
+}
+
+// A full ring refuses and counts the frame, and takes frames again once one is released
+static void test_drop_when_full(void) {
+  Ring ring;
+  for(uint32_t seq = 0; seq < Ring::Capacity(); seq++) {
+    Push(&ring, seq);
+  }
+  TEST_ASSERT_NULL(ring.Reserve());
+  TEST_ASSERT_NULL(ring.Reserve());
+  TEST_ASSERT_EQUAL(2, ring.Dropped());
+  TEST_ASSERT_EQUAL(Ring::Capacity(), ring.Size());
+
+  TEST_ASSERT_EQUAL(0, Pop(&ring));
+  Push(&ring, 100);
+  TEST_ASSERT_EQUAL(Ring::Capacity(), ring.Enqueued() - 1);
+  for(uint32_t seq = 1; seq < Ring::Capacity(); seq++) {
+    TEST_ASSERT_EQUAL(seq, Pop(&ring));
+  }
+  TEST_ASSERT_EQUAL(100, Pop(&ring));
+  TEST_ASSERT_EQUAL(2, ring.Dropped());
+}
+
+// Indices run far past the slot count, slots are reused in order
+static void test_slot_wraparound(void) {
+  Ring ring;
+  uint32_t next = 0;
+  for(uint32_t seq = 0; seq < 100 * Ring::Capacity(); seq++) {
+    Push(&ring, seq);
+    if(ring.Size() == 3) {
+      TEST_ASSERT_EQUAL(next++, Pop(&ring));
+    }
+  }
+  while(!ring.Empty()) {
+    TEST_ASSERT_EQUAL(next++, Pop(&ring));
+  }
+  TEST_ASSERT_EQUAL(100 * Ring::Capacity(), next);
+}
+
+// Producer and consumer on two threads: every frame arrives once, in order and intact
+static void test_two_threads(void) {
+  static Ring ring;
+  const uint32_t frames = 200000;
+  uint32_t bad = 0;
+  std::thread producer([&] {
+    for(uint32_t seq = 0; seq < frames; seq++) {
+      frame_t *slot;
+      while((slot = ring.Reserve()) == NULL) {
+        std::this_thread::yield();
+      }
+      slot->seq = seq;
+      memset(slot->payload, (uint8_t)seq, sizeof(slot->payload));
+      ring.Commit();
+    }
+  });
+  for(uint32_t seq = 0; seq < frames;) {
+    frame_t *slot = ring.Peek();
+    if(slot == NULL) {
+      std::this_thread::yield();
+      continue;
+    }
+    bad += slot->seq != seq || slot->payload[0] != (uint8_t)seq || slot->payload[59] != (uint8_t)seq;
+    seq++;
+    ring.Release();
+  }
+  producer.join();
+  TEST_ASSERT_EQUAL(0, bad);
+  TEST_ASSERT_TRUE(ring.Empty());
+  TEST_ASSERT_EQUAL(frames, ring.Enqueued());
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_empty_ring);
+  RUN_TEST(test_fifo_order);
+  RUN_TEST(test_peek_until_release);
+  RUN_TEST(test_drop_when_full);
+  RUN_TEST(test_slot_wraparound);
+  RUN_TEST(test_two_threads);
+  return UNITY_END();
+}
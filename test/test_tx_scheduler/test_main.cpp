@@ -0,0 +1,241 @@
+#include <cstring>
+#include <unity.h>
+#include "tx_scheduler.h"
+
+#define RADIO_LOG 16
+
+// Radio that takes every frame and remembers what it was handed
+typedef struct radio_log {
+  uint8_t mac[RADIO_LOG][MAC_SIZE];
+  uint8_t first[RADIO_LOG]; // First payload byte, tells the frames apart
+  int sends;
+} radio_log_t;
+
+static radio_log_t radio;
+static TxScheduler *scheduler;
+
+static const uint8_t hop_a[MAC_SIZE] = {0x24, 0x6F, 0x28, 0x01, 0x02, 0x03};
+static const uint8_t hop_b[MAC_SIZE] = {0x24, 0x6F, 0x28, 0x0A, 0x0B, 0x0C};
+
+static bool Send(void *ctx, const uint8_t *mac, const uint8_t *frame, size_t len, bool encrypt) {
+  radio_log_t *log = (radio_log_t *)ctx;
+  if(log->sends < RADIO_LOG) {
+    memcpy(log->mac[log->sends], mac, MAC_SIZE);
+    log->first[log->sends] = frame[0];
+  }
+  log->sends++;
+  return true;
+}
+
+static void Queue(TxClass cls, const uint8_t *mac, uint8_t first, uint32_t now) {
+  uint8_t frame[8];
+  memset(frame, first, sizeof(frame));
+  TEST_ASSERT_TRUE(scheduler->Enqueue(cls, mac, frame, sizeof(frame), now));
+}
+
+void setUp(void) {
+  memset(&radio, 0, sizeof(radio));
+  scheduler = new TxScheduler(Send, &radio);
+}
+
+void tearDown(void) {
+  delete scheduler;
+}
+
+// One frame with the radio at a time, the next goes out once Poll() sees the result
+static void test_one_frame_outstanding(void) {
+  Queue(TX_CLASS_ORIGIN, hop_a, 1, 0);
+  Queue(TX_CLASS_ORIGIN, hop_a, 2, 0);
+  TEST_ASSERT_EQUAL(1, radio.sends);
+  TEST_ASSERT_TRUE(scheduler->Busy());
+
+  scheduler->OnSent(hop_a, true);
+  TEST_ASSERT_EQUAL(1, radio.sends); // The callback only records
+  scheduler->Poll(1);
+  TEST_ASSERT_EQUAL(2, radio.sends);
+  TEST_ASSERT_EQUAL(2, radio.first[1]);
+
+  scheduler->OnSent(hop_a, true);
+  scheduler->Poll(2);
+  TEST_ASSERT_FALSE(scheduler->Busy());
+  TEST_ASSERT_EQUAL(0, scheduler->Stats().retries);
+}
+
+static void test_control_goes_first(void) {
+  Queue(TX_CLASS_ORIGIN, hop_a, 1, 0);
+  Queue(TX_CLASS_FORWARD, hop_a, 2, 0);
+  Queue(TX_CLASS_CONTROL, hop_a, 3, 0);
+  scheduler->OnSent(hop_a, true);
+  scheduler->Poll(1);
+  TEST_ASSERT_EQUAL(3, radio.first[1]);
+}
+
+// A failed result is resent after the backoff, ahead of what is queued
+static void test_failed_send_is_resent(void) {
+  Queue(TX_CLASS_FORWARD, hop_a, 1, 0);
+  Queue(TX_CLASS_FORWARD, hop_b, 2, 0);
+  scheduler->OnSent(hop_a, false);
+  scheduler->Poll(1);
+  TEST_ASSERT_EQUAL(1, scheduler->Stats().retries);
+  TEST_ASSERT_EQUAL(2, radio.first[1]); // Backoff running, the next frame goes meanwhile
+
+  scheduler->OnSent(hop_b, true);
+  scheduler->Poll(1 + (TX_RETRY_BACKOFF_MS << 0));
+  TEST_ASSERT_EQUAL(3, radio.sends);
+  TEST_ASSERT_EQUAL(1, radio.first[2]);
+  TEST_ASSERT_EQUAL_MEMORY(hop_a, radio.mac[2], MAC_SIZE);
+  scheduler->OnSent(hop_a, true);
+  scheduler->Poll(10);
+  TEST_ASSERT_EQUAL(1, scheduler->Stats().recovered);
+}
+
+// A callback that never comes counts as a failed send: the frame is resent
+static void test_timeout_counts_as_failure(void) {
+  Queue(TX_CLASS_FORWARD, hop_a, 1, 0);
+  scheduler->Poll(TX_SENT_TIMEOUT_MS);
+  TEST_ASSERT_TRUE(scheduler->Busy());
+  scheduler->Poll(TX_SENT_TIMEOUT_MS + 1);
+  TEST_ASSERT_EQUAL(1, scheduler->Stats().timeouts);
+  TEST_ASSERT_EQUAL(1, scheduler->Stats().retries);
+
+  scheduler->Poll(TX_SENT_TIMEOUT_MS + 1 + TX_RETRY_BACKOFF_MS);
+  TEST_ASSERT_EQUAL(2, radio.sends);
+  TEST_ASSERT_EQUAL(1, radio.first[1]);
+}
+
+// The result of a frame that timed out arrives while the next one is with the radio:
+// it must not be taken for the new frame's result
+static void test_late_callback_is_ignored(void) {
+  scheduler->SetRetries(0);
+  Queue(TX_CLASS_FORWARD, hop_a, 1, 0);
+  Queue(TX_CLASS_FORWARD, hop_b, 2, 0);
+  scheduler->Poll(TX_SENT_TIMEOUT_MS + 1);
+  TEST_ASSERT_EQUAL(2, radio.sends);
+  TEST_ASSERT_EQUAL(1, scheduler->Stats().failed);
+
+  const tx_frame_t *failed = scheduler->PeekFailed();
+  TEST_ASSERT_NOT_NULL(failed);
+  TEST_ASSERT_EQUAL(1, failed->data[0]);
+  scheduler->ReleaseFailed();
+
+  scheduler->OnSent(hop_a, false); // Late, belongs to frame 1
+  scheduler->Poll(TX_SENT_TIMEOUT_MS + 2);
+  TEST_ASSERT_TRUE(scheduler->Busy());
+  TEST_ASSERT_NULL(scheduler->PeekFailed());
+  TEST_ASSERT_EQUAL(1, scheduler->Stats().failed);
+
+  scheduler->OnSent(hop_b, true); // Frame 2's own result
+  scheduler->Poll(TX_SENT_TIMEOUT_MS + 3);
+  TEST_ASSERT_FALSE(scheduler->Busy());
+  TEST_ASSERT_EQUAL(1, scheduler->Stats().failed);
+}
+
+// A result that comes when nothing is outstanding any more changes nothing
+static void test_callback_after_timeout_while_idle(void) {
+  scheduler->SetRetries(0);
+  Queue(TX_CLASS_ORIGIN, hop_a, 1, 0);
+  scheduler->Poll(TX_SENT_TIMEOUT_MS + 1);
+  TEST_ASSERT_FALSE(scheduler->Busy());
+  scheduler->OnSent(hop_a, true);
+  scheduler->Poll(TX_SENT_TIMEOUT_MS + 2);
+  TEST_ASSERT_EQUAL(0, scheduler->Stats().recovered);
+
+  Queue(TX_CLASS_ORIGIN, hop_a, 2, TX_SENT_TIMEOUT_MS + 3);
+  scheduler->Poll(TX_SENT_TIMEOUT_MS + 4);
+  TEST_ASSERT_TRUE(scheduler->Busy()); // Waits for its own result
+  scheduler->OnSent(hop_a, true);
+  scheduler->Poll(TX_SENT_TIMEOUT_MS + 5);
+  TEST_ASSERT_FALSE(scheduler->Busy());
+}
+
+// A late result of the first try may stand in for its resend's: same frame, same hop.
+// The resend's own result then comes with nothing outstanding and is skipped
+static void test_late_result_of_first_try(void) {
+  Queue(TX_CLASS_FORWARD, hop_a, 1, 0);
+  scheduler->Poll(TX_SENT_TIMEOUT_MS + 1); // First try timed out, resend waits
+  uint32_t resend_at = TX_SENT_TIMEOUT_MS + 1 + TX_RETRY_BACKOFF_MS;
+  scheduler->Poll(resend_at);
+  TEST_ASSERT_EQUAL(2, radio.sends);
+
+  scheduler->OnSent(hop_a, true); // First try, late
+  scheduler->Poll(resend_at + 1);
+  TEST_ASSERT_EQUAL(1, scheduler->Stats().recovered);
+  TEST_ASSERT_FALSE(scheduler->Busy());
+
+  scheduler->OnSent(hop_a, false); // The resend's own
+  scheduler->Poll(resend_at + 2);
+  TEST_ASSERT_EQUAL(1, scheduler->Stats().retries);
+  TEST_ASSERT_EQUAL(0, scheduler->Stats().failed);
+
+  Queue(TX_CLASS_FORWARD, hop_a, 2, resend_at + 3); // Waits for its own result
+  scheduler->Poll(resend_at + 4);
+  TEST_ASSERT_TRUE(scheduler->Busy());
+}
+
+// A callback that never comes must not shift the results of the frames after it
+static void test_lost_callback_then_good_sends(void) {
+  Queue(TX_CLASS_FORWARD, hop_a, 1, 0);
+  uint32_t now = TX_SENT_TIMEOUT_MS + 1;
+  scheduler->Poll(now); // Lost, resend waits
+  now += TX_RETRY_BACKOFF_MS;
+  scheduler->Poll(now);
+  TEST_ASSERT_EQUAL(2, radio.sends);
+
+  for(int i = 0; i < 12; i++) {
+    const uint8_t *hop = radio.mac[(radio.sends - 1) % RADIO_LOG];
+    scheduler->OnSent(hop, true);
+    scheduler->Poll(++now);
+    TEST_ASSERT_FALSE(scheduler->Busy());
+    Queue(TX_CLASS_FORWARD, i % 2 ? hop_a : hop_b, (uint8_t)(10 + i), ++now);
+  }
+  scheduler->OnSent(radio.mac[radio.sends - 1], true);
+  scheduler->Poll(++now);
+
+  TEST_ASSERT_EQUAL(14, radio.sends);
+  TEST_ASSERT_FALSE(scheduler->Busy());
+  TEST_ASSERT_EQUAL(1, scheduler->Stats().timeouts);
+  TEST_ASSERT_EQUAL(1, scheduler->Stats().retries);
+  TEST_ASSERT_EQUAL(1, scheduler->Stats().recovered);
+  TEST_ASSERT_EQUAL(0, scheduler->Stats().failed);
+  TEST_ASSERT_NULL(scheduler->PeekFailed());
+}
+
+// Every resend failed: handed back once, for the mesh core to reroute
+static void test_given_up_after_retries(void) {
+  Queue(TX_CLASS_FORWARD, hop_a, 1, 0);
+  uint32_t now = 0;
+  for(int i = 0; i <= TX_HOP_RETRIES; i++) {
+    scheduler->OnSent(hop_a, false);
+    scheduler->Poll(++now);
+    now += TX_RETRY_BACKOFF_MS << i;
+    scheduler->Poll(now);
+  }
+  TEST_ASSERT_EQUAL(TX_HOP_RETRIES + 1, radio.sends);
+  TEST_ASSERT_EQUAL(TX_HOP_RETRIES, scheduler->Stats().retries);
+  TEST_ASSERT_EQUAL(1, scheduler->Stats().failed);
+
+  const tx_frame_t *failed = scheduler->PeekFailed();
+  TEST_ASSERT_NOT_NULL(failed);
+  TEST_ASSERT_EQUAL_MEMORY(hop_a, failed->mac, MAC_SIZE);
+  TEST_ASSERT_EQUAL(TX_HOP_RETRIES, failed->tries);
+  scheduler->ReleaseFailed();
+
+  scheduler->OnSent(hop_a, true); // Nothing outstanding, nothing to hand back
+  scheduler->Poll(now + 1);
+  TEST_ASSERT_NULL(scheduler->PeekFailed());
+  TEST_ASSERT_EQUAL(0, scheduler->Stats().recovered);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_one_frame_outstanding);
+  RUN_TEST(test_control_goes_first);
+  RUN_TEST(test_failed_send_is_resent);
+  RUN_TEST(test_timeout_counts_as_failure);
+  RUN_TEST(test_late_callback_is_ignored);
+  RUN_TEST(test_callback_after_timeout_while_idle);
+  RUN_TEST(test_late_result_of_first_try);
+  RUN_TEST(test_lost_callback_then_good_sends);
+  RUN_TEST(test_given_up_after_retries);
+  return UNITY_END();
+}
@@ -0,0 +1,366 @@
+#include <cstring>
+#include <unity.h>
+#include "wire_format.h"
+
+static const uint8_t table_macs[][MAC_SIZE] = {
+  {0xEC, 0x62, 0x60, 0x93, 0xC7, 0xA8},
+  {0x48, 0xE7, 0x29, 0xA3, 0x47, 0x40},
+  {0x24, 0xDC, 0xC3, 0xC6, 0xAE, 0xCC},
+  {0x08, 0xD1, 0xF9, 0xAF, 0x2D, 0x90},
+};
+static const wire_node_table_t table = {table_macs, 4};
+
+static uint32_t state;
+
+void setUp(void) { state = 0x5EED; }
+void tearDown(void) {}
+
+static uint32_t Random() {
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+static void Sample(message_t *packet) {
+  memset(packet, 0, sizeof(*packet));
+  const char text[] = "hello mesh";
+  memcpy(packet->text, text, sizeof(text));
+  packet->Text_Length = sizeof(text) - 1;
+  packet->TTL = 3;
+  packet->identification = 2;
+  memcpy(packet->destination_mac, table_macs[3], MAC_SIZE);
+  memcpy(packet->source_mac, table_macs[0], MAC_SIZE);
+  packet->packetID = 0x12345678;
+  packet->Path_Exist = true;
+  packet->Path_Length = 3;
+  packet->Path_Index = 1;
+  for(int i = 0; i < 3; i++) {
+    memcpy(packet->Path_Array[i], table_macs[i], MAC_SIZE);
+  }
+  packet->seq = 0xBEEF;
+}
+
+// Any packet the encoder accepts, with clamped fields, in range
+static void RandomPacket(message_t *packet, bool known_hops) {
+  memset(packet, 0, sizeof(*packet));
+  packet->Text_Length = (uint8_t)(Random() % (WIRE_MAX_TEXT + 1));
+  for(int i = 0; i < packet->Text_Length; i++) {
+    packet->text[i] = (uint8_t)Random();
+  }
+  packet->TTL = Random() % 256;
+  packet->identification = 1 + Random() % 4;
+  packet->broadcast_Ack = Random() & 1;
+  packet->Data_Ack = Random() & 1;
+  packet->Reliable = Random() & 1;
+  packet->Routed = Random() & 1;
+  packet->New_Session = Random() & 1;
+  packet->Path_Exist = Random() & 1;
+  packet->packetID = (int)Random();
+  packet->seq = (uint16_t)Random();
+  for(int i = 0; i < MAC_SIZE; i++) {
+    packet->destination_mac[i] = (uint8_t)Random();
+    packet->source_mac[i] = (uint8_t)Random();
+  }
+  packet->Path_Length = (uint8_t)(Random() % (MAX_NODES + 1));
+  packet->Path_Index = (uint8_t)(Random() % (packet->Path_Length < MAX_NODES ? packet->Path_Length + 1 : MAX_NODES));
+  for(int i = 0; i < packet->Path_Length; i++) {
+    if(known_hops) {
+      memcpy(packet->Path_Array[i], table_macs[Random() % table.count], MAC_SIZE);
+    } else {
+      for(int b = 0; b < MAC_SIZE; b++) {
+        packet->Path_Array[i][b] = (uint8_t)Random();
+      }
+    }
+  }
+  if(packet->Data_Ack && packet->Reliable) {
+    packet->ack_seq = (uint16_t)Random();
+    packet->sack = Random();
+  }
+}
+
+// Every field that goes on air came back
+static void AssertSame(const message_t *a, const message_t *b) {
+  TEST_ASSERT_EQUAL(a->Text_Length, b->Text_Length);
+  TEST_ASSERT_EQUAL(0, memcmp(a->text, b->text, a->Text_Length));
+  TEST_ASSERT_EQUAL(0, b->text[b->Text_Length]);
+  TEST_ASSERT_EQUAL(a->TTL, b->TTL);
+  TEST_ASSERT_EQUAL(a->identification, b->identification);
+  TEST_ASSERT_EQUAL(a->broadcast_Ack, b->broadcast_Ack);
+  TEST_ASSERT_EQUAL(a->Data_Ack, b->Data_Ack);
+  TEST_ASSERT_EQUAL(a->Reliable, b->Reliable);
+  TEST_ASSERT_EQUAL(a->Routed, b->Routed);
+  TEST_ASSERT_EQUAL(a->New_Session, b->New_Session);
+  TEST_ASSERT_EQUAL(a->Path_Exist, b->Path_Exist);
+  TEST_ASSERT_EQUAL_MEMORY(a->destination_mac, b->destination_mac, MAC_SIZE);
+  TEST_ASSERT_EQUAL_MEMORY(a->source_mac, b->source_mac, MAC_SIZE);
+  TEST_ASSERT_EQUAL(a->packetID, b->packetID);
+  TEST_ASSERT_EQUAL(a->seq, b->seq);
+  TEST_ASSERT_EQUAL(a->Path_Index, b->Path_Index);
+  TEST_ASSERT_EQUAL(a->Path_Length, b->Path_Length);
+  TEST_ASSERT_EQUAL(0, memcmp(a->Path_Array, b->Path_Array, a->Path_Length * MAC_SIZE));
+  if(a->Data_Ack && a->Reliable) {
+    TEST_ASSERT_EQUAL(a->ack_seq, b->ack_seq);
+    TEST_ASSERT_EQUAL(a->sack, b->sack);
+  }
+}
+
+static void test_round_trip(void) {
+  message_t packet, decoded;
+  uint8_t frame[WIRE_MAX_FRAME];
+  Sample(&packet);
+  size_t len = EncodeMessage(&packet, NULL, frame, sizeof(frame));
+  TEST_ASSERT_EQUAL(WIRE_HEADER_SIZE + 10 + 3 * MAC_SIZE, len);
+  TEST_ASSERT_EQUAL(EncodedSize(&packet, NULL), len);
+  TEST_ASSERT_EQUAL(WIRE_VERSION, frame[WIRE_OFF_VERSION]);
+  TEST_ASSERT_TRUE(MessageView(frame, (int)len).Valid());
+  TEST_ASSERT_TRUE(DecodeMessage(frame, len, NULL, &decoded));
+  AssertSame(&packet, &decoded);
+}
+
+// Multi-byte fields are little-endian whatever the host
+static void test_little_endian_header(void) {
+  message_t packet;
+  uint8_t frame[WIRE_MAX_FRAME];
+  Sample(&packet);
+  size_t len = EncodeMessage(&packet, NULL, frame, sizeof(frame));
+  TEST_ASSERT_GREATER_THAN(0, len);
+  const uint8_t id[4] = {0x78, 0x56, 0x34, 0x12};
+  TEST_ASSERT_EQUAL_MEMORY(id, frame + WIRE_OFF_PACKET_ID, 4);
+  TEST_ASSERT_EQUAL(0xEF, frame[WIRE_OFF_SEQ]);
+  TEST_ASSERT_EQUAL(0xBE, frame[WIRE_OFF_SEQ + 1]);
+  MessageView view(frame, (int)len);
+  TEST_ASSERT_EQUAL(0x12345678, view.PacketID());
+  TEST_ASSERT_EQUAL(0xBEEF, view.Seq());
+}
+
+// Hops both ends know go as one byte each
+static void test_indexed_path(void) {
+  message_t packet, decoded;
+  uint8_t frame[WIRE_MAX_FRAME];
+  Sample(&packet);
+  size_t len = EncodeMessage(&packet, &table, frame, sizeof(frame));
+  TEST_ASSERT_EQUAL(WIRE_HEADER_SIZE + 10 + 3, len);
+  TEST_ASSERT_TRUE(frame[WIRE_OFF_FLAGS] & WIRE_FLAG_PATH_INDEXED);
+  TEST_ASSERT_TRUE(DecodeMessage(frame, len, &table, &decoded));
+  AssertSame(&packet, &decoded);
+
+  // Without the table, or with an index past it, the frame cannot be decoded
+  TEST_ASSERT_FALSE(DecodeMessage(frame, len, NULL, &decoded));
+  frame[WIRE_HEADER_SIZE + 10] = table.count;
+  TEST_ASSERT_FALSE(DecodeMessage(frame, len, &table, &decoded));
+}
+
+// One hop the table lacks sends the whole path as MACs
+static void test_unknown_hop_sends_macs(void) {
+  message_t packet, decoded;
+  uint8_t frame[WIRE_MAX_FRAME];
+  Sample(&packet);
+  memset(packet.Path_Array[2], 0x77, MAC_SIZE);
+  size_t len = EncodeMessage(&packet, &table, frame, sizeof(frame));
+  TEST_ASSERT_EQUAL(WIRE_HEADER_SIZE + 10 + 3 * MAC_SIZE, len);
+  TEST_ASSERT_FALSE(frame[WIRE_OFF_FLAGS] & WIRE_FLAG_PATH_INDEXED);
+  TEST_ASSERT_TRUE(DecodeMessage(frame, len, &table, &decoded));
+  AssertSame(&packet, &decoded);
+}
+
+static void test_ack_block(void) {
+  message_t packet, decoded;
+  uint8_t frame[WIRE_MAX_FRAME];
+  Sample(&packet);
+  packet.Data_Ack = true;
+  packet.Reliable = true;
+  packet.ack_seq = 0x0102;
+  packet.sack = 0xA0B0C0D0;
+  size_t len = EncodeMessage(&packet, NULL, frame, sizeof(frame));
+  TEST_ASSERT_EQUAL(WIRE_HEADER_SIZE + 10 + 3 * MAC_SIZE + WIRE_ACK_BLOCK_SIZE, len);
+  TEST_ASSERT_TRUE(DecodeMessage(frame, len, NULL, &decoded));
+  AssertSame(&packet, &decoded);
+}
+
+// A full text with a full path of MACs is the largest frame and still fits
+static void test_largest_frame(void) {
+  message_t packet, decoded;
+  uint8_t frame[WIRE_MAX_FRAME];
+  Sample(&packet);
+  memset(packet.text, 'x', WIRE_MAX_TEXT);
+  packet.Text_Length = WIRE_MAX_TEXT;
+  packet.Path_Length = MAX_NODES;
+  for(int i = 0; i < MAX_NODES; i++) {
+    memset(packet.Path_Array[i], 0x10 + i, MAC_SIZE);
+  }
+  size_t len = EncodeMessage(&packet, NULL, frame, sizeof(frame));
+  TEST_ASSERT_GREATER_THAN(0, len);
+  TEST_ASSERT_LESS_OR_EQUAL(WIRE_MAX_FRAME, len);
+  TEST_ASSERT_TRUE(DecodeMessage(frame, len, NULL, &decoded));
+  AssertSame(&packet, &decoded);
+
+  TEST_ASSERT_EQUAL(0, EncodeMessage(&packet, NULL, frame, len - 1)); // Does not fit cap
+  packet.Path_Length = MAX_NODES + 1;
+  TEST_ASSERT_EQUAL(0, EncodeMessage(&packet, NULL, frame, sizeof(frame)));
+}
+
+// Valid() holds the lengths in the header to the frame length
+static void test_view_rejects_malformed(void) {
+  message_t packet;
+  uint8_t frame[WIRE_MAX_FRAME + 1];
+  Sample(&packet);
+  int len = (int)EncodeMessage(&packet, NULL, frame, sizeof(frame));
+  TEST_ASSERT_TRUE(MessageView(frame, len).Valid());
+  TEST_ASSERT_FALSE(MessageView(NULL, len).Valid());
+  TEST_ASSERT_FALSE(MessageView(frame, len - 1).Valid()); // Truncated
+  TEST_ASSERT_FALSE(MessageView(frame, len + 1).Valid()); // Trailing byte
+  TEST_ASSERT_FALSE(MessageView(frame, WIRE_HEADER_SIZE - 1).Valid());
+
+  uint8_t bad[WIRE_MAX_FRAME];
+  memcpy(bad, frame, len);
+  bad[WIRE_OFF_VERSION] = WIRE_VERSION + 1;
+  TEST_ASSERT_FALSE(MessageView(bad, len).Valid());
+  memcpy(bad, frame, len);
+  bad[WIRE_OFF_PATH_LENGTH] = MAX_NODES + 1;
+  TEST_ASSERT_FALSE(MessageView(bad, len).Valid());
+  memcpy(bad, frame, len);
+  bad[WIRE_OFF_TEXT_LENGTH] = WIRE_MAX_TEXT + 1;
+  TEST_ASSERT_FALSE(MessageView(bad, len).Valid());
+  memcpy(bad, frame, len);
+  bad[WIRE_OFF_FLAGS] |= WIRE_FLAG_DATA_ACK | WIRE_FLAG_RELIABLE; // Claims an ack block it lacks
+  TEST_ASSERT_FALSE(MessageView(bad, len).Valid());
+
+  message_t decoded;
+  TEST_ASSERT_FALSE(DecodeMessage(bad, len, NULL, &decoded));
+}
+
+// Path_Index comes from the air and indexes Path_Array: past the path it is refused
+static void test_bad_path_index(void) {
+  message_t packet, decoded;
+  uint8_t frame[WIRE_MAX_FRAME];
+  Sample(&packet);
+  int len = (int)EncodeMessage(&packet, NULL, frame, sizeof(frame));
+
+  uint8_t bad[WIRE_MAX_FRAME];
+  const uint8_t indices[] = {200, 4, 0xFF};
+  for(size_t i = 0; i < sizeof(indices); i++) {
+    memcpy(bad, frame, len);
+    bad[WIRE_OFF_PATH_INDEX] = indices[i];
+    TEST_ASSERT_FALSE(MessageView(bad, len).Valid());
+    TEST_ASSERT_FALSE(DecodeMessage(bad, len, NULL, &decoded));
+  }
+  memcpy(bad, frame, len);
+  bad[WIRE_OFF_PATH_INDEX] = 3; // Just past the last hop, where the next one appends
+  TEST_ASSERT_TRUE(DecodeMessage(bad, len, NULL, &decoded));
+  TEST_ASSERT_EQUAL(3, decoded.Path_Index);
+
+  // A full path leaves no slot to append to
+  packet.Path_Length = MAX_NODES;
+  packet.Path_Index = MAX_NODES;
+  TEST_ASSERT_EQUAL(0, EncodeMessage(&packet, NULL, frame, sizeof(frame)));
+  packet.Path_Index = MAX_NODES - 1;
+  len = (int)EncodeMessage(&packet, NULL, frame, sizeof(frame));
+  TEST_ASSERT_GREATER_THAN(0, len);
+  frame[WIRE_OFF_PATH_INDEX] = MAX_NODES;
+  TEST_ASSERT_FALSE(MessageView(frame, len).Valid());
+
+  packet.Path_Length = 2;
+  packet.Path_Index = 3;
+  TEST_ASSERT_EQUAL(0, EncodeMessage(&packet, NULL, frame, sizeof(frame)));
+}
+
+// Random packets, with and without the node table, survive the round trip
+static void test_fuzz_round_trip(void) {
+  message_t packet, decoded;
+  uint8_t frame[WIRE_MAX_FRAME];
+  for(int n = 0; n < 20000; n++) {
+    bool known = n & 1;
+    RandomPacket(&packet, known);
+    const wire_node_table_t *with = known ? &table : NULL;
+    size_t len = EncodeMessage(&packet, with, frame, sizeof(frame));
+    if(len == 0) {
+      // Only a frame over the radio limit is refused
+      TEST_ASSERT_GREATER_THAN(WIRE_MAX_FRAME, EncodedSize(&packet, with));
+      continue;
+    }
+    TEST_ASSERT_EQUAL(EncodedSize(&packet, with), len);
+    TEST_ASSERT_TRUE(MessageView(frame, (int)len).Valid());
+    TEST_ASSERT_TRUE(DecodeMessage(frame, len, with, &decoded));
+    AssertSame(&packet, &decoded);
+  }
+}
+
+// Mutated frames: the view and the decoder agree, and whatever decodes encodes back
+// to a frame that decodes the same. Run under a sanitizer for out-of-bounds reads
+static void test_fuzz_mutations(void) {
+  message_t packet, decoded, again;
+  uint8_t frame[WIRE_MAX_FRAME];
+  uint8_t copy[WIRE_MAX_FRAME];
+  int accepted = 0;
+  for(int n = 0; n < 50000; n++) {
+    bool known = n & 1;
+    const wire_node_table_t *with = known ? &table : NULL;
+    RandomPacket(&packet, known);
+    size_t len = EncodeMessage(&packet, with, frame, sizeof(frame));
+    if(len == 0) {
+      continue;
+    }
+    // Flip bytes, and sometimes cut or extend the frame
+    int flips = 1 + Random() % 4;
+    for(int f = 0; f < flips; f++) {
+      frame[Random() % len] ^= (uint8_t)(1 + Random() % 255);
+    }
+    switch(Random() % 4) {
+      case 0: len = Random() % (len + 1); break;
+      case 1: len = len + Random() % (sizeof(frame) - len + 1); break;
+      default: break;
+    }
+
+    uint8_t *heap = new uint8_t[len > 0 ? len : 1]; // Exact size, so a sanitizer sees overreads
+    memcpy(heap, frame, len);
+    bool valid = MessageView(heap, (int)len).Valid();
+    bool ok = DecodeMessage(heap, len, with, &decoded);
+    delete[] heap;
+    TEST_ASSERT_TRUE(!ok || valid);
+    if(!ok) {
+      continue;
+    }
+    accepted++;
+    size_t again_len = EncodeMessage(&decoded, with, copy, sizeof(copy));
+    TEST_ASSERT_GREATER_THAN(0, again_len);
+    TEST_ASSERT_TRUE(DecodeMessage(copy, again_len, with, &again));
+    AssertSame(&decoded, &again);
+  }
+  TEST_ASSERT_GREATER_THAN(0, accepted);
+}
+
+// Arbitrary bytes of any length never decode out of bounds
+static void test_fuzz_random_bytes(void) {
+  message_t decoded;
+  for(int n = 0; n < 50000; n++) {
+    size_t len = Random() % (WIRE_MAX_FRAME + 8);
+    uint8_t *heap = new uint8_t[len > 0 ? len : 1];
+    for(size_t i = 0; i < len; i++) {
+      heap[i] = (uint8_t)Random();
+    }
+    if(len > WIRE_OFF_VERSION && Random() % 2) {
+      heap[WIRE_OFF_VERSION] = WIRE_VERSION;
+    }
+    bool valid = MessageView(heap, (int)len).Valid();
+    bool ok = DecodeMessage(heap, len, &table, &decoded);
+    delete[] heap;
+    TEST_ASSERT_TRUE(!ok || valid);
+  }
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_round_trip);
+  RUN_TEST(test_little_endian_header);
+  RUN_TEST(test_indexed_path);
+  RUN_TEST(test_unknown_hop_sends_macs);
+  RUN_TEST(test_ack_block);
+  RUN_TEST(test_largest_frame);
+  RUN_TEST(test_view_rejects_malformed);
+  RUN_TEST(test_bad_path_index);
+  RUN_TEST(test_fuzz_round_trip);
+  RUN_TEST(test_fuzz_mutations);
+  RUN_TEST(test_fuzz_random_bytes);
+  return UNITY_END();
+}